@@ -14,6 +14,9 @@
 BEGIN_NAMESPACE(math) 
 	class float4x4;END_NAMESPACE()
 
+BEGIN_NAMESPACE(io) 
+	class OutputStream;END_NAMESPACE()
+
 
 BEGIN_NAMESPACE(gr) 
 
@@ -203,6 +206,25 @@ public:
 	 */
 	virtual Texture*	createTexture( const NS(lang,String)& filename ) = 0;
 
+	/**
+	 * Creates context dependent texture from image file which has been already read to memory.
+	 * @param filename Image file name. Used if the texture needs to be reloaded.
+	 * @param data Image file data.
+	 * @param size Size of the image file data in bytes.
+	 * @exception GraphicsException
+	 */
+	virtual Texture*	createTexture( const NS(lang,String)& filename, const void* data, int size ) = 0;
+
+	/**
+	 * Writes texture in platform dependent decoded form. The data can be
+	 * passed later to createTexture(filename,data,size) to create the texture
+	 * without decoding the original image file again.
+	 * Default implementation does nothing.
+	 * @return false if the platform does not support decoded texture data.
+	 * @exception IOException
+	 */
+	virtual bool		writeDecodedTexture( Texture* tex, NS(io,OutputStream)* out );
+
 	/**
 	 * Creates context dependent cube texture from image file.
 	 * @param filename Image file name.
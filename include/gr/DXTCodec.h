@@ -0,0 +1,98 @@
+#ifndef _GR_DXTCODEC_H
+#define _GR_DXTCODEC_H
+
+
+#include <gr/SurfaceFormat.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(gr)
+
+
+/**
+ * CPU encoder and decoder for DXT1/DXT3/DXT5 block-compressed pixel data.
+ * Compressed data consists of 4x4 pixel blocks (8 bytes per block
+ * in DXT1, 16 bytes in DXT3 and DXT5). Surface pitch of compressed data
+ * is distance between rows of blocks in bytes. Uncompressed data
+ * is always in A8R8G8B8 format.
+ *
+ * Color endpoints are selected either by range fit (endpoints from extremes
+ * along principal axis of the block colors, refined once with least squares)
+ * or by cluster fit (best ordering of the colors along principal axis
+ * to four clusters, as in Simon Brown's squish library). Cluster fit
+ * is over ten times slower but gives lower error.
+ * DXT1 blocks with alpha below 128 are encoded in 3-color mode with
+ * transparent pixels.
+ *
+ * SurfaceFormat::copyPixels uses range fit when converting to
+ * compressed format.
+ *
+ * @ingroup gr
+ */
+class DXTCodec
+{
+public:
+	/**
+	 * Color endpoint selection method.
+	 */
+	enum Quality
+	{
+		/** Endpoints from extremes along principal axis. */
+		QUALITY_RANGEFIT,
+		/** Exhaustive search of color clusters along principal axis. */
+		QUALITY_CLUSTERFIT,
+	};
+
+	/**
+	 * Compresses rectangle of A8R8G8B8 pixels.
+	 * Partial blocks at the right and bottom edges are padded by repeating edge pixels.
+	 * @param dst Destination block data.
+	 * @param dstpitch Distance between rows of blocks in bytes.
+	 * @param fmt Destination format, DXT1, DXT3 or DXT5.
+	 * @param src Source pixels.
+	 * @param srcpitch Distance between source pixel rows in bytes.
+	 * @param width Width of the rectangle in pixels.
+	 * @param height Height of the rectangle in pixels.
+	 * @param quality Color endpoint selection method.
+	 */
+	static void		compress( void* dst, int dstpitch, SurfaceFormat fmt,
+						const uint32_t* src, int srcpitch, int width, int height,
+						Quality quality=QUALITY_RANGEFIT );
+
+	/**
+	 * Decompresses rectangle of blocks to A8R8G8B8 pixels.
+	 * @param dst Destination pixels.
+	 * @param dstpitch Distance between destination pixel rows in bytes.
+	 * @param fmt Source format, DXT1, DXT3 or DXT5.
+	 * @param src Source block data.
+	 * @param srcpitch Distance between rows of blocks in bytes.
+	 * @param width Width of the rectangle in pixels.
+	 * @param height Height of the rectangle in pixels.
+	 */
+	static void		decompress( uint32_t* dst, int dstpitch, SurfaceFormat fmt,
+						const void* src, int srcpitch, int width, int height );
+
+	/**
+	 * Compresses single block of 4x4 A8R8G8B8 pixels stored row by row.
+	 */
+	static void		compressBlock( const uint32_t* argb, SurfaceFormat fmt, void* block,
+						Quality quality=QUALITY_RANGEFIT );
+
+	/**
+	 * Decompresses single block to 4x4 A8R8G8B8 pixels stored row by row.
+	 */
+	static void		decompressBlock( const void* block, SurfaceFormat fmt, uint32_t* argb );
+
+	/**
+	 * Returns size of compressed block in bytes.
+	 */
+	static int		blockSize( SurfaceFormat fmt );
+};
+
+
+END_NAMESPACE() // gr
+
+
+#endif // _GR_DXTCODEC_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
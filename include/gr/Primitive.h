@@ -274,6 +274,23 @@ public:
 	 */
 	virtual void	getIndexDataPtr( uint16_t** data, int* indexsize ) = 0;
 
+	/**
+	 * Returns pointer to the beginning of vertex data and
+	 * number of bytes spanned by data of all vertex components.
+	 * Primitive needs to be locked before calling this method.
+	 * WARNING: Low level operation, better to use getVertexPositions etc. methods.
+	 */
+	void			getVertexDataRange( uint8_t** data, int* size );
+
+	/**
+	 * Shares vertex and index buffers of other primitive instead of own buffers.
+	 * Other primitive must have same type, vertex format, vertex and index count,
+	 * and both must be static. Shared data should not be modified afterwards.
+	 * Shader, scale/bias, bound and used bones are not shared.
+	 * @exception GraphicsException
+	 */
+	virtual void	shareBuffers( Primitive* other ) = 0;
+
 	/**
 	 * Sets range of vertices used in rendering.
 	 * Range must be below maximum vertex count specified in object creation.
@@ -367,6 +384,11 @@ public:
 	 */
 	virtual const VertexFormat&	vertexFormat() const = 0;
 
+	/**
+	 * Returns approximate number of bytes of vertex and index data used by this primitive.
+	 */
+	virtual int		memoryUsed() const;
+
 	/**
 	 * Gets vertex position coordinates.
 	 * Primitive needs to be locked for reading before calling this method.
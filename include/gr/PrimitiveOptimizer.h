@@ -0,0 +1,145 @@
+#ifndef _GR_PRIMITIVEOPTIMIZER_H
+#define _GR_PRIMITIVEOPTIMIZER_H
+
+
+#include <lang/pp.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(math)
+	class float4;END_NAMESPACE()
+
+
+BEGIN_NAMESPACE(gr)
+
+
+class Primitive;
+
+
+/**
+ * Re-orders indexed triangle list primitive data for better rendering performance.
+ * Optimization is done in three passes:
+ * <ol>
+ * <li>Triangles are re-ordered for post-transform vertex cache (Forsyth's linear-speed algorithm).
+ * <li>Cache optimized triangle list is divided to clusters which are sorted
+ *     outside-in to reduce overdraw (Sander, Nehab, Barczak 2007).
+ * <li>Vertices are re-ordered to the order they are first referenced by
+ *     the index data to make vertex fetch linear.
+ * </ol>
+ * Optimization changes only order of triangles and vertices inside the primitive
+ * so used bone list of the primitive (see Primitive::usedBoneArray) stays valid.
+ * Cache efficiency is measured by average cache miss ratio (ACMR, transformed
+ * vertices per triangle) and average transform to vertex ratio (ATVR, transformed
+ * vertices per vertex) using FIFO cache simulation.
+ * @ingroup gr
+ */
+class PrimitiveOptimizer
+{
+public:
+	enum
+	{
+		/** Default FIFO cache size used in cache simulation. */
+		DEFAULT_CACHE_SIZE = 16,
+		/** Maximum cache size supported in cache simulation. */
+		MAX_CACHE_SIZE = 32,
+	};
+
+	/**
+	 * Optimization results.
+	 */
+	struct Statistics
+	{
+		/** Number of optimized primitives. */
+		int		primitives;
+		/** Number of triangles in optimized primitives. */
+		int		triangles;
+		/** Number of vertices in optimized primitives. */
+		int		vertices;
+		/** Number of transformed vertices before optimization. */
+		int		transformsBefore;
+		/** Number of transformed vertices after optimization. */
+		int		transformsAfter;
+
+		Statistics();
+
+		/** Average cache miss ratio before optimization. */
+		float	acmrBefore() const;
+
+		/** Average cache miss ratio after optimization. */
+		float	acmrAfter() const;
+
+		/** Average transform to vertex ratio before optimization. */
+		float	atvrBefore() const;
+
+		/** Average transform to vertex ratio after optimization. */
+		float	atvrAfter() const;
+	};
+
+	/**
+	 * Optimizes triangle and vertex order of indexed triangle list primitive.
+	 * Other primitive types are left untouched.
+	 * Primitive needs to be locked for reading and writing before calling this method.
+	 * @param prim Primitive to optimize.
+	 * @param stats [in/out] If not 0 then optimization results are accumulated to this.
+	 * @param cachesize Size of simulated FIFO cache used in measurements and overdraw optimization.
+	 */
+	static void		optimize( Primitive* prim, Statistics* stats=0, int cachesize=DEFAULT_CACHE_SIZE );
+
+	/**
+	 * Re-orders triangles for post-transform vertex cache.
+	 * @param indices [in/out] Triangle list indices.
+	 * @param indexcount Number of indices.
+	 * @param vertexcount Number of vertices referenced by the indices.
+	 */
+	static void		optimizeVertexCache( uint16_t* indices, int indexcount, int vertexcount );
+
+	/**
+	 * Re-orders clusters of vertex cache optimized triangle list to reduce overdraw.
+	 * @param indices [in/out] Triangle list indices.
+	 * @param indexcount Number of indices.
+	 * @param positions Vertex positions.
+	 * @param vertexcount Number of vertices.
+	 * @param cachesize Size of simulated FIFO cache.
+	 * @param threshold Maximum allowed ACMR increase, for example 1.05 allows 5% increase.
+	 */
+	static void		optimizeOverdraw( uint16_t* indices, int indexcount,
+						const NS(math,float4)* positions, int vertexcount,
+						int cachesize=DEFAULT_CACHE_SIZE, float threshold=1.05f );
+
+	/**
+	 * Computes vertex remapping which orders vertices in the order
+	 * they are first referenced by the index data. Unreferenced
+	 * vertices are placed last. Index data is remapped as well.
+	 * @param indices [in/out] Triangle list indices.
+	 * @param indexcount Number of indices.
+	 * @param vertexcount Number of vertices.
+	 * @param remap [out] Receives new index for each old vertex. Size must be vertexcount.
+	 */
+	static void		optimizeVertexFetch( uint16_t* indices, int indexcount, int vertexcount, uint16_t* remap );
+
+	/**
+	 * Returns number of vertex transforms needed to render the triangle list
+	 * using FIFO cache of specified size.
+	 */
+	static int		getTransformCount( const uint16_t* indices, int indexcount, int vertexcount, int cachesize=DEFAULT_CACHE_SIZE );
+
+	/**
+	 * Returns average cache miss ratio (transformed vertices per triangle) of the triangle list.
+	 * 0.5 is the theoretical optimum on regular grids, 3 is the worst case.
+	 */
+	static float	getACMR( const uint16_t* indices, int indexcount, int vertexcount, int cachesize=DEFAULT_CACHE_SIZE );
+
+	/**
+	 * Returns average transform to vertex ratio of the triangle list.
+	 * 1 is the optimum.
+	 */
+	static float	getATVR( const uint16_t* indices, int indexcount, int vertexcount, int cachesize=DEFAULT_CACHE_SIZE );
+};
+
+
+END_NAMESPACE() // gr
+
+
+#endif // _GR_PRIMITIVEOPTIMIZER_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -203,7 +203,9 @@ public:
 
 	/** 
 	 * Copies rectangle of pixels from one surface pixel format to another.
-	 * Supports also DXT-compressed formats as source data.
+	 * Supports also DXT-compressed formats as source and destination data.
+	 * Pitch of compressed data is distance between rows of 4x4 blocks.
+	 * Compression uses DXTCodec range fit.
 	 */
 	void		copyPixels( void* dst, int dstpitch, const SurfaceFormat& dstpalfmt, const void* dstpal,
 					const SurfaceFormat& srcfmt, const void* src, int srcpitch, const SurfaceFormat& srcpalfmt, const void* srcpal,
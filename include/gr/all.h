@@ -36,9 +36,11 @@
 #include <gr/Rect.h>
 #include <gr/Context.h>
 #include <gr/ContextObject.h>
+#include <gr/DXTCodec.h>
 #include <gr/GraphicsException.h>
 #include <gr/Palette.h>
 #include <gr/Primitive.h>
+#include <gr/PrimitiveOptimizer.h>
 #include <gr/Shader.h>
 #include <gr/SurfaceFormat.h>
 #include <gr/Texture.h>
@@ -138,6 +138,21 @@ public:
 	 */
 	Texture*	createTexture( const NS(lang,String)& filename );
 
+	/**
+	 * Creates context dependent texture from image file which has been already read to memory.
+	 * @param filename Image file name. Used if the texture needs to be reloaded.
+	 * @param data Image file data.
+	 * @param size Size of the image file data in bytes.
+	 * @exception GraphicsException
+	 */
+	Texture*	createTexture( const NS(lang,String)& filename, const void* data, int size );
+
+	/**
+	 * Writes texture as DDS file data, including all mipmap levels.
+	 * @exception IOException
+	 */
+	bool		writeDecodedTexture( Texture* tex, NS(io,OutputStream)* out );
+
 	/**
 	 * Creates context dependent cube texture from image file.
 	 * @param filename Image file name.
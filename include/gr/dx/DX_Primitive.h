@@ -58,6 +58,12 @@ public:
 	 */
 	void	getIndexDataPtr( uint16_t** data, int* indexsize );
 
+	/**
+	 * Shares vertex and index buffers of other primitive instead of own buffers.
+	 * @exception GraphicsException
+	 */
+	void	shareBuffers( Primitive* other );
+
 	/**
 	 * Sets shader to be used while rendering the primitive.
 	 */
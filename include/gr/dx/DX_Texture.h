@@ -34,6 +34,12 @@ public:
 	 */
 	explicit DX_Texture( DX_Context* context, const NS(lang,String)& filename );
 
+	/**
+	 * Initializes the texture from image file data in memory.
+	 * Texture is reloaded from the file after device reset.
+	 */
+	DX_Texture( DX_Context* context, const NS(lang,String)& filename, const void* data, int size );
+
 	///
 	~DX_Texture();
 
@@ -138,6 +144,7 @@ private:
 	LockType			m_locked;
 
 	void	create( const NS(lang,String)& filename );
+	void	create( const NS(lang,String)& filename, const void* data, int size );
 	void	create( int width, int height, const SurfaceFormat& fmt, int usageflags );
 	void	validateDesc( const NS(lang,String)& filename, int usageflags );
 
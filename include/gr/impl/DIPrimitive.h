@@ -6,6 +6,7 @@
 #include <gr/VertexFormat.h>
 #include <gr/impl/SortBuffer.h>
 #include <math/float4.h>
+#include <math/float4x4.h>
 #include <lang/Array.h>
 
 
@@ -185,6 +186,9 @@ public:
 	/**
 	 * Sorts primitive polygons front-to-back order.
 	 * Primitive needs to be locked for reading and writing before calling this method.
+	 * Sorting of non-skinned primitive is skipped if the primitive was already
+	 * sorted to the same order with the same transform and the reference point
+	 * has moved only a little relative to its distance from the primitive.
 	 * Note: If the primitive does not contain triangles, then this method
 	 * does might leave buffer well-defined state.
 	 * @param refpos World space origin to use for sorting.
@@ -200,6 +204,9 @@ public:
 	/**
 	 * Sorts primitive polygons back-to-front order.
 	 * Primitive needs to be locked for reading and writing before calling this method.
+	 * Sorting of non-skinned primitive is skipped if the primitive was already
+	 * sorted to the same order with the same transform and the reference point
+	 * has moved only a little relative to its distance from the primitive.
 	 * Note: If the primitive does not contain triangles, then this method
 	 * does might leave buffer well-defined state.
 	 * @param refpos World space origin to use for sorting.
@@ -379,7 +386,7 @@ public:
 	int		indices() const;
 
 	/**
-	 * Returns number of bytes of heap memory allocated by this primitive.
+	 * Returns number of bytes of heap memory allocated by this primitive. (from Primitive)
 	 */
 	int		memoryUsed() const;
 
@@ -475,18 +482,23 @@ public:
 	/**
 	 * Returns distances of individual triangle (in world space) to specified world space point.
 	 * Distance is computed from triangle center.
+	 * Each vertex is transformed to world space only once, so the
+	 * function needs temporary buffers for vertex positions.
 	 * Assumes that the primitive is locked for reading before calling this method.
 	 * @see NS(ContextObject,Lock)
 	 * @param worldpos World space reference point.
-	 * @param worldtm World transform (if any).
 	 * @param worldtm Model-to-world transform if any.
 	 * @param boneworldtm Bone-to-world transforms if any.
 	 * @param boneworldtmcount Number of bone-to-world transforms.
 	 * @param trix [out] Receives triangle indices from 0 to n.
  	 * @param tridist [out] Receives squared triangle center distances to specified world space point.
 	 * @param tricount Number of triangles in primitive.
+	 * @param vx [out] Receives world space vertex x-coordinates. Size must be at least number of vertices.
+	 * @param vy [out] Receives world space vertex y-coordinates. Size must be at least number of vertices.
+	 * @param vz [out] Receives world space vertex z-coordinates. Size must be at least number of vertices.
 	 */
-	void	getTriangleDistances( const NS(math,float3)& worldpos, const NS(math,float4x4)& worldtm, const NS(math,float4x4)* boneworldtm, int boneworldtmcount, uint16_t* trix, float* tridist, int tricount ) const;
+	void	getTriangleDistances( const NS(math,float3)& worldpos, const NS(math,float4x4)& worldtm, const NS(math,float4x4)* boneworldtm, int boneworldtmcount, uint16_t* trix, float* tridist, int tricount,
+				float* vx, float* vy, float* vz ) const;
 
 	/**
 	 * Computers axis aligned bounding box center point of the primitive.
@@ -560,6 +572,23 @@ protected:
 private:
 	enum { BUFFER_HEADER_SIZE = ((VertexFormat::DT_SIZE+1)*4+15&~15) };
 
+	/** Order of triangles after last distance sort. */
+	enum SortedOrder
+	{
+		SORTED_NONE,
+		SORTED_FRONTTOBACK,
+		SORTED_BACKTOFRONT
+	};
+
+	enum
+	{
+		/** Max average element moves per triangle in incremental re-sort before falling back to full sort. */
+		SORT_COHERENCE_MAX_MOVES = 4
+	};
+
+	/** Max reference point movement (relative to distance) which keeps previous sort order. */
+	static const float		SORT_COHERENCE_THRESHOLD;
+
 	/** 
 	 * Default data buffer or 0 if not used. 
 	 * One buffer for each vertex component, 0 allowed if component not exist. 
@@ -582,6 +611,9 @@ private:
 	int						m_indexRangeEnd;
 	NS(gr,VertexFormat)		m_vf;
 	uint8_t					m_usedBones;
+	uint8_t					m_sorted;
+	NS(math,float3)			m_sortRefPos;
+	NS(math,float4x4)		m_sortWorldTm;
 
 	/** Allocates device vertex buffer. */
 	virtual void	allocate( const VertexFormat& vf, int vertices, int indices );
@@ -601,6 +633,20 @@ private:
 	 */
 	void			reorderTriangles( const uint16_t* order, uint16_t* buffer );
 
+	/**
+	 * Sorts triangles by distance to reference point.
+	 * Uses previous order as starting point if the primitive was sorted to the same order last time.
+	 */
+	void			sortByDistance( SortedOrder order, const NS(math,float3)& refpos, const NS(math,float4x4)& worldtm,
+						const NS(math,float4x4)* boneworldtm, int boneworldtmcount, SortBuffer& tmp );
+
+	/**
+	 * Transforms (or skins) all vertex positions to world space.
+	 * Output is stored in separate x, y and z arrays.
+	 */
+	void			transformVertexPositions( const NS(math,float4x4)& worldtm, const NS(math,float4x4)* boneworldtm, int boneworldtmcount,
+						float* vx, float* vy, float* vz ) const;
+
 	/** Returns number of bytes used by vertex data. */
 	int				vertexDataSize() const;
 };
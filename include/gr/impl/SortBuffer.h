@@ -47,15 +47,28 @@ public:
 	SortBuffer();
 	~SortBuffer();
 
-	void reset( int intbuffersize, int floatbuffersize );
+	/**
+	 * Resizes buffers.
+	 * @param intbuffersize Number of 16-bit integers in intBuffer().
+	 * @param floatbuffersize Number of floats in floatBuffer().
+	 * @param vertexbuffersize Number of vertices in vertexBuffer(X/Y/Z).
+	 */
+	void reset( int intbuffersize, int floatbuffersize, int vertexbuffersize=0 );
 
 	uint16_t*	intBuffer()			{return m_intBuffer;}
 	float*		floatBuffer()		{return m_floatBuffer;}
 
+	/** Returns x-components of temporary vertex positions. y and z components follow in separate arrays. */
+	float*		vertexBufferX()		{return m_vertexBuffer;}
+	float*		vertexBufferY()		{return m_vertexBuffer+m_vertexBufferSize;}
+	float*		vertexBufferZ()		{return m_vertexBuffer+m_vertexBufferSize*2;}
+
 private:
 	NS(lang,Array)<uint8_t>	m_buf;
 	uint16_t*				m_intBuffer;
 	float*					m_floatBuffer;
+	float*					m_vertexBuffer;
+	int						m_vertexBufferSize;
 
 	SortBuffer( const SortBuffer& );
 	SortBuffer& operator=( const SortBuffer& );
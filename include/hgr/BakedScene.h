@@ -0,0 +1,453 @@
+#ifndef _HGR_BAKEDSCENE_H
+#define _HGR_BAKEDSCENE_H
+
+
+#include <io/InputStream.h>
+#include <io/OutputStream.h>
+#include <lang/Array.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+/**
+ * Relocatable memory image of a fully linked scene.
+ *
+ * Baked scene contains node table, transforms, bone bindings,
+ * light assignments, materials, animation keys and vertex/index data
+ * in final layout, so that SceneLoader can create the scene
+ * from the image without parsing and validating it field by field.
+ * Records refer to each other by table index and to strings
+ * and data blobs by byte offset. When the image is read, the tables
+ * are located with a single pass over the image header.
+ *
+ * Image is stored in native byte order and vertex data in device
+ * layout, so baked scenes are specific to the platform they were baked on.
+ * Baked scenes are created with SceneLoader::bake() and written
+ * to hgr files with DATA_BAKED flag.
+ *
+ * @ingroup hgr
+ */
+class BakedScene :
+	public NS(lang,Object)
+{
+public:
+	enum Constants
+	{
+		/** Image identifier, also used to detect byte order mismatch. */
+		MAGIC			= 0x68676230,
+		/** Alignment of data blobs in bytes. */
+		DATA_ALIGNMENT	= 16,
+		/** Maximum number of vertex data types in a primitive record. */
+		MAX_DATA_TYPES	= 16,
+		/** Maximum number of bones in a primitive record. */
+		MAX_BONES		= 256,
+	};
+
+	/** Material parameter types. */
+	enum ParamType
+	{
+		PARAM_TEXTURE,
+		PARAM_VECTOR,
+		PARAM_FLOAT,
+	};
+
+	/** Location of a table in the image. */
+	struct Table
+	{
+		uint32_t	offset;
+		uint32_t	count;
+	};
+
+	/** Texture file name relative to texture path. */
+	struct Texture
+	{
+		uint32_t	filename;
+		int32_t		type;
+	};
+
+	/** Material parameter. */
+	struct Param
+	{
+		uint32_t	name;
+		int32_t		type;
+		int32_t		texture;
+		float		value[4];
+	};
+
+	/** Material, parameters are stored in consecutive Param records. */
+	struct Material
+	{
+		uint32_t	name;
+		uint32_t	shader;
+		int32_t		flags;
+		int32_t		firstParam;
+		int32_t		params;
+	};
+
+	/** Primitive with vertex and index data in device layout. */
+	struct Primitive
+	{
+		int32_t		type;
+		int32_t		material;
+		int32_t		vertices;
+		int32_t		indices;
+		uint8_t		dataFormat[MAX_DATA_TYPES];
+		float		posScaleBias[4];
+		float		uvScaleBias[4];
+		float		boundMin[3];
+		float		boundMax[3];
+		float		boundRadius;
+		int32_t		vertexSize;
+		int32_t		vertexDataSize;
+		uint32_t	vertexData;
+		uint32_t	indexData;
+		int32_t		usedBones;
+		uint8_t		usedBoneArray[MAX_BONES];
+	};
+
+	/** Scene node. Data is index to class specific table or -1. */
+	struct Node
+	{
+		int32_t		classId;
+		uint32_t	name;
+		int32_t		parent;
+		int32_t		flags;
+		int32_t		id;
+		int32_t		data;
+		float		transform[12];
+	};
+
+	/** Mesh primitives (indices to MeshPrimitive table), bones and assigned light node or -1. */
+	struct Mesh
+	{
+		int32_t		firstPrimitive;
+		int32_t		primitives;
+		int32_t		firstBone;
+		int32_t		bones;
+		int32_t		light;
+	};
+
+	/** Bone node index and inverse rest transform. */
+	struct Bone
+	{
+		int32_t		node;
+		float		invRestTransform[12];
+	};
+
+	/** Camera parameters. */
+	struct Camera
+	{
+		float		front;
+		float		back;
+		float		verticalFov;
+	};
+
+	/** Light parameters. */
+	struct Light
+	{
+		float		color[3];
+		float		farAttenStart;
+		float		farAttenEnd;
+		float		innerCone;
+		float		outerCone;
+		int32_t		type;
+	};
+
+	/** Dummy box. */
+	struct Dummy
+	{
+		float		boxMin[3];
+		float		boxMax[3];
+	};
+
+	/** Lines object, line segments and paths are stored in consecutive records. */
+	struct Lines
+	{
+		int32_t		firstLine;
+		int32_t		lines;
+		int32_t		firstPath;
+		int32_t		paths;
+	};
+
+	/** Line segment. */
+	struct Line
+	{
+		float		start[3];
+		float		end[3];
+	};
+
+	/** Lines path. */
+	struct Path
+	{
+		int32_t		begin;
+		int32_t		end;
+	};
+
+	/**
+	 * Key data of an animation channel. Keyframe sequences have
+	 * data format, scale and bias, optimized position/scale channels
+	 * are float4 arrays. Missing channel has -1 keys.
+	 */
+	struct Track
+	{
+		int32_t		keys;
+		int32_t		format;
+		float		scale;
+		float		bias[4];
+		uint32_t	data;
+	};
+
+	/** Transform animation. Node is index of the node with the same name or -1. */
+	struct Animation
+	{
+		uint32_t	name;
+		int32_t		node;
+		int32_t		endBehaviour;
+		int32_t		posKeyRate;
+		int32_t		rotKeyRate;
+		int32_t		sclKeyRate;
+		int32_t		optimized;
+		float		endTime;
+		Track		pos;
+		Track		rot;
+		Track		scl;
+	};
+
+	/** User property string pair. Node is index of the node named by the key or -1. */
+	struct UserProperty
+	{
+		uint32_t	key;
+		int32_t		node;
+		uint32_t	value;
+	};
+
+	/** Image header. */
+	struct Header
+	{
+		uint32_t	magic;
+		uint32_t	size;
+		int32_t		fogType;
+		float		fogStart;
+		float		fogEnd;
+		float		fogColor[3];
+		Table		strings;
+		Table		data;
+		Table		textures;
+		Table		params;
+		Table		materials;
+		Table		primitives;
+		Table		meshPrimitives;
+		Table		nodes;
+		Table		meshes;
+		Table		bones;
+		Table		cameras;
+		Table		lights;
+		Table		dummies;
+		Table		lines;
+		Table		linePoints;
+		Table		paths;
+		Table		animations;
+		Table		userProperties;
+	};
+
+	/**
+	 * Creates empty image to be filled with add methods.
+	 */
+	BakedScene();
+
+	/**
+	 * Reads image from the stream and locates its tables.
+	 * @param in Input stream to read from.
+	 * @param size Number of bytes in the image.
+	 * @exception IOException
+	 */
+	BakedScene( NS(io,InputStream)* in, int size );
+
+	///
+	~BakedScene();
+
+	/** Returns image header, fog parameters can be set directly. */
+	Header&				header()										{return m_header;}
+
+	/** Adds zero-terminated string to the image and returns its offset. Identical strings are stored once. */
+	uint32_t			addString( const char* str );
+
+	/** Adds data blob to the image and returns its offset. */
+	uint32_t			addData( const void* data, int size );
+
+	/** Adds record and returns its index. */
+	int					addTexture( const Texture& rec )				{m_textures.add(rec); return m_textures.size()-1;}
+	/** Adds record and returns its index. */
+	int					addParam( const Param& rec )					{m_params.add(rec); return m_params.size()-1;}
+	/** Adds record and returns its index. */
+	int					addMaterial( const Material& rec )				{m_materials.add(rec); return m_materials.size()-1;}
+	/** Adds record and returns its index. */
+	int					addPrimitive( const Primitive& rec )			{m_primitives.add(rec); return m_primitives.size()-1;}
+	/** Adds record and returns its index. */
+	int					addMeshPrimitive( int primitive )				{m_meshPrimitives.add(primitive); return m_meshPrimitives.size()-1;}
+	/** Adds record and returns its index. */
+	int					addNode( const Node& rec )						{m_nodes.add(rec); return m_nodes.size()-1;}
+	/** Adds record and returns its index. */
+	int					addMesh( const Mesh& rec )						{m_meshes.add(rec); return m_meshes.size()-1;}
+	/** Adds record and returns its index. */
+	int					addBone( const Bone& rec )						{m_bones.add(rec); return m_bones.size()-1;}
+	/** Adds record and returns its index. */
+	int					addCamera( const Camera& rec )					{m_cameras.add(rec); return m_cameras.size()-1;}
+	/** Adds record and returns its index. */
+	int					addLight( const Light& rec )					{m_lights.add(rec); return m_lights.size()-1;}
+	/** Adds record and returns its index. */
+	int					addDummy( const Dummy& rec )					{m_dummies.add(rec); return m_dummies.size()-1;}
+	/** Adds record and returns its index. */
+	int					addLines( const Lines& rec )					{m_lines.add(rec); return m_lines.size()-1;}
+	/** Adds record and returns its index. */
+	int					addLine( const Line& rec )						{m_linePoints.add(rec); return m_linePoints.size()-1;}
+	/** Adds record and returns its index. */
+	int					addPath( const Path& rec )						{m_paths.add(rec); return m_paths.size()-1;}
+	/** Adds record and returns its index. */
+	int					addAnimation( const Animation& rec )			{m_animations.add(rec); return m_animations.size()-1;}
+	/** Adds record and returns its index. */
+	int					addUserProperty( const UserProperty& rec )		{m_userProperties.add(rec); return m_userProperties.size()-1;}
+
+	/**
+	 * Computes locations of the tables in the image.
+	 * @return Size of the image in bytes.
+	 */
+	int					layout();
+
+	/**
+	 * Lays out the image and writes it to the stream.
+	 * @return Number of bytes written.
+	 * @exception IOException
+	 */
+	int					write( NS(io,OutputStream)* out );
+
+	/** Returns table of records read from the image. */
+	const Texture*		textures() const								{return m_textureTable;}
+	/** Returns table of records read from the image. */
+	const Param*		params() const									{return m_paramTable;}
+	/** Returns table of records read from the image. */
+	const Material*		materials() const								{return m_materialTable;}
+	/** Returns table of records read from the image. */
+	const Primitive*	primitives() const								{return m_primitiveTable;}
+	/** Returns table of records read from the image. */
+	const int32_t*		meshPrimitives() const							{return m_meshPrimitiveTable;}
+	/** Returns table of records read from the image. */
+	const Node*			nodes() const									{return m_nodeTable;}
+	/** Returns table of records read from the image. */
+	const Mesh*			meshes() const									{return m_meshTable;}
+	/** Returns table of records read from the image. */
+	const Bone*			bones() const									{return m_boneTable;}
+	/** Returns table of records read from the image. */
+	const Camera*		cameras() const									{return m_cameraTable;}
+	/** Returns table of records read from the image. */
+	const Light*		lights() const									{return m_lightTable;}
+	/** Returns table of records read from the image. */
+	const Dummy*		dummies() const									{return m_dummyTable;}
+	/** Returns table of records read from the image. */
+	const Lines*		lines() const									{return m_linesTable;}
+	/** Returns table of records read from the image. */
+	const Line*			linePoints() const								{return m_lineTable;}
+	/** Returns table of records read from the image. */
+	const Path*			paths() const									{return m_pathTable;}
+	/** Returns table of records read from the image. */
+	const Animation*	animations() const								{return m_animationTable;}
+	/** Returns table of records read from the image. */
+	const UserProperty*	userProperties() const							{return m_userPropertyTable;}
+
+	/**
+	 * Returns string at specified offset of the string table.
+	 * @exception IOException
+	 */
+	const char*			getString( uint32_t offset ) const;
+
+	/**
+	 * Returns data blob at specified offset of the data table.
+	 * @exception IOException
+	 */
+	const void*			getData( uint32_t offset, int size ) const;
+
+	/**
+	 * Checks that a record index read from the image is valid.
+	 * @exception IOException
+	 */
+	void				checkIndex( int index, uint32_t count ) const;
+
+	/**
+	 * Checks that a range of records read from the image is valid.
+	 * @exception IOException
+	 */
+	void				checkRange( int first, int count, uint32_t size ) const;
+
+private:
+	enum { MAX_BLOCKS = 20 };
+
+	struct Block
+	{
+		const Table*	table;
+		const void*		data;
+		int				recordsize;
+		int				count;
+	};
+
+	Header								m_header;
+	NS(lang,Array)<uint8_t>				m_image;
+
+	// image being built
+	NS(lang,Array)<char>				m_strings;
+	NS(lang,Array)<uint32_t>			m_stringOffsets;
+	NS(lang,Array)<uint8_t>				m_data;
+	NS(lang,Array)<Texture>				m_textures;
+	NS(lang,Array)<Param>				m_params;
+	NS(lang,Array)<Material>			m_materials;
+	NS(lang,Array)<Primitive>			m_primitives;
+	NS(lang,Array)<int32_t>				m_meshPrimitives;
+	NS(lang,Array)<Node>				m_nodes;
+	NS(lang,Array)<Mesh>				m_meshes;
+	NS(lang,Array)<Bone>				m_bones;
+	NS(lang,Array)<Camera>				m_cameras;
+	NS(lang,Array)<Light>				m_lights;
+	NS(lang,Array)<Dummy>				m_dummies;
+	NS(lang,Array)<Lines>				m_lines;
+	NS(lang,Array)<Line>				m_linePoints;
+	NS(lang,Array)<Path>				m_paths;
+	NS(lang,Array)<Animation>			m_animations;
+	NS(lang,Array)<UserProperty>		m_userProperties;
+
+	// tables located in read image
+	const char*							m_stringTable;
+	const uint8_t*						m_dataTable;
+	const Texture*						m_textureTable;
+	const Param*						m_paramTable;
+	const Material*						m_materialTable;
+	const Primitive*					m_primitiveTable;
+	const int32_t*						m_meshPrimitiveTable;
+	const Node*							m_nodeTable;
+	const Mesh*							m_meshTable;
+	const Bone*							m_boneTable;
+	const Camera*						m_cameraTable;
+	const Light*						m_lightTable;
+	const Dummy*						m_dummyTable;
+	const Lines*						m_linesTable;
+	const Line*							m_lineTable;
+	const Path*							m_pathTable;
+	const Animation*					m_animationTable;
+	const UserProperty*					m_userPropertyTable;
+
+	void	defaults();
+	int		getBlocks( Block* blocks ) const;
+	void	relocate();
+	const void*	locate( const Table& table, int recordsize ) const;
+
+	BakedScene( const BakedScene& );
+	BakedScene& operator=( const BakedScene& );
+};
+
+
+END_NAMESPACE() // hgr
+
+
+#endif // _HGR_BAKEDSCENE_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
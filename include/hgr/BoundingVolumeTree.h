@@ -0,0 +1,129 @@
+#ifndef _HGR_BOUNDINGVOLUMETREE_H
+#define _HGR_BOUNDINGVOLUMETREE_H
+
+
+#include <lang/Array.h>
+#include <math/float3.h>
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+/**
+ * Binary tree of axis aligned bounding boxes (BVH).
+ * Tree is built using binned surface area heuristic (SAH).
+ * Items are referred only by index, so the tree can be used
+ * over any objects which have bounding boxes, e.g. triangles or
+ * mesh instances. If item boxes change but the set of items stays
+ * the same, the tree can be refitted without rebuilding it.
+ *
+ * @ingroup hgr
+ */
+class BoundingVolumeTree
+{
+public:
+	/** Build constants. */
+	enum Constants
+	{
+		/** Default maximum number of items in a leaf. */
+		MAX_LEAF_ITEMS	= 4,
+		/** Number of bins used to evaluate split candidates. */
+		SAH_BINS		= 16,
+		/** Maximum depth of the tree. */
+		MAX_DEPTH		= 64,
+	};
+
+	/**
+	 * Node of the tree.
+	 * Child nodes of an inner node are stored next to each other,
+	 * and always after the parent node.
+	 */
+	class TreeNode
+	{
+	public:
+		/** Bounding box minimum. */
+		NS(math,float3)	boxMin;
+		/** Index of the first child node if inner node, index of the first item (to items()) if leaf. */
+		int				first;
+		/** Bounding box maximum. */
+		NS(math,float3)	boxMax;
+		/** Number of items in leaf, 0 if inner node. */
+		int				count;
+
+		/** Returns true if the node is a leaf. */
+		bool			isLeaf() const			{return count > 0;}
+	};
+
+	/**
+	 * Creates an empty tree.
+	 */
+	BoundingVolumeTree();
+
+	/**
+	 * Builds the tree over items.
+	 * @param boxmin Bounding box minimums of the items.
+	 * @param boxmax Bounding box maximums of the items.
+	 * @param count Number of items.
+	 * @param maxleafitems Maximum number of items in a leaf.
+	 */
+	void			build( const NS(math,float3)* boxmin, const NS(math,float3)* boxmax, int count, int maxleafitems=MAX_LEAF_ITEMS );
+
+	/**
+	 * Recomputes node bounding boxes from changed item bounding boxes.
+	 * Tree topology stays the same, so refitting is fast but
+	 * quality of the tree degrades if the items move a lot.
+	 * @param boxmin Bounding box minimums of the items, in the same order as in build().
+	 * @param boxmax Bounding box maximums of the items, in the same order as in build().
+	 */
+	void			refit( const NS(math,float3)* boxmin, const NS(math,float3)* boxmax );
+
+	/**
+	 * Removes all nodes.
+	 */
+	void			clear();
+
+	/**
+	 * Returns nodes of the tree. Root node is the first one.
+	 */
+	const TreeNode*	nodes() const							{return m_nodes.begin();}
+
+	/**
+	 * Returns number of nodes in the tree.
+	 */
+	int				nodeCount() const						{return m_nodes.size();}
+
+	/**
+	 * Returns item indices ordered by leaves.
+	 * Items of a leaf are items()[node.first ... node.first+node.count-1].
+	 */
+	const int*		items() const							{return m_items.begin();}
+
+	/**
+	 * Returns number of items in the tree.
+	 */
+	int				itemCount() const						{return m_items.size();}
+
+	/**
+	 * Returns depth of the tree.
+	 */
+	int				depth() const							{return m_depth;}
+
+private:
+	NS(lang,Array)<TreeNode>			m_nodes;
+	NS(lang,Array)<int>					m_items;
+	NS(lang,Array)<NS(math,float3)>		m_centers;
+	const NS(math,float3)*				m_boxMin;
+	const NS(math,float3)*				m_boxMax;
+	int									m_maxLeafItems;
+	int									m_depth;
+
+	void	buildNode( int node, int begin, int end, int depth );
+};
+
+
+END_NAMESPACE() // hgr
+
+
+#endif // _HGR_BOUNDINGVOLUMETREE_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -14,6 +14,9 @@ BEGIN_NAMESPACE(gr)
 	class Shader;
 	class Context;END_NAMESPACE()
 
+BEGIN_NAMESPACE(lang) 
+	class ThreadPool;END_NAMESPACE()
+
 
 BEGIN_NAMESPACE(hgr) 
 
@@ -203,6 +206,28 @@ public:
 	 */
 	NS(lang,Array)<Light*>&	getLightsSortedByDistance( const NS(math,float3)& worldpos ) const;
 
+	/**
+	 * Assigns lights to visible meshes before rendering.
+	 * Light list of each mesh is computed once per frame and stored
+	 * to the camera, so that rendering only needs to set shader constants.
+	 * Transforms must have been cached before assigning lights.
+	 * @param visuals Visible visuals.
+	 * @param lightsorter Lights to be assigned.
+	 * @param pool Thread pool used to compute the light lists, or 0 to compute them in the calling thread.
+	 */
+	void					assignLights( const NS(lang,Array)<Visual*>& visuals, LightSorter* lightsorter, NS(lang,ThreadPool)* pool=0 );
+
+	/**
+	 * Gets lights assigned to the visual by assignLights().
+	 * If lights have not been assigned to the visual, lights are sorted by distance.
+	 * Number of lights returned is limited to NS(Shader,MAX)_LIGHTS.
+	 * This function can be used only during rendering.
+	 * @param vis Visual to be rendered.
+	 * @param lights [out] Receives pointer to the lights, closest first.
+	 * @return Number of lights.
+	 */
+	int						getAssignedLights( Visual* vis, Light* const** lights ) const;
+
 	/**
 	 * Returns current view frustum.
 	 * Used only if orthographic() is false.
@@ -252,6 +277,10 @@ private:
 	LightSorter							m_lightSorter; // used by simple render
 	LightSorter*						m_lightSorterPtr; // used by getLightsSortedByDistance
 	NS(lang,Array)<VisualSorter>		m_visualSorter; // used by cullVisuals
+	NS(lang,Array)<int>					m_lightListIndex; // used by assignLights, light list by transform cache index
+	NS(lang,Array)<Visual*>				m_lightMeshes; // used by assignLights
+	NS(lang,Array)<Light*>				m_lightLists; // used by assignLights, MAX_LIGHTS per mesh
+	NS(lang,Array)<int>					m_lightCounts; // used by assignLights
 
 	bool					m_ortho;
 
@@ -7,8 +7,11 @@
 #ifndef HGR_NOPARTICLES
 #include <hgr/ParticleSystem.h>
 #endif
+#include <gr/Primitive.h>
 #include <hgr/ResourceManager.h>
+#include <io/ResourceIndex.h>
 #include <lang/Hashtable.h>
+#include <lang/Array.h>
 
 
 BEGIN_NAMESPACE(gr) 
@@ -33,14 +36,81 @@ class ParticleSystem;
  * <li>Shares texture by matching pathname (i.e. C:/mydata/tex.bmp != C:/tex.bmp)
  * <li>Shares particles by matching basename (i.e. C:/flare.prs == C:/data/flare.prs)
  * <li>Shaders are not shared (i.e. C:/my.fx != C:/my.fx)
+ * <li>Shares key frame data and static vertex/index buffers by matching content,
+ *     if scenes are loaded with NS(Scene,LOAD_SHAREDATA) flag
  * </ul>
  *
+ * Texture files can be resolved through a persistent NS(io,ResourceIndex)
+ * instead of directory scans, and decoded textures can be cached
+ * to disk by content hash so that image files are decoded only once.
+ *
+ * Memory used by textures, cube textures and particle systems can be
+ * limited by a memory budget. When the budget is exceeded, least
+ * recently used resources without (external) references are evicted,
+ * and reloaded from disk if they are requested again.
+ *
  * @ingroup hgr
  */
 class DefaultResourceManager :
 	public ResourceManager
 {
 public:
+	/**
+	 * Statistics of key frame and vertex data shared by content.
+	 */
+	struct SharingStatistics
+	{
+		/** Number of distinct key frame sequences and animation channels registered for sharing. */
+		int		keyframeSequences;
+		/** Number of loaded key frame sequences and animation channels replaced by shared ones. */
+		int		sharedKeyframeSequences;
+		/** Number of key frame data bytes saved by sharing. */
+		int		keyframeBytesSaved;
+		/** Number of distinct primitives registered for sharing. */
+		int		primitives;
+		/** Number of loaded primitives using buffers of a shared primitive. */
+		int		sharedPrimitives;
+		/** Number of vertex data bytes saved by sharing. */
+		int		vertexBytesSaved;
+		/** Number of index data bytes saved by sharing. */
+		int		indexBytesSaved;
+
+		SharingStatistics();
+
+		/** Returns total number of bytes saved by sharing. */
+		int		bytesSaved() const;
+	};
+
+	/**
+	 * Memory usage of the resources held by the manager.
+	 */
+	struct MemoryStatistics
+	{
+		/** Number of loaded textures. */
+		int		textures;
+		/** Number of surface memory bytes used by loaded textures. */
+		int		textureBytes;
+		/** Number of loaded cube textures. */
+		int		cubeTextures;
+		/** Number of surface memory bytes used by loaded cube textures. */
+		int		cubeTextureBytes;
+		/** Number of loaded particle systems. */
+		int		particleSystems;
+		/** Number of bytes used by loaded particle systems. */
+		int		particleSystemBytes;
+		/** Number of resources evicted to keep memory usage within the budget. */
+		int		evicted;
+		/** Number of bytes released by evictions. */
+		int		evictedBytes;
+		/** Number of evicted resources reloaded on demand. */
+		int		reloaded;
+
+		MemoryStatistics();
+
+		/** Returns total number of bytes used by loaded resources. */
+		int		bytes() const;
+	};
+
 	/**
 	 * Creates resource manager using specified rendering context.
 	 */
@@ -60,6 +130,14 @@ public:
 	 */
 	NS(gr,Texture)*		getTexture( const NS(lang,String)& filename );
 
+	/** 
+	 * Gets texture by filename. Image file data is used if the texture
+	 * needs to be created and the file is not replaced by findTextureResources
+	 * or replaceTextureExtension.
+	 * @exception Exception
+	 */
+	NS(gr,Texture)*		getTexture( const NS(lang,String)& filename, const void* data, int size );
+
 	/** 
 	 * Gets cube texture by filename. 
 	 * @exception Exception
@@ -74,12 +152,51 @@ public:
 							const NS(lang,String)& texturepath,
 							const NS(lang,String)& shaderpath );
 
+	/**
+	 * Returns previously shared key frame sequence with identical
+	 * content, or registers the sequence for sharing and returns it.
+	 */
+	KeyframeSequence*	getSharedKeyframeSequence( KeyframeSequence* seq );
+
+	/** 
+	 * Returns previously shared optimized animation channel with identical
+	 * content, or registers the channel for sharing and returns it.
+	 */
+	TransformAnimation::Float3Anim*	getSharedFloat3Anim( TransformAnimation::Float3Anim* anim );
+
+	/**
+	 * Makes static primitive use vertex and index buffers of
+	 * previously shared primitive with identical data, or registers
+	 * the primitive for sharing. Primitives with sorted shaders
+	 * are not shared, since sorting re-orders indices when rendering.
+	 * Shader of the primitive must have been set.
+	 * @exception GraphicsException
+	 */
+	void				shareVertexData( NS(gr,Primitive)* prim );
+
 	/**
 	 * Finds texture resources below specific path.
 	 * @param pathfilter Path to find resource from, e.g. D:/data/*
 	 */
 	void				findTextureResources( const NS(lang,String)& pathfilter );
 
+	/**
+	 * Sets index used to find texture files by basename and to get
+	 * content hashes of the files without reading them.
+	 * Index lookups are used before textures found by findTextureResources.
+	 * @param index Resource index or 0 to disable index lookups.
+	 */
+	void				setResourceIndex( NS(io,ResourceIndex)* index );
+
+	/**
+	 * Sets directory of the decoded texture cache.
+	 * Textures are cached in platform dependent decoded form
+	 * by content hash of the image file, so the cache stays valid
+	 * when files are moved or renamed. Requires FindFile support.
+	 * @param path Cache directory or empty string to disable the cache.
+	 */
+	void				setTextureCachePath( const NS(lang,String)& path );
+
 	/**
 	 * Replaces texture file extension with specified string.
 	 * Can be used for example to load platform-specific texture files 
@@ -94,6 +211,48 @@ public:
 	 */
 	int					releaseUnusedTextures();
 
+	/**
+	 * Sets memory budget of textures, cube textures and particle systems.
+	 * When the budget is exceeded, least recently used resources which
+	 * have no (external) references left are evicted. Evicted resources
+	 * are reloaded from disk if they are requested again.
+	 * Referenced resources are never evicted, so memory usage can
+	 * stay above the budget while the resources are in use.
+	 * @param bytes Memory budget in bytes or 0 for unlimited.
+	 * @param autoevict If true then the budget is enforced whenever a resource is loaded, 
+	 *		otherwise only when enforceMemoryBudget is called.
+	 */
+	void				setMemoryBudget( int bytes, bool autoevict=true );
+
+	/**
+	 * Returns memory budget in bytes or 0 if unlimited.
+	 */
+	int					memoryBudget() const		{return m_memoryBudget;}
+
+	/**
+	 * Evicts least recently used unreferenced resources until 
+	 * memory usage is within the budget.
+	 * @return Number of bytes released.
+	 */
+	int					enforceMemoryBudget();
+
+	/**
+	 * Updates and returns memory usage statistics.
+	 */
+	const MemoryStatistics&		memoryStatistics();
+
+	/**
+	 * Releases shared key frame sequences, animation channels and
+	 * primitives which have no (external) references left.
+	 * @return Number of objects released.
+	 */
+	int					releaseUnusedSharedData();
+
+	/**
+	 * Returns statistics of key frame and vertex data shared by content.
+	 */
+	const SharingStatistics&	sharingStatistics() const	{return m_sharingStats;}
+
 	/**
 	 * Returns active resource manager.
 	 */
@@ -105,22 +264,80 @@ public:
 	static void				set( ResourceManager* res );
 
 private:
+	enum ResourceType
+	{
+		RESOURCE_TEXTURE,
+		RESOURCE_CUBETEXTURE,
+		RESOURCE_PARTICLESYSTEM,
+	};
+
 	class TextureResource
 	{
 	public:
 		P(NS(gr,Texture))	texture;
 		NS(lang,String)		filename;
+		int					lastUsed;
+		bool				evicted;
+
+		TextureResource() : lastUsed(0), evicted(false) {}
+	};
+
+	class CubeTextureResource
+	{
+	public:
+		P(NS(gr,CubeTexture))	texture;
+		int						lastUsed;
+		bool					evicted;
+
+		CubeTextureResource() : lastUsed(0), evicted(false) {}
+	};
+
+#ifndef HGR_NOPARTICLES
+	class ParticleSystemResource
+	{
+	public:
+		P(NS(hgr,ParticleSystem))	particle;
+		int							lastUsed;
+		bool						evicted;
+
+		ParticleSystemResource() : lastUsed(0), evicted(false) {}
+	};
+#endif
+
+	class EvictionCandidate
+	{
+	public:
+		int					lastUsed;
+		int					bytes;
+		ResourceType		type;
+		NS(lang,String)		name;
+
+		bool operator<( const EvictionCandidate& other ) const		{return lastUsed < other.lastUsed;}
 	};
 
 	NS(lang,String)		m_textureExtension;
+	NS(lang,String)		m_textureCachePath;
+	P(NS(io,ResourceIndex))	m_index;
 	P(NS(gr,Context))																				m_context;
 	NS(lang,Hashtable)< NS(lang,String),TextureResource,NS(lang,Hash)<NS(lang,String)> >			m_textures;
-	NS(lang,Hashtable)< NS(lang,String),P(NS(gr,CubeTexture)),NS(lang,Hash)<NS(lang,String)> >		m_cubeTextures;
+	NS(lang,Hashtable)< NS(lang,String),CubeTextureResource,NS(lang,Hash)<NS(lang,String)> >		m_cubeTextures;
 #ifndef HGR_NOPARTICLES
-	NS(lang,Hashtable)< NS(lang,String),P(NS(hgr,ParticleSystem)),NS(lang,Hash)<NS(lang,String)> >	m_particles;
+	NS(lang,Hashtable)< NS(lang,String),ParticleSystemResource,NS(lang,Hash)<NS(lang,String)> >	m_particles;
 #endif
+	NS(lang,Hashtable)< int,NS(lang,Array)<P(KeyframeSequence)> >									m_keyframeSequences;
+	NS(lang,Hashtable)< int,NS(lang,Array)<P(TransformAnimation::Float3Anim)> >						m_float3Anims;
+	NS(lang,Hashtable)< int,NS(lang,Array)<P(NS(gr,Primitive))> >									m_primitives;
+	SharingStatistics																				m_sharingStats;
+	MemoryStatistics																				m_memoryStats;
+	NS(lang,Array)<EvictionCandidate>																m_evictionCandidates;
+	int																								m_memoryBudget;
+	int																								m_accessTime;
+	bool																							m_autoEvict;
 
 	NS(lang,String)		getTextureSystemFilename( const NS(lang,String)& filename );
+	P(NS(gr,Texture))	loadTexture( const NS(lang,String)& filename, const void* data, int size );
+	void				updateMemoryStatistics();
+	void				resourceLoaded( bool evicted );
 
 
 	DefaultResourceManager( const DefaultResourceManager& );
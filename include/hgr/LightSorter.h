@@ -16,6 +16,10 @@ class Light;
  * Helper class for sorting lights by distance.
  * Used to select the most important lights in object rendering.
  *
+ * When there are many lights, the collected lights are indexed
+ * by a uniform grid over light positions, and nearest light queries
+ * visit only the grid cells which can contain the nearest lights.
+ *
  * @ingroup hgr
  */
 class LightSorter
@@ -28,6 +32,10 @@ public:
 		float v;
 		P(Light) obj;
 		NS(math,float3) wpos;
+		float range2;
+		bool global;
+		int cell;
+		int next;
 	};
 
 	/* Private implementation class. */
@@ -50,6 +58,41 @@ public:
 	 */
 	NS(lang,Array)<Light*>&	getLightsByDistance( const NS(math,float3)& worldpos, int maxlights=8 );
 
+	/**
+	 * Returns array of lights which affect the world space position,
+	 * sorted by distance. Closest lights become first. Lights further
+	 * away than their far attenuation end are skipped, directional lights
+	 * affect every position.
+	 */
+	NS(lang,Array)<Light*>&	getLightsInRange( const NS(math,float3)& worldpos, int maxlights=8 );
+
+	/**
+	 * Finds lights closest to the world space position without modifying
+	 * the sorter, so that multiple threads can query lights at the same time.
+	 * Spatial index must be up-to-date, see updateIndex.
+	 * @param worldpos World space position.
+	 * @param maxlights Maximum number of lights to return.
+	 * @param inrange If true then lights which do not affect the position are skipped (see getLightsInRange).
+	 * @param lights [out] Receives lights, closest first. Must have space for maxlights lights.
+	 * @param dist [out] Receives squared distances to the lights. Must have space for maxlights values.
+	 * @return Number of lights found.
+	 */
+	int			findNearest( const NS(math,float3)& worldpos, int maxlights, bool inrange,
+					Light** lights, float* dist ) const;
+
+	/**
+	 * Builds spatial index of the lights if lights have been added or removed.
+	 * Needs to be called before findNearest.
+	 */
+	void		updateIndex();
+
+	/**
+	 * Updates positions and attenuation ranges of the collected lights.
+	 * Only lights which moved to other cell of the spatial index are relocated.
+	 * @return Number of lights relocated in the index.
+	 */
+	int			updateLights();
+
 	/**
 	 * Adds a new collected light.
 	 */
@@ -78,9 +121,33 @@ public:
 	int			lights() const						{return m_lightData.size();}
 
 private:
+	enum Constants
+	{
+		/** Minimum number of lights to use spatial index. */
+		MIN_INDEXED_LIGHTS	= 16,
+		/** Maximum number of grid cells per axis. */
+		MAX_GRID_SIZE		= 32,
+	};
+
 	NS(lang,Array)<Light*>			m_lights;
 	NS(lang,Array)<LightData>		m_lightData;
 	NS(lang,Array)<LightSortValue>	m_lightSorter;
+	NS(lang,Array)<float>			m_distances;
+	NS(lang,Array)<int>				m_cells;
+	NS(lang,Array)<int>				m_globalLights;
+	NS(math,float3)					m_gridMin;
+	float							m_cellSize;
+	float							m_invCellSize;
+	float							m_maxRange2;
+	int								m_gridSize[3];
+	bool							m_indexDirty;
+
+	NS(lang,Array)<Light*>&	getLights( const NS(math,float3)& worldpos, int maxlights, bool inrange );
+	void		getCellCoords( const NS(math,float3)& pos, int* coords ) const;
+	int			getCell( const NS(math,float3)& pos ) const;
+	bool		indexed( int maxlights ) const;
+	static int	insertNearest( Light* obj, float v, Light** lights, float* dist, int count, int maxlights );
+	static void	setLightData( LightData& data );
 };
 
 
@@ -6,11 +6,15 @@
 #include <hgr/Light.h>
 #include <hgr/Visual.h>
 #include <lang/Array.h>
+#include <math/float4.h>
 
 
 BEGIN_NAMESPACE(math) 
 	class float4x4;END_NAMESPACE()
 
+BEGIN_NAMESPACE(lang) 
+	class ThreadPool;END_NAMESPACE()
+
 
 BEGIN_NAMESPACE(hgr) 
 
@@ -28,6 +32,63 @@ class Mesh :
 	public Visual
 {
 public:
+	/**
+	 * Vertex data of a mesh skinned on the CPU.
+	 * Buffers are reused between skinVertices() calls, so no memory
+	 * is allocated once the buffers have grown to the size of the mesh.
+	 * Source vertex data and bone transforms of the mesh are cached
+	 * to the object as well, so one object should be used per mesh.
+	 */
+	class SkinnedVertices
+	{
+	public:
+		/** Skinned positions in model space of the mesh (w=1). Vertices of primitive i start at offsets[i]. */
+		NS(lang,Array)<NS(math,float4)>	positions;
+
+		/** Skinned normals in model space of the mesh (w=0), not normalized. Zero if primitive has no normals. */
+		NS(lang,Array)<NS(math,float4)>	normals;
+
+		/** Index of the first vertex of each primitive. Last entry is total number of vertices. */
+		NS(lang,Array)<int>				offsets;
+
+		/** Bounding box minimum of skinned positions. */
+		NS(math,float3)					boundMin;
+
+		/** Bounding box maximum of skinned positions. */
+		NS(math,float3)					boundMax;
+
+		/** Maximum distance of skinned positions from model space origin. */
+		float							boundRadius;
+
+		/** Number of primitives skinned in last update. Primitives without moved bones are skipped. */
+		int								skinnedPrimitives;
+
+		///
+		SkinnedVertices();
+
+		/** 
+		 * Discards cached source data. 
+		 * Needs to be called if primitives of the mesh have been modified. 
+		 */
+		void	reset();
+
+	private:
+		friend class Mesh;
+
+		const Mesh*							m_mesh;
+		NS(lang,Array)<NS(math,float4)>		m_srcPositions;
+		NS(lang,Array)<NS(math,float4)>		m_srcNormals;
+		NS(lang,Array)<NS(math,float4)>		m_weights;
+		NS(lang,Array)<uint8_t>				m_boneIndices;
+		NS(lang,Array)<uint8_t>				m_primBones;
+		NS(lang,Array)<int>					m_primBoneOffsets;
+		NS(lang,Array)<NS(math,float3x4)>	m_boneTms;
+		NS(lang,Array)<NS(math,float4)>		m_boneColumns;
+		NS(lang,Array)<bool>				m_boneChanged;
+		bool								m_prepared;
+		bool								m_updated;
+	};
+
 	///
 	Mesh();
 
@@ -166,17 +227,81 @@ public:
 	 */
 	int				bones() const;
 
+	/**
+	 * Computes bounding box of each bone from the vertices it affects.
+	 * Boxes are in bone space, so bounding box of the skinned mesh 
+	 * can be updated from bone transforms without skinning the vertices.
+	 * Needs to be called after the bones have been added.
+	 * Primitives are locked for reading. Sets world space bounding box 
+	 * of the mesh from current bone transforms. Primitives without bone weights
+	 * are bounded by their model space boxes transformed by the mesh.
+	 * @see updateBoneBound
+	 */
+	void			computeBoneBounds();
+
+	/**
+	 * Sets world space bounding box of skinned mesh by transforming
+	 * bone bounding boxes to world space. Cost depends only on
+	 * the number of bones. Does nothing if bone bounds have not been computed.
+	 * @param camera If not 0 then transform cache of the camera is used for bone world transforms.
+	 * @return true if bounding box was set.
+	 */
+	bool			updateBoneBound( const Camera* camera=0 );
+
+	/**
+	 * Returns true if bone bounding boxes have been computed.
+	 * @see computeBoneBounds
+	 */
+	bool			hasBoneBounds() const;
+
+	/**
+	 * Computes skinned vertex positions and normals on the CPU,
+	 * e.g. for picking, hit detection or decal projection.
+	 * Bone transforms are computed from the current world transforms
+	 * of the bone nodes, so camera transform cache is not needed.
+	 * Primitives whose bones have not moved since the previous call
+	 * are not skinned again. Up to 4 bone weights per vertex are used,
+	 * if weight format has less than 4 components, the last used weight 
+	 * is 1 minus sum of the others.
+	 * On the first call (or after reset) primitives are locked for
+	 * reading to cache source vertex data.
+	 * @param out [in/out] Skinned vertex data of this mesh.
+	 * @param updatebound If true then bounding volume of the mesh is set from skinned positions.
+	 */
+	void			skinVertices( SkinnedVertices* out, bool updatebound=false );
+
+	/**
+	 * Computes skinned vertex positions and normals of multiple meshes.
+	 * Meshes are skinned in parallel if thread pool is given.
+	 * @param meshes Meshes to skin.
+	 * @param out [in/out] Skinned vertex data of each mesh.
+	 * @param count Number of meshes.
+	 * @param pool Thread pool to use. Can be 0.
+	 * @param updatebound If true then bounding volumes of the meshes are set from skinned positions.
+	 * @see skinVertices
+	 */
+	static void		skinVertices( Mesh* const* meshes, SkinnedVertices* const* out, int count, NS(lang,ThreadPool)* pool=0, bool updatebound=false );
+
 private:
 	class Bone
 	{
 	public:
 		NS(math,float3x4)	invresttm; // skin->bone tm in non-deforming pose
+		NS(math,float3)		boxmin; // bound of affected vertices in bone space
+		NS(math,float3)		boxmax;
 		Node*			node;
 	};
 
 	NS(lang,Array)<P(NS(gr,Primitive))>	m_primitives;
 	NS(lang,Array)<NS(hgr,Light)*>		m_lights;
 	NS(lang,Array)<Bone>				m_bones;
+	NS(math,float3)						m_unweightedBoxMin; // model space bound of primitives without bone weights
+	NS(math,float3)						m_unweightedBoxMax;
+	bool								m_boneBounds;
+
+	void	prepareSkinning( SkinnedVertices* out ) const;
+	static void	mergeBoxWorld( const NS(math,float3x4)& tm, const NS(math,float3)& boxmin, const NS(math,float3)& boxmax, NS(math,float3)* minv, NS(math,float3)* maxv );
+	void	updateSkinning( SkinnedVertices* out, bool updatebound );
 
 	Mesh& operator=( const Mesh& other );
 };
@@ -20,4 +20,9 @@ inline int Mesh::lights() const
 	return m_lights.size();
 }
 
+inline bool Mesh::hasBoneBounds() const
+{
+	return m_boneBounds;
+}
+
 // Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -348,6 +348,7 @@ protected:
 
 private:
 	friend class Camera;
+	friend class SceneLoader;
 	friend class SceneInputStream;
 	friend class SceneOutputStream;
 
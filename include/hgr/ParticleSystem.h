@@ -7,6 +7,7 @@
 #include <hgr/Visual.h>
 #include <hgr/impl/ParticleSystem_Integral.h>
 #include <lang/Array.h>
+#include <math/Random.h>
 
 
 BEGIN_NAMESPACE(gr) 
@@ -423,6 +424,13 @@ public:
 	 */
 	void	setDelay( float time );
 
+	/**
+	 * Restarts random number sequence of the particle system instance.
+	 * Instances get different seeds by default, same seed can be used
+	 * to reproduce the same particles for example in replays.
+	 */
+	void	setRandomSeed( uint32_t seed );
+
 	/**
 	 * Sets velocity of parent node in world space to be taken into account while
 	 * computing sprite elasticity effect.
@@ -445,6 +453,12 @@ public:
 	 */
 	int				particles() const;
 
+	/**
+	 * Returns approximate number of bytes used by the particle system instance
+	 * (particle data and rendering primitive, but not shared description).
+	 */
+	int				memoryUsed() const;
+
 	/**
 	 * Returns description used by this particle system.
 	 */
@@ -480,6 +494,9 @@ private:
 	NS(math,float3)				m_parentVelocity;
 	NS(math,float3x3)			m_userRot;
 	P(NS(gr,Primitive))			m_prim;
+	NS(math,Random)				m_random;
+	NS(lang,Array)<NS(math,float3)>	m_spawnVelocities;
+	NS(lang,Array)<NS(math,float3)>	m_spawnPositions;
 
 	void		renderDX( NS(gr,Context)* context, Camera* camera );
 	void		renderN3D( NS(gr,Context)* context, Camera* camera );
@@ -489,7 +506,7 @@ private:
 	static int	log2i( int x );
 
 	template <class T> static void	killOld( NS(lang,Array)<T>& array );
-	template <class T> static T*	getNew( NS(lang,Array)<T>& array, int limit, KillType killtype );
+	template <class T> static T*	getNew( NS(lang,Array)<T>& array, int limit, KillType killtype, NS(math,Random)& rng );
 
 	ParticleSystem& operator=( const ParticleSystem& );
 };
@@ -10,6 +10,9 @@ BEGIN_NAMESPACE(gr)
 	class Shader;
 	class Context;END_NAMESPACE()
 
+BEGIN_NAMESPACE(lang) 
+	class ThreadPool;END_NAMESPACE()
+
 
 BEGIN_NAMESPACE(hgr) 
 
@@ -60,6 +63,7 @@ public:
 	   <li>Collects visible Visuals to 'visuals' array
 	   <li>Sorts visible Visuals array by ascending distance to camera
 	   <li>Collects Lights to 'lights' array
+	   <li>Assigns lights to visible meshes (see NS(Camera,assignLights))
 	   <li>Collects unique used Shaders to 'shaders' array
 	   </ol>
 	 */
@@ -72,6 +76,13 @@ public:
 	 */
 	void			setTechnique( const char* name );
 
+	/**
+	 * Sets thread pool used to assign lights to visible meshes.
+	 * Thread pool is not owned by PipeSetup and must stay alive while in use.
+	 * @param pool Thread pool or 0 to assign lights in the calling thread.
+	 */
+	void			setThreadPool( NS(lang,ThreadPool)* pool );
+
 	/**
 	 * Returns true if setup() has been called in this frame.
 	 */
@@ -110,6 +121,7 @@ private:
 	/** Last frame when setup() was called. */
 	int				m_frameCounter;
 	P(NS(gr,Context))	m_context;
+	NS(lang,ThreadPool)*	m_pool;
 
 	PipeSetup( const PipeSetup& );
 	PipeSetup& operator=( const PipeSetup& );
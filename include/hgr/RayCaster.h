@@ -0,0 +1,258 @@
+#ifndef _HGR_RAYCASTER_H
+#define _HGR_RAYCASTER_H
+
+
+#include <hgr/Mesh.h>
+#include <hgr/BoundingVolumeTree.h>
+#include <lang/Array.h>
+#include <lang/Hashtable.h>
+#include <math/float3.h>
+#include <math/float3x4.h>
+
+
+BEGIN_NAMESPACE(lang)
+	class ThreadPool;END_NAMESPACE()
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+class Node;
+
+
+/**
+ * Ray, segment and sphere cast queries against mesh geometry of a scene.
+ *
+ * Triangles of each primitive are stored in a bounding volume tree
+ * in model space, and primitives shared by multiple meshes share the tree.
+ * Mesh primitive instances are stored in a second tree in world space.
+ * When meshes move, refit() updates the instance tree from
+ * current world transforms without rebuilding the triangle trees.
+ *
+ * Rays are traversed in packets of 4 (SSE if MATH_SSE is defined),
+ * single ray queries use the same code with one active ray.
+ * Leaf triangles are tested 4 at a time with
+ * IntersectionUtil::findRayTrianglesIntersection.
+ * Queries do not modify the caster, so multiple threads can
+ * cast rays at the same time, see also castRays().
+ *
+ * Skinned meshes are skipped since their triangles are not static
+ * in model space. Triangles which are not in meshes can be added 
+ * with addTriangles().
+ *
+ * @ingroup hgr
+ */
+class RayCaster
+{
+public:
+	/**
+	 * Ray to be cast with castRays().
+	 */
+	class Ray
+	{
+	public:
+		/** Ray origin. */
+		NS(math,float3)	orig;
+		/** Ray direction. Hit distances are relative to the length of the direction. */
+		NS(math,float3)	dir;
+		/** Maximum distance along ray. */
+		float			maxDist;
+	};
+
+	/**
+	 * Ray cast query result.
+	 */
+	class Hit
+	{
+	public:
+		/** Distance along ray to the hit, relative to the length of the ray direction. */
+		float			t;
+		/** World space position of the hit. */
+		NS(math,float3)	point;
+		/** World space normal of the hit triangle, facing towards the ray origin. */
+		NS(math,float3)	normal;
+		/** Mesh which was hit, 0 if no hit or if hit triangles were added with addTriangles(). */
+		Mesh*			mesh;
+		/** Index of the primitive in the mesh. */
+		int				primitive;
+		/** Index of the triangle in the primitive. */
+		int				triangle;
+		/** Index of the instance which was hit, -1 if no hit. */
+		int				instance;
+	};
+
+	/**
+	 * Creates an empty ray caster.
+	 */
+	RayCaster();
+
+	~RayCaster();
+
+	/**
+	 * Builds trees from meshes in a node hierarchy.
+	 * @param root Root of the hierarchy.
+	 */
+	void		build( Node* root );
+
+	/**
+	 * Adds mesh to the caster. Call update() after adding meshes.
+	 */
+	void		addMesh( Mesh* mesh );
+
+	/**
+	 * Adds triangles which are not in a mesh, e.g. collision geometry.
+	 * Hits of these triangles have mesh 0, primitive 0 and 
+	 * instance set to the returned index. Call update() after adding triangles.
+	 * @param verts Model space triangle vertices, 3 per triangle.
+	 * @param count Number of triangles.
+	 * @param tm Model to world transform.
+	 * @return Index of the new instance.
+	 */
+	int			addTriangles( const NS(math,float3)* verts, int count, const NS(math,float3x4)& tm );
+
+	/**
+	 * Sets model to world transform of triangles added with addTriangles().
+	 * Call refit() or update() after changing transforms.
+	 * @param instance Instance index returned by addTriangles().
+	 * @param tm Model to world transform.
+	 */
+	void		setTransform( int instance, const NS(math,float3x4)& tm );
+
+	/**
+	 * Rebuilds instance tree after meshes have been added.
+	 */
+	void		update();
+
+	/**
+	 * Updates world transforms of the meshes and refits the instance tree.
+	 * Cheaper than update() but the tree becomes less efficient
+	 * if meshes move a lot compared to their size.
+	 * Transforms of instances added with addTriangles() are not changed.
+	 */
+	void		refit();
+
+	/**
+	 * Removes all meshes.
+	 */
+	void		clear();
+
+	/**
+	 * Finds the closest intersection of a ray.
+	 * @param orig Ray origin.
+	 * @param dir Ray direction.
+	 * @param maxdist Maximum distance along ray, relative to dir length.
+	 * @param hit [out] Receives the closest hit if any.
+	 * @return true if ray hits something.
+	 */
+	bool		castRay( const NS(math,float3)& orig, const NS(math,float3)& dir, float maxdist, Hit* hit ) const;
+
+	/**
+	 * Finds the closest intersection of a line segment.
+	 * Hit distance is between 0 (start) and 1 (end).
+	 * @return true if segment hits something.
+	 */
+	bool		castSegment( const NS(math,float3)& start, const NS(math,float3)& end, Hit* hit ) const;
+
+	/**
+	 * Returns true if a line segment hits anything.
+	 * Faster than castSegment since search ends at first hit found,
+	 * useful for visibility checks.
+	 */
+	bool		testSegment( const NS(math,float3)& start, const NS(math,float3)& end ) const;
+
+	/**
+	 * Finds the first contact of a sphere moving along a ray.
+	 * Hit point is the contact point on the triangle.
+	 * @param orig Sphere center at start.
+	 * @param dir Sphere movement direction.
+	 * @param radius Sphere radius.
+	 * @param maxdist Maximum distance along ray, relative to dir length.
+	 * @param hit [out] Receives the first contact if any.
+	 * @return true if sphere hits something.
+	 */
+	bool		castSphere( const NS(math,float3)& orig, const NS(math,float3)& dir, float radius, float maxdist, Hit* hit ) const;
+
+	/**
+	 * Finds the closest intersections of multiple rays.
+	 * Rays are cast in parallel if thread pool is given.
+	 * Coherent rays (e.g. similar origins and directions)
+	 * should be next to each other for best performance.
+	 * @param rays Rays to cast.
+	 * @param hits [out] Receives closest hits. Hit instance is -1 if ray did not hit anything.
+	 * @param count Number of rays.
+	 * @param pool Thread pool to use, or 0 if the rays are cast in the calling thread.
+	 * @return Number of rays which hit something.
+	 */
+	int			castRays( const Ray* rays, Hit* hits, int count, NS(lang,ThreadPool)* pool=0 ) const;
+
+	/**
+	 * Returns number of mesh primitive and triangle instances in the caster.
+	 */
+	int			instances() const						{return m_instances.size();}
+
+	/**
+	 * Returns number of unique triangles in the caster.
+	 */
+	int			triangles() const;
+
+	/* Private implementation class. */
+	class PrimitiveHash
+	{
+	public:
+		int operator()( NS(gr,Primitive)* const& x ) const	{return int( reinterpret_cast<size_t>(x) >> 4 );}
+	};
+
+	/* Private implementation class. */
+	class Shape
+	{
+	public:
+		P(NS(gr,Primitive))				primitive;
+		BoundingVolumeTree				tree;
+		NS(lang,Array)<NS(math,float3)>	vertices;
+		NS(lang,Array)<int>				triangles;
+		NS(lang,Array)<float>			blocks;
+		NS(lang,Array)<int>				leafBlocks;
+	};
+
+	/* Private implementation class. */
+	class Instance
+	{
+	public:
+		P(Mesh)				mesh;
+		int					primitive;
+		int					shape;
+		NS(math,float3x4)	tm;
+		NS(math,float3x4)	invtm;
+		float				invscale;
+	};
+
+	/* Private implementation class. */
+	class RayPacket;
+
+private:
+	NS(lang,Array)<Shape*>				m_shapes;
+	NS(lang,Hashtable)<NS(gr,Primitive)*,int,PrimitiveHash>	m_shapeMap;
+	NS(lang,Array)<Instance>			m_instances;
+	NS(lang,Array)<NS(math,float3)>		m_boxMin;
+	NS(lang,Array)<NS(math,float3)>		m_boxMax;
+	BoundingVolumeTree					m_tree;
+
+	int		addShape( const NS(math,float3)* verts, int count );
+	void	addInstance( Mesh* mesh, int primitive, int shape, const NS(math,float3x4)& tm );
+	void	updateInstanceBounds();
+	void	castPacket( RayPacket& packet, bool anyhit ) const;
+	int		castShapePacket( const Shape& shape, RayPacket& packet, bool anyhit ) const;
+	bool	castSphereShape( int instance, const NS(math,float3)& orig, const NS(math,float3)& dir, float radius, Hit* hit ) const;
+	void	getHitInfo( const RayPacket& packet, int lane, Hit* hit ) const;
+
+	RayCaster( const RayCaster& );
+	RayCaster& operator=( const RayCaster& );
+};
+
+
+END_NAMESPACE() // hgr
+
+
+#endif // _HGR_RAYCASTER_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
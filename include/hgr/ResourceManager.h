@@ -2,6 +2,7 @@
 #define _HGR_RESOURCEMANAGER_H
 
 
+#include <hgr/TransformAnimation.h>
 #include <lang/Object.h>
 #include <lang/String.h>
 
@@ -10,6 +11,7 @@ BEGIN_NAMESPACE(gr)
 	class Shader;
 	class Context;
 	class Texture;
+	class Primitive;
 	class CubeTexture;END_NAMESPACE()
 
 BEGIN_NAMESPACE(lang) 
@@ -46,6 +48,17 @@ public:
 	 */
 	virtual NS(gr,Texture)*		getTexture( const NS(lang,String)& filename ) = 0;
 
+	/** 
+	 * Gets texture by filename. If the texture needs to be created
+	 * then image file data already read to memory can be used.
+	 * Default implementation ignores the data.
+	 * @param name Name of the texture.
+	 * @param data Image file data.
+	 * @param size Size of the image file data in bytes.
+	 * @exception Exception
+	 */
+	virtual NS(gr,Texture)*		getTexture( const NS(lang,String)& filename, const void* /*data*/, int /*size*/ )	{return getTexture(filename);}
+
 	/** 
 	 * Gets cube texture by filename. 
 	 * @param name Name of the texture.
@@ -63,6 +76,34 @@ public:
 									const NS(lang,String)& texturepath="",
 									const NS(lang,String)& shaderpath="" ) = 0;
 #endif
+
+	/**
+	 * Returns previously shared key frame sequence with identical
+	 * content, or registers the sequence for sharing and returns it.
+	 * Returned sequence should not be modified.
+	 * Default implementation does not share data.
+	 * @param seq Key frame sequence. Can be 0.
+	 */
+	virtual KeyframeSequence*	getSharedKeyframeSequence( KeyframeSequence* seq )		{return seq;}
+
+	/** 
+	 * Returns previously shared optimized animation channel with identical
+	 * content, or registers the channel for sharing and returns it.
+	 * Returned channel should not be modified.
+	 * Default implementation does not share data.
+	 * @param anim Animation channel. Can be 0.
+	 */
+	virtual TransformAnimation::Float3Anim*	getSharedFloat3Anim( TransformAnimation::Float3Anim* anim )	{return anim;}
+
+	/**
+	 * Makes static primitive use vertex and index buffers of
+	 * previously shared primitive with identical data, or registers
+	 * the primitive for sharing. Vertex and index data of the primitive
+	 * should not be modified afterwards.
+	 * Default implementation does not share data.
+	 * @exception GraphicsException
+	 */
+	virtual void				shareVertexData( NS(gr,Primitive)* /*prim*/ )			{}
 };
 
 
@@ -21,7 +21,7 @@ BEGIN_NAMESPACE(hgr)
 class Mesh;
 class Camera;
 class ResourceManager;
-class SceneInputStream;
+class SceneLoader;
 
 
 /**
@@ -45,6 +45,19 @@ public:
 		FOG_LINEAR
 	};
 
+	/**
+	 * Scene loading options.
+	 */
+	enum LoadFlags
+	{
+		/** Optimize triangle and vertex order of primitives for vertex cache, overdraw and vertex fetch. */
+		LOAD_OPTIMIZEPRIMITIVES	= 1,
+		/** Keep loading data so that the scene can be baked with NS(SceneLoader,bake). */
+		LOAD_BAKE				= 2,
+		/** Share identical key frame and static vertex/index data with other scenes through ResourceManager. Shared data must not be modified. */
+		LOAD_SHAREDATA			= 4,
+	};
+
 	/** 
 	 * Creates empty scene.
 	 */
@@ -52,12 +65,14 @@ public:
 
 	/**
 	 * Loads a scene from hgr file.
+	 * Use SceneLoader to load scenes in background.
 	 * @param context Rendering context to be used while loading.
 	 * @param filename Scene file name relative to current working directory.
 	 * @param res Resource manager to load textures and particles from.
 	 * @param texturepath Texture path relative to current working directory.
 	 * @param shaderpath Shader path relative to current working directory.
 	 * @param particlepath Particle system path relative to current working directory.
+	 * @param loadflags Scene loading options. See LoadFlags.
 	 * @exception IOException
 	 * @exception GraphicsException
 	 */
@@ -65,7 +80,8 @@ public:
 		ResourceManager* res=0,
 		const NS(lang,String)& texturepath="",
 		const NS(lang,String)& shaderpath="",
-		const NS(lang,String)& particlepath="" );
+		const NS(lang,String)& particlepath="",
+		int loadflags=0 );
 
 	/** 
 	 * Create a value copy of this scene. 
@@ -155,8 +171,7 @@ public:
 	void	getBoundBox( NS(math,float3)* boxmin, NS(math,float3)* boxmax ) const;
 
 private:
-	struct MeshBoneCount {Mesh* mesh; int bonecount;};
-	struct MeshBone {int boneindex; NS(math,float3x4) invresttm;};
+	friend class SceneLoader;
 
 	P(TransformAnimationSet)		m_transformAnims;
 	P(UserPropertySet)				m_userProperties;
@@ -166,9 +181,6 @@ private:
 	float			m_fogEnd;
 	FogType			m_fogType;
 
-	void	readId( SceneInputStream& in, int& id );
-	void	readNode( SceneInputStream& in, Node* node, NS(lang,Array)<int>& nodeparents, NS(lang,Array)<NS(lang,String)>& nodenames, NS(lang,Array)<P(Node)>& nodes );
-
 	Scene& operator=( const Scene& other );
 };
 
@@ -4,7 +4,10 @@
 
 #include <gr/Context.h>
 #include <gr/Primitive.h>
+#include <gr/PrimitiveOptimizer.h>
 #include <io/DataInputStream.h>
+#include <io/InflateInputStream.h>
+#include <hgr/BakedScene.h>
 #include <hgr/UserPropertySet.h>
 #include <hgr/TransformAnimation.h>
 #include <lang/Array.h>
@@ -49,6 +52,10 @@ public:
 		DATA_ANIMATIONS		= 8,
 		/** Scene stream contains user properties. */
 		DATA_USERPROPERTIES	= 16,
+		/** Scene stream data after file header is compressed with NS(io,DeflateOutputStream). Version 1.94 and later. */
+		DATA_COMPRESSED		= 32,
+		/** Scene stream contains baked scene image instead of separate sections. See NS(BakedScene). Version 1.95 and later. */
+		DATA_BAKED			= 64,
 	};
 
 	/** Minimum version number (major*100+minor) the scene loader supports. */
@@ -59,6 +66,8 @@ public:
 
 	/**
 	 * Prepares to read scene from the input stream.
+	 * If the scene file is compressed then the rest of
+	 * the stream is decompressed transparently.
 	 * @exception IOException
 	 */
 	explicit SceneInputStream( NS(io,InputStream)* in );
@@ -126,6 +135,12 @@ public:
 	 * @exception IOException
 	 */
 	P(UserPropertySet)		readUserPropertySet( Scene* scene=0 );
+
+	/**
+	 * Reads baked scene image from the stream.
+	 * @exception IOException
+	 */
+	P(BakedScene)			readBakedScene();
 		
 	/**
 	 * Reads vertex format from the input stream.
@@ -134,8 +149,17 @@ public:
 	 */
 	void					readVertexFormat( NS(gr,VertexFormat)* vf );
 
+	/**
+	 * Enables/disables vertex cache, overdraw and vertex fetch optimization
+	 * of primitives read by readPrimitive. Default is disabled.
+	 * @see NS(gr,PrimitiveOptimizer)
+	 */
+	void					setOptimizePrimitives( bool enabled );
+
 	/**
 	 * Reads geometry primitive data from the input stream.
+	 * If primitive optimization is enabled then triangle and vertex
+	 * order of indexed triangle lists is optimized after reading.
 	 * @param materialindex [out] Receives material index of the primitive.
 	 * @exception IOException
 	 */
@@ -171,11 +195,20 @@ public:
 	 */
 	NS(gr,Context)::PlatformType	platform() const;
 
+	/**
+	 * Returns accumulated results of primitive optimization.
+	 * @see setOptimizePrimitives
+	 */
+	const NS(gr,PrimitiveOptimizer)::Statistics&	primitiveStatistics() const	{return m_primStats;}
+
 private:
 	int							m_ver;
 	int							m_exporterVer;
 	int							m_dataFlags;
 	NS(gr,Context)::PlatformType	m_platformID;
+	bool						m_optimizePrimitives;
+	NS(gr,PrimitiveOptimizer)::Statistics	m_primStats;
+	P(NS(io,InflateInputStream))	m_inflate;
 
 	SceneInputStream( const SceneInputStream& );
 	SceneInputStream& operator=( const SceneInputStream& );
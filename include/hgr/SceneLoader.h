@@ -0,0 +1,277 @@
+#ifndef _HGR_SCENELOADER_H
+#define _HGR_SCENELOADER_H
+
+
+#include <io/PathName.h>
+#include <io/InputStream.h>
+#include <lang/Array.h>
+#include <lang/Mutex.h>
+#include <lang/ThreadPool.h>
+#include <math/float3x4.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(gr)
+	class Context;
+	class Shader;
+	class Primitive;
+	class BaseTexture;END_NAMESPACE()
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+class Node;
+class Mesh;
+class Scene;
+class BakedScene;
+class TransformAnimation;
+class ResourceManager;
+class SceneInputStream;
+
+
+/**
+ * Loads scene from hgr file in steps, optionally in background.
+ *
+ * When created with a thread pool, scene file and texture files
+ * referenced by the scene are read to memory by a pool job.
+ * After that update() creates textures, materials, primitives and nodes
+ * in calling thread, spending at most specified time per call,
+ * so that for example a game can keep rendering loading screen
+ * while a level is being loaded. Scene nodes and other objects
+ * are created only by the calling thread, since Strings
+ * and reference counts are not shared between threads.
+ *
+ * Usage example:
+ * <pre>
+ * P(SceneLoader) loader = new SceneLoader( pool, context, "data/level1.hgr" );
+ * while ( !loader->update(10) )
+ *     renderLoadingScreen( loader->progress() );
+ * P(Scene) scene = loader->scene();
+ * </pre>
+ *
+ * Scenes can also be baked to relocatable images (see BakedScene)
+ * offline, in which case loading skips parsing and validation of
+ * individual fields, and linking of the nodes is done with
+ * pre-computed indices.
+ *
+ * @ingroup hgr
+ */
+class SceneLoader :
+	public NS(lang,Object)
+{
+public:
+	/**
+	 * Starts loading a scene from hgr file in background.
+	 * @param pool Thread pool which reads the files. Pool is not owned by the loader and must exist until the loader has been destroyed.
+	 * @param context Rendering context to be used while loading.
+	 * @param filename Scene file name relative to current working directory.
+	 * @param res Resource manager to load textures and particles from.
+	 * @param texturepath Texture path relative to current working directory.
+	 * @param shaderpath Shader path relative to current working directory.
+	 * @param particlepath Particle system path relative to current working directory.
+	 * @param loadflags Scene loading options. See NS(Scene,LoadFlags).
+	 */
+	SceneLoader( NS(lang,ThreadPool)* pool, NS(gr,Context)* context, const NS(lang,String)& filename,
+		ResourceManager* res=0,
+		const NS(lang,String)& texturepath="",
+		const NS(lang,String)& shaderpath="",
+		const NS(lang,String)& particlepath="",
+		int loadflags=0 );
+
+	/**
+	 * Prepares to load scene data from a stream to existing scene.
+	 * All loading is done in calling thread.
+	 * @param scene Scene to load to. Name of the scene is used as file name.
+	 * @param in Scene data input stream.
+	 */
+	SceneLoader( Scene* scene, NS(io,InputStream)* in, NS(gr,Context)* context,
+		ResourceManager* res=0,
+		const NS(lang,String)& texturepath="",
+		const NS(lang,String)& shaderpath="",
+		const NS(lang,String)& particlepath="",
+		int loadflags=0 );
+
+	/**
+	 * Waits until background reading has been finished.
+	 */
+	~SceneLoader();
+
+	/**
+	 * Continues loading the scene in calling thread.
+	 * Returns immediately if files are still being read in background.
+	 * @param maxtime Maximum time to spend in milliseconds. Single loading step
+	 * (texture, primitive, etc.) is always completed, so actual time can be longer.
+	 * @return true if the scene has been loaded.
+	 * @exception IOException
+	 * @exception GraphicsException
+	 */
+	bool	update( int maxtime );
+
+	/**
+	 * Completes loading the scene in calling thread.
+	 * @return Loaded scene.
+	 * @exception IOException
+	 * @exception GraphicsException
+	 */
+	Scene*	finish();
+
+	/**
+	 * Returns true if the scene has been loaded.
+	 */
+	bool	finished() const;
+
+	/**
+	 * Returns approximate loading progress, 0 at start and 1 when finished.
+	 */
+	float	progress() const;
+
+	/**
+	 * Returns loaded scene or 0 if loading is not finished.
+	 */
+	Scene*	scene() const;
+
+	/**
+	 * Creates baked image of the loaded scene.
+	 * Scene must have been loaded with NS(Scene,LOAD_BAKE) flag.
+	 * Write the image to a scene file with NS(SceneOutputStream,writeBakedScene).
+	 * @exception IOException
+	 */
+	P(BakedScene)	bake();
+
+	/**
+	 * Loads hgr scene file and writes it baked to another file.
+	 * Baked scene can be used only on the same platform.
+	 * @param context Rendering context to be used while loading.
+	 * @param filename Scene file name relative to current working directory.
+	 * @param bakedfilename Baked scene file name relative to current working directory.
+	 * @param res Resource manager to load textures and particles from.
+	 * @param texturepath Texture path relative to current working directory.
+	 * @param shaderpath Shader path relative to current working directory.
+	 * @param particlepath Particle system path relative to current working directory.
+	 * @param loadflags Scene loading options. See NS(Scene,LoadFlags).
+	 * @param compress Compress baked scene data.
+	 * @return Size of baked image in bytes.
+	 * @exception IOException
+	 * @exception GraphicsException
+	 */
+	static int		bakeFile( NS(gr,Context)* context, const NS(lang,String)& filename,
+						const NS(lang,String)& bakedfilename,
+						ResourceManager* res=0,
+						const NS(lang,String)& texturepath="",
+						const NS(lang,String)& shaderpath="",
+						const NS(lang,String)& particlepath="",
+						int loadflags=0, bool compress=false );
+
+private:
+	enum Stage
+	{
+		STAGE_READ,
+		STAGE_HEADER,
+		STAGE_TEXTURES,
+		STAGE_MATERIALS,
+		STAGE_PRIMITIVES,
+		STAGE_MESHES,
+		STAGE_CAMERAS,
+		STAGE_LIGHTS,
+		STAGE_DUMMIES,
+		STAGE_LINES,
+		STAGE_NODES,
+		STAGE_ANIMATIONS,
+		STAGE_USERPROPERTIES,
+		STAGE_LINK,
+		STAGE_DONE
+	};
+
+	struct MeshBoneCount {Mesh* mesh; int bonecount;};
+	struct MeshBone {int boneindex; NS(math,float3x4) invresttm;};
+	class ReadJob;
+
+	Scene*									m_scene;
+	P(Scene)								m_sceneRef;
+	P(NS(gr,Context))						m_context;
+	P(ResourceManager)						m_res;
+	int										m_loadFlags;
+	char									m_texturePath[NS(io,PathName)::MAXLEN];
+	char									m_shaderPath[NS(io,PathName)::MAXLEN];
+	char									m_particlePath[NS(io,PathName)::MAXLEN];
+	NS(lang,String)							m_texturePathString;
+	NS(lang,String)							m_shaderPathString;
+
+	NS(lang,ThreadPool)*					m_pool;
+	ReadJob*								m_job;
+	NS(lang,ThreadPool)::Batch				m_batch;
+	mutable NS(lang,Mutex)					m_mutex;
+	float									m_readProgress;
+	bool									m_readDone;
+
+	NS(io,InputStream)*						m_source;
+	P(NS(io,InputStream))					m_sourceRef;
+	P(SceneInputStream)						m_in;
+	P(BakedScene)							m_baked;
+	P(BakedScene)							m_bake;
+	int										m_sourceSize;
+	int										m_stage;
+	int										m_count;
+	int										m_index;
+	int										m_checkId;
+	int										m_exporterVersion;
+
+	NS(lang,Array)<char>					m_buf;
+	NS(lang,Array)<char>					m_propText;
+	NS(lang,Array)<char>					m_propName;
+	NS(lang,Array)<P(NS(gr,BaseTexture))>	m_textures;
+	NS(lang,Array)<P(NS(gr,Shader))>		m_materials;
+	NS(lang,Array)<P(NS(gr,Primitive))>		m_primitives;
+	NS(lang,Array)<P(Node)>					m_nodes;
+	NS(lang,Array)<NS(lang,String)>			m_nodeNames;
+	NS(lang,Array)<int>						m_nodeParents;
+	NS(lang,Array)<MeshBoneCount>			m_meshBoneCounts;
+	NS(lang,Array)<MeshBone>				m_meshBones;
+
+	void	init( NS(gr,Context)* context, ResourceManager* res, const NS(lang,String)& filename,
+				const NS(lang,String)& texturepath, const NS(lang,String)& shaderpath,
+				const NS(lang,String)& particlepath, int loadflags );
+	bool	pollRead();
+	void	step();
+	void	beginSection();
+	void	readHeader();
+	void	readTexture( int i );
+	void	readMaterial( int i );
+	void	readPrimitive( int i );
+	void	readMesh( int i );
+	void	readCamera();
+	void	readLight();
+	void	readDummy();
+	void	readLines();
+	void	readOtherNode();
+	void	readTransformAnimation( int i );
+	P(TransformAnimation)	shareAnimation( TransformAnimation* anim );
+	void	link();
+	void	linkUserProperties();
+	void	releaseLoadingData();
+	void	readId();
+	void	readNode( Node* node );
+	void	loadTexture( int i, const char* filename, int type );
+
+	void	beginBakedSection();
+	void	createBakedTexture( int i );
+	void	createBakedMaterial( int i );
+	void	createBakedPrimitive( int i );
+	void	createBakedNode( int i );
+	void	createBakedAnimation( int i );
+	void	createBakedUserProperty( int i );
+	void	linkBaked();
+	void	bakePrimitive( NS(gr,Primitive)* prim, int material );
+
+	SceneLoader( const SceneLoader& );
+	SceneLoader& operator=( const SceneLoader& );
+};
+
+
+END_NAMESPACE() // hgr
+
+
+#endif // _HGR_SCENELOADER_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
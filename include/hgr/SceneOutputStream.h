@@ -3,6 +3,7 @@
 
 
 #include <io/DataOutputStream.h>
+#include <io/DeflateOutputStream.h>
 #include <gr/Shader.h>
 #include <gr/Context.h>
 #include <hgr/TransformAnimation.h>
@@ -28,6 +29,7 @@ class Dummy;
 class Lines;
 class Light;
 class Camera;
+class BakedScene;
 class UserPropertySet;
 class KeyframeSequence;
 
@@ -47,6 +49,8 @@ public:
 
 	/**
 	 * Prepares to write scene to the output stream.
+	 * If dataflags has DATA_COMPRESSED set then data after the file header
+	 * is compressed and finish() must be called after the scene has been written.
 	 * @param out Output stream
 	 * @param dataflags Data content descriptor. See NS(SceneInputStream,DataFlags).
 	 * @param platformid Content platform id.
@@ -178,6 +182,19 @@ public:
 	 */
 	void	writeUserPropertySet( UserPropertySet* obj );
 
+	/**
+	 * Writes baked scene image to the output stream.
+	 * Scene stream must have been created with DATA_BAKED flag.
+	 * @exception IOException
+	 */
+	void	writeBakedScene( BakedScene* obj );
+
+	/**
+	 * Completes writing of compressed scene. Does nothing if the scene is not compressed.
+	 * @exception IOException
+	 */
+	void	finish();
+
 	/**
 	 * Returns true if the scene file has specified data.
 	 * @see DataFlags
@@ -186,6 +203,7 @@ public:
 
 private:
 	int		m_dataFlags;
+	P(NS(io,DeflateOutputStream))	m_deflate;
 
 	SceneOutputStream( const SceneOutputStream& );
 	SceneOutputStream& operator=( const SceneOutputStream& );
@@ -10,7 +10,8 @@
  * 
  * Scene files can be loaded by creating Scene class instance
  * with scene file name as parameter (and additional paths for
- * textures and shaders if needed).
+ * textures and shaders if needed). SceneLoader loads scenes
+ * in background and completes them in time-sliced steps.
  *
  * Key-framed animation playback is handled by TransformAnimation
  * and TransformAnimationSet classes. For simple usage example
@@ -31,6 +32,8 @@
  * @{
  */
 
+#include <hgr/BakedScene.h>
+#include <hgr/BoundingVolumeTree.h>
 #include <hgr/Camera.h>
 #include <hgr/Console.h>
 #include <hgr/DefaultPipe.h>
@@ -45,8 +48,10 @@
 #include <hgr/ParticleSystem.h>
 #include <hgr/Pipe.h>
 #include <hgr/PipeSetup.h>
+#include <hgr/RayCaster.h>
 #include <hgr/Scene.h>
 #include <hgr/SceneInputStream.h>
+#include <hgr/SceneLoader.h>
 #include <hgr/SceneOutputStream.h>
 #include <hgr/TransformAnimation.h>
 #include <hgr/TransformAnimationSet.h>
@@ -0,0 +1,28 @@
+#ifndef _HGR_TEST_H
+#define _HGR_TEST_H
+
+
+BEGIN_NAMESPACE(lang)
+	class String;END_NAMESPACE()
+
+BEGIN_NAMESPACE(gr)
+	class Context;END_NAMESPACE()
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+/**
+ * Performs hgr library internal tests.
+ * @param context Rendering context used to load scenes. Scene loading tests are skipped if 0.
+ * @param datapath Path to directory with scene (.hgr) files used in loading tests.
+ */
+void test( NS(gr,Context)* context, const NS(lang,String)& datapath );
+
+
+END_NAMESPACE() // hgr
+
+
+#endif // _HGR_TEST_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -68,7 +68,7 @@ public:
 	/**
 	 * Returns access to pixel data.
 	 */
-	const uint32_t*		bits()		{return &m_bits[0];}
+	uint32_t*			bits()		{return &m_bits[0];}
 
 	/**
 	 * Reads image pixel at specified coordinates. Top left is (0,0).
@@ -0,0 +1,166 @@
+#ifndef _IMG_IMAGEBATCHREADER_H
+#define _IMG_IMAGEBATCHREADER_H
+
+
+#include <gr/SurfaceFormat.h>
+#include <lang/Ptr.h>
+#include <lang/Array.h>
+#include <lang/Event.h>
+#include <lang/Mutex.h>
+#include <lang/String.h>
+#include <lang/Object.h>
+#include <lang/ThreadPool.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(img)
+
+
+/**
+ * Decodes batch of image files in parallel using a thread pool.
+ * Files are read and decoded by the worker threads and decoded
+ * images are returned in completion order by next().
+ *
+ * Memory usage is bounded by back-pressure: new files are not
+ * started while decoded but not yet returned images
+ * use more than specified number of bytes, and at most
+ * specified number of files are decoded at the same time.
+ *
+ * Usage example:
+ * <pre>
+   ThreadPool pool;
+   ImageBatchReader reader( &pool );
+   for ( int i = 0 ; i < filenames.size() ; ++i )
+       reader.add( filenames[i] );
+   for ( P(ImageBatchReader::Result) res = reader.next() ; res != 0 ; res = reader.next() )
+       ...
+   </pre>
+ *
+ * @ingroup img
+ */
+class ImageBatchReader :
+	public NS(lang,Object)
+{
+public:
+	/**
+	 * Decoded surface pixel data.
+	 */
+	class Surface
+	{
+	public:
+		/** Pixel data in the format requested from the reader. */
+		NS(lang,Array)<uint8_t>	data;
+		/** Width of the surface in pixels. */
+		int						width;
+		/** Height of the surface in pixels. */
+		int						height;
+		/** Distance between pixel rows in bytes. */
+		int						pitch;
+	};
+
+	/**
+	 * Decoded image file.
+	 */
+	class Result :
+		public NS(lang,Object)
+	{
+	public:
+		/** Name of the image file. */
+		NS(lang,String)			filename;
+		/** Index of the file in the order the files were added. */
+		int						index;
+		/** Pixel format of the surfaces. */
+		NS(gr,SurfaceFormat)	format;
+		/** Number of mipmap levels in the file. */
+		int						mipLevels;
+		/** True if the image is cube map. */
+		bool					cubeMap;
+		/** Surfaces in ImageReader::readSurface iteration order. */
+		NS(lang,Array)<Surface>	surfaces;
+		/** Error message if decoding failed, empty otherwise. */
+		NS(lang,String)			error;
+
+		Result();
+
+		/** Returns total size of surface data in bytes. */
+		int		bytes() const;
+
+		/** Returns true if decoding failed. */
+		bool	failed() const		{return error.length() > 0;}
+	};
+
+	/**
+	 * Creates batch reader.
+	 * @param pool Thread pool used for decoding. Pool is not owned.
+	 * @param format Pixel format of the decoded surfaces. Must be non-palettized.
+	 * @param maxbytes Maximum size of decoded images waiting to be returned before decoding is paused.
+	 * @param maxjobs Maximum number of images decoded at the same time. 0 uses number of threads plus one.
+	 */
+	explicit ImageBatchReader( NS(lang,ThreadPool)* pool,
+		NS(gr,SurfaceFormat) format=NS(gr,SurfaceFormat)::SURFACE_A8R8G8B8,
+		int maxbytes=32<<20, int maxjobs=0 );
+
+	/**
+	 * Waits for decoding in progress to finish.
+	 */
+	~ImageBatchReader();
+
+	/**
+	 * Adds image file to be decoded.
+	 */
+	void			add( const NS(lang,String)& filename );
+
+	/**
+	 * Returns next decoded image. Blocks until an image is available.
+	 * Decoding errors are reported in Result::error.
+	 * @return 0 if all added images have been returned.
+	 */
+	P(Result)		next();
+
+	/**
+	 * Returns number of added images which have not been returned yet.
+	 */
+	int				remaining() const;
+
+	/**
+	 * Returns number of bytes used by decoded images waiting to be returned.
+	 */
+	int				bufferedBytes() const;
+
+	/**
+	 * Returns pixel format of the decoded surfaces.
+	 */
+	NS(gr,SurfaceFormat)	format() const		{return m_format;}
+
+private:
+	class DecodeJob;
+
+	NS(lang,ThreadPool)*			m_pool;
+	NS(gr,SurfaceFormat)			m_format;
+	int								m_maxBytes;
+	NS(lang,Array)<DecodeJob*>		m_jobs;
+	NS(lang,Array)<DecodeJob*>		m_freeJobs;
+	NS(lang,Array)<NS(lang,String)>	m_files;
+	int								m_nextFile;
+	NS(lang,Array)<DecodeJob*>		m_completed;
+	int								m_running;
+	int								m_bufferedBytes;
+	int								m_returned;
+	mutable NS(lang,Mutex)			m_mutex;
+	NS(lang,Event)					m_completedEvent;
+	NS(lang,ThreadPool)::Batch		m_batch;
+
+	void	startJobs();
+	void	finishJob( DecodeJob* job );
+
+	ImageBatchReader( const ImageBatchReader& );
+	ImageBatchReader& operator=( const ImageBatchReader& );
+};
+
+
+END_NAMESPACE() // img
+
+
+#endif // _IMG_IMAGEBATCHREADER_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
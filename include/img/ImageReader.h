@@ -67,9 +67,11 @@ public:
 			FLAG_COLORKEY	= 1,
 			/** Enable compression. */
 			FLAG_COMPRESS	= 2,
+			/** Mipmap level count (16-bit) follows the header and level pixel data follows the top level. */
+			FLAG_MIPMAPS	= 4,
 		};
 
-		/** Version number of the file. Currently 0x102. */
+		/** Version number of the file. Currently 0x104. */
 		uint16_t	version;
 		/** Width of image in pixels. */
 		uint16_t	width;
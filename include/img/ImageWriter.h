@@ -44,6 +44,22 @@ public:
 					const void* bits, int width, int height, int pitch, NS(gr,SurfaceFormat) format,
 					int flags, int userflags );
 
+	/**
+	 * Saves image with mipmap levels as NTX file.
+	 * Palette is not used for files with more than one level or with DXT-compressed format.
+	 * @param levelbits Pixel data of each level, largest first. Each level is half size of the previous one (min 1).
+	 * @param levelpitches Distance between pixel rows (rows of 4x4 blocks in DXT formats) in bytes of each level.
+	 * @param levels Number of levels.
+	 * @param flags NTXFlags.
+	 * @param userflags User defined flags. Doesn't affect the image in any way.
+	 * @exception IOException
+	 * @return Number of bytes written to the stream.
+	 */
+	static int	writeNTX( const NS(lang,String)& filename,
+					const void* const* levelbits, const int* levelpitches, int levels, 
+					int width, int height, NS(gr,SurfaceFormat) format,
+					int flags, int userflags );
+
 	/**
 	 * Saves image as PNG file.
 	 * @exception IOException
@@ -0,0 +1,119 @@
+#ifndef _IMG_MIPMAPGENERATOR_H
+#define _IMG_MIPMAPGENERATOR_H
+
+
+#include <img/Image.h>
+#include <lang/Ptr.h>
+#include <lang/Array.h>
+#include <lang/Object.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(lang) 
+	class String;
+	class ThreadPool;END_NAMESPACE()
+
+
+BEGIN_NAMESPACE(img) 
+
+
+class ImageReader;
+
+
+/**
+ * Generates mipmap chains for 32-bit A8R8G8B8 images.
+ * Each level is filtered from the previous one in linear color space
+ * using floating point intermediate buffers, so quantization errors
+ * do not accumulate down the chain. Color channels are optionally
+ * treated as sRGB (gamma-correct filtering), alpha is always linear.
+ * If thread pool is set then each level is split to horizontal bands
+ * which are filtered in parallel.
+ * @ingroup img
+ */
+class MipMapGenerator :
+	public NS(lang,Object)
+{	
+public:
+	/** Downsampling filter type. */
+	enum FilterType
+	{
+		/** Area-weighted box filter. Fast, slightly blurry. */
+		FILTER_BOX,
+		/** Kaiser-windowed sinc filter. Sharper, costs more. */
+		FILTER_KAISER,
+	};
+
+	/**
+	 * Creates mipmap generator.
+	 * @param filter Downsampling filter.
+	 * @param srgb If true then color channels are converted to linear space before filtering.
+	 * @param pool Optional thread pool used for filtering. Pool is not owned.
+	 */
+	explicit MipMapGenerator( FilterType filter=FILTER_BOX, bool srgb=true, NS(lang,ThreadPool)* pool=0 );
+
+	///
+	~MipMapGenerator();
+
+	/**
+	 * Generates mipmap chain from the image. 
+	 * First level of the output is a copy of the source image.
+	 * @param img Source image.
+	 * @param levels [out] Receives mipmap levels, largest first.
+	 * @param maxlevels Maximum number of levels to generate, or 0 for full chain down to 1x1.
+	 */
+	void	generate( const Image* img, NS(lang,Array)<P(Image)>& levels, int maxlevels=0 ) const;
+
+	/**
+	 * Reads current surface of the image reader and generates mipmap chain from it.
+	 * @exception IOException
+	 */
+	void	generate( ImageReader* reader, NS(lang,Array)<P(Image)>& levels, int maxlevels=0 ) const;
+
+	/**
+	 * Sets downsampling filter type.
+	 */
+	void	setFilter( FilterType filter );
+
+	/**
+	 * Sets thread pool to be used in filtering. Pass 0 to filter in calling thread only.
+	 */
+	void	setThreadPool( NS(lang,ThreadPool)* pool );
+
+	/**
+	 * Returns downsampling filter type.
+	 */
+	FilterType	filter() const;
+
+	/**
+	 * Returns number of mipmap levels in full chain of specified size image, including top level.
+	 */
+	static int	getLevelCount( int width, int height );
+
+	/**
+	 * Writes mipmap levels to NTX file.
+	 * @param levels Mipmap levels, largest first. Each level must be half size of the previous one.
+	 * @param format Pixel format of the stored file.
+	 * @param flags ImageWriter::NTXFlags.
+	 * @param userflags User defined flags.
+	 * @return Number of bytes written.
+	 * @exception IOException
+	 */
+	static int	writeNTX( const NS(lang,String)& filename, const NS(lang,Array)<P(Image)>& levels,
+					NS(gr,SurfaceFormat) format, int flags=0, int userflags=0 );
+
+private:
+	FilterType				m_filter;
+	bool					m_srgb;
+	NS(lang,ThreadPool)*	m_pool;
+
+	MipMapGenerator( const MipMapGenerator& );
+	MipMapGenerator& operator=( const MipMapGenerator& );
+};
+
+
+END_NAMESPACE() // img
+
+
+#endif // _IMG_MIPMAPGENERATOR_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
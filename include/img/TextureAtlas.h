@@ -0,0 +1,138 @@
+#ifndef _IMG_TEXTUREATLAS_H
+#define _IMG_TEXTUREATLAS_H
+
+
+#include <img/Image.h>
+#include <lang/Ptr.h>
+#include <lang/Array.h>
+#include <lang/String.h>
+#include <lang/Object.h>
+
+
+BEGIN_NAMESPACE(img)
+
+
+/**
+ * Merges many small images to a single texture atlas image.
+ * Images are packed using skyline bottom-left rectangle packing.
+ * Each packed image is surrounded by padding pixels which
+ * replicate the image edges to avoid filtering artifacts.
+ * Texture coordinates of a source image are mapped to the atlas by
+ * u' = u*uscale + ubias and v' = v*vscale + vbias.
+ * @ingroup img
+ */
+class TextureAtlas :
+	public NS(lang,Object)
+{
+public:
+	/**
+	 * Placement of a single image in the atlas.
+	 */
+	class Entry
+	{
+	public:
+		/** Name of the image. */
+		NS(lang,String)	name;
+		/** Left edge of the image in atlas pixels. */
+		int				x;
+		/** Top edge of the image in atlas pixels. */
+		int				y;
+		/** Width of the image in pixels. */
+		int				width;
+		/** Height of the image in pixels. */
+		int				height;
+		/** Texture coordinate scale in u-direction. */
+		float			uscale;
+		/** Texture coordinate scale in v-direction. */
+		float			vscale;
+		/** Texture coordinate bias in u-direction. */
+		float			ubias;
+		/** Texture coordinate bias in v-direction. */
+		float			vbias;
+
+		Entry();
+	};
+
+	/**
+	 * Creates empty atlas.
+	 * @param maxwidth Maximum width of the atlas image.
+	 * @param maxheight Maximum height of the atlas image.
+	 * @param padding Number of padding pixels around each image.
+	 */
+	explicit TextureAtlas( int maxwidth=2048, int maxheight=2048, int padding=1 );
+
+	///
+	~TextureAtlas();
+
+	/**
+	 * Adds image to be packed.
+	 * @return Index of the entry.
+	 */
+	int		add( const NS(lang,String)& name, Image* img );
+
+	/**
+	 * Packs added images to atlas image. Atlas size is the smallest
+	 * power-of-two size (up to maximum) the images fit in.
+	 * @exception Exception If the images do not fit maximum size atlas.
+	 */
+	void	build();
+
+	/**
+	 * Returns atlas image. Valid after build().
+	 */
+	Image*	image() const;
+
+	/**
+	 * Returns number of entries.
+	 */
+	int		entries() const;
+
+	/**
+	 * Returns ith entry.
+	 */
+	const Entry&	getEntry( int i ) const;
+
+	/**
+	 * Returns index of named entry or -1 if not found.
+	 */
+	int		indexOf( const NS(lang,String)& name ) const;
+
+	/**
+	 * Writes atlas image as NTX file.
+	 * @param format Pixel format of the stored file.
+	 * @param flags ImageWriter::NTXFlags.
+	 * @param userflags User defined flags.
+	 * @return Number of bytes written.
+	 * @exception IOException
+	 */
+	int		writeNTX( const NS(lang,String)& filename, NS(gr,SurfaceFormat) format, int flags=0, int userflags=0 ) const;
+
+	/**
+	 * Writes texture coordinate remap table as text file.
+	 * Each line contains 'name=x y width height uscale vscale ubias vbias',
+	 * so the table can be read with io::PropertyParser.
+	 * @exception IOException
+	 */
+	void	writeUVTable( const NS(lang,String)& filename ) const;
+
+private:
+	NS(lang,Array)<Entry>		m_entries;
+	NS(lang,Array)<P(Image)>	m_images;
+	P(Image)					m_image;
+	int							m_maxWidth;
+	int							m_maxHeight;
+	int							m_padding;
+
+	bool	pack( int w, int h );
+
+	TextureAtlas( const TextureAtlas& );
+	TextureAtlas& operator=( const TextureAtlas& );
+};
+
+
+END_NAMESPACE() // img
+
+
+#endif // _IMG_TEXTUREATLAS_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -11,6 +11,9 @@
 #include <img/ImageReader.h>
 #include <img/ImageWriter.h>
 #include <img/ShapeUtil.h>
+#include <img/MipMapGenerator.h>
+#include <img/TextureAtlas.h>
+#include <img/ImageBatchReader.h>
 	
 	
 /** @} */
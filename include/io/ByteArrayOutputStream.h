@@ -7,24 +7,41 @@
 #include <stdint.h>
 
 
-BEGIN_NAMESPACE(io) 
+BEGIN_NAMESPACE(io)
 
 
 /**
  * ByteArrayOutputStream writes bytes to a memory buffer.
- * 
+ *
+ * By default the data is stored in a list of chunks, so already
+ * written bytes are never moved when the buffer grows. Chunks
+ * can be accessed directly with chunks() and chunk(), or written
+ * to another stream with writeTo(). toByteArray() copies
+ * the chunks to a single contiguous array.
+ *
+ * If the stream is created to a user defined buffer, the data is
+ * written directly to the user buffer, which grows as needed.
+ *
  * @ingroup io
  */
 class ByteArrayOutputStream :
 	public OutputStream
 {
 public:
-	/** 
+	enum Constants
+	{
+		/** Size of the first chunk, if initial capacity is not specified. */
+		DEFAULT_CHUNK_SIZE	= 4*1024,
+		/** Chunk size is doubled up to this limit as the buffer grows. */
+		MAX_CHUNK_SIZE		= 1024*1024,
+	};
+
+	/**
 	 * Creates an output stream to a memory buffer of specified initial capacity.
 	 */
 	explicit ByteArrayOutputStream( int size=0 );
 
-	/** 
+	/**
 	 * Creates an output stream to a user defined memory buffer.
 	 * Note that user defined memory buffer is NOT deleted when ByteArrayOutputStream is deleted.
 	 */
@@ -33,18 +50,46 @@ public:
 	///
 	~ByteArrayOutputStream();
 
-	/** Discards all written bytes and resets write pointer. */
+	/**
+	 * Discards all written bytes and resets write pointer.
+	 * Allocated memory is kept for reuse.
+	 */
 	void			reset();
 
+	/**
+	 * Makes sure that at least specified number of bytes can be
+	 * written without allocating memory, and that the bytes
+	 * will be stored contiguously in a single chunk.
+	 */
+	void			reserve( int bytes );
+
 	/**
 	 * Writes specified number of bytes to the stream.
 	 */
 	void			write( const void* data, int size );
 
 	/**
-	 * Returns pointer to the memory buffer used by the stream.
+	 * Writes contents of the stream to another stream with a single gather write.
+	 * @exception IOException
 	 */
-	const NS(lang,Array)<uint8_t>&	toByteArray() const							{return *m_buffer;}
+	void			writeTo( OutputStream* out ) const;
+
+	/**
+	 * Returns reference to the contiguous memory buffer of the stream.
+	 * If the data is stored in chunks, the chunks are first
+	 * copied to the buffer, so chunk() is preferred for large streams.
+	 */
+	const NS(lang,Array)<uint8_t>&	toByteArray() const;
+
+	/**
+	 * Returns number of chunks containing written bytes.
+	 */
+	int				chunks() const;
+
+	/**
+	 * Returns pointer to ith chunk and number of bytes in the chunk.
+	 */
+	const uint8_t*	chunk( int i, int* size ) const;
 
 	/**
 	 * Returns number of bytes written to the stream.
@@ -55,8 +100,23 @@ public:
 	NS(lang,String)	toString() const;
 
 private:
+	struct Chunk
+	{
+		uint8_t*	data;
+		int			size;
+		int			capacity;
+	};
+
 	NS(lang,Array)<uint8_t>*	m_buffer;
+	NS(lang,Array)<Chunk>		m_chunks;
+	int							m_chunk;
+	int							m_size;
+	int							m_nextChunkSize;
 	bool						m_userDefined;
+	mutable bool				m_bufferValid;
+
+	void			nextChunk( int bytes );
+	void			writeUser( const void* data, int size );
 
 	ByteArrayOutputStream( const ByteArrayOutputStream& );
 	ByteArrayOutputStream& operator=( const ByteArrayOutputStream& );
@@ -14,6 +14,12 @@ BEGIN_NAMESPACE(io)
 
 /**
  * Class for reading primitive types from the input stream in portable way.
+ *
+ * Data is read from the source stream in blocks to a read-ahead buffer, 
+ * so primitive reads are decoded directly from the buffer without
+ * calling the source stream. Because of read-ahead, position of the source
+ * stream can be ahead of the data stream position. Use buffer size 0
+ * if the source stream is accessed also directly.
  * 
  * @ingroup io
  */
@@ -22,8 +28,18 @@ class DataInputStream :
 	public DataInput
 {
 public:
-	///
-	explicit DataInputStream( InputStream* in );
+	enum Constants
+	{
+		/** Default size of the read-ahead buffer in bytes. */
+		DEFAULT_BUFFER_SIZE = 8192,
+	};
+
+	/**
+	 * Creates data input stream.
+	 * @param in Source stream.
+	 * @param bufsize Size of the read-ahead buffer. 0 disables read-ahead.
+	 */
+	explicit DataInputStream( InputStream* in, int bufsize=DEFAULT_BUFFER_SIZE );
 
 	///
 	~DataInputStream();
@@ -52,6 +68,20 @@ public:
 	 */
 	void readFully( void* data, int size );
 
+	/** 
+	 * Returns the number of bytes that can be read from the stream without blocking.
+	 * Includes bytes in the read-ahead buffer.
+	 *
+	 * @exception IOException
+	 */
+	int available() const;
+
+	/** 
+	 * Returns number of bytes read from the stream.
+	 * Bytes in the read-ahead buffer are not included.
+	 */
+	int bytesRead() const;
+
 	/**
 	 * Reads boolean from the stream.
 	 *
@@ -136,10 +166,36 @@ public:
 	 */
 	void readUTF( NS(lang,Array)<char>& buf );
 
+	/**
+	 * Reads array of big-endian 32-bit floats from the stream.
+	 *
+	 * @exception IOException
+	 */
+	void readFloatArrayBE( float* data, int count );
+
+	/**
+	 * Reads array of big-endian 16-bit signed integers from the stream.
+	 *
+	 * @exception IOException
+	 */
+	void readInt16ArrayBE( int16_t* data, int count );
+
+protected:
+	/**
+	 * Changes the source stream and size of the read-ahead buffer.
+	 * Read-ahead buffer must be empty.
+	 */
+	void			setSource( InputStream* in, int bufsize );
+
 private:
 	NS(lang,Array)<uint8_t> m_buf;
+	NS(lang,Array)<uint8_t> m_readBuffer;
+	const uint8_t*			m_readPos;
+	const uint8_t*			m_readEnd;
 
-	void	readBE( void* data, int size );
+	void			readBE( void* data, int size );
+	void			fillBuffer();
+	const uint8_t*	readBytes( uint8_t* tmp, int size );
 
 	DataInputStream();
 	DataInputStream( const DataInputStream& );
@@ -147,6 +203,9 @@ private:
 };
 
 
+#include <io/DataInputStream.inl>
+
+
 END_NAMESPACE() // io
 
 
@@ -0,0 +1,54 @@
+inline const uint8_t* DataInputStream::readBytes( uint8_t* tmp, int size )
+{
+	const uint8_t* p = m_readPos;
+	if ( m_readEnd - p >= size )
+	{
+		m_readPos = p + size;
+		return p;
+	}
+	readFully( tmp, size );
+	return tmp;
+}
+
+inline bool DataInputStream::readBoolean()
+{
+	uint8_t tmp[1];
+	return *readBytes( tmp, 1 ) != 0;
+}
+
+inline uint8_t DataInputStream::readByte()
+{
+	uint8_t tmp[1];
+	return *readBytes( tmp, 1 );
+}
+
+inline char DataInputStream::readChar()
+{
+	uint8_t tmp[1];
+	return (char)*readBytes( tmp, 1 );
+}
+
+inline float DataInputStream::readFloat()
+{
+	uint8_t tmp[4];
+	const uint8_t* p = readBytes( tmp, 4 );
+	uint32_t v = (uint32_t(p[0])<<24) + (uint32_t(p[1])<<16) + (uint32_t(p[2])<<8) + uint32_t(p[3]);
+	return *reinterpret_cast<float*>( &v );
+}
+
+inline int DataInputStream::readInt()
+{
+	uint8_t tmp[4];
+	const uint8_t* p = readBytes( tmp, 4 );
+	uint32_t v = (uint32_t(p[0])<<24) + (uint32_t(p[1])<<16) + (uint32_t(p[2])<<8) + uint32_t(p[3]);
+	return (int)(int32_t)v;
+}
+
+inline int DataInputStream::readShort()
+{
+	uint8_t tmp[2];
+	const uint8_t* p = readBytes( tmp, 2 );
+	return (int)(int16_t)( (p[0]<<8) + p[1] );
+}
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -0,0 +1,105 @@
+#ifndef _IO_DEFLATEOUTPUTSTREAM_H
+#define _IO_DEFLATEOUTPUTSTREAM_H
+
+
+#include <io/OutputStream.h>
+#include <lang/Array.h>
+#include <stdint.h>
+
+
+struct z_stream_s;
+
+
+BEGIN_NAMESPACE(io)
+
+
+/**
+ * DeflateOutputStream compresses data with zlib and writes it
+ * to the target stream. Data is compressed in independent blocks,
+ * each prefixed by uncompressed and compressed size (32-bit big-endian).
+ * Blocks which don't compress are stored as is, and the stream is
+ * terminated by a block of size 0. Larger blocks give somewhat
+ * better compression ratio at the cost of memory usage in both ends.
+ * finish() must be called after all data has been written.
+ * The target stream must exist as long as DeflateOutputStream is used.
+ *
+ * @see InflateInputStream
+ * @ingroup io
+ */
+class DeflateOutputStream :
+	public OutputStream
+{
+public:
+	enum Constants
+	{
+		/** Default block size, uncompressed bytes. */
+		DEFAULT_BLOCK_SIZE	= 64*1024,
+		/** Block size for large block mode, uncompressed bytes. */
+		LARGE_BLOCK_SIZE	= 1024*1024,
+		/** Maximum block size accepted by the reader. */
+		MAX_BLOCK_SIZE		= 16*1024*1024,
+	};
+
+	/**
+	 * Starts writing compressed data to specified target stream.
+	 * @param target Target stream for compressed data.
+	 * @param level zlib compression level, 1 (fastest) - 9 (best compression).
+	 * @param blocksize Size of an uncompressed block in bytes.
+	 */
+	explicit DeflateOutputStream( OutputStream* target, int level=6, int blocksize=DEFAULT_BLOCK_SIZE );
+
+	///
+	~DeflateOutputStream();
+
+	/**
+	 * Starts writing new compressed stream. Buffers are reused.
+	 * Previous stream should have been finished.
+	 */
+	void	reset( OutputStream* target );
+
+	/**
+	 * Compresses specified number of bytes to the stream.
+	 * @exception IOException
+	 */
+	void	write( const void* data, int size );
+
+	/**
+	 * Compresses buffered data and writes end of stream marker.
+	 * @exception IOException
+	 */
+	void	finish();
+
+	/** Returns number of uncompressed bytes written to the stream. */
+	int		bytesWritten() const;
+
+	/** Returns number of compressed bytes written to the target stream. */
+	int		compressedBytesWritten() const;
+
+	/** Returns name of the target stream. */
+	NS(lang,String)	toString() const;
+
+private:
+	OutputStream*			m_target;
+	z_stream_s*				m_zs;
+	int						m_level;
+	NS(lang,Array)<uint8_t>	m_block;
+	NS(lang,Array)<uint8_t>	m_compressed;
+	int						m_pos;
+	int						m_bytesWritten;
+	int						m_compressedBytesWritten;
+	bool					m_finished;
+
+	void	writeBlock();
+	void	writeHeader( int size, int compressedsize );
+
+	DeflateOutputStream( const DeflateOutputStream& );
+	DeflateOutputStream& operator=( const DeflateOutputStream& );
+};
+
+
+END_NAMESPACE() // io
+
+
+#endif // _IO_DEFLATEOUTPUTSTREAM_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
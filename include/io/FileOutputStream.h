@@ -36,6 +36,12 @@ public:
 	 */
 	void			write( const void* data, int size );
 
+	/**
+	 * Writes multiple buffers to the stream.
+	 * @exception IOException
+	 */
+	void			writev( const void* const* data, const int* sizes, int count );
+
 	/** Returns name of the file. */
 	NS(lang,String)	toString() const;
 
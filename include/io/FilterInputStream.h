@@ -58,6 +58,12 @@ public:
 	 */
 	NS(lang,String)	toString() const;
 
+protected:
+	/**
+	 * Changes the source stream.
+	 */
+	void	setSource( InputStream* source );
+
 private:
 	InputStream*	m_source;
 	int				m_bytesRead;
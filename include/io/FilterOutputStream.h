@@ -31,12 +31,23 @@ public:
 	 */
 	 void	write( const void* data, int size );
 
+	/**
+	 * Writes multiple buffers to the target stream.
+	 *
+	 * @exception IOException
+	 */
+	void	writev( const void* const* data, const int* sizes, int count );
+
 	 /** Returns name of the target stream. */
 	NS(lang,String)	toString() const;
 
 	/** Returns number of bytes written to the stream. */
 	int				bytesWritten() const;
 
+protected:
+	/** Changes the target stream. */
+	void			setTarget( OutputStream* target );
+
 private:
 	OutputStream*	m_target;
 	int				m_bytesWritten;
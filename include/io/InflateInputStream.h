@@ -0,0 +1,93 @@
+#ifndef _IO_INFLATEINPUTSTREAM_H
+#define _IO_INFLATEINPUTSTREAM_H
+
+
+#include <io/InputStream.h>
+#include <lang/Array.h>
+#include <stdint.h>
+
+
+struct z_stream_s;
+
+
+BEGIN_NAMESPACE(io)
+
+
+/**
+ * InflateInputStream decompresses data written by DeflateOutputStream.
+ * Compressed data is read from the source stream one block at a time,
+ * and each block is decompressed to an internal buffer as soon as
+ * the previous one has been consumed, so available() returns
+ * exact number of bytes decompressed but not yet read.
+ * The buffers grow to the largest block size in the stream
+ * and are kept when the stream is reset to read another source.
+ * The source stream must exist as long as InflateInputStream is used.
+ *
+ * @see DeflateOutputStream
+ * @ingroup io
+ */
+class InflateInputStream :
+	public InputStream
+{
+public:
+	/**
+	 * Starts reading compressed data from specified source stream.
+	 * @exception IOException
+	 */
+	explicit InflateInputStream( InputStream* source );
+
+	///
+	~InflateInputStream();
+
+	/**
+	 * Starts reading new compressed stream. Buffers are reused.
+	 * @exception IOException
+	 */
+	void	reset( InputStream* source );
+
+	/**
+	 * Tries to read specified number of bytes from the stream.
+	 * @return Number of bytes actually read.
+	 * @exception IOException
+	 */
+	int		read( void* data, int size );
+
+	/**
+	 * Returns the number of decompressed bytes that can be read without
+	 * reading more data from the source stream. Returns 0 only at end of stream.
+	 */
+	int		available() const;
+
+	/**
+	 * Returns number of decompressed bytes read from the stream.
+	 */
+	int		bytesRead() const;
+
+	/**
+	 * Returns name of the source stream.
+	 */
+	NS(lang,String)	toString() const;
+
+private:
+	InputStream*			m_source;
+	z_stream_s*				m_zs;
+	NS(lang,Array)<uint8_t>	m_compressed;
+	NS(lang,Array)<uint8_t>	m_block;
+	int						m_pos;
+	int						m_end;
+	int						m_bytesRead;
+
+	void	readBlock();
+	void	readSource( void* data, int size );
+
+	InflateInputStream( const InflateInputStream& );
+	InflateInputStream& operator=( const InflateInputStream& );
+};
+
+
+END_NAMESPACE() // io
+
+
+#endif // _IO_INFLATEINPUTSTREAM_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
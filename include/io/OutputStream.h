@@ -28,6 +28,17 @@ public:
 	 */
 	virtual void 			write( const void* data, int size ) = 0;
 
+	/**
+	 * Writes multiple buffers to the stream in order (gather write).
+	 * Default implementation calls write() for each buffer,
+	 * streams which can do better should override this.
+	 * @param data Pointers to the buffers.
+	 * @param sizes Byte counts of the buffers.
+	 * @param count Number of buffers.
+	 * @exception IOException
+	 */
+	virtual void			writev( const void* const* data, const int* sizes, int count );
+
 	/** Returns name of the stream. */
 	virtual NS(lang,String)	toString() const = 0;
 };
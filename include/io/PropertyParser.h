@@ -12,7 +12,7 @@ BEGIN_NAMESPACE(io)
 
 /**
  * Parses key=value style property pairs from character string.
- * Pairs are separated by newline.
+ * Pairs are separated by newline or ';'.
  * Keys are parsed to lower-case to provide case-insensitive comparison.
  * Trailing and preceding whitespace of values is ignored.
  * Comments can be embedded with line starting with '--'.
@@ -21,6 +21,11 @@ BEGIN_NAMESPACE(io)
  * but this class is suitable for conditions where for example
  * heap memory allocations need to be avoided.
  *
+ * The buffer is copied once and the pairs are parsed in place,
+ * so re-using the same parser with reset() does not allocate memory
+ * after the internal buffers have grown large enough. For the fastest
+ * parsing of known keys see PropertySchema.
+ *
  * @ingroup io
  */
 class PropertyParser :
@@ -33,7 +38,7 @@ public:
 	class ConstIterator
 	{
 	public:
-		ConstIterator( const PropertyParser* parser, int pos, int line );
+		ConstIterator( const PropertyParser* parser, int index );
 
 		/**
 		 * Iterates to next (key,value) pair.
@@ -52,20 +57,19 @@ public:
 
 		/**
 		 * Returns key of current pair.
-		 * Valid until next call to parser (direct or indirect).
+		 * Valid until parser is reset.
 		 */
 		const char*		key() const;
 
 		/**
 		 * Returns value of current pair.
-		 * Valid until next call to parser (direct or indirect).
+		 * Valid until parser is reset.
 		 */
 		const char*		value() const;
 
 	private:
 		const PropertyParser*	m_parser;
-		int						m_pos;
-		int						m_line;
+		int						m_index;
 	};
 
 	/**
@@ -105,7 +109,7 @@ public:
 
 	/**
 	 * Parses key=x user property and returns x as 0-terminated string.
-	 * String is valid until next call to PropertyParser.
+	 * String is valid until parser is reset.
 	 * @param key Name of the property to find.
 	 * @return 0-terminated key value.
 	 * @exception IOException
@@ -169,28 +173,21 @@ private:
 	class Pair
 	{
 	public:
-		NS(lang,String)	key;
-		NS(lang,String)	value;
+		const char*	key;
+		const char*	value;
+		int			keyLength;
+		int			valueLength;
 
-		bool operator<( const Pair& other ) const	{return key < other.key;}
+		bool operator<( const Pair& other ) const;
 	};
 
-	NS(lang,String)					m_buf;
-	int								m_len;
+	NS(lang,Array)<char>			m_text;
 	NS(lang,String)					m_name;
-	mutable NS(lang,Array)<char>	m_temp;
+	NS(lang,Array)<char>			m_nameText;
 	NS(lang,Array)<Pair>			m_pairs;
+	NS(lang,Array)<Pair>			m_sorted;
 
-	void		parsePair( int& pos, int& line, NS(lang,Array)<char>& pair ) const;
-	void		parseKey( int& pos, int& line, NS(lang,Array)<char>& value ) const;
-	void		parseValue( int& pos, int& line, NS(lang,Array)<char>& value ) const;
-	bool		skipLine( int& pos, int& line ) const;
-	bool		skipSpace( int& pos, int& line ) const;
-	bool		skipComments( int& pos, int& line ) const;
-	char		get( int pos ) const;
-	bool		isComment( int pos ) const;
-
-	static void	toLowerCase( NS(lang,Array)<char>& temp );
+	const char*	find( const char* key ) const;
 };
 
 
@@ -0,0 +1,138 @@
+#ifndef _IO_PROPERTYSCHEMA_H
+#define _IO_PROPERTYSCHEMA_H
+
+
+#include <io/PropertyTokenizer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(io)
+
+
+/**
+ * Declarative mapping from property keys to typed fields of a structure.
+ * Schema is defined as a static table of fields at file scope, for example:
+ *
+ * static const PropertySchema::Field FIELDS[] =
+ * {
+ *     PROPERTYSCHEMA_FIELD( MyProps, "time", FIELD_FLOAT, time ),
+ *     PROPERTYSCHEMA_FIELD( MyProps, "particle", FIELD_VIEW, particle ),
+ * };
+ * static const PropertySchema schema( FIELDS, sizeof(FIELDS)/sizeof(FIELDS[0]) );
+ *
+ * parse() then tokenizes key=value pairs (see PropertyTokenizer) and stores
+ * the values directly to the structure. Parsing does not allocate memory
+ * (except FIELD_STRING values) and does not use sscanf.
+ *
+ * @ingroup io
+ */
+class PropertySchema
+{
+public:
+	/** Type of the field in the target structure. */
+	enum FieldType
+	{
+		/** bool */
+		FIELD_BOOLEAN,
+		/** int, value must be integral number */
+		FIELD_INT,
+		/** float */
+		FIELD_FLOAT,
+		/** float[count], whitespace separated */
+		FIELD_FLOATS,
+		/** PropertyView to the original buffer */
+		FIELD_VIEW,
+		/** lang::String */
+		FIELD_STRING,
+		/** int, index of the value in names[count], case is ignored */
+		FIELD_ENUM,
+	};
+
+	/** Limits of the schema. */
+	enum Constants
+	{
+		/** Maximum number of fields, as parse() returns found fields as bit mask. */
+		MAX_FIELDS = 32,
+	};
+
+	/** Single field of the schema. */
+	struct Field
+	{
+		/** Lower-case property key. */
+		const char*			key;
+		/** Type of the field. */
+		FieldType			type;
+		/** Byte offset of the field in the target structure. */
+		int					offset;
+		/** Number of floats (FIELD_FLOATS) or enum names (FIELD_ENUM). */
+		int					count;
+		/** Enum names (FIELD_ENUM). */
+		const char* const*	names;
+	};
+
+	/**
+	 * Creates schema from static field table.
+	 * The table is not copied so it must stay valid.
+	 */
+	PropertySchema( const Field* fields, int count );
+
+	/**
+	 * Parses key=value pairs and stores values of the known keys
+	 * to the structure. Unknown keys are ignored.
+	 * @param buf Property text. Does not need to be 0-terminated.
+	 * @param len Number of characters in the buffer.
+	 * @param obj Structure receiving field values.
+	 * @param name Name of the buffer used in error messages.
+	 * @return Bit mask of the fields found, bit i for field i.
+	 * @exception IOException If value cannot be parsed to the field.
+	 */
+	uint32_t		parse( const char* buf, int len, void* obj, const char* name ) const;
+
+	/**
+	 * Returns index of the field by key or -1 if not found.
+	 * Case of the key is ignored.
+	 */
+	int				getFieldIndex( const PropertyView& key ) const;
+
+	/** Returns number of fields in the schema. */
+	int				fields() const												{return m_count;}
+
+	/** Returns ith field. */
+	const Field&	getField( int i ) const										{return m_fields[i];}
+
+private:
+	const Field*	m_fields;
+	int				m_count;
+	uint32_t		m_hashes[MAX_FIELDS];
+
+	static uint32_t	hash( const char* s, int len );
+	static void		setField( const Field& field, const PropertyView& value, void* obj, const char* name, int line );
+};
+
+
+/**
+ * Creates PropertySchema::Field initializer for member of a structure.
+ * @param CLASS Structure type.
+ * @param KEY Lower-case property key.
+ * @param TYPE PropertySchema::FieldType without class prefix.
+ * @param MEMBER Member of the structure.
+ */
+#define PROPERTYSCHEMA_FIELD( CLASS, KEY, TYPE, MEMBER ) \
+	{KEY, NS(io,PropertySchema)::TYPE, offsetof(CLASS,MEMBER), 0, 0}
+
+/**
+ * Creates PropertySchema::Field initializer for FIELD_FLOATS or FIELD_ENUM member of a structure.
+ * @param COUNT Number of floats or enum names.
+ * @param NAMES Enum names or 0.
+ */
+#define PROPERTYSCHEMA_FIELDN( CLASS, KEY, TYPE, MEMBER, COUNT, NAMES ) \
+	{KEY, NS(io,PropertySchema)::TYPE, offsetof(CLASS,MEMBER), COUNT, NAMES}
+
+
+END_NAMESPACE() // io
+
+
+#endif // _IO_PROPERTYSCHEMA_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
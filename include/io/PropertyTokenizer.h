@@ -0,0 +1,133 @@
+#ifndef _IO_PROPERTYTOKENIZER_H
+#define _IO_PROPERTYTOKENIZER_H
+
+
+#include <lang/pp.h>
+
+
+BEGIN_NAMESPACE(io)
+
+
+/**
+ * Non-owning view to a range of characters in a property buffer.
+ * View is not 0-terminated and is valid as long as the buffer is.
+ *
+ * @ingroup io
+ */
+class PropertyView
+{
+public:
+	/** First character of the view. */
+	const char*		begin;
+
+	/** Number of characters in the view. */
+	int				length;
+
+	/** Creates empty view. */
+	PropertyView() : begin(0), length(0)											{}
+
+	/** Creates view to specified characters. */
+	PropertyView( const char* s, int len ) : begin(s), length(len)				{}
+
+	/** Returns one beyond the last character of the view. */
+	const char*		end() const													{return begin+length;}
+
+	/** Returns true if the view has the same characters as 0-terminated string. */
+	bool			operator==( const char* sz ) const;
+
+	/** Returns true if the view does not have the same characters as 0-terminated string. */
+	bool			operator!=( const char* sz ) const							{return !this->operator==(sz);}
+
+	/** Returns true if the view is equal to 0-terminated string when case is ignored. */
+	bool			equalsIgnoreCase( const char* sz ) const;
+
+	/**
+	 * Copies view to 0-terminated character buffer.
+	 * The string is truncated if the buffer is too small.
+	 */
+	void			get( char* buf, int bufsize ) const;
+};
+
+/**
+ * Tokenizes key=value style property pairs from character buffer
+ * without copying or allocating memory. The syntax is the same as in PropertyParser:
+ * Pairs are separated by newline or ';' and comments start with '--'.
+ * Keys and values are returned as views to the original buffer,
+ * so keys are not converted to lower-case but should be compared
+ * with PropertyView::equalsIgnoreCase.
+ *
+ * Tokenizer also provides number parsing functions which
+ * work on views directly, without sscanf or 0-terminated copies.
+ *
+ * @ingroup io
+ */
+class PropertyTokenizer
+{
+public:
+	/**
+	 * Starts tokenizing specified buffer.
+	 * @param buf Property text. Does not need to be 0-terminated.
+	 * @param len Number of characters in the buffer.
+	 * @param name Name of the buffer used in error messages.
+	 */
+	PropertyTokenizer( const char* buf, int len, const char* name );
+
+	/**
+	 * Returns next (key,value) pair from the buffer.
+	 * Trailing and preceding whitespace of values is ignored.
+	 * @return false if there are no more pairs.
+	 * @exception IOException If key has no value.
+	 */
+	bool			next( PropertyView* key, PropertyView* value );
+
+	/**
+	 * Returns line number of the last returned pair.
+	 */
+	int				line() const												{return m_line;}
+
+	/**
+	 * Parses number from the beginning of the character range.
+	 * Leading whitespace is skipped and parsing stops at the first
+	 * character which is not part of the number. Plain decimal numbers
+	 * are parsed directly, anything else (inf, nan, hex) with strtod,
+	 * so accepted input is the same as with sscanf("%g").
+	 * @return Number of characters consumed, or 0 if no number was found.
+	 */
+	static int		parseNumber( const char* s, const char* end, double* v );
+
+	/**
+	 * Parses whitespace separated floating point values.
+	 * @return Number of values parsed.
+	 */
+	static int		parseFloats( const PropertyView& str, float* v, int count );
+
+	/**
+	 * Parses integer value. Value needs to be an integral number.
+	 * @return true if value was parsed succesfully.
+	 */
+	static bool		parseInt( const PropertyView& str, int* v );
+
+	/**
+	 * Parses boolean value. See PropertyParser::getBoolean for accepted strings.
+	 * @return true if value was parsed succesfully.
+	 */
+	static bool		parseBoolean( const PropertyView& str, bool* v );
+
+private:
+	const char*		m_buf;
+	const char*		m_end;
+	const char*		m_name;
+	int				m_pos;
+	int				m_line;
+	int				m_nextLine;
+
+	void			skipSpaceAndComments();
+};
+
+
+END_NAMESPACE() // io
+
+
+#endif // _IO_PROPERTYTOKENIZER_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -0,0 +1,154 @@
+#ifndef _IO_RESOURCEINDEX_H
+#define _IO_RESOURCEINDEX_H
+
+
+#include <lang/Array.h>
+#include <lang/Object.h>
+#include <lang/String.h>
+#include <lang/Hashtable.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(io)
+
+
+/**
+ * Persistent index of the files in a data directory.
+ * Maps file basenames and path names to file size, modification
+ * time and content hash. The index is stored to the data directory
+ * (INDEX_FILENAME) so that resolving resource names does not need
+ * directory scans, and content hashes can be used as keys for
+ * caches of processed (e.g. decoded) resource data.
+ *
+ * When the index is updated, the directory is scanned and only
+ * files with changed size or modification time are hashed again.
+ *
+ * @ingroup io
+ */
+class ResourceIndex :
+	public NS(lang,Object)
+{
+public:
+	/** Index file format constants. */
+	enum Constants
+	{
+		/** Identifier of the index file. */
+		MAGIC	= 0x52494458,
+		/** Version of the index file format. */
+		VERSION	= 1,
+	};
+
+	/** Description of an indexed file. */
+	struct Entry
+	{
+		/** Path name of the file. */
+		NS(lang,String)	path;
+		/** Size of the file in bytes. */
+		int				size;
+		/** Time when the file was last modified. */
+		int				writeTime;
+		/** 64-bit FNV-1a hash of the file content. */
+		uint64_t		hash;
+	};
+
+	/** Name of the index file in the data directory. */
+	static const char* const INDEX_FILENAME;
+
+	/**
+	 * Opens index of specified data directory.
+	 * If the index file exists, it is loaded. If the index file
+	 * does not exist or update is true, the directory is
+	 * scanned and the index file is saved if it changed.
+	 * @param path Data directory.
+	 * @param update If false then existing index file is trusted without checking the directory.
+	 * @param indexfilename Index file name, or empty string to use INDEX_FILENAME in the data directory.
+	 * @exception IOException
+	 */
+	explicit ResourceIndex( const NS(lang,String)& path, bool update=true, const NS(lang,String)& indexfilename="" );
+
+	///
+	~ResourceIndex();
+
+	/**
+	 * Scans the data directory and rehashes new and modified files.
+	 * The index file is saved if there were any changes.
+	 * Does nothing if the platform does not support FindFile.
+	 * @return Number of files (re)hashed.
+	 * @exception IOException
+	 */
+	int				update();
+
+	/**
+	 * Saves index to the index file.
+	 * @exception IOException
+	 */
+	void			save();
+
+	/**
+	 * Finds file by basename (name without path and suffix).
+	 * If multiple files have the same basename, the first one found is returned.
+	 * @return File description or 0 if not found.
+	 */
+	const Entry*	findByName( const NS(lang,String)& basename ) const;
+
+	/**
+	 * Finds file by path name.
+	 * @return File description or 0 if not found.
+	 */
+	const Entry*	findByPath( const NS(lang,String)& path ) const;
+
+	/** Returns number of files in the index. */
+	int				entries() const							{return m_entries.size();}
+
+	/** Returns ith file description. */
+	const Entry&	getEntry( int i ) const					{return m_entries[i];}
+
+	/** Returns data directory of the index. */
+	const NS(lang,String)&	path() const					{return m_path;}
+
+	/** Returns index file name. */
+	const NS(lang,String)&	indexFilename() const			{return m_indexFilename;}
+
+	/**
+	 * Returns 64-bit FNV-1a hash of the data.
+	 */
+	static uint64_t			hashData( const void* data, int size );
+
+	/**
+	 * Returns 64-bit FNV-1a hash of the data, continuing from previous hash value.
+	 */
+	static uint64_t			hashData( const void* data, int size, uint64_t hash );
+
+	/**
+	 * Returns hash of file content.
+	 * @exception IOException
+	 */
+	static uint64_t			hashFile( const NS(lang,String)& filename );
+
+	/**
+	 * Returns hash as 16 character hexadecimal string,
+	 * suitable to be used as a file name in content caches.
+	 */
+	static NS(lang,String)	toString( uint64_t hash );
+
+private:
+	NS(lang,String)										m_path;
+	NS(lang,String)										m_indexFilename;
+	NS(lang,Array)<Entry>								m_entries;
+	NS(lang,Hashtable)< NS(lang,String),int,NS(lang,Hash)<NS(lang,String)> >	m_names;
+	NS(lang,Hashtable)< NS(lang,String),int,NS(lang,Hash)<NS(lang,String)> >	m_paths;
+
+	bool			load();
+	void			rebuildLookup();
+
+	ResourceIndex( const ResourceIndex& );
+	ResourceIndex& operator=( const ResourceIndex& );
+};
+
+
+END_NAMESPACE() // io
+
+
+#endif // _IO_RESOURCEINDEX_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
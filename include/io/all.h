@@ -42,17 +42,22 @@
 #include <io/DataInputStream.h>
 #include <io/DataOutput.h>
 #include <io/DataOutputStream.h>
+#include <io/DeflateOutputStream.h>
 #include <io/FileInputStream.h>
 #include <io/FileNotFoundException.h>
 #include <io/FileOutputStream.h>
 #include <io/FilterInputStream.h>
 #include <io/FilterOutputStream.h>
 #include <io/FindFile.h>
+#include <io/InflateInputStream.h>
 #include <io/InputStream.h>
 #include <io/IOException.h>
 #include <io/OutputStream.h>
 #include <io/PathName.h>
 #include <io/PropertyParser.h>
+#include <io/PropertySchema.h>
+#include <io/PropertyTokenizer.h>
+#include <io/ResourceIndex.h>
 
 /** @} */
 
@@ -2,10 +2,18 @@
 #define _IO_TEST_H
 
 
+BEGIN_NAMESPACE(lang) 
+	class String;END_NAMESPACE()
+
+
 BEGIN_NAMESPACE(io) 
 
 	
-void test();
+/**
+ * Performs io library internal tests.
+ * @param datapath Path to directory with scene (.hgr) files used in stream benchmarks.
+ */
+void test( const NS(lang,String)& datapath );
 
 
 END_NAMESPACE() // io
@@ -42,6 +42,20 @@ public:
 	 * @return false if the code point couldn't be encoded.
 	 */
 	virtual bool	encode( void* dst, void* dstend, int* dstbytes, int src ) const = 0;
+
+	/**
+	 * Converts bytes to UTF-8 with a single call instead of
+	 * decoding and encoding each code point separately.
+	 * Default implementation doesn't support bulk conversion.
+	 *
+	 * @param src Ptr to the source data.
+	 * @param srcsize Number of bytes in the source data.
+	 * @param dst Destination buffer. Can be 0 to get the required size only.
+	 * @param dstsize Size of the destination buffer. If the result doesn't fit, buffer contents are undefined.
+	 * @return Number of UTF-8 bytes in the result, or -1 if the data
+	 * needs to be converted with decode() since it is malformed or bulk conversion is not supported.
+	 */
+	virtual int		toUTF8( const void* /*src*/, int /*srcsize*/, char* /*dst*/, int /*dstsize*/ ) const		{return -1;}
 };
 
 
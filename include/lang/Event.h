@@ -0,0 +1,60 @@
+#ifndef _LANG_EVENT_H
+#define _LANG_EVENT_H
+
+
+#include <lang/pp.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+/** 
+ * Synchronization object which threads can wait for to become signaled.
+ * Auto-reset event releases single waiting thread and returns to
+ * non-signaled state, manual-reset event stays signaled until reset().
+ * On platforms without thread support waiting does nothing.
+ * 
+ * @ingroup lang
+ */
+class Event
+{
+public:
+	/** 
+	 * Creates event.
+	 * @param manualreset If true then event stays signaled until reset() is called.
+	 * @param signaled Initial state of the event.
+	 */
+	explicit Event( bool manualreset=false, bool signaled=false );
+
+	///
+	~Event();
+
+	/**
+	 * Sets the event to signaled state.
+	 */
+	void	set();
+
+	/**
+	 * Sets the event to non-signaled state.
+	 */
+	void	reset();
+
+	/**
+	 * Blocks until the event is signaled.
+	 */
+	void	wait();
+
+private:
+	void*	m_handle;
+
+	Event( const Event& );
+	Event& operator=( const Event& );
+};
+
+
+END_NAMESPACE() // lang
+
+
+#endif // _LANG_EVENT_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -8,6 +8,11 @@
 #include <lang/GlobalStorage.h>
 
 
+#ifdef PLATFORM_WIN32
+	#define LANG_THREADLOCAL __declspec(thread)
+#endif
+
+
 BEGIN_NAMESPACE(lang) 
 
 
@@ -61,12 +66,29 @@ public:
 	 */
 	static void			cleanup();
 
+	/**
+	 * Initializes private globals for the calling thread.
+	 * Called by Thread before run(). Strings created by the thread
+	 * are allocated from the thread's own string pool,
+	 * so they must not be passed to other threads.
+	 */
+	static void			initThread();
+
+	/**
+	 * Releases private globals of the calling thread.
+	 */
+	static void			cleanupThread();
+
 	/**
 	 * Returns the globals.
 	 */
 	static lang_Globals&		get();
 
 private:
+#ifdef LANG_THREADLOCAL
+	static LANG_THREADLOCAL lang_Globals*	sm_threadGlobals;
+#endif
+
 	lang_Globals( int stringmem, int tempmem );
 	~lang_Globals();
 };
@@ -74,6 +96,10 @@ private:
 
 inline lang_Globals& lang_Globals::get()
 {
+#ifdef LANG_THREADLOCAL
+	if ( sm_threadGlobals != 0 )
+		return *sm_threadGlobals;
+#endif
 	NS(lang,GlobalStorage)& gs = NS(lang,GlobalStorage)::get(); 
 	if ( !gs.langGlobals )
 		init();
@@ -0,0 +1,72 @@
+#ifndef _LANG_MUTEX_H
+#define _LANG_MUTEX_H
+
+
+#include <lang/pp.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+/** 
+ * Mutual exclusion object for synchronizing access 
+ * to shared data between threads. Mutex is recursive,
+ * i.e. the same thread can lock it multiple times.
+ * On platforms without thread support locking does nothing.
+ * 
+ * @ingroup lang
+ */
+class Mutex
+{
+public:
+	/**
+	 * Helper class for locking the mutex for the duration of the scope.
+	 */
+	class Lock
+	{
+	public:
+		/** Locks the mutex. */
+		explicit Lock( Mutex& mutex )					: m_mutex(mutex) {m_mutex.lock();}
+
+		/** Unlocks the mutex. */
+		~Lock()											{m_mutex.unlock();}
+
+	private:
+		Mutex&	m_mutex;
+
+		Lock( const Lock& );
+		Lock& operator=( const Lock& );
+	};
+
+	/** 
+	 * Creates unlocked mutex. 
+	 */
+	Mutex();
+
+	///
+	~Mutex();
+
+	/**
+	 * Locks the mutex. Blocks until the mutex is available.
+	 */
+	void	lock();
+
+	/**
+	 * Unlocks the mutex locked by the calling thread.
+	 */
+	void	unlock();
+
+private:
+	void*	m_handle;
+
+	Mutex( const Mutex& );
+	Mutex& operator=( const Mutex& );
+};
+
+
+END_NAMESPACE() // lang
+
+
+#endif // _LANG_MUTEX_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
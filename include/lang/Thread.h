@@ -0,0 +1,84 @@
+#ifndef _LANG_THREAD_H
+#define _LANG_THREAD_H
+
+
+#include <lang/Object.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+/** 
+ * Base class for threads of execution. 
+ * Derived class implements run() which is executed
+ * in the new thread after start() has been called.
+ * On platforms without thread support run() is executed 
+ * synchronously by start().
+ *
+ * Each started thread has private string pool and temporary buffers
+ * (see lang_Globals::initThread), so String objects must not be
+ * passed between threads. Pass plain character data instead.
+ * 
+ * @ingroup lang
+ */
+class Thread :
+	public Object
+{
+public:
+	/** 
+	 * Creates thread object. Execution is not started before start() is called.
+	 */
+	Thread();
+
+	/**
+	 * Waits for the thread to finish execution.
+	 */
+	~Thread();
+
+	/**
+	 * Starts executing run() in a new thread.
+	 */
+	void		start();
+
+	/**
+	 * Waits until the thread has finished execution.
+	 * Does nothing if the thread has not been started.
+	 */
+	void		join();
+
+	/**
+	 * Thread execution function.
+	 */
+	virtual void	run() = 0;
+
+	/**
+	 * Returns true if the thread has been started and has not been joined yet.
+	 */
+	bool		started() const				{return m_handle != 0;}
+
+	/**
+	 * Suspends execution of the calling thread.
+	 * @param millis Time to sleep in milliseconds.
+	 */
+	static void	sleep( int millis );
+
+	/**
+	 * Returns number of processors available to the process.
+	 * Returns 1 on platforms without thread support.
+	 */
+	static int	processors();
+
+private:
+	void*		m_handle;
+
+	Thread( const Thread& );
+	Thread& operator=( const Thread& );
+};
+
+
+END_NAMESPACE() // lang
+
+
+#endif // _LANG_THREAD_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
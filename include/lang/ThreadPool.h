@@ -0,0 +1,145 @@
+#ifndef _LANG_THREADPOOL_H
+#define _LANG_THREADPOOL_H
+
+
+#include <lang/Array.h>
+#include <lang/Event.h>
+#include <lang/Mutex.h>
+#include <lang/Thread.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+/** 
+ * Pool of worker threads executing queued jobs.
+ * Jobs are executed in arbitrary order. Thread calling wait() 
+ * participates in executing the jobs, so the pool can 
+ * be created without worker threads as well, in which case
+ * all jobs are executed serially in wait().
+ *
+ * Jobs can be added as a part of a Batch, so that the caller can wait
+ * for its own jobs only. This way the same pool can be shared between
+ * for example per-frame work and background loading, without
+ * per-frame code waiting for (or executing) loading jobs.
+ * 
+ * @ingroup lang
+ */
+class ThreadPool :
+	public Object
+{
+public:
+	class Batch;
+
+	/**
+	 * Interface for jobs executed by the pool.
+	 * Jobs are owned by the caller and must stay alive until 
+	 * wait() (or wait() of the job's batch) returns.
+	 */
+	class Job
+	{
+	public:
+		Job() : m_batch(0) {}
+		virtual ~Job() {}
+
+		/** Executes the job. Called by one of the worker threads. */
+		virtual void	run() = 0;
+
+	private:
+		friend class ThreadPool;
+		Batch*	m_batch;
+	};
+
+	/**
+	 * Group of jobs which can be waited for separately
+	 * from other jobs in the pool. Batch is owned by the caller
+	 * and must stay alive until its jobs have been finished.
+	 */
+	class Batch
+	{
+	public:
+		Batch();
+		~Batch();
+
+	private:
+		friend class ThreadPool;
+		int		m_pending;
+		Event	m_done;
+
+		Batch( const Batch& );
+		Batch& operator=( const Batch& );
+	};
+
+	/**
+	 * Creates pool of worker threads.
+	 * @param threads Number of worker threads. Negative value uses processor count minus one
+	 * (calling thread executes jobs as well in wait()).
+	 */
+	explicit ThreadPool( int threads=-1 );
+
+	/**
+	 * Waits for pending jobs and stops worker threads.
+	 */
+	~ThreadPool();
+
+	/**
+	 * Adds job to execution queue.
+	 * Job execution may start immediately.
+	 */
+	void	add( Job* job );
+
+	/**
+	 * Adds job to execution queue as a part of a batch.
+	 * Job execution may start immediately.
+	 */
+	void	add( Job* job, Batch* batch );
+
+	/**
+	 * Executes queued jobs and waits until all of them have been finished.
+	 */
+	void	wait();
+
+	/**
+	 * Executes queued jobs of the batch and waits until all jobs
+	 * of the batch have been finished. Jobs of other batches
+	 * are not executed by the calling thread.
+	 */
+	void	wait( Batch* batch );
+
+	/**
+	 * Returns number of worker threads.
+	 */
+	int		threads() const;
+
+	/**
+	 * Returns number of jobs which have been added but not finished yet.
+	 */
+	int		pending() const;
+
+private:
+	class Worker;
+
+	Array<Worker*>	m_workers;
+	Array<Job*>		m_jobs;
+	int				m_next;
+	int				m_pending;
+	bool			m_quit;
+	mutable Mutex	m_mutex;
+	void*			m_jobSema;
+	Event			m_done;
+
+	Job*	nextJob( Batch* batch );
+	void	finishJob( Batch* batch );
+	void	workerMain();
+
+	ThreadPool( const ThreadPool& );
+	ThreadPool& operator=( const ThreadPool& );
+};
+
+
+END_NAMESPACE() // lang
+
+
+#endif // _LANG_THREADPOOL_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
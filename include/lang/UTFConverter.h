@@ -12,7 +12,11 @@ BEGIN_NAMESPACE(lang)
 /**
  * Unicode UTF-data encoding/decoding helper class.
  * Supported encoding schemes are 
- * ASCII-7, UTF-8, UTF-16BE, UTF-16LE, UTF-32BE, UTF-32LE.
+ * ASCII-7, Latin-1, UTF-8, UTF-16BE, UTF-16LE, UTF-32BE, UTF-32LE.
+ *
+ * Conversion from ASCII-7, Latin-1, UTF-8 and UTF-16 to UTF-8
+ * is also supported in bulk with toUTF8(), which handles runs
+ * of ASCII characters 16 bytes at a time.
  * 
  * @ingroup lang
  */
@@ -40,7 +44,9 @@ public:
 		/** UTF-32 Big Endian */
 		ENCODING_UTF32BE,
 		/** UTF-32 Little Endian */
-		ENCODING_UTF32LE
+		ENCODING_UTF32LE,
+		/** ISO-8859-1 */
+		ENCODING_LATIN1
 	};
 	
 	/** 
@@ -71,6 +77,31 @@ public:
 	 */
 	bool	encode( void* dst, void* dstend, int* dstbytes, int src ) const;
 
+	/**
+	 * Converts bytes to UTF-8 in bulk.
+	 * UTF-8 input is validated and copied in a single pass.
+	 * Not supported for UTF-32 encodings.
+	 *
+	 * @param src Ptr to the source data.
+	 * @param srcsize Number of bytes in the source data.
+	 * @param dst Destination buffer. Can be 0 to get the required size only.
+	 * @param dstsize Size of the destination buffer. If the result doesn't fit, buffer contents are undefined.
+	 * @return Number of UTF-8 bytes in the result, or -1 if the data
+	 * is malformed or encoding not supported.
+	 */
+	int		toUTF8( const void* src, int srcsize, char* dst, int dstsize ) const;
+
+	/**
+	 * Returns number of leading ASCII-7 bytes in the data.
+	 */
+	static int	countASCII( const void* src, int srcsize );
+
+	/**
+	 * Returns true if the data is valid UTF-8, i.e. has
+	 * no overlong sequences, surrogates or code points above U+10FFFF.
+	 */
+	static bool	isValidUTF8( const void* src, int srcsize );
+
 private:
 	EncodingType	m_type;
 };
@@ -111,6 +111,10 @@
 #include <lang/FormatException.h>
 #include <lang/Debug.h>
 #include <lang/Profile.h>
+#include <lang/Mutex.h>
+#include <lang/Event.h>
+#include <lang/Thread.h>
+#include <lang/ThreadPool.h>
 
 /** @} */
 
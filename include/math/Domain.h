@@ -9,6 +9,9 @@
 BEGIN_NAMESPACE(math) 
 
 
+class Random;
+
+
 /**
  * Domain specifies distribution for a random variable.
  * @ingroup math
@@ -102,6 +105,28 @@ public:
 	 */
 	float		getRandomFloat() const;
 
+	/**
+	 * Returns random 3-vector inside current domain using specified generator.
+	 * @see getRandomFloat3
+	 */
+	float3		getRandomFloat3( Random& rng ) const;
+
+	/**
+	 * Returns random scalar inside current domain using specified generator.
+	 * @see getRandomFloat
+	 */
+	float		getRandomFloat( Random& rng ) const;
+
+	/**
+	 * Fills array with random 3-vectors inside current domain.
+	 * Domain type and parameters are resolved once for the whole batch,
+	 * so this is faster than getting the values one by one.
+	 * @param rng Random number generator.
+	 * @param v [out] Receives the random vectors.
+	 * @param count Number of vectors to generate.
+	 */
+	void		getRandomFloat3( Random& rng, float3* v, int count ) const;
+
 	/**
 	 * Returns random 3-vector inside current domain.
 	 * If the domain has less dimensions than the rest are filled with zero.
@@ -3,11 +3,16 @@
 
 
 #include <lang/pp.h>
+#include <stdint.h>
 
 
 BEGIN_NAMESPACE(math) 
 
 
+class float3x4;
+class float4;
+
+
 /**
  * Utilities for interpolating between key values.
  * @ingroup math
@@ -57,6 +62,46 @@ public:
 		const float* key0, const float* key1, const float* key2, const float* key3,
 		float* result );
 
+	/**
+	 * Sets 4 bone weights and bone indices per vertex for skinVertices.
+	 * If weights have less than 4 components, the last used weight
+	 * is 1 minus sum of the others. Bones with zero weight get index 0.
+	 * @param dim Number of weight components per vertex [1,4].
+	 * @param vertexbones Bone indices of the vertices, 4 per vertex.
+	 * @param palette Maps vertex bone indices to bones. Vertex bone indices are bones if 0.
+	 * @param palettesize Number of entries in palette.
+	 * @param bones Number of bones.
+	 * @param weights [in/out] Bone weights of the vertices.
+	 * @param boneindices [out] Receives 4 bone indices per vertex.
+	 * @param count Number of vertices.
+	 */
+	static void	setSkinBones( int dim, const float4* vertexbones, 
+					const uint8_t* palette, int palettesize, int bones,
+					float4* weights, uint8_t* boneindices, int count );
+
+	/**
+	 * Stores bone transform as 4 columns used by skinVertices.
+	 * @param tm Bone transform.
+	 * @param columns [out] Receives 4 columns, w=(0,0,0,1).
+	 */
+	static void	setSkinBoneColumns( const float3x4& tm, float4* columns );
+
+	/**
+	 * Skins vertex positions and normals by blending 4 bone transforms per vertex
+	 * (with SSE if MATH_SSE is defined).
+	 * @param bonecolumns Bone transforms, 4 columns per bone, see setSkinBoneColumns.
+	 * @param pos Vertex positions (w=1).
+	 * @param nrm Vertex normals (w=0).
+	 * @param weights Bone weights, see setSkinBones.
+	 * @param boneindices Bone indices, 4 per vertex, see setSkinBones.
+	 * @param outpos [out] Receives skinned positions.
+	 * @param outnrm [out] Receives skinned normals.
+	 * @param count Number of vertices.
+	 */
+	static void	skinVertices( const float4* bonecolumns, const float4* pos, const float4* nrm,
+					const float4* weights, const uint8_t* boneindices, 
+					float4* outpos, float4* outnrm, int count );
+
 	/**
 	 * Returns string representing animation start/end behaviour type.
 	 */
@@ -119,6 +119,55 @@ public:
 		const float3& vert0, const float3& vert1, const float3& vert2,
 		float* t );
 
+	/**
+	 * Returns number of floats needed to store triangles in block layout.
+	 * @see setTriangleBlocks
+	 */
+	static int	getTriangleBlockSize( int count )						{return ((count+3)>>2) * 36;}
+
+	/**
+	 * Stores triangles in block layout used by findRayTrianglesIntersection.
+	 * Each block has 4 triangles as structure of arrays: first vertex,
+	 * first edge and second edge, each as x[4], y[4], z[4] (36 floats).
+	 * Last block is padded with degenerate triangles which are never hit.
+	 * @param verts Triangle vertices, 3 per triangle.
+	 * @param count Number of triangles.
+	 * @param blocks [out] Receives triangle blocks. Must have space for getTriangleBlockSize(count) floats.
+	 */
+	static void	setTriangleBlocks( const float3* verts, int count, float* blocks );
+
+	/**
+	 * Finds the closest intersection of a ray and a set of triangles if any.
+	 * Same as findRayTriangleIntersection but tests 4 triangles at a time
+	 * (with SSE if MATH_SSE is defined).
+	 * @param orig Ray origin.
+	 * @param dir Ray direction.
+	 * @param blocks Triangles in block layout, see setTriangleBlocks.
+	 * @param count Number of triangles.
+	 * @param t [in/out] Maximum length along ray, receives length along ray to the closest intersection if any.
+	 * @return Index of the closest intersected triangle, or -1 if none.
+	 */
+	static int	findRayTrianglesIntersection(
+		const float3& orig, const float3& dir,
+		const float* blocks, int count, float* t );
+
+	/**
+	 * Finds intersections of multiple rays and an axis aligned box.
+	 * Rays are tested 4 at a time (with SSE if MATH_SSE is defined).
+	 * @param orig Ray origins.
+	 * @param dir Ray directions.
+	 * @param count Number of rays.
+	 * @param boxmin Box minimum.
+	 * @param boxmax Box maximum.
+	 * @param t [in/out] Maximum lengths along rays, receives lengths along rays to the box for intersecting rays. Receives 0 if ray origin is inside box.
+	 * @param hit [out] Receives true for rays which intersect the box and false for others.
+	 * @return Number of rays which intersect the box.
+	 */
+	static int	findRaysBoxIntersection(
+		const float3* orig, const float3* dir, int count,
+		const float3& boxmin, const float3& boxmax,
+		float* t, bool* hit );
+
 	/**
 	 * Finds ray Bezier patch intersection if any.
 	 * Uses constant subdivision.
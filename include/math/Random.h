@@ -0,0 +1,109 @@
+#ifndef _MATH_RANDOM_H
+#define _MATH_RANDOM_H
+
+
+#include <lang/pp.h>
+#include <stdint.h>
+
+
+BEGIN_NAMESPACE(math)
+
+
+/**
+ * Pseudo-random number generator (xoshiro128**).
+ * Each generator has its own state, so generators can be used
+ * per thread or per object without locking, and same seed
+ * always produces the same sequence (e.g. for replays).
+ * @ingroup math
+ */
+class Random
+{
+public:
+	/**
+	 * Creates generator with specified seed.
+	 */
+	explicit Random( uint32_t seed=0 );
+
+	/**
+	 * Restarts sequence with specified seed.
+	 */
+	void		setSeed( uint32_t seed );
+
+	/**
+	 * Returns 32 random bits.
+	 */
+	uint32_t	nextInt()									{return next(m_s);}
+
+	/**
+	 * Returns random integer between 0 (inclusive) and n (exclusive).
+	 */
+	int			nextInt( int n )							{return nextInt(m_s,n);}
+
+	/**
+	 * Returns random number between 0 (inclusive) and 1 (exclusive).
+	 */
+	float		nextFloat()									{return nextFloat(m_s);}
+
+	/**
+	 * Returns random number in given range.
+	 * @param begin Range start (inclusive).
+	 * @param end Range end (exclusive).
+	 */
+	float		nextFloat( float begin, float end )			{return (end-begin)*nextFloat(m_s) + begin;}
+
+	/**
+	 * Fills array with random numbers between 0 (inclusive) and 1 (exclusive).
+	 */
+	void		nextFloats( float* v, int count );
+
+	/**
+	 * Returns generator state, to be used with the static functions.
+	 */
+	uint32_t*	state()										{return m_s;}
+
+	/**
+	 * Returns next 32 random bits from generator state.
+	 */
+	static uint32_t	next( uint32_t* s );
+
+	/**
+	 * Returns random integer between 0 (inclusive) and n (exclusive) from generator state.
+	 */
+	static int		nextInt( uint32_t* s, int n )			{return int( (uint64_t(next(s)) * uint64_t(n)) >> 32 );}
+
+	/**
+	 * Returns random number between 0 (inclusive) and 1 (exclusive) from generator state.
+	 */
+	static float	nextFloat( uint32_t* s )				{return float(next(s) >> 8) * (1.f/16777216.f);}
+
+	/**
+	 * Initializes generator state from seed.
+	 */
+	static void		setSeed( uint32_t* s, uint32_t seed );
+
+private:
+	uint32_t	m_s[4];
+};
+
+
+inline uint32_t Random::next( uint32_t* s )
+{
+	const uint32_t x = s[1] * 5;
+	const uint32_t result = ((x << 7) | (x >> 25)) * 9;
+	const uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 11) | (s[3] >> 21);
+	return result;
+}
+
+
+END_NAMESPACE() // math
+
+
+#endif // _MATH_RANDOM_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
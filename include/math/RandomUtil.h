@@ -4,6 +4,7 @@
 
 #include <lang/pp.h>
 #include <math/float3.h>
+#include <math/Random.h>
 
 
 BEGIN_NAMESPACE(math) 
@@ -12,11 +13,26 @@ BEGIN_NAMESPACE(math)
 /**
  * Utility functions for pseudo-random number generation
  * inside various domains.
+ *
+ * Functions without generator parameter use generator
+ * of the calling thread, so they are thread safe. The thread
+ * generators are seeded in the order the threads first use them,
+ * and can be reseeded by setSeed().
  * @ingroup math
  */
 class RandomUtil
 {
 public:
+	/**
+	 * Seeds generator of the calling thread.
+	 */
+	static void		setSeed( uint32_t seed );
+
+	/**
+	 * Returns 32 random bits.
+	 */
+	static uint32_t	randomInt();
+
 	/**
 	 * Returns random number between 0 (inclusive) and 1 (exclusive).
 	 */
@@ -29,6 +45,9 @@ public:
 	 */
 	static float	getRandom( float begin, float end );
 
+	/** Same as getRandom() but uses specified generator. */
+	static float	getRandom( Random& rng, float begin, float end );
+
 	/**
 	 * Returns random point on origin centered XY-plane disk.
 	 * @param r1 Radius inside which there are no points (inclusive).
@@ -36,6 +55,9 @@ public:
 	 */
 	static float3	getPointOnDisk( float r1, float r2 );
 
+	/** Same as getPointOnDisk() but uses specified generator. */
+	static float3	getPointOnDisk( Random& rng, float r1, float r2 );
+
 	/**
 	 * Returns random point inside disk.
 	 * @param o Origin of disk.
@@ -45,6 +67,9 @@ public:
 	 */
 	static float3	getPointOnDisk( const float3& o, const float3& n, float r1, float r2 );
 
+	/** Same as getPointOnDisk() but uses specified generator. */
+	static float3	getPointOnDisk( Random& rng, const float3& o, const float3& n, float r1, float r2 );
+
 	/**
 	 * Randomizes point inside origin centered sphere.
 	 * @param r1 Radius inside which there are no points (inclusive).
@@ -52,6 +77,9 @@ public:
 	 */
 	static float3	getPointInSphere( float r1, float r2 );
 
+	/** Same as getPointInSphere() but uses specified generator. */
+	static float3	getPointInSphere( Random& rng, float r1, float r2 );
+
 	/**
 	 * Randomizes point on line.
 	 * @param p1 Start of line (inclusive).
@@ -59,6 +87,9 @@ public:
 	 */
 	static float3	getPointOnLine( const float3& p1, const float3& p2 );
 
+	/** Same as getPointOnLine() but uses specified generator. */
+	static float3	getPointOnLine( Random& rng, const float3& p1, const float3& p2 );
+
 	/**
 	 * Randomizes point inside box.
 	 * @param p1 Min corner of box (inclusive).
@@ -66,6 +97,9 @@ public:
 	 */
 	static float3	getPointInBox( const float3& p1, const float3& p2 );
 
+	/** Same as getPointInBox() but uses specified generator. */
+	static float3	getPointInBox( Random& rng, const float3& p1, const float3& p2 );
+
 	/**
 	 * Randomizes point inside cylinder which starts at origin and extends along +Z.
 	 * @param len Length of cylinder along Z+ axis.
@@ -74,6 +108,9 @@ public:
 	 */
 	static float3	getPointInCylinder( float len, float r1, float r2 );
 
+	/** Same as getPointInCylinder() but uses specified generator. */
+	static float3	getPointInCylinder( Random& rng, float len, float r1, float r2 );
+
 	/**
 	 * Randomizes point inside cylinder.
 	 * @param p1 Start of cylinder (inclusive).
@@ -83,6 +120,9 @@ public:
 	 */
 	static float3	getPointInCylinder( const float3& p1, const float3& p2, float r1, float r2 );
 
+	/** Same as getPointInCylinder() but uses specified generator. */
+	static float3	getPointInCylinder( Random& rng, const float3& p1, const float3& p2, float r1, float r2 );
+
 	/**
 	 * Randomizes point on rectangle.
 	 * @param o Origin.
@@ -91,6 +131,9 @@ public:
 	 */
 	static float3	getPointOnRectangle( const float3& o, const float3& e1, const float3& e2 );
 
+	/** Same as getPointOnRectangle() but uses specified generator. */
+	static float3	getPointOnRectangle( Random& rng, const float3& o, const float3& e1, const float3& e2 );
+
 	/**
 	 * Randomizes point on triangle.
 	 * @param o Origin of triangle.
@@ -99,8 +142,8 @@ public:
 	 */
 	static float3	getPointOnTriangle( const float3& o, const float3& e1, const float3& e2 );
 
-private:
-	static void		getPointOnDisk( float r1, float r2, float* x, float* y );
+	/** Same as getPointOnTriangle() but uses specified generator. */
+	static float3	getPointOnTriangle( Random& rng, const float3& o, const float3& e1, const float3& e2 );
 };
 
 
@@ -21,6 +21,7 @@
 #include <math/toString.h>
 #include <math/quaternion.h>
 #include <math/RandomUtil.h>
+#include <math/Random.h>
 #include <math/float2.h>
 #include <math/float3.h>
 #include <math/float4.h>
@@ -14,6 +14,16 @@
 	#define MATH_ALIGN_128
 #endif
 
+/* 
+ * MATH_SSE selects SSE implementation of the matrix operations.
+ * It is enabled automatically if compiler generates SSE code 
+ * (e.g. VC /arch:SSE or gcc -msse). Define MATH_NO_SSE to use 
+ * portable implementation always. Data layout is the same in both.
+ */
+#if !defined(MATH_SSE) && !defined(MATH_NO_SSE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+	#define MATH_SSE
+#endif
+
 
 BEGIN_NAMESPACE(math) 
 
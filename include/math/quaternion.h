@@ -128,6 +128,29 @@ public:
 	 */
 	quaternion		slerp( float t, const quaternion& q ) const;
 
+	/** 
+	 * Returns normalized linear interpolation for unit quaternions. 
+	 * Interpolates along the shorter arc. Cheaper than slerp, 
+	 * but angular velocity is not constant.
+	 *
+	 * @param t Interpolation phase [0,1]
+	 * @param q quaternion [n+1]
+	 * @return Interpolated unit quaternion.
+	 */
+	quaternion		nlerp( float t, const quaternion& q ) const;
+
+	/** 
+	 * Returns approximation of spherical linear interpolation for unit quaternions.
+	 * Interpolates along the shorter arc. Uses nlerp with corrected 
+	 * interpolation phase, so no trigonometric functions are needed.
+	 * Maximum error compared to slerp is about 0.001 radians.
+	 *
+	 * @param t Interpolation phase [0,1]
+	 * @param q quaternion [n+1]
+	 * @return Interpolated unit quaternion.
+	 */
+	quaternion		fastSlerp( float t, const quaternion& q ) const;
+
 	/** 
 	 * Returns spherical cubic interpolation for unit quaternions. 
 	 * This quaternion is used as element [n-1] in the interpolation.
@@ -27,6 +27,13 @@ public:
 	 * @return Number of contacts in the buffer to add as contact joints to the simulation solver.
 	 */
 	virtual int		checkCollisions( dGeomID o1, dGeomID o2, dContact* contacts, int maxcontacts ) = 0;
+
+	/**
+	 * Returns true if checkCollisions() can be called from multiple threads 
+	 * at the same time. Default is false, so collisions are checked 
+	 * in the calling thread even if ODEWorld is stepped with a thread pool.
+	 */
+	virtual bool	isThreadSafe() const								{return false;}
 };
 
 
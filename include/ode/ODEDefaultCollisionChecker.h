@@ -27,6 +27,11 @@ public:
 	 * @return Number of contacts in the buffer to add as contact joints to the simulation solver.
 	 */
 	int		checkCollisions( dGeomID o1, dGeomID o2, dContact* contacts, int maxcontacts );
+
+	/**
+	 * Returns true since the checker has no state.
+	 */
+	bool	isThreadSafe() const;
 };
 
 
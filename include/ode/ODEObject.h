@@ -110,6 +110,14 @@ public:
 	 */
 	void			updateVisualTransform();
 
+	/** 
+	 * Sets visual object's transform from simulated object transform 
+	 * interpolated between the last two time steps of the world.
+	 * Used after ODEWorld::update() to get smooth motion regardless
+	 * of simulation time step.
+	 */
+	void			updateVisualTransform( const ODEWorld* world );
+
 	/** Adds impulse to the body. */
 	void			addImpulse( dWorldID world, const NS(math,float3)& imp, float dt );
 
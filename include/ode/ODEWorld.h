@@ -3,11 +3,18 @@
 
 
 #include <ode/ODECollisionInterface.h>
+#include <lang/Array.h>
 #include <lang/Object.h>
+#include <lang/Hashtable.h>
+#include <math/float3.h>
+#include <math/quaternion.h>
 
 
+BEGIN_NAMESPACE(lang) 
+	class ThreadPool;END_NAMESPACE()
+
 BEGIN_NAMESPACE(math) 
-	class float3;END_NAMESPACE()
+	class float3x4;END_NAMESPACE()
 
 
 BEGIN_NAMESPACE(ode) 
@@ -16,6 +23,21 @@ BEGIN_NAMESPACE(ode)
 /**
  * Simple wrapper which combines ODE simulation world and collision space.
  *
+ * Simulation step can be executed in parallel with a thread pool:
+ * contacts of near object pairs are checked in parallel (if collision
+ * checker is thread safe), and islands (groups of bodies connected by 
+ * joints or contacts) are solved in parallel. Finding near object pairs
+ * stays in the calling thread. Contact joints are created and islands
+ * are formed in the same order regardless of threads, and each island
+ * uses its own random number generator state, so results do not depend
+ * on the number of threads.
+ *
+ * update() advances simulation by frame time using fixed time steps,
+ * so that simulation stays stable and its cost does not depend
+ * on rendering frame rate. Body states before the last step are stored,
+ * and visual transforms can be interpolated between the last two steps,
+ * see getInterpolatedTransform() and ODEObject::updateVisualTransform().
+ *
  * @ingroup ode
  */
 class ODEWorld :
@@ -39,10 +61,55 @@ public:
 	/** 
 	 * Simulates time step. 
 	 * Calls user specified collision checker to find out contacts between two objects.
+	 * If thread pool is given and the checker is thread safe (see 
+	 * ODECollisionInterface::isThreadSafe), the checker is called from multiple 
+	 * threads at the same time. Pairs with triangle meshes or geometry transforms
+	 * are always checked in the calling thread, since ODE trimesh colliders use
+	 * static data and geometry transform colliders modify the transformed geometry.
+	 * Near object pairs are found (broadphase) in the calling thread.
 	 * @param dt Time step to simulate.
 	 * @param checker Collision checker to be used to find contacts. Pass 0 to use default.
+	 * @param pool Thread pool to use, or 0 if the step is executed in the calling thread.
+	 */
+	void			step( float dt, ODECollisionInterface* checker, NS(lang,ThreadPool)* pool=0 );
+
+	/**
+	 * Advances simulation by elapsed time using fixed time steps.
+	 * Time which is left over is simulated in later updates.
+	 * If more than maximum number of steps would be needed (e.g. after
+	 * a long frame), extra time is dropped so that slow simulation
+	 * does not make the following frames even slower.
+	 * @param dt Elapsed time since last update.
+	 * @param checker Collision checker to be used to find contacts. Pass 0 to use default.
+	 * @param pool Thread pool to use, or 0 if the steps are executed in the calling thread.
+	 * @return Number of time steps simulated.
+	 * @see setTimeStep
 	 */
-	void			step( float dt, ODECollisionInterface* checker );
+	int				update( float dt, ODECollisionInterface* checker, NS(lang,ThreadPool)* pool=0 );
+
+	/**
+	 * Sets fixed time step used by update(). Default is 1/100 seconds.
+	 * @param dt Time step to simulate.
+	 * @param maxsteps Maximum number of time steps per update. Default is 8.
+	 */
+	void			setTimeStep( float dt, int maxsteps=8 );
+
+	/**
+	 * Returns position and rotation of the body interpolated
+	 * between the last two time steps simulated by update().
+	 * If body has no previous state (e.g. it was added after
+	 * the last update), current transform is returned.
+	 */
+	void			getInterpolatedTransform( dBodyID body, NS(math,float3x4)* tm ) const;
+
+	/** 
+	 * Returns fraction (0-1) of time step which has elapsed
+	 * after the last time step simulated by update().
+	 */
+	float			interpolation() const;
+
+	/** Returns fixed time step used by update(). */
+	float			timeStep() const;
 
 	/** Returns simulation world. */
 	dWorldID		world() const;
@@ -60,20 +127,62 @@ public:
 	 */
 	int				enabledBodies() const;
 
-private:
 	enum { MAX_CONTACTS = 16 };
 
-	struct CollisionCallbackProxyData
+	/* Private implementation class. */
+	class CollisionPair
+	{
+	public:
+		dGeomID		o1;
+		dGeomID		o2;
+		int			contacts;
+		bool		serial;
+	};
+
+	/* Private implementation class. */
+	class Island
 	{
-		ODEWorld*				world;
-		ODECollisionInterface*	checker;
-		dContact				contacts[MAX_CONTACTS];
+	public:
+		int				firstBody;
+		int				bodies;
+		int				firstJoint;
+		int				joints;
+		unsigned long	seed;
 	};
 
-	dWorldID		m_world;
-	dSpaceID		m_space;
-	dJointGroupID	m_contacts;
-	dGeomID			m_ground;
+	/* Private implementation class. */
+	class BodyState
+	{
+	public:
+		NS(math,float3)		position;
+		NS(math,quaternion)	rotation;
+	};
+
+	/* Private implementation class. */
+	class BodyHash
+	{
+	public:
+		int operator()( dBodyID const& x ) const				{return int( reinterpret_cast<size_t>(x) >> 4 );}
+	};
+
+private:
+	dWorldID						m_world;
+	dSpaceID						m_space;
+	dJointGroupID					m_contacts;
+	dGeomID							m_ground;
+	NS(lang,Array)<CollisionPair>	m_pairs;
+	NS(lang,Array)<dContact>		m_contactBuffer;
+	NS(lang,Array)<Island>			m_islands;
+	NS(lang,Array)<dBodyID>			m_islandBodies;
+	NS(lang,Array)<dJointID>		m_islandJoints;
+	NS(lang,Hashtable)<dBodyID,BodyState,BodyHash>	m_prevStates;
+	float							m_timeStep;
+	float							m_time;
+	int								m_maxSteps;
+
+	void			collide( ODECollisionInterface* checker, NS(lang,ThreadPool)* pool );
+	void			stepIslands( float dt, NS(lang,ThreadPool)* pool );
+	void			storeBodyStates();
 
 	static void		collisionCallbackProxy( void* data, dGeomID o1, dGeomID o2 );
 
@@ -0,0 +1,22 @@
+#ifndef _ODE_TEST_H
+#define _ODE_TEST_H
+
+
+#include <lang/pp.h>
+
+
+BEGIN_NAMESPACE(ode) 
+
+	
+/**
+ * Performs ode library internal tests.
+ */
+void test();
+
+
+END_NAMESPACE() // ode
+
+
+#endif // _ODE_TEST_H
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -502,7 +502,7 @@ int GameLevel::checkCollisions( dGeomID o1, dGeomID o2, dContact* contacts, int
 void GameLevel::blendLights( const float3& pos, Light* lt )
 {
 	LightSorter* lightsorter = lightSorter();
-	Array<Light*>& lights = lightsorter->getLightsByDistance( pos );
+	Array<Light*>& lights = lightsorter->getLightsInRange( pos );
 
 	float ltweight = 0.f;
 	float3 ltpos(0,0,0);
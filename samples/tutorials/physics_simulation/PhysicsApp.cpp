@@ -17,7 +17,7 @@ USING_NAMESPACE(framework)
 
 PhysicsApp::PhysicsApp( NS(framework,OSInterface)* os, Context* context ) :
 	App( os ),
-	m_timeToUpdate( 0 ),
+	m_time( 0 ),
 	m_context( context ),
 	m_world( 0 )
 {
@@ -38,16 +38,12 @@ void PhysicsApp::update( float dt, Context* context )
 
 	// update time
 	float fps = 1.f / dt;
-	float fixdt = 1.f / 100.f; // simulate physics at 100Hz
 	if ( isKeyDown(KEY_F4) )
-	{
 		dt *= .2f;
-		fixdt *= .2f;
-	}
-	m_timeToUpdate += dt;
+	m_time += dt;
 
-	m_scene->applyAnimations( m_timeToUpdate, dt );
-	simulate( fixdt );
+	m_scene->applyAnimations( m_time, dt );
+	simulate( dt );
 	render( context, fps );
 	swapBackBuffer( context );
 
@@ -59,12 +55,12 @@ void PhysicsApp::simulate( float dt )
 	PROFILE(simulation);
 
 	// update simulation at fixed interval
-	for ( ; m_timeToUpdate > dt ; m_timeToUpdate -= dt )
-		m_world->step( dt, 0 );
+	m_world->update( dt, 0 );
 
-	// get visual object positions from the rigid bodies
+	// get visual object positions from the rigid bodies,
+	// interpolated between the last two simulation steps
 	for ( int i = 0 ; i < m_objects.size() ; ++i )
-		m_objects[i]->updateVisualTransform();
+		m_objects[i]->updateVisualTransform( m_world );
 }
 
 void PhysicsApp::render( Context* context, float fps )
@@ -117,7 +113,7 @@ void PhysicsApp::keyDown( KeyType key )
 void PhysicsApp::restart()
 { 
 	// (re)start time
-	m_timeToUpdate = 0.f;
+	m_time = 0.f;
 
 	// (re)load scene to be simulated
 	m_scene = new Scene( m_context, "data/scene.hgr" );
@@ -131,6 +127,7 @@ void PhysicsApp::initSim()
 {
 	m_objects.clear();
 	m_world = new ODEWorld;
+	m_world->setTimeStep( 1.f/100.f ); // simulate physics at 100Hz
 
 	// create simulation objects from meshes
 	for ( Node* node = m_scene ; node != 0 ; node = node->next(m_scene) )
@@ -25,7 +25,7 @@ public:
 	void	update( float dt, NS(gr,Context)* context );
 
 private:
-	float				m_timeToUpdate;
+	float				m_time;
 	P(NS(gr,Context))		m_context;
 	P(NS(hgr,Scene))		m_scene;
 	P(NS(hgr,Camera))		m_camera;
@@ -79,6 +79,11 @@ void Context::setWireframeEnabled( bool /*enabled*/ )
 {
 }
 
+bool Context::writeDecodedTexture( Texture* /*tex*/, io::OutputStream* /*out*/ )
+{
+	return false;
+}
+
 
 END_NAMESPACE() // gr
 
@@ -21,6 +21,36 @@ USING_NAMESPACE(math)
 BEGIN_NAMESPACE(gr) 
 
 
+/**
+ * Insertion sort of triangle indices.
+ * Gives up and returns false if more than maxmoves element moves are needed.
+ * On failure the array is left as valid permutation but unsorted.
+ */
+template <class C> static bool insertionSort( uint16_t* a, int n, C cmp, int maxmoves )
+{
+	int moves = 0;
+	for ( int i = 1 ; i < n ; ++i )
+	{
+		uint16_t x = a[i];
+		int j = i;
+		while ( j > 0 && cmp(x,a[j-1]) )
+		{
+			a[j] = a[j-1];
+			--j;
+		}
+		a[j] = x;
+
+		moves += i-j;
+		if ( moves > maxmoves )
+			return false;
+	}
+	return true;
+}
+
+
+const float DIPrimitive::SORT_COHERENCE_THRESHOLD = 1e-3f;
+
+
 DIPrimitive::DIPrimitive() :
 	m_posScaleBias(1,0,0,0),
 	m_texcoordScaleBias(1,0,0,0),
@@ -36,7 +66,8 @@ DIPrimitive::DIPrimitive() :
 	m_indexRangeBegin( 0 ),
 	m_indexRangeEnd( 0 ),
 	m_vf(),
-	m_usedBones( 0 )
+	m_usedBones( 0 ),
+	m_sorted( SORTED_NONE )
 {
 }
 
@@ -47,6 +78,7 @@ DIPrimitive::~DIPrimitive()
 
 void DIPrimitive::reset()
 {
+	m_sorted = SORTED_NONE;
 	m_usedBones = 0;
 	m_vf = VertexFormat();
 	m_indices = 0;
@@ -154,6 +186,8 @@ void DIPrimitive::setIndexData( int v0, const void* data, int indexsize, int cou
 	assert( v0 >= 0 && count > 0 && v0+count <= m_indices );
 	assert( indexsize == 1 || indexsize == 2 || indexsize == 4 );
 
+	m_sorted = SORTED_NONE;
+
 	uint16_t* d = 0;
 	int isize = 0;
 	getIndexDataPtr( &d, &isize );
@@ -250,6 +284,8 @@ void DIPrimitive::setVertexTextureCoordinates( int index, int layer, const float
 
 void DIPrimitive::setIndices( int index, const int* data, int count )
 {
+	m_sorted = SORTED_NONE;
+
 	uint16_t* d = 0;
 	int indexsize = 0;
 	getIndexDataPtr( &d, &indexsize );
@@ -536,33 +572,61 @@ void DIPrimitive::getIndexDataPtr( uint16_t** data, int* indexsize )
 void DIPrimitive::sortFrontToBack( const float3& refpos, const float4x4& worldtm,
 	const float4x4* boneworldtm, int boneworldtmcount, SortBuffer& tmp )
 {
-	assert( indexCount() > 0 && "Only indexed primitives can be sorted" );
-
-	int tricount = indexCount()/3;
-	tmp.reset( tricount+indexCount(), tricount );
-	uint16_t* intbuffer = tmp.intBuffer();
-	float* floatbuffer = tmp.floatBuffer();
-
-	getTriangleDistances( refpos, worldtm, boneworldtm, boneworldtmcount, intbuffer, floatbuffer, tricount );
-	LANG_SORT( intbuffer, intbuffer+tricount, SortLess(floatbuffer) );
-	assert( floatbuffer[intbuffer[tricount-1]] >= floatbuffer[intbuffer[0]] );
-	reorderTriangles( intbuffer, intbuffer+tricount );
+	sortByDistance( SORTED_FRONTTOBACK, refpos, worldtm, boneworldtm, boneworldtmcount, tmp );
 }
 
 void DIPrimitive::sortBackToFront( const float3& refpos, const float4x4& worldtm,
 	const float4x4* boneworldtm, int boneworldtmcount, SortBuffer& tmp )
+{
+	sortByDistance( SORTED_BACKTOFRONT, refpos, worldtm, boneworldtm, boneworldtmcount, tmp );
+}
+
+void DIPrimitive::sortByDistance( SortedOrder order, const float3& refpos, const float4x4& worldtm,
+	const float4x4* boneworldtm, int boneworldtmcount, SortBuffer& tmp )
 {
 	assert( indexCount() > 0 && "Only indexed primitives can be sorted" );
+	assert( order == SORTED_FRONTTOBACK || order == SORTED_BACKTOFRONT );
+
+	// temporal coherence: rigid primitive sorted last time with
+	// the same transform and almost the same reference point keeps its order
+	const bool skinned = m_vf.hasData(VertexFormat::DT_BONEWEIGHTS) && boneworldtm != 0;
+	if ( m_sorted == order && !skinned && m_sortWorldTm == worldtm )
+	{
+		float3 delta = refpos - m_sortRefPos;
+		float3 dist = refpos - worldtm.translation();
+		if ( dot(delta,delta) < dot(dist,dist)*(SORT_COHERENCE_THRESHOLD*SORT_COHERENCE_THRESHOLD) )
+			return;
+	}
 
 	int tricount = indexCount()/3;
-	tmp.reset( tricount+indexCount(), tricount );
+	tmp.reset( tricount+indexCount(), tricount, vertexCount() );
 	uint16_t* intbuffer = tmp.intBuffer();
 	float* floatbuffer = tmp.floatBuffer();
 
-	getTriangleDistances( refpos, worldtm, boneworldtm, boneworldtmcount, intbuffer, floatbuffer, tricount );
-	LANG_SORT( intbuffer, intbuffer+tricount, SortGreater(floatbuffer) );
-	assert( floatbuffer[intbuffer[tricount-1]] <= floatbuffer[intbuffer[0]] );
+	getTriangleDistances( refpos, worldtm, boneworldtm, boneworldtmcount, intbuffer, floatbuffer, tricount,
+		tmp.vertexBufferX(), tmp.vertexBufferY(), tmp.vertexBufferZ() );
+
+	// if primitive was sorted to the same order last time then
+	// index data is almost in order already so use insertion sort
+	// and fall back to full sort only if the order changed too much
+	const int maxmoves = tricount * SORT_COHERENCE_MAX_MOVES;
+	if ( SORTED_FRONTTOBACK == order )
+	{
+		if ( m_sorted != order || !insertionSort(intbuffer, tricount, SortLess(floatbuffer), maxmoves) )
+			LANG_SORT( intbuffer, intbuffer+tricount, SortLess(floatbuffer) );
+		assert( floatbuffer[intbuffer[tricount-1]] >= floatbuffer[intbuffer[0]] );
+	}
+	else
+	{
+		if ( m_sorted != order || !insertionSort(intbuffer, tricount, SortGreater(floatbuffer), maxmoves) )
+			LANG_SORT( intbuffer, intbuffer+tricount, SortGreater(floatbuffer) );
+		assert( floatbuffer[intbuffer[tricount-1]] <= floatbuffer[intbuffer[0]] );
+	}
 	reorderTriangles( intbuffer, intbuffer+tricount );
+
+	m_sorted = (uint8_t)order;
+	m_sortRefPos = refpos;
+	m_sortWorldTm = worldtm;
 }
 
 void DIPrimitive::sortInsideOut( SortBuffer& tmp )
@@ -570,15 +634,17 @@ void DIPrimitive::sortInsideOut( SortBuffer& tmp )
 	assert( indexCount() > 0 && "Only indexed primitives can be sorted" );
 
 	int tricount = indexCount()/3;
-	tmp.reset( tricount+indexCount(), tricount );
+	tmp.reset( tricount+indexCount(), tricount, vertexCount() );
 	uint16_t* intbuffer = tmp.intBuffer();
 	float* floatbuffer = tmp.floatBuffer();
 
 	const float4x4 id( 1.f );
-	getTriangleDistances( center(), id, 0, 0, intbuffer, floatbuffer, tricount );
+	getTriangleDistances( center(), id, 0, 0, intbuffer, floatbuffer, tricount,
+		tmp.vertexBufferX(), tmp.vertexBufferY(), tmp.vertexBufferZ() );
 	LANG_SORT( intbuffer, intbuffer+tricount, SortLess(floatbuffer) );
 	assert( floatbuffer[intbuffer[tricount-1]] >= floatbuffer[intbuffer[0]] );
 	reorderTriangles( intbuffer, intbuffer+tricount );
+	m_sorted = SORTED_NONE;
 }
 
 void DIPrimitive::sortOutsideIn( SortBuffer& tmp )
@@ -586,15 +652,17 @@ void DIPrimitive::sortOutsideIn( SortBuffer& tmp )
 	assert( indexCount() > 0 && "Only indexed primitives can be sorted" );
 
 	int tricount = indexCount()/3;
-	tmp.reset( tricount+indexCount(), tricount );
+	tmp.reset( tricount+indexCount(), tricount, vertexCount() );
 	uint16_t* intbuffer = tmp.intBuffer();
 	float* floatbuffer = tmp.floatBuffer();
 
 	const float4x4 id( 1.f );
-	getTriangleDistances( center(), id, 0, 0, intbuffer, floatbuffer, tricount );
+	getTriangleDistances( center(), id, 0, 0, intbuffer, floatbuffer, tricount,
+		tmp.vertexBufferX(), tmp.vertexBufferY(), tmp.vertexBufferZ() );
 	LANG_SORT( intbuffer, intbuffer+tricount, SortGreater(floatbuffer) );
 	assert( floatbuffer[intbuffer[tricount-1]] <= floatbuffer[intbuffer[0]] );
 	reorderTriangles( intbuffer, intbuffer+tricount );
+	m_sorted = SORTED_NONE;
 }
 
 float3 DIPrimitive::center() const
@@ -627,33 +695,100 @@ float3 DIPrimitive::center() const
 	return (boxmax + boxmin) * .5f;
 }
 
-void DIPrimitive::getTriangleDistances( const NS(math,float3)& worldpos, const NS(math,float4x4)& worldtm, const NS(math,float4x4)* boneworldtm, int boneworldtmcount, uint16_t* trix, float* tridist, int tricount ) const
+void DIPrimitive::transformVertexPositions( const float4x4& worldtm, const float4x4* boneworldtm, int boneworldtmcount, float* vx, float* vy, float* vz ) const
 {
-	assert( tricount == (indexCount() > 0 ? indexCount()/3 : vertexCount()/3) && "Invalid triangle count" );
 	assert( locked() != LOCK_NONE );
 	assert( boneworldtmcount >= 0 && boneworldtmcount < 256 ); boneworldtmcount=boneworldtmcount;
 
+	const int vertices = vertexCount();
+
 	uint8_t* vposdata = 0;
 	int vpospitch = 0;
 	VertexFormat::DataFormat vposdatafmt = m_vf.getDataFormat( VertexFormat::DT_POSITION );
 	const_cast<DIPrimitive*>(this)->getVertexDataPtr( VertexFormat::DT_POSITION, &vposdata, &vpospitch );
 
-	uint8_t* vboneindexdata = 0;
-	uint8_t* vboneweightdata = 0;
-	int vboneindexpitch = 0;
-	int vboneweightpitch = 0;
-	VertexFormat::DataFormat vboneindexdatafmt = m_vf.getDataFormat( VertexFormat::DT_BONEINDICES );
-	VertexFormat::DataFormat vboneweightdatafmt = m_vf.getDataFormat( VertexFormat::DT_BONEWEIGHTS );
-	if ( m_vf.hasData(VertexFormat::DT_BONEWEIGHTS) )
+	float4 v;
+	if ( m_vf.hasData(VertexFormat::DT_BONEWEIGHTS) && boneworldtm != 0 )
 	{
+		uint8_t* vboneindexdata = 0;
+		uint8_t* vboneweightdata = 0;
+		int vboneindexpitch = 0;
+		int vboneweightpitch = 0;
+		VertexFormat::DataFormat vboneindexdatafmt = m_vf.getDataFormat( VertexFormat::DT_BONEINDICES );
+		VertexFormat::DataFormat vboneweightdatafmt = m_vf.getDataFormat( VertexFormat::DT_BONEWEIGHTS );
 		const_cast<DIPrimitive*>(this)->getVertexDataPtr( VertexFormat::DT_BONEINDICES, &vboneindexdata, &vboneindexpitch );
 		const_cast<DIPrimitive*>(this)->getVertexDataPtr( VertexFormat::DT_BONEWEIGHTS, &vboneweightdata, &vboneweightpitch );
+
+		// skinned, 2 weights used, second weight is 1-first
+		float4 bi, bw;
+		for ( int i = 0 ; i < vertices ; ++i )
+		{
+			VertexFormat::getData( vposdatafmt, vposdata, &v );
+			VertexFormat::getData( vboneindexdatafmt, vboneindexdata, &bi );
+			VertexFormat::getData( vboneweightdatafmt, vboneweightdata, &bw );
+			vposdata += vpospitch;
+			vboneindexdata += vboneindexpitch;
+			vboneweightdata += vboneweightpitch;
+
+			const int ix0 = (int)bi.x;
+			const int ix1 = (int)bi.y;
+			assert( ix0 >= 0 && ix0 < boneworldtmcount );
+			assert( ix1 >= 0 && ix1 < boneworldtmcount );
+			const float w0 = bw.x;
+			const float w1 = 1.f - bw.x;
+			const float4x4& m0 = boneworldtm[ix0];
+			const float4x4& m1 = boneworldtm[ix1];
+
+			vx[i] = (m0(0,0)*v.x + m0(0,1)*v.y + m0(0,2)*v.z + m0(3,0)) * w0 + 
+				(m1(0,0)*v.x + m1(0,1)*v.y + m1(0,2)*v.z + m1(3,0)) * w1;
+			vy[i] = (m0(1,0)*v.x + m0(1,1)*v.y + m0(1,2)*v.z + m0(3,1)) * w0 + 
+				(m1(1,0)*v.x + m1(1,1)*v.y + m1(1,2)*v.z + m1(3,1)) * w1;
+			vz[i] = (m0(2,0)*v.x + m0(2,1)*v.y + m0(2,2)*v.z + m0(3,2)) * w0 + 
+				(m1(2,0)*v.x + m1(2,1)*v.y + m1(2,2)*v.z + m1(3,2)) * w1;
+		}
+	}
+	else
+	{
+		// rigid, decode first then transform in separate loop without data dependencies
+		for ( int i = 0 ; i < vertices ; ++i )
+		{
+			VertexFormat::getData( vposdatafmt, vposdata, &v );
+			vposdata += vpospitch;
+			vx[i] = v.x;
+			vy[i] = v.y;
+			vz[i] = v.z;
+		}
+
+		const float m00 = worldtm(0,0), m01 = worldtm(0,1), m02 = worldtm(0,2), m03 = worldtm(0,3);
+		const float m10 = worldtm(1,0), m11 = worldtm(1,1), m12 = worldtm(1,2), m13 = worldtm(1,3);
+		const float m20 = worldtm(2,0), m21 = worldtm(2,1), m22 = worldtm(2,2), m23 = worldtm(2,3);
+		for ( int i = 0 ; i < vertices ; ++i )
+		{
+			const float x = vx[i];
+			const float y = vy[i];
+			const float z = vz[i];
+			vx[i] = m00*x + m01*y + m02*z + m03;
+			vy[i] = m10*x + m11*y + m12*z + m13;
+			vz[i] = m20*x + m21*y + m22*z + m23;
+		}
 	}
+}
+
+void DIPrimitive::getTriangleDistances( const float3& worldpos, const float4x4& worldtm, const float4x4* boneworldtm, int boneworldtmcount, 
+	uint16_t* trix, float* tridist, int tricount, float* vx, float* vy, float* vz ) const
+{
+	assert( tricount == (indexCount() > 0 ? indexCount()/3 : vertexCount()/3) && "Invalid triangle count" );
+	assert( locked() != LOCK_NONE );
+
+	// each vertex transformed only once even if shared by many triangles
+	transformVertexPositions( worldtm, boneworldtm, boneworldtmcount, vx, vy, vz );
 
-	float4 v0,v1,v2,v;
-	float4 worldpos4(worldpos,1.f);
-	float4 v0bi,v1bi,v2bi;
-	float4 v0bw,v1bw,v2bw;
+	// compare triangle vertex sums against 3*worldpos,
+	// scale of 1/9 restores squared distance from triangle center
+	const float px = worldpos.x * 3.f;
+	const float py = worldpos.y * 3.f;
+	const float pz = worldpos.z * 3.f;
+	const float scale = 1.f/9.f;
 
 	if ( indexCount() > 0 )
 	{
@@ -661,195 +796,30 @@ void DIPrimitive::getTriangleDistances( const NS(math,float3)& worldpos, const N
 		int indexsize;
 		const_cast<DIPrimitive*>(this)->getIndexDataPtr( &indexdata, &indexsize );
 
-		if ( m_vf.hasData(VertexFormat::DT_BONEWEIGHTS) && boneworldtm != 0 )
-		{
-			// indexed and skinned
-			const int WEIGHTS_USED = 2;
-			int i = 0;
-			for ( int tri = 0 ; tri < tricount ; ++tri )
-			{
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch*indexdata[i], &v0 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch*indexdata[i+1], &v1 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch*indexdata[i+2], &v2 );
-				VertexFormat::getData( vboneindexdatafmt, vboneindexdata+vboneindexpitch*indexdata[i], &v0bi );
-				VertexFormat::getData( vboneindexdatafmt, vboneindexdata+vboneindexpitch*indexdata[i+1], &v1bi );
-				VertexFormat::getData( vboneindexdatafmt, vboneindexdata+vboneindexpitch*indexdata[i+2], &v2bi );
-				VertexFormat::getData( vboneweightdatafmt, vboneweightdata+vboneweightpitch*indexdata[i], &v0bw );
-				VertexFormat::getData( vboneweightdatafmt, vboneweightdata+vboneweightpitch*indexdata[i+1], &v1bw );
-				VertexFormat::getData( vboneweightdatafmt, vboneweightdata+vboneweightpitch*indexdata[i+2], &v2bw );
-				i += 3;
-
-				v0.w = v1.w = v2.w = 1.f;
-				v.x = v.y = v.z = 0.f;
-				float4 sumw(0,0,0,0);
-				for ( int k = 0 ; k < WEIGHTS_USED ; ++k )
-				{
-					int ix0 = (int)v0bi[k];
-					int ix1 = (int)v1bi[k];
-					int ix2 = (int)v2bi[k];
-					assert( ix0 >= 0 && ix0 < boneworldtmcount );
-					assert( ix1 >= 0 && ix1 < boneworldtmcount );
-					assert( ix2 >= 0 && ix2 < boneworldtmcount );
-					if ( k == (WEIGHTS_USED-1) )
-					{
-						v0bw[k] = 1.f - sumw[0];
-						v1bw[k] = 1.f - sumw[1];
-						v2bw[k] = 1.f - sumw[2];
-					}
-					else
-					{
-						sumw[0] += v0bw[k];
-						sumw[1] += v1bw[k];
-						sumw[2] += v2bw[k];
-					}
-
-					{
-						const float4x4& m = boneworldtm[ix0];
-						float4 r0( m(0,0), m(0,1), m(0,2), 0.f );
-						float4 r1( m(1,0), m(1,1), m(1,2), 0.f );
-						float4 r2( m(2,0), m(2,1), m(2,2), 0.f );
-						float4 r3( m(3,0), m(3,1), m(3,2), 0.f );
-						v += float4( dot(r0,v0)+r3.x, dot(r1,v0)+r3.y, dot(r2,v0)+r3.z, 0.f ) * v0bw[k] * (1.f/3.f);
-					}
-
-					{
-						const float4x4& m = boneworldtm[ix1];
-						float4 r0( m(0,0), m(0,1), m(0,2), 0.f );
-						float4 r1( m(1,0), m(1,1), m(1,2), 0.f );
-						float4 r2( m(2,0), m(2,1), m(2,2), 0.f );
-						float4 r3( m(3,0), m(3,1), m(3,2), 0.f );
-						v += float4( dot(r0,v1)+r3.x, dot(r1,v1)+r3.y, dot(r2,v1)+r3.z, 0.f ) * v1bw[k] * (1.f/3.f);
-					}
-
-					{
-						const float4x4& m = boneworldtm[ix2];
-						float4 r0( m(0,0), m(0,1), m(0,2), 0.f );
-						float4 r1( m(1,0), m(1,1), m(1,2), 0.f );
-						float4 r2( m(2,0), m(2,1), m(2,2), 0.f );
-						float4 r3( m(3,0), m(3,1), m(3,2), 0.f );
-						v += float4( dot(r0,v2)+r3.x, dot(r1,v2)+r3.y, dot(r2,v2)+r3.z, 0.f ) * v2bw[k] * (1.f/3.f);
-					}
-				}
-				v.w = 1.f;
-
-				trix[tri] = (uint16_t)tri;
-				tridist[tri] = (v-worldpos4).lengthSquared();
-			}
-		}
-		else
+		for ( int tri = 0 ; tri < tricount ; ++tri )
 		{
-			// indexed and non-skinned
-			int i = 0;
-			for ( int tri = 0 ; tri < tricount ; ++tri )
-			{
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch*indexdata[i], &v0 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch*indexdata[i+1], &v1 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch*indexdata[i+2], &v2 );
-				i += 3;
-
-				v = (v0+v1+v2)*(1.f/3.f);
-				v.w = 1.f;
-				v = worldtm.transform( v );
-				trix[tri] = (uint16_t)tri;
-				tridist[tri] = (v-worldpos4).lengthSquared();
-			}
+			const int i0 = indexdata[0];
+			const int i1 = indexdata[1];
+			const int i2 = indexdata[2];
+			indexdata += 3;
+
+			const float dx = vx[i0] + vx[i1] + vx[i2] - px;
+			const float dy = vy[i0] + vy[i1] + vy[i2] - py;
+			const float dz = vz[i0] + vz[i1] + vz[i2] - pz;
+			trix[tri] = (uint16_t)tri;
+			tridist[tri] = (dx*dx + dy*dy + dz*dz) * scale;
 		}
 	}
 	else
 	{
-		const int vpospitch2 = vpospitch+vpospitch;
-		const int vpospitch3 = vpospitch+vpospitch2;
-		const int vboneindexpitch2 = vboneindexpitch+vboneindexpitch;
-		const int vboneweightpitch2 = vboneweightpitch+vboneweightpitch;
-
-		if ( m_vf.hasData(VertexFormat::DT_BONEWEIGHTS) )
-		{
-			// non-indexed and skinned
-			const int WEIGHTS_USED = 2;
-			for ( int tri = 0 ; tri < tricount ; ++tri )
-			{
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch, &v0 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch2, &v1 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch3, &v2 );
-				VertexFormat::getData( vboneindexdatafmt, vboneindexdata, &v0bi );
-				VertexFormat::getData( vboneindexdatafmt, vboneindexdata+vboneindexpitch, &v1bi );
-				VertexFormat::getData( vboneindexdatafmt, vboneindexdata+vboneindexpitch2, &v2bi );
-				VertexFormat::getData( vboneweightdatafmt, vboneweightdata, &v0bw );
-				VertexFormat::getData( vboneweightdatafmt, vboneweightdata+vboneweightpitch, &v1bw );
-				VertexFormat::getData( vboneweightdatafmt, vboneweightdata+vboneweightpitch2, &v2bw );
-
-				v0.w = v1.w = v2.w = 1.f;
-				v.x = v.y = v.z = 0.f;
-				float4 sumw(0,0,0,0);
-				for ( int k = 0 ; k < WEIGHTS_USED ; ++k )
-				{
-					int ix0 = (int)v0bi[k];
-					int ix1 = (int)v1bi[k];
-					int ix2 = (int)v2bi[k];
-					assert( ix0 >= 0 && ix0 < boneworldtmcount );
-					assert( ix1 >= 0 && ix1 < boneworldtmcount );
-					assert( ix2 >= 0 && ix2 < boneworldtmcount );
-					if ( k == (WEIGHTS_USED-1) )
-					{
-						v0bw[k] = 1.f - sumw[0];
-						v1bw[k] = 1.f - sumw[1];
-						v2bw[k] = 1.f - sumw[2];
-					}
-					else
-					{
-						sumw[0] += v0bw[k];
-						sumw[1] += v1bw[k];
-						sumw[2] += v2bw[k];
-					}
-
-					{
-						const float4x4& m = boneworldtm[ix0];
-						float4 r0( m(0,0), m(0,1), m(0,2), 0.f );
-						float4 r1( m(1,0), m(1,1), m(1,2), 0.f );
-						float4 r2( m(2,0), m(2,1), m(2,2), 0.f );
-						float4 r3( m(3,0), m(3,1), m(3,2), 0.f );
-						v += float4( dot(r0,v0)+r3.x, dot(r1,v0)+r3.y, dot(r2,v0)+r3.z, 0.f ) * v0bw[k] * (1.f/3.f);
-					}
-
-					{
-						const float4x4& m = boneworldtm[ix1];
-						float4 r0( m(0,0), m(0,1), m(0,2), 0.f );
-						float4 r1( m(1,0), m(1,1), m(1,2), 0.f );
-						float4 r2( m(2,0), m(2,1), m(2,2), 0.f );
-						float4 r3( m(3,0), m(3,1), m(3,2), 0.f );
-						v += float4( dot(r0,v1)+r3.x, dot(r1,v1)+r3.y, dot(r2,v1)+r3.z, 0.f ) * v1bw[k] * (1.f/3.f);
-					}
-
-					{
-						const float4x4& m = boneworldtm[ix2];
-						float4 r0( m(0,0), m(0,1), m(0,2), 0.f );
-						float4 r1( m(1,0), m(1,1), m(1,2), 0.f );
-						float4 r2( m(2,0), m(2,1), m(2,2), 0.f );
-						float4 r3( m(3,0), m(3,1), m(3,2), 0.f );
-						v += float4( dot(r0,v2)+r3.x, dot(r1,v2)+r3.y, dot(r2,v2)+r3.z, 0.f ) * v2bw[k] * (1.f/3.f);
-					}
-				}
-				v.w = 1.f;
-
-				trix[tri] = (uint16_t)tri;
-				tridist[tri] = (v-worldpos4).lengthSquared();
-			}
-		}
-		else
+		for ( int tri = 0 ; tri < tricount ; ++tri )
 		{
-			// non-indexed and non-skinned
-			for ( int tri = 0 ; tri < tricount ; ++tri )
-			{
-				VertexFormat::getData( vposdatafmt, vposdata, &v0 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch, &v1 );
-				VertexFormat::getData( vposdatafmt, vposdata+vpospitch2, &v2 );
-				v = (v0+v1+v2)*(1.f/3.f);
-				v.w = 1.f;
-				v = worldtm.transform( v );
-				trix[tri] = (uint16_t)tri;
-				tridist[tri] = (v-worldpos4).lengthSquared();
-				vposdata += vpospitch3;
-			}
+			const int i0 = tri*3;
+			const float dx = vx[i0] + vx[i0+1] + vx[i0+2] - px;
+			const float dy = vy[i0] + vy[i0+1] + vy[i0+2] - py;
+			const float dz = vz[i0] + vz[i0+1] + vz[i0+2] - pz;
+			trix[tri] = (uint16_t)tri;
+			tridist[tri] = (dx*dx + dy*dy + dz*dz) * scale;
 		}
 	}
 }
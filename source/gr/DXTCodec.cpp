@@ -0,0 +1,847 @@
+#include <gr/DXTCodec.h>
+#include <math.h>
+#include <string.h>
+#include <config.h>
+
+
+BEGIN_NAMESPACE(gr)
+
+
+/**
+ * Color endpoints and pixel indices of a color block.
+ */
+class ColorFit
+{
+public:
+	uint16_t	col0;
+	uint16_t	col1;
+	uint8_t		indices[16];
+	int			error;
+};
+
+/**
+ * Endpoint pairs which reproduce a single 8-bit value
+ * best when interpolated 2/3 of the way from first to second endpoint.
+ */
+class SingleColorTables
+{
+public:
+	uint8_t		match5[256][2];
+	uint8_t		match6[256][2];
+
+	SingleColorTables()
+	{
+		build( match5, 5 );
+		build( match6, 6 );
+	}
+
+private:
+	static void build( uint8_t table[256][2], int bits )
+	{
+		const int n = 1 << bits;
+		for ( int v = 0 ; v < 256 ; ++v )
+		{
+			int besterr = 0x7FFFFFFF;
+			for ( int a = 0 ; a < n ; ++a )
+			{
+				const int ea = bits == 5 ? (a<<3)|(a>>2) : (a<<2)|(a>>4);
+				for ( int b = 0 ; b < n ; ++b )
+				{
+					const int eb = bits == 5 ? (b<<3)|(b>>2) : (b<<2)|(b>>4);
+					int err = (2*ea+eb+1)/3 - v;
+					err = err*err*1024 + (ea-eb)*(ea-eb);
+					if ( err < besterr )
+					{
+						besterr = err;
+						table[v][0] = (uint8_t)a;
+						table[v][1] = (uint8_t)b;
+					}
+				}
+			}
+		}
+	}
+};
+
+static const SingleColorTables s_singleColor;
+
+/** Interpolation weights of the first endpoint by 4-color block index. */
+static const float WEIGHTS4[4] = {1.f, 0.f, 2.f/3.f, 1.f/3.f};
+
+/** Interpolation weights of the first endpoint by 3-color block index. */
+static const float WEIGHTS3[4] = {1.f, 0.f, .5f, 0.f};
+
+
+/** Expands 5-bit value to 8 bits as done by graphics hardware. */
+static inline int expand5( int v )
+{
+	return (v<<3) | (v>>2);
+}
+
+/** Expands 6-bit value to 8 bits as done by graphics hardware. */
+static inline int expand6( int v )
+{
+	return (v<<2) | (v>>4);
+}
+
+/** Quantizes value in range [0,255] to specified number of bits. */
+static inline int quantize( float v, int bits )
+{
+	const int maxv = (1<<bits) - 1;
+	int q = int( v * float(maxv) / 255.f + .5f );
+	return q < 0 ? 0 : (q > maxv ? maxv : q);
+}
+
+/** Returns R5G6B5 color from RGB in range [0,255]. */
+static inline uint16_t packColor( const float* rgb )
+{
+	return uint16_t( (quantize(rgb[0],5)<<11) | (quantize(rgb[1],6)<<5) | quantize(rgb[2],5) );
+}
+
+/** Returns RGB in range [0,255] from R5G6B5 color. */
+static inline void unpackColor( uint16_t c, int* rgb )
+{
+	rgb[0] = expand5( c>>11 );
+	rgb[1] = expand6( (c>>5) & 0x3F );
+	rgb[2] = expand5( c & 0x1F );
+}
+
+static inline uint16_t getUInt16LE( const uint8_t* data )
+{
+	return uint16_t( data[0] + (data[1]<<8) );
+}
+
+static inline void setUInt16LE( uint8_t* data, uint16_t v )
+{
+	data[0] = uint8_t( v );
+	data[1] = uint8_t( v>>8 );
+}
+
+/**
+ * Returns color palette of a block.
+ * In 3-color mode fourth entry is transparent black.
+ */
+static void getColorPalette( uint16_t col0, uint16_t col1, bool fourcolor, int pal[4][3] )
+{
+	unpackColor( col0, pal[0] );
+	unpackColor( col1, pal[1] );
+
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		if ( fourcolor )
+		{
+			pal[2][k] = (2*pal[0][k] + pal[1][k] + 1) / 3;
+			pal[3][k] = (pal[0][k] + 2*pal[1][k] + 1) / 3;
+		}
+		else
+		{
+			pal[2][k] = (pal[0][k] + pal[1][k]) / 2;
+			pal[3][k] = 0;
+		}
+	}
+}
+
+/**
+ * Returns alpha palette of DXT5 block.
+ */
+static void getAlphaPalette( int a0, int a1, int pal[8] )
+{
+	pal[0] = a0;
+	pal[1] = a1;
+
+	if ( a0 > a1 )
+	{
+		for ( int i = 1 ; i < 7 ; ++i )
+			pal[i+1] = ((7-i)*a0 + i*a1 + 3) / 7;
+	}
+	else
+	{
+		for ( int i = 1 ; i < 5 ; ++i )
+			pal[i+1] = ((5-i)*a0 + i*a1 + 2) / 5;
+		pal[6] = 0;
+		pal[7] = 255;
+	}
+}
+
+/**
+ * Selects closest palette color for each pixel.
+ * Pixels excluded by the mask get index 3 (transparent in 3-color mode).
+ * @return Total squared error.
+ */
+static int matchColors( const int rgb[16][3], const bool* mask, uint16_t col0, uint16_t col1, bool fourcolor, uint8_t* indices )
+{
+	int pal[4][3];
+	getColorPalette( col0, col1, fourcolor, pal );
+	const int colors = fourcolor ? 4 : 3;
+
+	int error = 0;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		if ( mask != 0 && !mask[i] )
+		{
+			indices[i] = 3;
+			continue;
+		}
+
+		int besterr = 0x7FFFFFFF;
+		for ( int k = 0 ; k < colors ; ++k )
+		{
+			const int dr = rgb[i][0] - pal[k][0];
+			const int dg = rgb[i][1] - pal[k][1];
+			const int db = rgb[i][2] - pal[k][2];
+			const int err = dr*dr + dg*dg + db*db;
+			if ( err < besterr )
+			{
+				besterr = err;
+				indices[i] = (uint8_t)k;
+			}
+		}
+		error += besterr;
+	}
+	return error;
+}
+
+/**
+ * Fits endpoints to colors and evaluates the result.
+ */
+static void evaluateFit( const int rgb[16][3], const bool* mask, const float* start, const float* end, bool fourcolor, ColorFit* fit )
+{
+	fit->col0 = packColor( start );
+	fit->col1 = packColor( end );
+	fit->error = matchColors( rgb, mask, fit->col0, fit->col1, fourcolor, fit->indices );
+}
+
+/**
+ * Solves least squares endpoints for fixed pixel indices.
+ * @return false if the indices do not define the endpoints.
+ */
+static bool solveEndpoints( const int rgb[16][3], const bool* mask, const uint8_t* indices, bool fourcolor, float* start, float* end )
+{
+	const float* weights = fourcolor ? WEIGHTS4 : WEIGHTS3;
+
+	float alpha2 = 0.f;
+	float beta2 = 0.f;
+	float alphabeta = 0.f;
+	float alphax[3] = {0.f, 0.f, 0.f};
+	float betax[3] = {0.f, 0.f, 0.f};
+
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		if ( (mask != 0 && !mask[i]) || (!fourcolor && indices[i] == 3) )
+			continue;
+
+		const float alpha = weights[ indices[i] ];
+		const float beta = 1.f - alpha;
+		alpha2 += alpha*alpha;
+		beta2 += beta*beta;
+		alphabeta += alpha*beta;
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			alphax[k] += alpha * float(rgb[i][k]);
+			betax[k] += beta * float(rgb[i][k]);
+		}
+	}
+
+	const float det = alpha2*beta2 - alphabeta*alphabeta;
+	if ( fabsf(det) < 1e-6f )
+		return false;
+
+	const float invdet = 1.f / det;
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		float a = (alphax[k]*beta2 - betax[k]*alphabeta) * invdet;
+		float b = (betax[k]*alpha2 - alphax[k]*alphabeta) * invdet;
+		start[k] = a < 0.f ? 0.f : (a > 255.f ? 255.f : a);
+		end[k] = b < 0.f ? 0.f : (b > 255.f ? 255.f : b);
+	}
+	return true;
+}
+
+/**
+ * Computes centroid and principal axis of the colors.
+ */
+static void getPrincipalAxis( const int rgb[16][3], const bool* mask, float* centroid, float* axis )
+{
+	float n = 0.f;
+	centroid[0] = centroid[1] = centroid[2] = 0.f;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		if ( mask == 0 || mask[i] )
+		{
+			for ( int k = 0 ; k < 3 ; ++k )
+				centroid[k] += float(rgb[i][k]);
+			n += 1.f;
+		}
+	}
+	for ( int k = 0 ; k < 3 ; ++k )
+		centroid[k] /= n;
+
+	// covariance matrix (symmetric)
+	float cov[3][3];
+	memset( cov, 0, sizeof(cov) );
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		if ( mask == 0 || mask[i] )
+		{
+			float d[3];
+			for ( int k = 0 ; k < 3 ; ++k )
+				d[k] = float(rgb[i][k]) - centroid[k];
+			for ( int r = 0 ; r < 3 ; ++r )
+				for ( int c = r ; c < 3 ; ++c )
+					cov[r][c] += d[r]*d[c];
+		}
+	}
+	cov[1][0] = cov[0][1];
+	cov[2][0] = cov[0][2];
+	cov[2][1] = cov[1][2];
+
+	// start power iteration from the row with largest magnitude
+	int row = 0;
+	float rowlen = 0.f;
+	for ( int r = 0 ; r < 3 ; ++r )
+	{
+		float len = cov[r][0]*cov[r][0] + cov[r][1]*cov[r][1] + cov[r][2]*cov[r][2];
+		if ( len > rowlen )
+		{
+			rowlen = len;
+			row = r;
+		}
+	}
+	if ( rowlen <= 0.f )
+	{
+		axis[0] = axis[1] = axis[2] = .57735f;
+		return;
+	}
+
+	float v[3] = {cov[row][0], cov[row][1], cov[row][2]};
+	for ( int iter = 0 ; iter < 8 ; ++iter )
+	{
+		float w[3];
+		for ( int r = 0 ; r < 3 ; ++r )
+			w[r] = cov[r][0]*v[0] + cov[r][1]*v[1] + cov[r][2]*v[2];
+		float len = sqrtf( w[0]*w[0] + w[1]*w[1] + w[2]*w[2] );
+		if ( len <= 1e-12f )
+			break;
+		for ( int k = 0 ; k < 3 ; ++k )
+			v[k] = w[k] / len;
+	}
+
+	float len = sqrtf( v[0]*v[0] + v[1]*v[1] + v[2]*v[2] );
+	for ( int k = 0 ; k < 3 ; ++k )
+		axis[k] = v[k] / len;
+}
+
+/**
+ * Range fit: endpoints from extreme colors along the principal axis,
+ * refined once by least squares.
+ */
+static void rangeFit( const int rgb[16][3], const bool* mask, bool fourcolor, ColorFit* fit )
+{
+	float centroid[3];
+	float axis[3];
+	getPrincipalAxis( rgb, mask, centroid, axis );
+
+	float mind = 1e30f;
+	float maxd = -1e30f;
+	int mini = 0;
+	int maxi = 0;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		if ( mask == 0 || mask[i] )
+		{
+			float d = float(rgb[i][0])*axis[0] + float(rgb[i][1])*axis[1] + float(rgb[i][2])*axis[2];
+			if ( d < mind )
+			{
+				mind = d;
+				mini = i;
+			}
+			if ( d > maxd )
+			{
+				maxd = d;
+				maxi = i;
+			}
+		}
+	}
+
+	float start[3];
+	float end[3];
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		start[k] = float( rgb[maxi][k] );
+		end[k] = float( rgb[mini][k] );
+	}
+	evaluateFit( rgb, mask, start, end, fourcolor, fit );
+
+	// least squares refinement
+	if ( fit->error > 0 && solveEndpoints(rgb, mask, fit->indices, fourcolor, start, end) )
+	{
+		ColorFit refined;
+		evaluateFit( rgb, mask, start, end, fourcolor, &refined );
+		if ( refined.error < fit->error )
+			*fit = refined;
+	}
+}
+
+/**
+ * Cluster fit: tries all orderings of the colors along the principal axis
+ * to four clusters and selects least squares endpoints of the best one.
+ */
+static void clusterFit( const int rgb[16][3], ColorFit* fit )
+{
+	float centroid[3];
+	float axis[3];
+	getPrincipalAxis( rgb, 0, centroid, axis );
+
+	// sort colors along the axis
+	int order[16];
+	float dist[16];
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		float d = float(rgb[i][0])*axis[0] + float(rgb[i][1])*axis[1] + float(rgb[i][2])*axis[2];
+		int k = i;
+		for ( ; k > 0 && dist[k-1] > d ; --k )
+		{
+			dist[k] = dist[k-1];
+			order[k] = order[k-1];
+		}
+		dist[k] = d;
+		order[k] = i;
+	}
+
+	// prefix sums of sorted colors
+	float sum[17][3];
+	sum[0][0] = sum[0][1] = sum[0][2] = 0.f;
+	for ( int i = 0 ; i < 16 ; ++i )
+		for ( int k = 0 ; k < 3 ; ++k )
+			sum[i+1][k] = sum[i][k] + float( rgb[order[i]][k] );
+
+	// clusters [0,i) -> start, [i,j) -> 2/3, [j,m) -> 1/3, [m,16) -> end
+	float besterr = 1e30f;
+	float beststart[3] = {0.f, 0.f, 0.f};
+	float bestend[3] = {0.f, 0.f, 0.f};
+	for ( int i = 0 ; i <= 16 ; ++i )
+	{
+		for ( int j = i ; j <= 16 ; ++j )
+		{
+			for ( int m = j ; m <= 16 ; ++m )
+			{
+				const float n0 = float(i);
+				const float n2 = float(j-i);
+				const float n3 = float(m-j);
+				const float n1 = float(16-m);
+
+				const float alpha2 = n0 + n2*(4.f/9.f) + n3*(1.f/9.f);
+				const float beta2 = n1 + n2*(1.f/9.f) + n3*(4.f/9.f);
+				const float alphabeta = (n2 + n3) * (2.f/9.f);
+				const float det = alpha2*beta2 - alphabeta*alphabeta;
+				if ( fabsf(det) < 1e-6f )
+					continue;
+				const float invdet = 1.f / det;
+
+				float err = 0.f;
+				float start[3];
+				float end[3];
+				for ( int k = 0 ; k < 3 ; ++k )
+				{
+					const float x0 = sum[i][k];
+					const float x2 = sum[j][k] - sum[i][k];
+					const float x3 = sum[m][k] - sum[j][k];
+					const float x1 = sum[16][k] - sum[m][k];
+					const float alphax = x0 + x2*(2.f/3.f) + x3*(1.f/3.f);
+					const float betax = x1 + x2*(1.f/3.f) + x3*(2.f/3.f);
+
+					float a = (alphax*beta2 - betax*alphabeta) * invdet;
+					float b = (betax*alpha2 - alphax*alphabeta) * invdet;
+
+					// snap to endpoint grid
+					const int bits = k == 1 ? 6 : 5;
+					a = a < 0.f ? 0.f : (a > 255.f ? 255.f : a);
+					b = b < 0.f ? 0.f : (b > 255.f ? 255.f : b);
+					a = float( bits == 5 ? expand5(quantize(a,5)) : expand6(quantize(a,6)) );
+					b = float( bits == 5 ? expand5(quantize(b,5)) : expand6(quantize(b,6)) );
+
+					err += a*a*alpha2 + b*b*beta2 + 2.f*(a*b*alphabeta - a*alphax - b*betax);
+					start[k] = a;
+					end[k] = b;
+				}
+
+				if ( err < besterr )
+				{
+					besterr = err;
+					memcpy( beststart, start, sizeof(start) );
+					memcpy( bestend, end, sizeof(end) );
+				}
+			}
+		}
+	}
+
+	evaluateFit( rgb, 0, beststart, bestend, true, fit );
+}
+
+/**
+ * Encodes block where all used pixels have the same color.
+ */
+static void singleColorFit( const int* color, const int rgb[16][3], const bool* mask, bool fourcolor, ColorFit* fit )
+{
+	if ( fourcolor )
+	{
+		const uint8_t* r = s_singleColor.match5[ color[0] ];
+		const uint8_t* g = s_singleColor.match6[ color[1] ];
+		const uint8_t* b = s_singleColor.match5[ color[2] ];
+		fit->col0 = uint16_t( (r[0]<<11) | (g[0]<<5) | b[0] );
+		fit->col1 = uint16_t( (r[1]<<11) | (g[1]<<5) | b[1] );
+	}
+	else
+	{
+		float c[3] = {float(color[0]), float(color[1]), float(color[2])};
+		fit->col0 = fit->col1 = packColor( c );
+	}
+	fit->error = matchColors( rgb, mask, fit->col0, fit->col1, fourcolor, fit->indices );
+}
+
+/**
+ * Orders endpoints to select 4-color (col0 > col1) or
+ * 3-color (col0 <= col1) mode and remaps indices accordingly.
+ */
+static void orderEndpoints( ColorFit* fit, bool fourcolor )
+{
+	if ( fourcolor )
+	{
+		if ( fit->col0 == fit->col1 )
+		{
+			// all palette entries are the same color
+			memset( fit->indices, 0, sizeof(fit->indices) );
+		}
+		else if ( fit->col0 < fit->col1 )
+		{
+			const uint8_t REMAP[4] = {1, 0, 3, 2};
+			uint16_t tmp = fit->col0;
+			fit->col0 = fit->col1;
+			fit->col1 = tmp;
+			for ( int i = 0 ; i < 16 ; ++i )
+				fit->indices[i] = REMAP[ fit->indices[i] ];
+		}
+	}
+	else if ( fit->col0 > fit->col1 )
+	{
+		const uint8_t REMAP[4] = {1, 0, 2, 3};
+		uint16_t tmp = fit->col0;
+		fit->col0 = fit->col1;
+		fit->col1 = tmp;
+		for ( int i = 0 ; i < 16 ; ++i )
+			fit->indices[i] = REMAP[ fit->indices[i] ];
+	}
+}
+
+/**
+ * Compresses colors of a block to 8-byte color block.
+ * @param mask Pixels used in the fit, or 0 if all pixels are used. Excluded pixels are transparent.
+ */
+static void compressColors( const int rgb[16][3], const bool* mask, bool fourcolor, DXTCodec::Quality quality, uint8_t* block )
+{
+	ColorFit fit;
+
+	int first = -1;
+	bool single = true;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		if ( mask == 0 || mask[i] )
+		{
+			if ( first < 0 )
+				first = i;
+			else if ( rgb[i][0] != rgb[first][0] || rgb[i][1] != rgb[first][1] || rgb[i][2] != rgb[first][2] )
+				single = false;
+		}
+	}
+
+	if ( first < 0 )
+	{
+		// fully transparent
+		fit.col0 = fit.col1 = 0;
+		memset( fit.indices, 3, sizeof(fit.indices) );
+	}
+	else if ( single )
+	{
+		singleColorFit( rgb[first], rgb, mask, fourcolor, &fit );
+	}
+	else
+	{
+		rangeFit( rgb, mask, fourcolor, &fit );
+
+		if ( quality == DXTCodec::QUALITY_CLUSTERFIT && fourcolor && fit.error > 0 )
+		{
+			ColorFit cfit;
+			clusterFit( rgb, &cfit );
+			if ( cfit.error < fit.error )
+				fit = cfit;
+		}
+	}
+
+	orderEndpoints( &fit, fourcolor );
+
+	setUInt16LE( block+0, fit.col0 );
+	setUInt16LE( block+2, fit.col1 );
+	for ( int y = 0 ; y < 4 ; ++y )
+	{
+		const uint8_t* ix = fit.indices + y*4;
+		block[4+y] = uint8_t( ix[0] | (ix[1]<<2) | (ix[2]<<4) | (ix[3]<<6) );
+	}
+}
+
+/**
+ * Selects closest alpha palette entry for each pixel.
+ * @return Total squared error.
+ */
+static int matchAlphas( const int* alpha, int a0, int a1, uint8_t* indices )
+{
+	int pal[8];
+	getAlphaPalette( a0, a1, pal );
+
+	int error = 0;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		int besterr = 0x7FFFFFFF;
+		for ( int k = 0 ; k < 8 ; ++k )
+		{
+			const int d = alpha[i] - pal[k];
+			if ( d*d < besterr )
+			{
+				besterr = d*d;
+				indices[i] = (uint8_t)k;
+			}
+		}
+		error += besterr;
+	}
+	return error;
+}
+
+/**
+ * Compresses alpha of a block to 8-byte DXT5 alpha block.
+ * Both 8-alpha and 6-alpha (with explicit 0 and 255) modes are tried.
+ */
+static void compressAlphaDXT5( const int* alpha, uint8_t* block )
+{
+	int mina = 255;
+	int maxa = 0;
+	int mina6 = 255;
+	int maxa6 = 0;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		const int a = alpha[i];
+		mina = a < mina ? a : mina;
+		maxa = a > maxa ? a : maxa;
+		if ( a != 0 && a != 255 )
+		{
+			mina6 = a < mina6 ? a : mina6;
+			maxa6 = a > maxa6 ? a : maxa6;
+		}
+	}
+	if ( mina6 > maxa6 )
+		mina6 = maxa6 = 0;
+
+	uint8_t indices8[16];
+	uint8_t indices6[16];
+	const int err8 = matchAlphas( alpha, maxa, mina, indices8 );
+	const int err6 = matchAlphas( alpha, mina6, maxa6, indices6 );
+
+	const uint8_t* indices = indices8;
+	block[0] = (uint8_t)maxa;
+	block[1] = (uint8_t)mina;
+	if ( err6 < err8 )
+	{
+		indices = indices6;
+		block[0] = (uint8_t)mina6;
+		block[1] = (uint8_t)maxa6;
+	}
+
+	// 3-bit indices, 8 pixels per 24 bits
+	for ( int k = 0 ; k < 2 ; ++k )
+	{
+		uint32_t bits = 0;
+		for ( int i = 0 ; i < 8 ; ++i )
+			bits |= uint32_t(indices[k*8+i]) << (i*3);
+		block[2+k*3+0] = uint8_t( bits );
+		block[2+k*3+1] = uint8_t( bits>>8 );
+		block[2+k*3+2] = uint8_t( bits>>16 );
+	}
+}
+
+/**
+ * Compresses alpha of a block to 8-byte DXT3 explicit alpha block.
+ */
+static void compressAlphaDXT3( const int* alpha, uint8_t* block )
+{
+	for ( int i = 0 ; i < 16 ; i += 2 )
+	{
+		const int a0 = (alpha[i] + 8) / 17;
+		const int a1 = (alpha[i+1] + 8) / 17;
+		block[i>>1] = uint8_t( a0 | (a1<<4) );
+	}
+}
+
+
+void DXTCodec::compressBlock( const uint32_t* argb, SurfaceFormat fmt, void* block, Quality quality )
+{
+	assert( fmt.compressed() );
+
+	int rgb[16][3];
+	int alpha[16];
+	bool opaque[16];
+	bool transparent = false;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		const uint32_t c = argb[i];
+		rgb[i][0] = (c >> 16) & 0xFF;
+		rgb[i][1] = (c >> 8) & 0xFF;
+		rgb[i][2] = c & 0xFF;
+		alpha[i] = c >> 24;
+		opaque[i] = alpha[i] >= 128;
+		transparent |= !opaque[i];
+	}
+
+	uint8_t* data = reinterpret_cast<uint8_t*>( block );
+	switch ( fmt.type() )
+	{
+	case SurfaceFormat::SURFACE_DXT1:
+		compressColors( rgb, transparent ? opaque : 0, !transparent, quality, data );
+		break;
+
+	case SurfaceFormat::SURFACE_DXT3:
+		compressAlphaDXT3( alpha, data );
+		compressColors( rgb, 0, true, quality, data+8 );
+		break;
+
+	case SurfaceFormat::SURFACE_DXT5:
+		compressAlphaDXT5( alpha, data );
+		compressColors( rgb, 0, true, quality, data+8 );
+		break;
+
+	default:
+		break;
+	}
+}
+
+void DXTCodec::decompressBlock( const void* block, SurfaceFormat fmt, uint32_t* argb )
+{
+	assert( fmt.compressed() );
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>( block );
+	const uint8_t* colordata = fmt.type() == SurfaceFormat::SURFACE_DXT1 ? data : data+8;
+
+	// DXT3 and DXT5 color blocks are always in 4-color mode
+	const uint16_t col0 = getUInt16LE( colordata+0 );
+	const uint16_t col1 = getUInt16LE( colordata+2 );
+	const bool fourcolor = col0 > col1 || fmt.type() != SurfaceFormat::SURFACE_DXT1;
+
+	int pal[4][3];
+	getColorPalette( col0, col1, fourcolor, pal );
+	uint32_t colors[4];
+	for ( int k = 0 ; k < 4 ; ++k )
+		colors[k] = 0xFF000000 + (pal[k][0]<<16) + (pal[k][1]<<8) + pal[k][2];
+	if ( !fourcolor )
+		colors[3] = 0;
+
+	for ( int i = 0 ; i < 16 ; ++i )
+		argb[i] = colors[ (colordata[4+(i>>2)] >> ((i&3)*2)) & 3 ];
+
+	switch ( fmt.type() )
+	{
+	case SurfaceFormat::SURFACE_DXT3:
+		for ( int i = 0 ; i < 16 ; ++i )
+		{
+			const uint32_t a = ( (data[i>>1] >> ((i&1)*4)) & 0xF ) * 17;
+			argb[i] = (argb[i] & 0xFFFFFF) + (a<<24);
+		}
+		break;
+
+	case SurfaceFormat::SURFACE_DXT5:{
+		int alphas[8];
+		getAlphaPalette( data[0], data[1], alphas );
+		for ( int k = 0 ; k < 2 ; ++k )
+		{
+			const uint32_t bits = data[2+k*3] + (data[2+k*3+1]<<8) + (data[2+k*3+2]<<16);
+			for ( int i = 0 ; i < 8 ; ++i )
+			{
+				const uint32_t a = alphas[ (bits >> (i*3)) & 7 ];
+				uint32_t& c = argb[k*8+i];
+				c = (c & 0xFFFFFF) + (a<<24);
+			}
+		}
+		break;}
+
+	default:
+		break;
+	}
+}
+
+void DXTCodec::compress( void* dst, int dstpitch, SurfaceFormat fmt,
+	const uint32_t* src, int srcpitch, int width, int height, Quality quality )
+{
+	assert( fmt.compressed() );
+	assert( width > 0 && height > 0 );
+
+	const int blocksize = blockSize( fmt );
+	uint32_t pixels[16];
+
+	for ( int by = 0 ; by < height ; by += 4 )
+	{
+		uint8_t* d = reinterpret_cast<uint8_t*>(dst) + (by>>2)*dstpitch;
+
+		for ( int bx = 0 ; bx < width ; bx += 4 )
+		{
+			// gather block, repeating edge pixels of partial blocks
+			for ( int j = 0 ; j < 4 ; ++j )
+			{
+				const int y = by+j < height ? by+j : height-1;
+				const uint32_t* s = reinterpret_cast<const uint32_t*>( reinterpret_cast<const uint8_t*>(src) + y*srcpitch );
+				for ( int i = 0 ; i < 4 ; ++i )
+				{
+					const int x = bx+i < width ? bx+i : width-1;
+					pixels[j*4+i] = s[x];
+				}
+			}
+
+			compressBlock( pixels, fmt, d, quality );
+			d += blocksize;
+		}
+	}
+}
+
+void DXTCodec::decompress( uint32_t* dst, int dstpitch, SurfaceFormat fmt,
+	const void* src, int srcpitch, int width, int height )
+{
+	assert( fmt.compressed() );
+
+	const int blocksize = blockSize( fmt );
+	uint32_t pixels[16];
+
+	for ( int by = 0 ; by < height ; by += 4 )
+	{
+		const uint8_t* s = reinterpret_cast<const uint8_t*>(src) + (by>>2)*srcpitch;
+		const int rows = by+4 <= height ? 4 : height-by;
+
+		for ( int bx = 0 ; bx < width ; bx += 4 )
+		{
+			decompressBlock( s, fmt, pixels );
+			s += blocksize;
+
+			const int cols = bx+4 <= width ? 4 : width-bx;
+			for ( int j = 0 ; j < rows ; ++j )
+			{
+				uint32_t* d = reinterpret_cast<uint32_t*>( reinterpret_cast<uint8_t*>(dst) + (by+j)*dstpitch ) + bx;
+				for ( int i = 0 ; i < cols ; ++i )
+					d[i] = pixels[j*4+i];
+			}
+		}
+	}
+}
+
+int DXTCodec::blockSize( SurfaceFormat fmt )
+{
+	assert( fmt.compressed() );
+	return fmt.type() == SurfaceFormat::SURFACE_DXT1 ? 8 : 16;
+}
+
+
+END_NAMESPACE() // gr
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -19,6 +19,38 @@ void Primitive::setWireframeColor( int /*color*/ )
 {
 }
 
+int Primitive::memoryUsed() const
+{
+	return vertices()*vertexFormat().vertexSize() + indices()*2;
+}
+
+void Primitive::getVertexDataRange( uint8_t** data, int* size )
+{
+	const VertexFormat& vf = vertexFormat();
+	const int n = vertices();
+	uint8_t* begin = 0;
+	uint8_t* end = 0;
+
+	for ( int k = 0 ; k < (int)VertexFormat::DT_SIZE ; ++k )
+	{
+		VertexFormat::DataType dt = (VertexFormat::DataType)k;
+		if ( vf.hasData(dt) )
+		{
+			uint8_t* ptr;
+			int pitch;
+			getVertexDataPtr( dt, &ptr, &pitch );
+			uint8_t* ptrend = ptr + (n-1)*pitch + VertexFormat::getDataSize( vf.getDataFormat(dt) );
+			if ( !begin || ptr < begin )
+				begin = ptr;
+			if ( ptrend > end )
+				end = ptrend;
+		}
+	}
+
+	*data = begin;
+	*size = n > 0 ? end - begin : 0;
+}
+
 
 END_NAMESPACE() // gr
 
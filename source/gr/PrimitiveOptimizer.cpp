@@ -0,0 +1,522 @@
+#include <gr/PrimitiveOptimizer.h>
+#include <gr/Primitive.h>
+#include <gr/VertexFormat.h>
+#include <lang/Math.h>
+#include <lang/Array.h>
+#include <lang/algorithm/sort.h>
+#include <math/float3.h>
+#include <math/float4.h>
+#include <string.h>
+#include <config.h>
+
+
+USING_NAMESPACE(lang)
+USING_NAMESPACE(math)
+
+
+BEGIN_NAMESPACE(gr)
+
+
+/** Forsyth's algorithm parameters. */
+enum
+{
+	FORSYTH_CACHE_SIZE		= 32,
+	FORSYTH_MAX_VALENCE		= 32,
+};
+
+/** Score of vertex by its position in simulated LRU cache. */
+static float s_cacheScore[FORSYTH_CACHE_SIZE];
+
+/** Score of vertex by number of triangles still using it. */
+static float s_valenceScore[FORSYTH_MAX_VALENCE];
+
+static void initScoreTables()
+{
+	if ( s_valenceScore[0] != 0.f )
+		return;
+
+	// last triangle vertices have fixed score to avoid re-using them in the next triangle
+	const float LAST_TRI_SCORE = .75f;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float VALENCE_BOOST_SCALE = 2.f;
+	const float VALENCE_BOOST_POWER = .5f;
+
+	for ( int i = 0 ; i < FORSYTH_CACHE_SIZE ; ++i )
+	{
+		if ( i < 3 )
+			s_cacheScore[i] = LAST_TRI_SCORE;
+		else
+			s_cacheScore[i] = Math::pow( 1.f - float(i-3)/float(FORSYTH_CACHE_SIZE-3), CACHE_DECAY_POWER );
+	}
+
+	for ( int i = 0 ; i < FORSYTH_MAX_VALENCE ; ++i )
+		s_valenceScore[i] = VALENCE_BOOST_SCALE * Math::pow( float(i+1), -VALENCE_BOOST_POWER );
+}
+
+static inline float getVertexScore( int cachepos, int valence )
+{
+	if ( valence <= 0 )
+		return -1.f;
+
+	float score = 0.f;
+	if ( cachepos >= 0 )
+		score = s_cacheScore[cachepos];
+	return score + s_valenceScore[ Math::min(valence,int(FORSYTH_MAX_VALENCE))-1 ];
+}
+
+/** Cluster sort key, sorted in descending order. */
+class ClusterGreater
+{
+public:
+	explicit ClusterGreater( const float* key ) : m_key(key) {}
+
+	inline bool operator()( int a, int b ) const
+	{
+		return m_key[a] > m_key[b];
+	}
+
+private:
+	const float* m_key;
+};
+
+
+PrimitiveOptimizer::Statistics::Statistics() :
+	primitives( 0 ),
+	triangles( 0 ),
+	vertices( 0 ),
+	transformsBefore( 0 ),
+	transformsAfter( 0 )
+{
+}
+
+float PrimitiveOptimizer::Statistics::acmrBefore() const
+{
+	return triangles > 0 ? float(transformsBefore)/float(triangles) : 0.f;
+}
+
+float PrimitiveOptimizer::Statistics::acmrAfter() const
+{
+	return triangles > 0 ? float(transformsAfter)/float(triangles) : 0.f;
+}
+
+float PrimitiveOptimizer::Statistics::atvrBefore() const
+{
+	return vertices > 0 ? float(transformsBefore)/float(vertices) : 0.f;
+}
+
+float PrimitiveOptimizer::Statistics::atvrAfter() const
+{
+	return vertices > 0 ? float(transformsAfter)/float(vertices) : 0.f;
+}
+
+void PrimitiveOptimizer::optimize( Primitive* prim, Statistics* stats, int cachesize )
+{
+	assert( prim->locked() == Primitive::LOCK_READWRITE );
+
+	const int indexcount = prim->indices();
+	const int vertexcount = prim->vertices();
+	if ( prim->type() != Primitive::PRIM_TRI || indexcount < 3 || vertexcount < 3 )
+		return;
+
+	uint16_t* indices = 0;
+	int indexsize = 0;
+	prim->getIndexDataPtr( &indices, &indexsize );
+	assert( indexsize == 2 );
+
+	const int transformsbefore = getTransformCount( indices, indexcount, vertexcount, cachesize );
+
+	// triangle order
+	optimizeVertexCache( indices, indexcount, vertexcount );
+	if ( prim->vertexFormat().hasData(VertexFormat::DT_POSITION) )
+	{
+		Array<float4> positions( vertexcount );
+		prim->getVertexPositions( 0, positions.begin(), vertexcount );
+		optimizeOverdraw( indices, indexcount, positions.begin(), vertexcount, cachesize );
+	}
+
+	// vertex order
+	Array<uint16_t> remap( vertexcount );
+	optimizeVertexFetch( indices, indexcount, vertexcount, remap.begin() );
+
+	Array<uint8_t> buf;
+	const VertexFormat& vf = prim->vertexFormat();
+	for ( int k = 0 ; k < VertexFormat::DT_SIZE ; ++k )
+	{
+		VertexFormat::DataType dt = (VertexFormat::DataType)k;
+		if ( !vf.hasData(dt) )
+			continue;
+
+		uint8_t* data = 0;
+		int pitch = 0;
+		prim->getVertexDataPtr( dt, &data, &pitch );
+		const int size = VertexFormat::getDataSize( vf.getDataFormat(dt) );
+
+		buf.resize( vertexcount*size );
+		for ( int i = 0 ; i < vertexcount ; ++i )
+			memcpy( &buf[remap[i]*size], data+i*pitch, size );
+		for ( int i = 0 ; i < vertexcount ; ++i )
+			memcpy( data+i*pitch, &buf[i*size], size );
+	}
+
+	// let primitive know that index data has changed
+	prim->setIndexData( 0, indices, 2, indexcount );
+
+	if ( stats != 0 )
+	{
+		stats->primitives += 1;
+		stats->triangles += indexcount/3;
+		stats->vertices += vertexcount;
+		stats->transformsBefore += transformsbefore;
+		stats->transformsAfter += getTransformCount( indices, indexcount, vertexcount, cachesize );
+	}
+}
+
+void PrimitiveOptimizer::optimizeVertexCache( uint16_t* indices, int indexcount, int vertexcount )
+{
+	assert( indexcount % 3 == 0 );
+
+	initScoreTables();
+
+	const int tricount = indexcount / 3;
+	if ( tricount < 2 )
+		return;
+
+	// vertex-triangle adjacency
+	Array<int> valence( vertexcount, 0 );
+	for ( int i = 0 ; i < indexcount ; ++i )
+	{
+		assert( indices[i] < vertexcount );
+		++valence[ indices[i] ];
+	}
+
+	Array<int> adjoffset( vertexcount+1, 0 );
+	for ( int i = 0 ; i < vertexcount ; ++i )
+		adjoffset[i+1] = adjoffset[i] + valence[i];
+
+	Array<int> adjtris( indexcount );
+	Array<int> adjfill( adjoffset );
+	for ( int i = 0 ; i < indexcount ; ++i )
+		adjtris[ adjfill[indices[i]]++ ] = i/3;
+
+	// initial scores
+	Array<int> cachepos( vertexcount, -1 );
+	Array<float> vertexscore( vertexcount );
+	for ( int i = 0 ; i < vertexcount ; ++i )
+		vertexscore[i] = getVertexScore( -1, valence[i] );
+
+	Array<float> triscore( tricount );
+	Array<bool> triadded( tricount, false );
+	for ( int i = 0 ; i < tricount ; ++i )
+		triscore[i] = vertexscore[indices[i*3]] + vertexscore[indices[i*3+1]] + vertexscore[indices[i*3+2]];
+
+	Array<uint16_t> output( indexcount );
+	int cache[FORSYTH_CACHE_SIZE+3];
+	int cachesize = 0;
+	int besttri = -1;
+	int nexttri = 0;
+
+	for ( int out = 0 ; out < tricount ; ++out )
+	{
+		// no candidate from cache neighbourhood, find best remaining triangle with linear scan
+		if ( besttri < 0 )
+		{
+			float bestscore = -1.f;
+			for ( int i = nexttri ; i < tricount ; ++i )
+			{
+				if ( !triadded[i] && triscore[i] > bestscore )
+				{
+					bestscore = triscore[i];
+					besttri = i;
+				}
+			}
+			assert( besttri >= 0 );
+		}
+
+		// emit triangle
+		const uint16_t* tri = indices + besttri*3;
+		output[out*3] = tri[0];
+		output[out*3+1] = tri[1];
+		output[out*3+2] = tri[2];
+		triadded[besttri] = true;
+		while ( nexttri < tricount && triadded[nexttri] )
+			++nexttri;
+
+		// move triangle vertices to the front of the cache
+		int newcache[FORSYTH_CACHE_SIZE+3];
+		int newcachesize = 0;
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			int v = tri[k];
+			if ( (k < 1 || v != tri[0]) && (k < 2 || v != tri[1]) )
+				newcache[newcachesize++] = v;
+
+			// remove emitted triangle from vertex adjacency
+			int* adj = &adjtris[adjoffset[v]];
+			int n = valence[v];
+			for ( int j = 0 ; j < n ; ++j )
+			{
+				if ( adj[j] == besttri )
+				{
+					adj[j] = adj[n-1];
+					break;
+				}
+			}
+			--valence[v];
+		}
+		for ( int i = 0 ; i < cachesize ; ++i )
+		{
+			int v = cache[i];
+			if ( v != tri[0] && v != tri[1] && v != tri[2] )
+				newcache[newcachesize++] = v;
+		}
+
+		// update scores of the vertices in (or just dropped from) the cache
+		for ( int i = 0 ; i < newcachesize ; ++i )
+		{
+			int v = newcache[i];
+			cachepos[v] = i < FORSYTH_CACHE_SIZE ? i : -1;
+			vertexscore[v] = getVertexScore( cachepos[v], valence[v] );
+		}
+
+		// update scores of triangles using the cached vertices and select best one
+		besttri = -1;
+		float bestscore = -1.f;
+		for ( int i = 0 ; i < newcachesize ; ++i )
+		{
+			int v = newcache[i];
+			const int* adj = &adjtris[adjoffset[v]];
+			for ( int j = 0 ; j < valence[v] ; ++j )
+			{
+				int t = adj[j];
+				assert( !triadded[t] );
+				const uint16_t* ti = indices + t*3;
+				float score = vertexscore[ti[0]] + vertexscore[ti[1]] + vertexscore[ti[2]];
+				triscore[t] = score;
+				if ( score > bestscore )
+				{
+					bestscore = score;
+					besttri = t;
+				}
+			}
+		}
+
+		cachesize = Math::min( newcachesize, int(FORSYTH_CACHE_SIZE) );
+		memcpy( cache, newcache, sizeof(int)*cachesize );
+	}
+
+	memcpy( indices, output.begin(), sizeof(uint16_t)*indexcount );
+}
+
+void PrimitiveOptimizer::optimizeOverdraw( uint16_t* indices, int indexcount,
+	const float4* positions, int vertexcount, int cachesize, float threshold )
+{
+	assert( indexcount % 3 == 0 );
+	assert( cachesize > 0 && cachesize <= MAX_CACHE_SIZE );
+
+	const int tricount = indexcount / 3;
+	if ( tricount < 2 )
+		return;
+
+	// cache misses of each triangle with FIFO cache
+	Array<int> timestamp( vertexcount, 0 );
+	Array<uint8_t> trimisses( tricount );
+	int time = cachesize + 1;
+	for ( int i = 0 ; i < tricount ; ++i )
+	{
+		int misses = 0;
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			int v = indices[i*3+k];
+			if ( time - timestamp[v] > cachesize )
+			{
+				timestamp[v] = time++;
+				++misses;
+			}
+		}
+		trimisses[i] = (uint8_t)misses;
+	}
+
+	// hard cluster boundaries where all triangle vertices missed cache
+	Array<int> hard;
+	for ( int i = 0 ; i < tricount ; ++i )
+	{
+		if ( i == 0 || trimisses[i] == 3 )
+			hard.add( i );
+	}
+	hard.add( tricount );
+
+	// split hard clusters further as long as ACMR of the split cluster with
+	// cold cache stays within threshold of ACMR of the whole hard cluster
+	Array<int> clusters;
+	for ( int c = 0 ; c+1 < hard.size() ; ++c )
+	{
+		const int begin = hard[c];
+		const int end = hard[c+1];
+
+		int totalmisses = 0;
+		for ( int i = begin ; i < end ; ++i )
+			totalmisses += trimisses[i];
+		const float limit = float(totalmisses) / float(end-begin) * threshold;
+
+		clusters.add( begin );
+		time += cachesize + 1;
+		int misses = 0;
+		int start = begin;
+		for ( int i = begin ; i < end ; ++i )
+		{
+			for ( int k = 0 ; k < 3 ; ++k )
+			{
+				int v = indices[i*3+k];
+				if ( time - timestamp[v] > cachesize )
+				{
+					timestamp[v] = time++;
+					++misses;
+				}
+			}
+
+			if ( i+1 < end && float(misses) <= limit * float(i+1-start) )
+			{
+				clusters.add( i+1 );
+				time += cachesize + 1;
+				start = i+1;
+				misses = 0;
+			}
+		}
+	}
+	const int clustercount = clusters.size();
+	clusters.add( tricount );
+	if ( clustercount < 2 )
+		return;
+
+	// mesh centroid
+	float3 meshcenter( 0, 0, 0 );
+	float meshweight = 0.f;
+	for ( int i = 0 ; i < tricount ; ++i )
+	{
+		const float3& p0 = positions[indices[i*3]].xyz();
+		const float3& p1 = positions[indices[i*3+1]].xyz();
+		const float3& p2 = positions[indices[i*3+2]].xyz();
+		float area = cross( p1-p0, p2-p0 ).length();
+		meshcenter += (p0+p1+p2) * area;
+		meshweight += area * 3.f;
+	}
+	if ( meshweight > 0.f )
+		meshcenter *= 1.f / meshweight;
+
+	// sort key of each cluster: clusters facing out from the mesh center are drawn first
+	Array<float> sortkey( clustercount );
+	Array<int> order( clustercount );
+	for ( int c = 0 ; c < clustercount ; ++c )
+	{
+		float3 center( 0, 0, 0 );
+		float3 normal( 0, 0, 0 );
+		float weight = 0.f;
+		for ( int i = clusters[c] ; i < clusters[c+1] ; ++i )
+		{
+			const float3& p0 = positions[indices[i*3]].xyz();
+			const float3& p1 = positions[indices[i*3+1]].xyz();
+			const float3& p2 = positions[indices[i*3+2]].xyz();
+			float3 n = cross( p1-p0, p2-p0 );
+			float area = n.length();
+			center += (p0+p1+p2) * area;
+			normal += n;
+			weight += area * 3.f;
+		}
+		if ( weight > 0.f )
+			center *= 1.f / weight;
+		float len = normal.length();
+		if ( len > 0.f )
+			normal *= 1.f / len;
+
+		sortkey[c] = dot( center-meshcenter, normal );
+		order[c] = c;
+	}
+	LANG_SORT( order.begin(), order.end(), ClusterGreater(sortkey.begin()) );
+
+	// write clusters in new order
+	Array<uint16_t> output( indexcount );
+	int out = 0;
+	for ( int c = 0 ; c < clustercount ; ++c )
+	{
+		int cluster = order[c];
+		int begin = clusters[cluster]*3;
+		int count = clusters[cluster+1]*3 - begin;
+		memcpy( &output[out], indices+begin, sizeof(uint16_t)*count );
+		out += count;
+	}
+	assert( out == indexcount );
+	memcpy( indices, output.begin(), sizeof(uint16_t)*indexcount );
+}
+
+void PrimitiveOptimizer::optimizeVertexFetch( uint16_t* indices, int indexcount, int vertexcount, uint16_t* remap )
+{
+	const uint16_t UNUSED = 0xFFFF;
+	for ( int i = 0 ; i < vertexcount ; ++i )
+		remap[i] = UNUSED;
+
+	int next = 0;
+	for ( int i = 0 ; i < indexcount ; ++i )
+	{
+		int v = indices[i];
+		assert( v < vertexcount );
+		if ( remap[v] == UNUSED )
+			remap[v] = (uint16_t)next++;
+		indices[i] = remap[v];
+	}
+
+	for ( int i = 0 ; i < vertexcount ; ++i )
+	{
+		if ( remap[i] == UNUSED )
+			remap[i] = (uint16_t)next++;
+	}
+	assert( next == vertexcount );
+}
+
+int PrimitiveOptimizer::getTransformCount( const uint16_t* indices, int indexcount, int vertexcount, int cachesize )
+{
+	assert( cachesize > 0 && cachesize <= MAX_CACHE_SIZE );
+
+	Array<int> timestamp( vertexcount, 0 );
+	int time = cachesize + 1;
+	int transforms = 0;
+	for ( int i = 0 ; i < indexcount ; ++i )
+	{
+		int v = indices[i];
+		assert( v < vertexcount );
+		if ( time - timestamp[v] > cachesize )
+		{
+			timestamp[v] = time++;
+			++transforms;
+		}
+	}
+	return transforms;
+}
+
+float PrimitiveOptimizer::getACMR( const uint16_t* indices, int indexcount, int vertexcount, int cachesize )
+{
+	if ( indexcount < 3 )
+		return 0.f;
+	return float( getTransformCount(indices,indexcount,vertexcount,cachesize) ) / float( indexcount/3 );
+}
+
+float PrimitiveOptimizer::getATVR( const uint16_t* indices, int indexcount, int vertexcount, int cachesize )
+{
+	Array<bool> used( vertexcount, false );
+	int usedcount = 0;
+	for ( int i = 0 ; i < indexcount ; ++i )
+	{
+		if ( !used[indices[i]] )
+		{
+			used[indices[i]] = true;
+			++usedcount;
+		}
+	}
+	if ( usedcount == 0 )
+		return 0.f;
+	return float( getTransformCount(indices,indexcount,vertexcount,cachesize) ) / float( usedcount );
+}
+
+
+END_NAMESPACE() // gr
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
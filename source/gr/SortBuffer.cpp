@@ -5,7 +5,11 @@
 BEGIN_NAMESPACE(gr) 
 
 
-SortBuffer::SortBuffer()
+SortBuffer::SortBuffer() :
+	m_intBuffer( 0 ),
+	m_floatBuffer( 0 ),
+	m_vertexBuffer( 0 ),
+	m_vertexBufferSize( 0 )
 {
 }
 
@@ -25,15 +29,19 @@ SortBuffer::~SortBuffer()
 	}
 }
 
-void SortBuffer::reset( int intbuffersize, int floatbuffersize )
+void SortBuffer::reset( int intbuffersize, int floatbuffersize, int vertexbuffersize )
 {
-	int floatbytes = sizeof(float)*floatbuffersize;
+	// vertex buffer first to keep float arrays 16-byte aligned relative to buffer start
+	int vertexbytes = (sizeof(float)*3*vertexbuffersize + 15) & ~15;
+	int floatbytes = (sizeof(float)*floatbuffersize + 15) & ~15;
 	int intbytes = 2*intbuffersize;
-	m_buf.resize( floatbytes + intbytes + 4 );
-	m_floatBuffer = reinterpret_cast<float*>( m_buf.begin() );
-	m_intBuffer = reinterpret_cast<uint16_t*>( m_buf.begin() + floatbytes );
+	m_buf.resize( vertexbytes + floatbytes + intbytes + 4 );
+	m_vertexBuffer = reinterpret_cast<float*>( m_buf.begin() );
+	m_vertexBufferSize = vertexbuffersize;
+	m_floatBuffer = reinterpret_cast<float*>( m_buf.begin() + vertexbytes );
+	m_intBuffer = reinterpret_cast<uint16_t*>( m_buf.begin() + vertexbytes + floatbytes );
 	
-	uint8_t* tag = m_buf.begin() + floatbytes + intbytes;
+	uint8_t* tag = m_buf.begin() + vertexbytes + floatbytes + intbytes;
 	tag[0] = 'o';
 	tag[1] = 'k';
 	tag[2] = '!';
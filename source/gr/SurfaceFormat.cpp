@@ -1,5 +1,7 @@
 #include <gr/SurfaceFormat.h>
+#include <gr/DXTCodec.h>
 #include <gr/GraphicsException.h>
+#include <lang/Array.h>
 #include <string.h>
 #include <config.h>
 
@@ -10,35 +12,6 @@ USING_NAMESPACE(lang)
 BEGIN_NAMESPACE(gr) 
 
 
-/** 
- * DXT1-5 surface color data struct. 
- */
-struct DXTColBlock
-{
-	uint16_t	col0;
-	uint16_t	col1;
-	uint8_t		rows[4];
-};
-
-/** 
- * DXT2-3 surface alpha data struct. 
- */
-struct DXTAlphaBlockExplicit
-{
-	uint16_t	rows[4];
-};
-
-/** 
- * DXT4-5 surface alpha data struct. 
- */
-struct DXTAlphaBlock3BitLinear
-{
-	uint8_t		alpha0;
-	uint8_t		alpha1;
-	uint8_t		values[6];
-};
-
-
 const char* const FORMAT_NAMES[] =
 {
 	/** The surface format is unknown. */
@@ -214,230 +187,6 @@ static inline int countBits( uint32_t mask )
 	return count;
 }
 
-/** 
- * Returns red component of R5G6B5 in range [0,255]. 
- */
-static inline uint32_t getRedR5G6B5( uint32_t c )
-{
-	return (c>>11) * 255 / 31;
-}
-
-/** 
- * Returns green component of R5G6B5 in range [0,255]. 
- */
-static inline uint32_t getGreenR5G6B5( uint32_t c )
-{
-	return ((c>>5)&0x3F) * 255 / 63;
-}
-
-/** 
- * Returns blue component of R5G6B5 in range [0,255]. 
- */
-static inline uint32_t getBlueR5G6B5( uint32_t c )
-{
-	return (c&0x1F) * 255 / 31;
-}
-
-/** 
- * Returns ARGB8888 from values in range [0,255]. 
- */
-static inline uint32_t makeA8R8G8B8( uint32_t red, uint32_t green, uint32_t blue, uint32_t alpha )
-{
-	return (alpha<<24) + (red<<16) + (green<<8) + blue;
-}
-
-/** 
- * Returns R5G6B5 as ARGB8888. 
- */
-static inline uint32_t convertR5G6B5toARGB8888( uint32_t c )
-{
-	return makeA8R8G8B8( getRedR5G6B5(c), getGreenR5G6B5(c), getBlueR5G6B5(c), 0xFF );
-}
-
-/** 
- * Gets DXT1-3 block colors. 
- */
-static inline void getBlockColorsA8R8G8B8( const DXTColBlock* colorBlock, uint32_t c[4] )
-{
-	if ( colorBlock->col0 > colorBlock->col1 ) 
-	{
-		c[0] = convertR5G6B5toARGB8888( colorBlock->col0 );
-		c[1] = convertR5G6B5toARGB8888( colorBlock->col1 );
-
-		// Four-color block: derive the other two colors.
-		// 00 = c[0], 01 = c[1], 10 = c[2], 11 = c[3]
-		// These 2-bit codes correspond to the 2-bit fields 
-		// stored in the 64-bit block.
-		c[2] = makeA8R8G8B8( 
-			(2*getRedR5G6B5(colorBlock->col0)+getRedR5G6B5(colorBlock->col1)+1)/3, 
-			(2*getGreenR5G6B5(colorBlock->col0)+getGreenR5G6B5(colorBlock->col1)+1)/3,
-			(2*getBlueR5G6B5(colorBlock->col0)+getBlueR5G6B5(colorBlock->col1)+1)/3,
-			255 );
-
-		c[3] = makeA8R8G8B8( 
-			(getRedR5G6B5(colorBlock->col0)+2*getRedR5G6B5(colorBlock->col1)+1)/3, 
-			(getGreenR5G6B5(colorBlock->col0)+2*getGreenR5G6B5(colorBlock->col1)+1)/3,
-			(getBlueR5G6B5(colorBlock->col0)+2*getBlueR5G6B5(colorBlock->col1)+1)/3,
-			255 );
-	}	 
-	else
-	{ 
-		c[0] = convertR5G6B5toARGB8888( colorBlock->col0 );
-		c[1] = convertR5G6B5toARGB8888( colorBlock->col1 );
-
-		// Three-color block: derive the other color.
-		// 00 = c[0],  01 = c[1],  10 = c[2],  
-		// 11 = transparent.
-		// These 2-bit codes correspond to the 2-bit fields 
-		// stored in the 64-bit block. 
-		c[2] = makeA8R8G8B8( 
-			(getRedR5G6B5(colorBlock->col0)+getRedR5G6B5(colorBlock->col1))/2,
-			(getGreenR5G6B5(colorBlock->col0)+getGreenR5G6B5(colorBlock->col1))/2,
-			(getBlueR5G6B5(colorBlock->col0)+getBlueR5G6B5(colorBlock->col1))/2,
-			255 );
-
-		c[3] = makeA8R8G8B8(0,0,0,0);
-	}
-}
-
-/** 
- * Gets DXT4-5 block alpha values. 
- */
-static inline void getBlockAlphas( const DXTAlphaBlock3BitLinear* alphaBlock, uint32_t a[8] )
-{
-	// 8-alpha or 6-alpha block?   
-	a[0] = alphaBlock->alpha0;
-	a[1] = alphaBlock->alpha1;
-
-	if ( alphaBlock->alpha0 > alphaBlock->alpha1 )
-	{    
-		// 8-alpha block:  derive the other six alphas.
-		// Bit code 000 = a[0], 001 = a[1], others are interpolated.
-		a[2] = (6 * alphaBlock->alpha0 + 1 * alphaBlock->alpha1 + 3) / 7;		// Bit code 010
-		a[3] = (5 * alphaBlock->alpha0 + 2 * alphaBlock->alpha1 + 3) / 7;		// Bit code 011
-		a[4] = (4 * alphaBlock->alpha0 + 3 * alphaBlock->alpha1 + 3) / 7;		// Bit code 100
-		a[5] = (3 * alphaBlock->alpha0 + 4 * alphaBlock->alpha1 + 3) / 7;		// Bit code 101
-		a[6] = (2 * alphaBlock->alpha0 + 5 * alphaBlock->alpha1 + 3) / 7;		// Bit code 110
-		a[7] = (1 * alphaBlock->alpha0 + 6 * alphaBlock->alpha1 + 3) / 7;		// Bit code 111  
-	}    
-	else
-	{  
-		// 6-alpha block.
-		// Bit code 000 = a[0], 001 = a[1], others are interpolated.
-		a[2] = (4 * alphaBlock->alpha0 + 1 * alphaBlock->alpha1 + 2) / 5;		// Bit code 010
-		a[3] = (3 * alphaBlock->alpha0 + 2 * alphaBlock->alpha1 + 2) / 5;		// Bit code 011
-		a[4] = (2 * alphaBlock->alpha0 + 3 * alphaBlock->alpha1 + 2) / 5;		// Bit code 100
-		a[5] = (1 * alphaBlock->alpha0 + 4 * alphaBlock->alpha1 + 2) / 5;		// Bit code 101
-		a[6] = 0;																// Bit code 110
-		a[7] = 255;																// Bit code 111
-	}
-}
-
-/** 
- * Reads ARGB8888 pixel value from DXT1-compressed texture. 
- */
-static inline uint32_t getPixelDXT1( int x, int y, const void* data, int pitch )
-{
-	int xblock = x >> 2;
-	int yblock = y >> 2;
-
-	const uint8_t* blockData = reinterpret_cast<const uint8_t*>(data) + xblock*8 + yblock*pitch;
-	const DXTColBlock* colorBlock = reinterpret_cast<const DXTColBlock*>( blockData );
-
-	uint32_t c[4];
-	getBlockColorsA8R8G8B8( colorBlock, c );
-	
-	uint8_t b = colorBlock->rows[ y & 3 ];
-	return c[ ((b>>(x&3)*2)&3) ];
-}
-
-/** 
- * Reads ARGB8888 pixel value from DXT2/3-compressed texture. 
- */
-static inline uint32_t getPixelDXT3( int x, int y, const void* data, int pitch )
-{
-	int xblock = x >> 2;
-	int yblock = y >> 2;
-
-	const uint8_t* blockData = reinterpret_cast<const uint8_t*>(data) + xblock*16 + yblock*pitch;
-	const DXTAlphaBlockExplicit* alphaBlock = reinterpret_cast<const DXTAlphaBlockExplicit*>( blockData );
-	const DXTColBlock* colorBlock = reinterpret_cast<const DXTColBlock*>( blockData+8 );
-
-	uint32_t c[4];
-	getBlockColorsA8R8G8B8( colorBlock, c );
-	uint8_t b = colorBlock->rows[ y & 3 ];
-	uint32_t color = c[ ((b>>(x&3)*2)&3) ];
-
-	uint32_t alpha = ( alphaBlock->rows[y&3] >> (4*(x&3)) ) & 0xF;
-	alpha = (alpha * 255) / 15;
-
-	return (color&0xFFFFFF) + (alpha<<24);
-}
-
-/** 
- * Reads ARGB8888 pixel value from DXT4/5-compressed texture. 
- */
-static inline uint32_t getPixelDXT5( int x, int y, const void* data, int pitch )
-{
-	int xblock = x >> 2;
-	int yblock = y >> 2;
-
-	const uint8_t* blockData = reinterpret_cast<const uint8_t*>(data) + xblock*16 + yblock*pitch;
-	const DXTAlphaBlock3BitLinear* alphaBlock = reinterpret_cast<const DXTAlphaBlock3BitLinear*>( blockData );
-	const DXTColBlock* colorBlock = reinterpret_cast<const DXTColBlock*>( blockData+8 );
-
-	uint32_t c[4];
-	getBlockColorsA8R8G8B8( colorBlock, c );
-	uint8_t b = colorBlock->rows[ y & 3 ];
-	uint32_t color = c[ ((b>>(x&3)*2)&3) ];
-
-	uint32_t a[8];
-	getBlockAlphas( alphaBlock, a );
-	
-	// first two rows of 4 pixels each:
-	const uint32_t mask = 0x00000007;		// bits = 00 00 01 11
-	uint32_t bits = *reinterpret_cast<const uint32_t*>( alphaBlock->values );
-	uint8_t alphaBits[4][4];
-	alphaBits[0][0] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[0][1] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[0][2] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[0][3] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[1][0] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[1][1] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[1][2] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[1][3] = (uint8_t)( bits & mask );
-
-	// now for last two rows:
-	bits = *reinterpret_cast<const uint32_t*>( alphaBlock->values+3 );
-	alphaBits[2][0] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[2][1] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[2][2] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[2][3] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[3][0] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[3][1] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[3][2] = (uint8_t)( bits & mask );
-	bits >>= 3;
-	alphaBits[3][3] = (uint8_t)( bits & mask );
-
-	// get alpha value
-	uint32_t alpha = a[ alphaBits[y&3][x&3] & 7 ];
-	
-	return (color&0xFFFFFF) + (alpha<<24);
-}
-
 static uint32_t halfToFloatBits( uint16_t y )
 {
     int s = (y >> 15) & 0x00000001;
@@ -986,51 +735,60 @@ void SurfaceFormat::copyPixels( void* dst, int dstpitch, const SurfaceFormat& ds
 	const SurfaceFormat& srcfmt, const void* src, int srcpitch, const SurfaceFormat& srcpalfmt, const void* srcpal,
 	int width, int height ) const
 {
-	assert( !compressed() );
-	assert( bitsPerPixel() >= 8 || !srcfmt.compressed() );
+	assert( bitsPerPixel() >= 8 || compressed() || !srcfmt.compressed() );
 
-	const int bytesperpixel = bitsPerPixel()/8;
+	if ( !compressed() && !srcfmt.compressed() )
+	{
+		for ( int y = 0 ; y < height ; ++y )
+		{
+			uint8_t* d = reinterpret_cast<uint8_t*>(dst) + y*dstpitch;
+			const uint8_t* s = reinterpret_cast<const uint8_t*>(src) + y*srcpitch;
+			copyPixels( d, dstpalfmt, dstpal, srcfmt, s, srcpalfmt, srcpal, width );
+		}
+		return;
+	}
 
-	for ( int y = 0 ; y < height ; ++y )
+	if ( *this == srcfmt )
 	{
-		uint8_t* d = reinterpret_cast<uint8_t*>(dst) + y*dstpitch;
+		const int rowbytes = getMemoryUsage( width, 1 );
+		for ( int y = 0 ; y < height ; y += 4 )
+			memcpy( reinterpret_cast<uint8_t*>(dst) + (y>>2)*dstpitch, reinterpret_cast<const uint8_t*>(src) + (y>>2)*srcpitch, rowbytes );
+		return;
+	}
 
-		switch ( srcfmt.m_type )
-		{
-		case SURFACE_DXT1:
-			for ( int x = 0 ; x < width ; ++x )
-			{
-				uint32_t pix = getPixelDXT1( x, y, src, srcpitch );
-				copyPixels( d, dstpalfmt, dstpal, SurfaceFormat::SURFACE_A8R8G8B8, &pix, SurfaceFormat(), 0, 1 );
-				d += bytesperpixel;
-			}
-			break;
+	// convert one row of 4x4 blocks at a time through A8R8G8B8
+	const SurfaceFormat argbfmt( SURFACE_A8R8G8B8 );
+	const int argbpitch = width * sizeof(uint32_t);
+	Array<uint32_t> argb( width*4 );
 
-		case SURFACE_DXT3:
-			for ( int x = 0 ; x < width ; ++x )
-			{
-				uint32_t pix = getPixelDXT3( x, y, src, srcpitch );
-				copyPixels( d, dstpalfmt, dstpal, SurfaceFormat::SURFACE_A8R8G8B8, &pix, SurfaceFormat(), 0, 1 );
-				d += bytesperpixel;
-			}
-			break;
+	for ( int y = 0 ; y < height ; y += 4 )
+	{
+		const int rows = y+4 <= height ? 4 : height-y;
 
-		case SURFACE_DXT5:
-			for ( int x = 0 ; x < width ; ++x )
-			{
-				uint32_t pix = getPixelDXT5( x, y, src, srcpitch );
-				copyPixels( d, dstpalfmt, dstpal, SurfaceFormat::SURFACE_A8R8G8B8, &pix, SurfaceFormat(), 0, 1 );
-				d += bytesperpixel;
-			}
-			break;
+		if ( srcfmt.compressed() )
+		{
+			DXTCodec::decompress( argb.begin(), argbpitch, srcfmt, 
+				reinterpret_cast<const uint8_t*>(src) + (y>>2)*srcpitch, srcpitch, width, rows );
+		}
+		else
+		{
+			for ( int j = 0 ; j < rows ; ++j )
+				argbfmt.copyPixels( &argb[j*width], SurfaceFormat(), 0, 
+					srcfmt, reinterpret_cast<const uint8_t*>(src) + (y+j)*srcpitch, srcpalfmt, srcpal, width );
+		}
 
-		default:{
-			const uint8_t* s = reinterpret_cast<const uint8_t*>(src) + y*srcpitch;
-			copyPixels( d, dstpalfmt, dstpal, srcfmt, s, srcpalfmt, srcpal, width );
-			break;}
+		if ( compressed() )
+		{
+			DXTCodec::compress( reinterpret_cast<uint8_t*>(dst) + (y>>2)*dstpitch, dstpitch, *this,
+				argb.begin(), argbpitch, width, rows );
+		}
+		else
+		{
+			for ( int j = 0 ; j < rows ; ++j )
+				copyPixels( reinterpret_cast<uint8_t*>(dst) + (y+j)*dstpitch, dstpalfmt, dstpal, 
+					argbfmt, &argb[j*width], SurfaceFormat(), 0, width );
 		}
 	}
-
 }
 
 void SurfaceFormat::getPixel( int x, int y,
@@ -1043,16 +801,13 @@ void SurfaceFormat::getPixel( int x, int y,
 	switch ( m_type )
 	{
 	case SURFACE_DXT1:
-		pix = getPixelDXT1( x, y, data, pitch );
-		break;
-
-	case SURFACE_DXT3:	
-		pix = getPixelDXT3( x, y, data, pitch );
-		break;
-
-	case SURFACE_DXT5:
-		pix = getPixelDXT5( x, y, data, pitch );
-		break;
+	case SURFACE_DXT3:
+	case SURFACE_DXT5:{
+		uint32_t block[16];
+		const uint8_t* blockdata = reinterpret_cast<const uint8_t*>(data) + (y>>2)*pitch + (x>>2)*DXTCodec::blockSize(*this);
+		DXTCodec::decompressBlock( blockdata, *this, block );
+		pix = block[ (y&3)*4 + (x&3) ];
+		break;}
 
 	default:{
 		int pixelbytes = (int)FORMATDESC[m_type][1] >> 3;
@@ -10,6 +10,7 @@
 #include <gr/dx/DX_helpers.h>
 #include <gr/dx/zero.h>
 #include <io/PathName.h>
+#include <io/OutputStream.h>
 #include <lang/Debug.h>
 #include <math/float4x4.h>
 #include <string.h>
@@ -516,6 +517,26 @@ Texture* DX_Context::createTexture( const String& filename )
 	return new DX_Texture( this, filename );
 }
 
+Texture* DX_Context::createTexture( const String& filename, const void* data, int size )
+{
+	return new DX_Texture( this, filename, data, size );
+}
+
+bool DX_Context::writeDecodedTexture( Texture* tex, io::OutputStream* out )
+{
+	assert( tex->classId() == CLASSID_TEXTURE );
+	DX_Texture* dxtex = static_cast<DX_Texture*>( tex );
+
+	ID3DXBuffer* buf = 0;
+	HRESULT hr = DX_TRY( D3DXSaveTextureToFileInMemory(&buf,D3DXIFF_DDS,dxtex->texture(),0) );
+	if ( D3D_OK != hr )
+		return false;
+
+	out->write( buf->GetBufferPointer(), buf->GetBufferSize() );
+	buf->Release();
+	return true;
+}
+
 CubeTexture* DX_Context::createCubeTexture( const String& filename )
 {
 	return new DX_CubeTexture( this, filename );
@@ -316,6 +316,29 @@ void DX_Primitive::getIndexDataPtr( uint16_t** data, int* indexsize )
 	*indexsize = 2;
 }
 
+void DX_Primitive::shareBuffers( Primitive* other )
+{
+	DX_Primitive* obj = static_cast<DX_Primitive*>( other );
+	assert( LOCK_NONE == m_locked && LOCK_NONE == obj->m_locked );
+
+	if ( obj == this )
+		return;
+	if ( m_usage != Context::USAGE_STATIC || obj->m_usage != Context::USAGE_STATIC || m_prim != obj->m_prim ||
+		m_deviceFVF != obj->m_deviceFVF || m_deviceVertexSize != obj->m_deviceVertexSize ||
+		vertexCount() != obj->vertexCount() || indexCount() != obj->indexCount() )
+		throwError( GraphicsException( Format("Cannot share DirectX buffers of {0} with {1}", toString(), obj->toString()) ) );
+
+	// buffers are reference counted by DirectX
+	if ( obj->m_vb )
+		obj->m_vb->AddRef();
+	if ( obj->m_ib )
+		obj->m_ib->AddRef();
+	deallocate();
+	m_vb = obj->m_vb;
+	m_ib = obj->m_ib;
+	m_sort = Shader::SORT_NONE;
+}
+
 void DX_Primitive::allocate( const VertexFormat& vf, int vertices, int indices )
 {
 	if ( vertexCount() != vertices )
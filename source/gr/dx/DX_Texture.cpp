@@ -57,6 +57,19 @@ DX_Texture::DX_Texture( DX_Context* context, const String& filename ) :
 	create( filename );
 }
 
+DX_Texture::DX_Texture( DX_Context* context, const String& filename, const void* data, int size ) :
+	DX_ContextItem( context, CLASSID_TEXTURE ),
+	m_tex( 0 ),
+	m_filename( filename ),
+	m_width( 0 ),
+	m_height( 0 ),
+	m_usageflags( 0 ),
+	m_format( SurfaceFormat::SURFACE_UNKNOWN ),
+	m_locked( LOCK_NONE )
+{
+	create( filename, data, size );
+}
+
 void DX_Texture::create( int width, int height, 
 	const SurfaceFormat& fmt, int usageflags )
 {
@@ -90,16 +103,21 @@ void DX_Texture::create( int width, int height,
 
 void DX_Texture::create( const String& filename )
 {
-	assert( !m_tex );
-
-	DX_Context* context = m_context;
-	IDirect3DDevice9* dev = context->device();
 	Array<uint8_t> data;
 	io::FileInputStream in( filename );
 	data.resize( in.available() );
 	in.read( data.begin(), data.size() );
 
-	HRESULT hr = DX_TRY( D3DXCreateTextureFromFileInMemory(dev,data.begin(),data.size(),&m_tex) );
+	create( filename, data.begin(), data.size() );
+}
+
+void DX_Texture::create( const String& filename, const void* data, int size )
+{
+	assert( !m_tex );
+
+	DX_Context* context = m_context;
+	IDirect3DDevice9* dev = context->device();
+	HRESULT hr = DX_TRY( D3DXCreateTextureFromFileInMemory(dev,data,size,&m_tex) );
 	if ( D3D_OK != hr )
 		throwError( DX_GraphicsException( Format("Failed to create texture ({0}): {1}", filename, gr::toString(hr)) ) );
 
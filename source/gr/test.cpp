@@ -30,6 +30,101 @@ static void run()
 		assert( vf.getTextureCoordinateFormat(2) == VertexFormat::DF_V3_32 );
 	}
 	
+	// PrimitiveOptimizer test
+	{
+		// 16x16 quad grid with triangles in scrambled order
+		const int n = 16;
+		const int verts = (n+1)*(n+1);
+		const int inds = n*n*6;
+		uint16_t ind[inds];
+		for ( int i = 0 ; i < n*n ; ++i )
+		{
+			int q = (i*37) % (n*n);
+			int a = (q/n)*(n+1) + q%n;
+			const int tri[6] = {a, a+1, a+n+1, a+1, a+n+2, a+n+1};
+			for ( int k = 0 ; k < 6 ; ++k )
+				ind[i*6+k] = uint16_t( tri[k] );
+		}
+
+		float acmr0 = PrimitiveOptimizer::getACMR( ind, inds, verts );
+		PrimitiveOptimizer::optimizeVertexCache( ind, inds, verts );
+		float acmr1 = PrimitiveOptimizer::getACMR( ind, inds, verts );
+		assert( acmr1 < acmr0 && acmr1 < 1.f );
+
+		uint16_t remap[verts];
+		PrimitiveOptimizer::optimizeVertexFetch( ind, inds, verts, remap );
+		assert( ind[0] == 0 );
+		assert( PrimitiveOptimizer::getACMR(ind,inds,verts) == acmr1 );
+		assert( PrimitiveOptimizer::getATVR(ind,inds,verts) >= 1.f );
+	}
+
+	// DXTCodec test
+	{
+		// 8x6 color gradient with alpha ramp, left half of the bottom rows transparent
+		const int w = 8;
+		const int h = 6;
+		uint32_t src[w*h];
+		for ( int j = 0 ; j < h ; ++j )
+			for ( int i = 0 ; i < w ; ++i )
+				src[j*w+i] = ((20+i*25)<<16) + ((60+i*15)<<8) + (200-i*20) + ((j >= 4 && i < 4 ? 0 : 255-j*30)<<24);
+
+		const SurfaceFormat::SurfaceFormatType formats[] = {SurfaceFormat::SURFACE_DXT1, SurfaceFormat::SURFACE_DXT3, SurfaceFormat::SURFACE_DXT5};
+		for ( int f = 0 ; f < 3 ; ++f )
+		{
+			for ( int q = 0 ; q < 2 ; ++q )
+			{
+				SurfaceFormat fmt( formats[f] );
+				uint8_t dxt[64];
+				uint32_t dst[w*h];
+				const int pitch = fmt.getMemoryUsage( w, 1 );
+				assert( fmt.getMemoryUsage(w,h) <= (int)sizeof(dxt) );
+				DXTCodec::compress( dxt, pitch, fmt, src, w*4, w, h, (DXTCodec::Quality)q );
+				DXTCodec::decompress( dst, w*4, fmt, dxt, pitch, w, h );
+
+				for ( int i = 0 ; i < w*h ; ++i )
+				{
+					const int alpha = src[i] >> 24;
+					if ( fmt == SurfaceFormat::SURFACE_DXT1 && alpha < 128 )
+					{
+						assert( dst[i] == 0 );
+						continue;
+					}
+					for ( int k = 0 ; k < 3 ; ++k )
+					{
+						int d = int((src[i]>>(k*8))&0xFF) - int((dst[i]>>(k*8))&0xFF);
+						const int maxerr = fmt == SurfaceFormat::SURFACE_DXT1 ? 16 : 8; // 3-color blocks in DXT1
+						assert( d >= -maxerr && d <= maxerr );
+					}
+					int da = alpha - int(dst[i]>>24);
+					if ( fmt == SurfaceFormat::SURFACE_DXT1 )
+						assert( (dst[i]>>24) == 0xFF );
+					else
+						assert( da >= -9 && da <= 9 );
+				}
+
+				// copyPixels goes through the codec
+				uint8_t dxt2[64];
+				fmt.copyPixels( dxt2, pitch, SurfaceFormat(), 0, SurfaceFormat::SURFACE_A8R8G8B8, src, w*4, SurfaceFormat(), 0, w, h );
+				if ( q == DXTCodec::QUALITY_RANGEFIT )
+					assert( !memcmp(dxt, dxt2, fmt.getMemoryUsage(w,h)) );
+			}
+		}
+
+		// solid color block is reproduced almost exactly
+		uint32_t solid[16];
+		uint32_t solid2[16];
+		uint8_t block[8];
+		for ( int i = 0 ; i < 16 ; ++i )
+			solid[i] = 0xFF3C8A15;
+		DXTCodec::compressBlock( solid, SurfaceFormat::SURFACE_DXT1, block );
+		DXTCodec::decompressBlock( block, SurfaceFormat::SURFACE_DXT1, solid2 );
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			int d = int((solid[0]>>(k*8))&0xFF) - int((solid2[5]>>(k*8))&0xFF);
+			assert( d >= -1 && d <= 1 );
+		}
+	}
+
 	// SurfaceFormat test
 	{
 		// 16 <-> 32
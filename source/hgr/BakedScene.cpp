@@ -0,0 +1,256 @@
+#include <hgr/BakedScene.h>
+#include <io/IOException.h>
+#include <string.h>
+#include <config.h>
+
+
+USING_NAMESPACE(io)
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+BakedScene::BakedScene()
+{
+	defaults();
+}
+
+BakedScene::BakedScene( InputStream* in, int size )
+{
+	defaults();
+
+	if ( size < (int)sizeof(Header) )
+		throwError( IOException( Format("Invalid baked scene size ({1}) in {0}", in->toString(), size) ) );
+
+	m_image.resize( size );
+	uint8_t* dst = m_image.begin();
+	while ( size > 0 )
+	{
+		int bytes = in->read( dst, size );
+		if ( bytes <= 0 )
+			throwError( IOException( Format("Unexpected end of baked scene in {0}", in->toString()) ) );
+		dst += bytes;
+		size -= bytes;
+	}
+
+	relocate();
+}
+
+BakedScene::~BakedScene()
+{
+}
+
+void BakedScene::defaults()
+{
+	memset( &m_header, 0, sizeof(m_header) );
+	m_header.magic = MAGIC;
+
+	m_stringTable = 0;
+	m_dataTable = 0;
+	m_textureTable = 0;
+	m_paramTable = 0;
+	m_materialTable = 0;
+	m_primitiveTable = 0;
+	m_meshPrimitiveTable = 0;
+	m_nodeTable = 0;
+	m_meshTable = 0;
+	m_boneTable = 0;
+	m_cameraTable = 0;
+	m_lightTable = 0;
+	m_dummyTable = 0;
+	m_linesTable = 0;
+	m_lineTable = 0;
+	m_pathTable = 0;
+	m_animationTable = 0;
+	m_userPropertyTable = 0;
+}
+
+uint32_t BakedScene::addString( const char* str )
+{
+	for ( int i = 0 ; i < m_stringOffsets.size() ; ++i )
+	{
+		uint32_t offset = m_stringOffsets[i];
+		if ( !strcmp(m_strings.begin()+offset,str) )
+			return offset;
+	}
+
+	uint32_t offset = m_strings.size();
+	int len = strlen( str ) + 1;
+	m_strings.resize( offset + len );
+	memcpy( m_strings.begin()+offset, str, len );
+	m_stringOffsets.add( offset );
+	return offset;
+}
+
+uint32_t BakedScene::addData( const void* data, int size )
+{
+	assert( size >= 0 );
+
+	uint32_t offset = (m_data.size() + DATA_ALIGNMENT-1) & ~(DATA_ALIGNMENT-1);
+	m_data.resize( offset + size );
+	if ( size > 0 )
+		memcpy( m_data.begin()+offset, data, size );
+	return offset;
+}
+
+int BakedScene::getBlocks( Block* blocks ) const
+{
+	Block list[] =
+	{
+		{&m_header.strings, m_strings.begin(), 1, m_strings.size()},
+		{&m_header.data, m_data.begin(), 1, m_data.size()},
+		{&m_header.textures, m_textures.begin(), sizeof(Texture), m_textures.size()},
+		{&m_header.params, m_params.begin(), sizeof(Param), m_params.size()},
+		{&m_header.materials, m_materials.begin(), sizeof(Material), m_materials.size()},
+		{&m_header.primitives, m_primitives.begin(), sizeof(Primitive), m_primitives.size()},
+		{&m_header.meshPrimitives, m_meshPrimitives.begin(), sizeof(int32_t), m_meshPrimitives.size()},
+		{&m_header.nodes, m_nodes.begin(), sizeof(Node), m_nodes.size()},
+		{&m_header.meshes, m_meshes.begin(), sizeof(Mesh), m_meshes.size()},
+		{&m_header.bones, m_bones.begin(), sizeof(Bone), m_bones.size()},
+		{&m_header.cameras, m_cameras.begin(), sizeof(Camera), m_cameras.size()},
+		{&m_header.lights, m_lights.begin(), sizeof(Light), m_lights.size()},
+		{&m_header.dummies, m_dummies.begin(), sizeof(Dummy), m_dummies.size()},
+		{&m_header.lines, m_lines.begin(), sizeof(Lines), m_lines.size()},
+		{&m_header.linePoints, m_linePoints.begin(), sizeof(Line), m_linePoints.size()},
+		{&m_header.paths, m_paths.begin(), sizeof(Path), m_paths.size()},
+		{&m_header.animations, m_animations.begin(), sizeof(Animation), m_animations.size()},
+		{&m_header.userProperties, m_userProperties.begin(), sizeof(UserProperty), m_userProperties.size()},
+	};
+
+	const int count = sizeof(list)/sizeof(list[0]);
+	assert( count <= MAX_BLOCKS );
+	for ( int i = 0 ; i < count ; ++i )
+		blocks[i] = list[i];
+	return count;
+}
+
+int BakedScene::layout()
+{
+	Block blocks[MAX_BLOCKS];
+	const int count = getBlocks( blocks );
+
+	// tables follow the header, each aligned to DATA_ALIGNMENT
+	int offset = sizeof(m_header);
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		offset = (offset + DATA_ALIGNMENT-1) & ~(DATA_ALIGNMENT-1);
+		Table* table = const_cast<Table*>( blocks[i].table );
+		table->offset = offset;
+		table->count = blocks[i].count;
+		offset += blocks[i].count * blocks[i].recordsize;
+	}
+
+	m_header.magic = MAGIC;
+	m_header.size = offset;
+	return offset;
+}
+
+int BakedScene::write( OutputStream* out )
+{
+	static const uint8_t padding[DATA_ALIGNMENT] = {0};
+
+	const int size = layout();
+	Block blocks[MAX_BLOCKS];
+	const int count = getBlocks( blocks );
+
+	// write header, padding and tables with single gather write
+	const void* data[1+MAX_BLOCKS*2];
+	int sizes[1+MAX_BLOCKS*2];
+	int buffers = 0;
+	data[buffers] = &m_header;
+	sizes[buffers++] = sizeof(m_header);
+
+	int offset = sizeof(m_header);
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		const Block& block = blocks[i];
+		if ( int(block.table->offset) > offset )
+		{
+			data[buffers] = padding;
+			sizes[buffers++] = block.table->offset - offset;
+		}
+
+		data[buffers] = block.data;
+		sizes[buffers++] = block.count * block.recordsize;
+		offset = block.table->offset + block.count * block.recordsize;
+	}
+	assert( offset == size );
+
+	out->writev( data, sizes, buffers );
+	return size;
+}
+
+void BakedScene::relocate()
+{
+	memcpy( &m_header, m_image.begin(), sizeof(m_header) );
+
+	if ( m_header.magic != MAGIC )
+		throwError( IOException( Format("Invalid baked scene identifier ({0,x}), scene might have been baked on a different platform", m_header.magic) ) );
+	if ( (int)m_header.size != m_image.size() )
+		throwError( IOException( Format("Invalid baked scene size ({0}), should be {1}", m_header.size, m_image.size()) ) );
+
+	m_stringTable = reinterpret_cast<const char*>( locate(m_header.strings,1) );
+	m_dataTable = reinterpret_cast<const uint8_t*>( locate(m_header.data,1) );
+	m_textureTable = reinterpret_cast<const Texture*>( locate(m_header.textures,sizeof(Texture)) );
+	m_paramTable = reinterpret_cast<const Param*>( locate(m_header.params,sizeof(Param)) );
+	m_materialTable = reinterpret_cast<const Material*>( locate(m_header.materials,sizeof(Material)) );
+	m_primitiveTable = reinterpret_cast<const Primitive*>( locate(m_header.primitives,sizeof(Primitive)) );
+	m_meshPrimitiveTable = reinterpret_cast<const int32_t*>( locate(m_header.meshPrimitives,sizeof(int32_t)) );
+	m_nodeTable = reinterpret_cast<const Node*>( locate(m_header.nodes,sizeof(Node)) );
+	m_meshTable = reinterpret_cast<const Mesh*>( locate(m_header.meshes,sizeof(Mesh)) );
+	m_boneTable = reinterpret_cast<const Bone*>( locate(m_header.bones,sizeof(Bone)) );
+	m_cameraTable = reinterpret_cast<const Camera*>( locate(m_header.cameras,sizeof(Camera)) );
+	m_lightTable = reinterpret_cast<const Light*>( locate(m_header.lights,sizeof(Light)) );
+	m_dummyTable = reinterpret_cast<const Dummy*>( locate(m_header.dummies,sizeof(Dummy)) );
+	m_linesTable = reinterpret_cast<const Lines*>( locate(m_header.lines,sizeof(Lines)) );
+	m_lineTable = reinterpret_cast<const Line*>( locate(m_header.linePoints,sizeof(Line)) );
+	m_pathTable = reinterpret_cast<const Path*>( locate(m_header.paths,sizeof(Path)) );
+	m_animationTable = reinterpret_cast<const Animation*>( locate(m_header.animations,sizeof(Animation)) );
+	m_userPropertyTable = reinterpret_cast<const UserProperty*>( locate(m_header.userProperties,sizeof(UserProperty)) );
+
+	// string table must be terminated so that any offset in it is a valid string
+	if ( m_header.strings.count > 0 && m_stringTable[m_header.strings.count-1] != 0 )
+		throwError( IOException( Format("Invalid baked scene string table") ) );
+}
+
+const void* BakedScene::locate( const Table& table, int recordsize ) const
+{
+	const uint32_t size = m_image.size();
+	if ( table.offset < sizeof(Header) || table.offset > size || (table.offset & 3) != 0 ||
+		table.count > (size - table.offset) / recordsize )
+		throwError( IOException( Format("Invalid baked scene table (offset {0}, count {1})", table.offset, table.count) ) );
+
+	return m_image.begin() + table.offset;
+}
+
+const char* BakedScene::getString( uint32_t offset ) const
+{
+	if ( offset >= m_header.strings.count )
+		throwError( IOException( Format("Invalid baked scene string offset ({0})", offset) ) );
+	return m_stringTable + offset;
+}
+
+const void* BakedScene::getData( uint32_t offset, int size ) const
+{
+	if ( size < 0 || offset > m_header.data.count || uint32_t(size) > m_header.data.count - offset )
+		throwError( IOException( Format("Invalid baked scene data block (offset {0}, size {1})", offset, size) ) );
+	return m_dataTable + offset;
+}
+
+void BakedScene::checkIndex( int index, uint32_t count ) const
+{
+	if ( index < 0 || uint32_t(index) >= count )
+		throwError( IOException( Format("Invalid baked scene record index ({0}), maximum is {1}", index, count) ) );
+}
+
+void BakedScene::checkRange( int first, int count, uint32_t size ) const
+{
+	if ( first < 0 || count < 0 || uint32_t(first) > size || uint32_t(count) > size - uint32_t(first) )
+		throwError( IOException( Format("Invalid baked scene record range ({0}, count {1}), maximum is {2}", first, count, size) ) );
+}
+
+
+END_NAMESPACE() // hgr
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -0,0 +1,240 @@
+#include <hgr/BoundingVolumeTree.h>
+#include <lang/Float.h>
+#include <lang/Math.h>
+#include <config.h>
+
+
+USING_NAMESPACE(lang)
+USING_NAMESPACE(math)
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+/** Returns half of the surface area of a box. */
+static inline float getHalfArea( const float3& boxmin, const float3& boxmax )
+{
+	float3 d = boxmax - boxmin;
+	return d.x*d.y + d.y*d.z + d.z*d.x;
+}
+
+/** Grows box to contain another box. */
+static inline void growBox( float3& boxmin, float3& boxmax, const float3& minv, const float3& maxv )
+{
+	boxmin.x = Math::min( boxmin.x, minv.x );
+	boxmin.y = Math::min( boxmin.y, minv.y );
+	boxmin.z = Math::min( boxmin.z, minv.z );
+	boxmax.x = Math::max( boxmax.x, maxv.x );
+	boxmax.y = Math::max( boxmax.y, maxv.y );
+	boxmax.z = Math::max( boxmax.z, maxv.z );
+}
+
+
+BoundingVolumeTree::BoundingVolumeTree() :
+	m_boxMin( 0 ),
+	m_boxMax( 0 ),
+	m_maxLeafItems( MAX_LEAF_ITEMS ),
+	m_depth( 0 )
+{
+}
+
+void BoundingVolumeTree::clear()
+{
+	m_nodes.clear();
+	m_items.clear();
+	m_depth = 0;
+}
+
+void BoundingVolumeTree::build( const float3* boxmin, const float3* boxmax, int count, int maxleafitems )
+{
+	assert( maxleafitems > 0 );
+
+	clear();
+	if ( count <= 0 )
+		return;
+
+	m_boxMin = boxmin;
+	m_boxMax = boxmax;
+	m_maxLeafItems = maxleafitems;
+
+	m_items.resize( count );
+	m_centers.resize( count );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		m_items[i] = i;
+		m_centers[i] = (boxmin[i] + boxmax[i]) * .5f;
+	}
+
+	m_nodes.resize( 1 );
+	buildNode( 0, 0, count, 1 );
+
+	m_boxMin = 0;
+	m_boxMax = 0;
+}
+
+void BoundingVolumeTree::buildNode( int node, int begin, int end, int depth )
+{
+	if ( depth > m_depth )
+		m_depth = depth;
+
+	// bounds of the items and their centers
+	float3 boxmin( Float::MAX_VALUE, Float::MAX_VALUE, Float::MAX_VALUE );
+	float3 boxmax( -Float::MAX_VALUE, -Float::MAX_VALUE, -Float::MAX_VALUE );
+	float3 cmin = boxmin;
+	float3 cmax = boxmax;
+	for ( int i = begin ; i < end ; ++i )
+	{
+		const int item = m_items[i];
+		growBox( boxmin, boxmax, m_boxMin[item], m_boxMax[item] );
+		growBox( cmin, cmax, m_centers[item], m_centers[item] );
+	}
+	m_nodes[node].boxMin = boxmin;
+	m_nodes[node].boxMax = boxmax;
+
+	const int count = end - begin;
+	if ( 1 == count || depth >= MAX_DEPTH )
+	{
+		m_nodes[node].first = begin;
+		m_nodes[node].count = count;
+		return;
+	}
+
+	// find the best split plane by binning item centers on each axis
+	float bestcost = Float::MAX_VALUE;
+	int bestaxis = -1;
+	int bestbin = 0;
+	for ( int axis = 0 ; axis < 3 ; ++axis )
+	{
+		const float extent = cmax[axis] - cmin[axis];
+		if ( extent <= 0.f )
+			continue;
+		const float scale = float(SAH_BINS) * (1.f-1e-5f) / extent;
+
+		int bincount[SAH_BINS];
+		float3 binmin[SAH_BINS];
+		float3 binmax[SAH_BINS];
+		for ( int k = 0 ; k < SAH_BINS ; ++k )
+		{
+			bincount[k] = 0;
+			binmin[k] = float3( Float::MAX_VALUE, Float::MAX_VALUE, Float::MAX_VALUE );
+			binmax[k] = float3( -Float::MAX_VALUE, -Float::MAX_VALUE, -Float::MAX_VALUE );
+		}
+		for ( int i = begin ; i < end ; ++i )
+		{
+			const int item = m_items[i];
+			const int k = int( (m_centers[item][axis] - cmin[axis]) * scale );
+			++bincount[k];
+			growBox( binmin[k], binmax[k], m_boxMin[item], m_boxMax[item] );
+		}
+
+		// sweep from right to get right side areas, then from left to evaluate costs
+		float rightarea[SAH_BINS];
+		int rightcount[SAH_BINS];
+		float3 rmin( Float::MAX_VALUE, Float::MAX_VALUE, Float::MAX_VALUE );
+		float3 rmax( -Float::MAX_VALUE, -Float::MAX_VALUE, -Float::MAX_VALUE );
+		int rcount = 0;
+		for ( int k = SAH_BINS-1 ; k > 0 ; --k )
+		{
+			rcount += bincount[k];
+			if ( bincount[k] > 0 )
+				growBox( rmin, rmax, binmin[k], binmax[k] );
+			rightcount[k] = rcount;
+			rightarea[k] = rcount > 0 ? getHalfArea(rmin,rmax) : 0.f;
+		}
+
+		float3 lmin( Float::MAX_VALUE, Float::MAX_VALUE, Float::MAX_VALUE );
+		float3 lmax( -Float::MAX_VALUE, -Float::MAX_VALUE, -Float::MAX_VALUE );
+		int lcount = 0;
+		for ( int k = 0 ; k < SAH_BINS-1 ; ++k )
+		{
+			lcount += bincount[k];
+			if ( bincount[k] > 0 )
+				growBox( lmin, lmax, binmin[k], binmax[k] );
+			if ( 0 == lcount || 0 == rightcount[k+1] )
+				continue;
+
+			const float cost = getHalfArea(lmin,lmax)*float(lcount) + rightarea[k+1]*float(rightcount[k+1]);
+			if ( cost < bestcost )
+			{
+				bestcost = cost;
+				bestaxis = axis;
+				bestbin = k;
+			}
+		}
+	}
+
+	// make leaf if splitting is not worth it (traversal step costs about as much as one item test)
+	const float area = getHalfArea( boxmin, boxmax );
+	const float leafcost = float(count) * area;
+	const float splitcost = area + bestcost;
+	if ( count <= m_maxLeafItems && (bestaxis < 0 || leafcost <= splitcost) )
+	{
+		m_nodes[node].first = begin;
+		m_nodes[node].count = count;
+		return;
+	}
+
+	// partition items
+	int mid = begin;
+	if ( bestaxis >= 0 )
+	{
+		const float scale = float(SAH_BINS) * (1.f-1e-5f) / (cmax[bestaxis] - cmin[bestaxis]);
+		int last = end - 1;
+		while ( mid <= last )
+		{
+			const int item = m_items[mid];
+			if ( int((m_centers[item][bestaxis] - cmin[bestaxis]) * scale) <= bestbin )
+			{
+				++mid;
+			}
+			else
+			{
+				m_items[mid] = m_items[last];
+				m_items[last--] = item;
+			}
+		}
+	}
+	if ( mid == begin || mid == end )
+		mid = begin + count/2;
+
+	const int left = m_nodes.size();
+	m_nodes.resize( left+2 );
+	m_nodes[node].first = left;
+	m_nodes[node].count = 0;
+	buildNode( left, begin, mid, depth+1 );
+	buildNode( left+1, mid, end, depth+1 );
+}
+
+void BoundingVolumeTree::refit( const float3* boxmin, const float3* boxmax )
+{
+	// children are always after parent, so update in reverse order
+	for ( int i = m_nodes.size()-1 ; i >= 0 ; --i )
+	{
+		TreeNode& node = m_nodes[i];
+		if ( node.isLeaf() )
+		{
+			float3 minv( Float::MAX_VALUE, Float::MAX_VALUE, Float::MAX_VALUE );
+			float3 maxv( -Float::MAX_VALUE, -Float::MAX_VALUE, -Float::MAX_VALUE );
+			for ( int k = node.first ; k < node.first+node.count ; ++k )
+			{
+				const int item = m_items[k];
+				growBox( minv, maxv, boxmin[item], boxmax[item] );
+			}
+			node.boxMin = minv;
+			node.boxMax = maxv;
+		}
+		else
+		{
+			const TreeNode& a = m_nodes[node.first];
+			const TreeNode& b = m_nodes[node.first+1];
+			node.boxMin = a.boxMin;
+			node.boxMax = a.boxMax;
+			growBox( node.boxMin, node.boxMax, b.boxMin, b.boxMax );
+		}
+	}
+}
+
+
+END_NAMESPACE() // hgr
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -7,6 +7,7 @@
 #include <hgr/PipeSetup.h>
 #include <lang/Math.h>
 #include <lang/Debug.h>
+#include <lang/ThreadPool.h>
 #include <lang/algorithm/sort.h>
 #include <lang/pp.h>
 #include <string.h>
@@ -37,6 +38,35 @@ USING_NAMESPACE(lang)
 BEGIN_NAMESPACE(hgr) 
 
 
+/** Meshes per light assignment job. */
+const int MESHES_PER_JOB = 64;
+
+
+/** Computes light lists for a range of visible meshes. */
+class LightAssignJob :
+	public ThreadPool::Job
+{
+public:
+	const Camera*		camera;
+	const LightSorter*	lightsorter;
+	Visual* const*		meshes;
+	Light**				lists;
+	int*				counts;
+	int					begin;
+	int					end;
+
+	void run()
+	{
+		float dist[Shader::MAX_LIGHTS];
+		for ( int i = begin ; i < end ; ++i )
+		{
+			float3 pos = camera->getCachedWorldTransform( meshes[i] ).translation();
+			counts[i] = lightsorter->findNearest( pos, Shader::MAX_LIGHTS, false, lists + i*Shader::MAX_LIGHTS, dist );
+		}
+	}
+};
+
+
 void Camera::Statistics::reset()
 {
 	memset( this, 0, sizeof(Statistics) );
@@ -118,6 +148,13 @@ void Camera::render( Context* context )
 		{
 			Mesh* mesh = (Mesh*)node;
 
+			// skinned meshes have world space box from their bones
+			if ( mesh->isBoundWorld() )
+			{
+				m_lines->addBox( float3x4(1.f), mesh->boundBoxMinWorld(), mesh->boundBoxMaxWorld(), float4(1,0,0,1) );
+				continue;
+			}
+
 			float3x4 tm = node->worldTransform();
 			float3x4 trans( float3x3(1), mesh->boundCenter() );
 			tm = tm * trans;
@@ -133,6 +170,7 @@ void Camera::render( Context* context )
 	PipeSetup::getLights( m_nodes, m_lightSorter );
 	cacheTransforms( context, m_nodes );
 	cullVisuals( m_nodes, m_visuals );
+	assignLights( m_visuals, &m_lightSorter );
 
 	PipeSetup::getShaders( m_visuals, m_shaders );
 	PipeSetup::getPriorities( m_shaders, m_priorities );
@@ -223,6 +261,73 @@ Array<Light*>& Camera::getLightsSortedByDistance( const float3& worldpos ) const
 	return m_lightSorterPtr->getLightsByDistance( worldpos );
 }
 
+void Camera::assignLights( const Array<Visual*>& visuals, LightSorter* lightsorter, ThreadPool* pool )
+{
+	assert( m_worldTransformCache.size() > 0 ); // cacheTransforms() not called
+
+	// meshes are the only visuals using the lights
+	m_lightListIndex.resize( m_worldTransformCache.size() );
+	for ( int i = 0 ; i < m_lightListIndex.size() ; ++i )
+		m_lightListIndex[i] = -1;
+	m_lightMeshes.clear();
+	for ( int i = 0 ; i < visuals.size() ; ++i )
+	{
+		Visual* vis = visuals[i];
+		if ( Node::NODE_MESH == vis->classId() )
+		{
+			m_lightListIndex[vis->m_tmindex] = m_lightMeshes.size();
+			m_lightMeshes.add( vis );
+		}
+	}
+
+	const int meshes = m_lightMeshes.size();
+	m_lightLists.resize( meshes * Shader::MAX_LIGHTS );
+	m_lightCounts.resize( meshes );
+	lightsorter->updateIndex();
+
+	int jobcount = 1;
+	if ( pool != 0 && meshes > MESHES_PER_JOB )
+		jobcount = (meshes+MESHES_PER_JOB-1) / MESHES_PER_JOB;
+	Array<LightAssignJob> jobs( jobcount );
+	for ( int i = 0 ; i < jobcount ; ++i )
+	{
+		LightAssignJob& job = jobs[i];
+		job.camera = this;
+		job.lightsorter = lightsorter;
+		job.meshes = m_lightMeshes.begin();
+		job.lists = m_lightLists.begin();
+		job.counts = m_lightCounts.begin();
+		job.begin = i*meshes/jobcount;
+		job.end = (i+1)*meshes/jobcount;
+	}
+
+	if ( jobcount > 1 )
+	{
+		ThreadPool::Batch batch;
+		for ( int i = 0 ; i < jobcount ; ++i )
+			pool->add( &jobs[i], &batch );
+		pool->wait( &batch );
+	}
+	else
+	{
+		jobs[0].run();
+	}
+}
+
+int Camera::getAssignedLights( Visual* vis, Light* const** lights ) const
+{
+	const int list = vis->m_tmindex < m_lightListIndex.size() ? m_lightListIndex[vis->m_tmindex] : -1;
+	if ( list >= 0 )
+	{
+		*lights = m_lightLists.begin() + list*Shader::MAX_LIGHTS;
+		return m_lightCounts[list];
+	}
+
+	Array<Light*>& sorted = getLightsSortedByDistance( getCachedWorldTransform(vis).translation() );
+	*lights = sorted.begin();
+	return sorted.size();
+}
+
 void Camera::cullVisuals( const Array<Node*>& nodes, Array<Visual*>& visuals )
 {
 	assert( m_viewtm == viewTransform() ); // cached transforms not up-to-date
@@ -269,14 +374,25 @@ void Camera::cullVisuals( const Array<Node*>& nodes, Array<Visual*>& visuals )
 			const float3x4& worldtm = getCachedWorldTransform( vis );
 #endif
 
+			// skinned meshes get world space bound from their bones
+			if ( Node::NODE_MESH == vis->classId() )
+				static_cast<Mesh*>(vis)->updateBoneBound( this );
+
 #ifdef ENABLE_FRUSTUM_CULLING
 			bool visible = vis->isBoundInfinity();
 			if ( !visible )
 			{
 #ifdef ENABLE_SPHERE_FRUSTUM_TEST
-				float r = vis->boundRadius();
-				//float r = Math::max( vis->boundBoxMax().length(), vis->boundBoxMin().length() );
-				visible = ViewFrustum::testSphere( worldtm, r, frustumworld, vis->frustumCheckHint );
+				if ( vis->isBoundWorld() )
+				{
+					visible = ViewFrustum::testAABox( vis->boundBoxMinWorld(), vis->boundBoxMaxWorld(), frustumworld );
+				}
+				else
+				{
+					float r = vis->boundRadius();
+					//float r = Math::max( vis->boundBoxMax().length(), vis->boundBoxMin().length() );
+					visible = ViewFrustum::testSphere( worldtm, r, frustumworld, vis->frustumCheckHint );
+				}
 #endif
 
 #ifdef ENABLE_OBBOX_FRUSTUM_TEST
@@ -352,6 +468,7 @@ void Camera::cacheTransforms( Context* context, const Array<Node*>& nodes )
 
 	Array<float3x4>& tmcache = m_worldTransformCache;
 	tmcache.clear();
+	m_lightListIndex.clear();
 
 	for ( int i = 0 ; i < nodes.size() ; ++i )
 	{
@@ -2,27 +2,188 @@
 #include <io/PathName.h>
 #include <io/FindFile.h>
 #include <io/IOException.h>
+#include <io/FileInputStream.h>
+#include <io/FileOutputStream.h>
+#include <io/ByteArrayOutputStream.h>
 #include <img/ImageReader.h>
 #include <gr/Context.h>
+#include <gr/Shader.h>
 #include <hgr/Globals.h>
 #include <lang/String.h>
+#include <lang/algorithm/sort.h>
 #include <config.h>
 #include <lang/pp.h>
 #include <lang/Debug.h>
 #include <time.h>
+#include <string.h>
 
 
 USING_NAMESPACE(gr)
 USING_NAMESPACE(io)
 USING_NAMESPACE(img)
 USING_NAMESPACE(lang)
+USING_NAMESPACE(math)
 
 
 BEGIN_NAMESPACE(hgr) 
 
 
+/** Reads whole file to memory. */
+static void readFile( const String& filename, Array<uint8_t>& data )
+{
+	FileInputStream in( filename );
+	data.resize( in.available() );
+	if ( in.read(data.begin(),data.size()) != data.size() )
+		throwError( IOException( Format("Failed to read file {0}", filename) ) );
+}
+
+/** Returns FNV-1a hash of the data, continuing from previous hash value. */
+static uint32_t hashData( const void* data, int size, uint32_t hash=2166136261U )
+{
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+	for ( int i = 0 ; i < size ; ++i )
+		hash = (hash ^ p[i]) * 16777619U;
+	return hash;
+}
+
+static int getTextureMemoryUsage( const BaseTexture* tex )
+{
+	return tex->format().getMemoryUsage( tex->width(), tex->height() );
+}
+
+static int getKeyframeDataSize( const KeyframeSequence* seq )
+{
+	return VertexFormat::getDataSize( seq->format(), seq->keys() );
+}
+
+static uint32_t hashKeyframeSequence( const KeyframeSequence* seq )
+{
+	int header[2] = {seq->keys(), seq->format()};
+	float scale = seq->scale();
+	uint32_t hash = hashData( header, sizeof(header) );
+	hash = hashData( &seq->bias(), sizeof(float4), hashData(&scale,sizeof(float),hash) );
+	return hashData( seq->data(), getKeyframeDataSize(seq), hash );
+}
+
+static bool equalKeyframeSequences( const KeyframeSequence* a, const KeyframeSequence* b )
+{
+	return a->keys() == b->keys() && a->format() == b->format() &&
+		a->scale() == b->scale() && a->bias() == b->bias() &&
+		0 == memcmp( a->data(), b->data(), getKeyframeDataSize(a) );
+}
+
+static uint32_t hashPrimitive( Primitive* prim )
+{
+	Primitive::Lock lk( prim, Primitive::LOCK_READ );
+
+	uint8_t* vdata;
+	int vsize;
+	prim->getVertexDataRange( &vdata, &vsize );
+	int header[3] = {prim->type(), prim->vertices(), prim->indices()};
+	uint32_t hash = hashData( vdata, vsize, hashData(header,sizeof(header)) );
+
+	if ( prim->indices() > 0 )
+	{
+		uint16_t* idata;
+		int indexsize;
+		prim->getIndexDataPtr( &idata, &indexsize );
+		hash = hashData( idata, prim->indices()*indexsize, hash );
+	}
+	return hash;
+}
+
+static bool equalPrimitives( Primitive* a, Primitive* b )
+{
+	if ( a->type() != b->type() || a->vertices() != b->vertices() || 
+		a->indices() != b->indices() || a->vertexFormat() != b->vertexFormat() )
+		return false;
+
+	Primitive::Lock lka( a, Primitive::LOCK_READ );
+	Primitive::Lock lkb( b, Primitive::LOCK_READ );
+
+	uint8_t* adata;
+	uint8_t* bdata;
+	int asize, bsize;
+	a->getVertexDataRange( &adata, &asize );
+	b->getVertexDataRange( &bdata, &bsize );
+	if ( asize != bsize || 0 != memcmp(adata,bdata,asize) )
+		return false;
+
+	if ( a->indices() > 0 )
+	{
+		uint16_t* aind;
+		uint16_t* bind;
+		int aindexsize, bindexsize;
+		a->getIndexDataPtr( &aind, &aindexsize );
+		b->getIndexDataPtr( &bind, &bindexsize );
+		if ( aindexsize != bindexsize || 0 != memcmp(aind,bind,a->indices()*aindexsize) )
+			return false;
+	}
+	return true;
+}
+
+template <class T> static int releaseUnreferenced( Hashtable< int,Array<P(T)> >& table )
+{
+	int count = 0;
+	for ( HashtableIterator< int,Array<P(T)> > it = table.begin() ; it != table.end() ; ++it )
+	{
+		Array<P(T)>& list = it.value();
+		for ( int i = 0 ; i < list.size() ; )
+		{
+			if ( list[i]->references() == 1 )
+			{
+				list.remove( i );
+				++count;
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+	return count;
+}
+
+
+DefaultResourceManager::SharingStatistics::SharingStatistics() :
+	keyframeSequences( 0 ),
+	sharedKeyframeSequences( 0 ),
+	keyframeBytesSaved( 0 ),
+	primitives( 0 ),
+	sharedPrimitives( 0 ),
+	vertexBytesSaved( 0 ),
+	indexBytesSaved( 0 )
+{
+}
+
+int DefaultResourceManager::SharingStatistics::bytesSaved() const
+{
+	return keyframeBytesSaved + vertexBytesSaved + indexBytesSaved;
+}
+
+DefaultResourceManager::MemoryStatistics::MemoryStatistics() :
+	textures( 0 ),
+	textureBytes( 0 ),
+	cubeTextures( 0 ),
+	cubeTextureBytes( 0 ),
+	particleSystems( 0 ),
+	particleSystemBytes( 0 ),
+	evicted( 0 ),
+	evictedBytes( 0 ),
+	reloaded( 0 )
+{
+}
+
+int DefaultResourceManager::MemoryStatistics::bytes() const
+{
+	return textureBytes + cubeTextureBytes + particleSystemBytes;
+}
+
 DefaultResourceManager::DefaultResourceManager( Context* context ) :
-	m_context( context )
+	m_context( context ),
+	m_memoryBudget( 0 ),
+	m_accessTime( 0 ),
+	m_autoEvict( true )
 {
 }
 
@@ -50,6 +211,11 @@ String DefaultResourceManager::getTextureSystemFilename( const String& filename
 }
 
 Texture* DefaultResourceManager::getTexture( const String& originalfilename )
+{
+	return getTexture( originalfilename, 0, 0 );
+}
+
+Texture* DefaultResourceManager::getTexture( const String& originalfilename, const void* data, int size )
 {
 #ifdef PLATFORM_SUPPORTS_FINDFILE
 
@@ -58,33 +224,135 @@ Texture* DefaultResourceManager::getTexture( const String& originalfilename )
 
 	if ( obj.texture == 0 )
 	{
-		if ( obj.filename.length() == 0 )
-		{
+		// index lookup takes precedence over files found by findTextureResources
+		const ResourceIndex::Entry* entry = m_index != 0 ? m_index->findByName(basename) : 0;
+		if ( entry != 0 )
+			obj.filename = entry->path;
+		else if ( obj.filename.length() == 0 )
 			obj.filename = originalfilename;
-		}
 
-		obj.texture = m_context->createTexture( getTextureSystemFilename(obj.filename) );
+		String filename = getTextureSystemFilename(obj.filename);
+		if ( data != 0 && filename == originalfilename )
+			obj.texture = loadTexture( filename, data, size );
+		else
+			obj.texture = loadTexture( filename, 0, 0 );
+
+		obj.lastUsed = ++m_accessTime;
+		P(Texture) tex = obj.texture;
+		resourceLoaded( obj.evicted );
+		obj.evicted = false;
+		return tex;
 	}
 
+	obj.lastUsed = ++m_accessTime;
 	return obj.texture;
 
 #else
 
 	TextureResource& res = m_textures[originalfilename];
 	if ( res.texture == 0 )
-		res.texture = m_context->createTexture( getTextureSystemFilename(originalfilename) );
+	{
+		String filename = getTextureSystemFilename(originalfilename);
+		if ( data != 0 && filename == originalfilename )
+			res.texture = loadTexture( filename, data, size );
+		else
+			res.texture = loadTexture( filename, 0, 0 );
+
+		res.lastUsed = ++m_accessTime;
+		P(Texture) tex = res.texture;
+		resourceLoaded( res.evicted );
+		res.evicted = false;
+		return tex;
+	}
+	res.lastUsed = ++m_accessTime;
 	return res.texture;
 
 #endif
 }
 
+P(Texture) DefaultResourceManager::loadTexture( const String& filename, const void* data, int size )
+{
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+
+	if ( m_textureCachePath.length() > 0 )
+	{
+		// content hash from the index, or from the image file data
+		Array<uint8_t> filedata;
+		uint64_t hash;
+		const ResourceIndex::Entry* entry = data == 0 && m_index != 0 ? m_index->findByPath(filename) : 0;
+		if ( entry != 0 )
+		{
+			hash = entry->hash;
+		}
+		else
+		{
+			if ( data == 0 )
+			{
+				readFile( filename, filedata );
+				data = filedata.begin();
+				size = filedata.size();
+			}
+			hash = ResourceIndex::hashData( data, size );
+		}
+
+		// create from previously decoded texture
+		PathName cachename( m_textureCachePath, ResourceIndex::toString(hash) + ".tex" );
+		if ( FindFile::isFileExist(cachename.toString(),FindFile::FIND_FILESONLY) )
+		{
+			Array<uint8_t> decoded;
+			readFile( cachename.toString(), decoded );
+			return m_context->createTexture( filename, decoded.begin(), decoded.size() );
+		}
+
+		if ( data == 0 )
+		{
+			readFile( filename, filedata );
+			data = filedata.begin();
+			size = filedata.size();
+		}
+
+		// decode and store to the cache
+		P(Texture) tex = m_context->createTexture( filename, data, size );
+		ByteArrayOutputStream decoded;
+		if ( m_context->writeDecodedTexture(tex,&decoded) )
+		{
+			FileOutputStream out( cachename.toString() );
+			decoded.writeTo( &out );
+		}
+		return tex;
+	}
+
+#endif
+
+	if ( data != 0 )
+		return m_context->createTexture( filename, data, size );
+	return m_context->createTexture( filename );
+}
+
+void DefaultResourceManager::setResourceIndex( ResourceIndex* index )
+{
+	m_index = index;
+}
+
+void DefaultResourceManager::setTextureCachePath( const String& path )
+{
+	m_textureCachePath = path;
+}
+
 CubeTexture* DefaultResourceManager::getCubeTexture( const String& filename )
 {
-	CubeTexture* obj = m_cubeTextures[filename];
-	if ( obj == 0 )
-		return m_cubeTextures[filename] = m_context->createCubeTexture( filename );
-	else
-		return obj;
+	CubeTextureResource& obj = m_cubeTextures[filename];
+	obj.lastUsed = ++m_accessTime;
+	if ( obj.texture == 0 )
+	{
+		obj.texture = m_context->createCubeTexture( filename );
+
+		P(CubeTexture) tex = obj.texture;
+		resourceLoaded( obj.evicted );
+		obj.evicted = false;
+		return tex;
+	}
+	return obj.texture;
 }
 
 #ifndef HGR_NOPARTICLES
@@ -93,11 +361,18 @@ ParticleSystem* DefaultResourceManager::getParticleSystem( const String& filenam
 {
 	String basename = PathName(filename).basename();
 
-	ParticleSystem* obj = m_particles[basename];
-	if ( obj == 0 )
-		return m_particles[basename] = new ParticleSystem( m_context, filename, this, texturepath, shaderpath );
-	else
-		return new ParticleSystem( *obj );
+	ParticleSystemResource& obj = m_particles[basename];
+	obj.lastUsed = ++m_accessTime;
+	if ( obj.particle == 0 )
+	{
+		obj.particle = new ParticleSystem( m_context, filename, this, texturepath, shaderpath );
+
+		P(ParticleSystem) particle = obj.particle;
+		resourceLoaded( obj.evicted );
+		obj.evicted = false;
+		return particle;
+	}
+	return new ParticleSystem( *obj.particle );
 }
 #endif
 
@@ -152,8 +427,7 @@ int DefaultResourceManager::releaseUnusedTextures()
 		Texture* tex = it.value().texture;
 		if ( tex && tex->references() == 1 )
 		{		
-			int texsize = tex->width()*tex->height()*(tex->format().bitsPerPixel()/8);
-			bytesrel += texsize;
+			bytesrel += getTextureMemoryUsage( tex );
 			it.value().texture = 0;
 		}
 	}
@@ -161,5 +435,256 @@ int DefaultResourceManager::releaseUnusedTextures()
 	return bytesrel;
 }
 
+void DefaultResourceManager::setMemoryBudget( int bytes, bool autoevict )
+{
+	m_memoryBudget = bytes;
+	m_autoEvict = autoevict;
+
+	if ( m_autoEvict )
+		enforceMemoryBudget();
+}
+
+void DefaultResourceManager::resourceLoaded( bool evicted )
+{
+	if ( evicted )
+		++m_memoryStats.reloaded;
+
+	if ( m_autoEvict && m_memoryBudget > 0 )
+		enforceMemoryBudget();
+}
+
+void DefaultResourceManager::updateMemoryStatistics()
+{
+	MemoryStatistics& stats = m_memoryStats;
+	stats.textures = stats.textureBytes = 0;
+	stats.cubeTextures = stats.cubeTextureBytes = 0;
+	stats.particleSystems = stats.particleSystemBytes = 0;
+
+	for ( HashtableIterator<String,TextureResource> it = m_textures.begin() ; it != m_textures.end() ; ++it )
+	{
+		Texture* tex = it.value().texture;
+		if ( tex )
+		{
+			++stats.textures;
+			stats.textureBytes += getTextureMemoryUsage( tex );
+		}
+	}
+
+	for ( HashtableIterator<String,CubeTextureResource> it = m_cubeTextures.begin() ; it != m_cubeTextures.end() ; ++it )
+	{
+		CubeTexture* tex = it.value().texture;
+		if ( tex )
+		{
+			++stats.cubeTextures;
+			stats.cubeTextureBytes += getTextureMemoryUsage( tex ) * 6;
+		}
+	}
+
+#ifndef HGR_NOPARTICLES
+	for ( HashtableIterator<String,ParticleSystemResource> it = m_particles.begin() ; it != m_particles.end() ; ++it )
+	{
+		ParticleSystem* particle = it.value().particle;
+		if ( particle )
+		{
+			++stats.particleSystems;
+			stats.particleSystemBytes += particle->memoryUsed();
+		}
+	}
+#endif
+}
+
+const DefaultResourceManager::MemoryStatistics& DefaultResourceManager::memoryStatistics()
+{
+	updateMemoryStatistics();
+	return m_memoryStats;
+}
+
+int DefaultResourceManager::enforceMemoryBudget()
+{
+	updateMemoryStatistics();
+	const int excess = m_memoryStats.bytes() - m_memoryBudget;
+	if ( m_memoryBudget <= 0 || excess <= 0 )
+		return 0;
+
+	// collect resources which are referenced only by the manager
+	m_evictionCandidates.clear();
+	EvictionCandidate cand;
+
+	cand.type = RESOURCE_TEXTURE;
+	for ( HashtableIterator<String,TextureResource> it = m_textures.begin() ; it != m_textures.end() ; ++it )
+	{
+		Texture* tex = it.value().texture;
+		if ( tex && tex->references() == 1 )
+		{
+			cand.lastUsed = it.value().lastUsed;
+			cand.bytes = getTextureMemoryUsage( tex );
+			cand.name = it.key();
+			m_evictionCandidates.add( cand );
+		}
+	}
+
+	cand.type = RESOURCE_CUBETEXTURE;
+	for ( HashtableIterator<String,CubeTextureResource> it = m_cubeTextures.begin() ; it != m_cubeTextures.end() ; ++it )
+	{
+		CubeTexture* tex = it.value().texture;
+		if ( tex && tex->references() == 1 )
+		{
+			cand.lastUsed = it.value().lastUsed;
+			cand.bytes = getTextureMemoryUsage( tex ) * 6;
+			cand.name = it.key();
+			m_evictionCandidates.add( cand );
+		}
+	}
+
+#ifndef HGR_NOPARTICLES
+	cand.type = RESOURCE_PARTICLESYSTEM;
+	for ( HashtableIterator<String,ParticleSystemResource> it = m_particles.begin() ; it != m_particles.end() ; ++it )
+	{
+		ParticleSystem* particle = it.value().particle;
+		if ( particle && particle->references() == 1 )
+		{
+			cand.lastUsed = it.value().lastUsed;
+			cand.bytes = particle->memoryUsed();
+			cand.name = it.key();
+			m_evictionCandidates.add( cand );
+		}
+	}
+#endif
+
+	// evict least recently used first, file names are kept for reloading
+	LANG_SORT( m_evictionCandidates.begin(), m_evictionCandidates.end() );
+
+	int bytesrel = 0;
+	for ( int i = 0 ; i < m_evictionCandidates.size() && bytesrel < excess ; ++i )
+	{
+		const EvictionCandidate& evict = m_evictionCandidates[i];
+		if ( evict.type == RESOURCE_TEXTURE )
+		{
+			TextureResource& res = m_textures[evict.name];
+			res.texture = 0;
+			res.evicted = true;
+		}
+		else if ( evict.type == RESOURCE_CUBETEXTURE )
+		{
+			CubeTextureResource& res = m_cubeTextures[evict.name];
+			res.texture = 0;
+			res.evicted = true;
+		}
+#ifndef HGR_NOPARTICLES
+		else if ( evict.type == RESOURCE_PARTICLESYSTEM )
+		{
+			ParticleSystemResource& res = m_particles[evict.name];
+			res.particle = 0;
+			res.evicted = true;
+		}
+#endif
+
+		bytesrel += evict.bytes;
+		++m_memoryStats.evicted;
+	}
+	m_memoryStats.evictedBytes += bytesrel;
+	m_evictionCandidates.clear();
+
+	updateMemoryStatistics();
+	return bytesrel;
+}
+
+KeyframeSequence* DefaultResourceManager::getSharedKeyframeSequence( KeyframeSequence* seq )
+{
+	if ( !seq )
+		return 0;
+
+	Array<P(KeyframeSequence)>& list = m_keyframeSequences[ hashKeyframeSequence(seq) ];
+	for ( int i = 0 ; i < list.size() ; ++i )
+	{
+		if ( list[i] == seq )
+			return seq;
+
+		if ( equalKeyframeSequences(list[i],seq) )
+		{
+			++m_sharingStats.sharedKeyframeSequences;
+			m_sharingStats.keyframeBytesSaved += getKeyframeDataSize(seq) + sizeof(KeyframeSequence);
+			return list[i];
+		}
+	}
+
+	list.add( seq );
+	++m_sharingStats.keyframeSequences;
+	return seq;
+}
+
+TransformAnimation::Float3Anim* DefaultResourceManager::getSharedFloat3Anim( TransformAnimation::Float3Anim* anim )
+{
+	if ( !anim )
+		return 0;
+
+	const int size = anim->keys.size() * sizeof(float4);
+	Array<P(TransformAnimation::Float3Anim)>& list = m_float3Anims[ hashData(anim->keys.begin(),size) ];
+	for ( int i = 0 ; i < list.size() ; ++i )
+	{
+		if ( list[i] == anim )
+			return anim;
+
+		if ( list[i]->keys.size() == anim->keys.size() && 0 == memcmp(list[i]->keys.begin(),anim->keys.begin(),size) )
+		{
+			++m_sharingStats.sharedKeyframeSequences;
+			m_sharingStats.keyframeBytesSaved += size + sizeof(TransformAnimation::Float3Anim);
+			return list[i];
+		}
+	}
+
+	list.add( anim );
+	++m_sharingStats.keyframeSequences;
+	return anim;
+}
+
+void DefaultResourceManager::shareVertexData( Primitive* prim )
+{
+	// sorted primitives re-order their indices when rendered
+	if ( prim->shader()->sort() != Shader::SORT_NONE )
+		return;
+
+	Array<P(Primitive)>& list = m_primitives[ hashPrimitive(prim) ];
+	for ( int i = 0 ; i < list.size() ; ++i )
+	{
+		Primitive* other = list[i];
+		if ( other == prim )
+			return;
+
+		if ( equalPrimitives(other,prim) )
+		{
+			prim->shareBuffers( other );
+
+			++m_sharingStats.sharedPrimitives;
+			Primitive::Lock lk( prim, Primitive::LOCK_READ );
+			uint8_t* vdata;
+			int vsize;
+			prim->getVertexDataRange( &vdata, &vsize );
+			m_sharingStats.vertexBytesSaved += vsize;
+			if ( prim->indices() > 0 )
+			{
+				uint16_t* idata;
+				int indexsize;
+				prim->getIndexDataPtr( &idata, &indexsize );
+				m_sharingStats.indexBytesSaved += prim->indices() * indexsize;
+			}
+			return;
+		}
+	}
+
+	list.add( prim );
+	++m_sharingStats.primitives;
+}
+
+int DefaultResourceManager::releaseUnusedSharedData()
+{
+	int keyframes = releaseUnreferenced( m_keyframeSequences ) + releaseUnreferenced( m_float3Anims );
+	int prims = releaseUnreferenced( m_primitives );
+
+	m_sharingStats.keyframeSequences -= keyframes;
+	m_sharingStats.primitives -= prims;
+	return keyframes + prims;
+}
+
 
 END_NAMESPACE() // hgr
@@ -1,4 +1,6 @@
 #include <hgr/LightSorter.h>
+#include <lang/Math.h>
+#include <lang/Float.h>
 #include <lang/algorithm/sort.h>
 #include <config.h>
 
@@ -11,38 +13,310 @@ USING_NAMESPACE(math)
 BEGIN_NAMESPACE(hgr) 
 
 
-LightSorter::LightSorter()
+LightSorter::LightSorter() :
+	m_gridMin( 0, 0, 0 ),
+	m_cellSize( 1.f ),
+	m_invCellSize( 1.f ),
+	m_maxRange2( 0.f ),
+	m_indexDirty( true )
 {
+	m_gridSize[0] = m_gridSize[1] = m_gridSize[2] = 1;
 }
 
 Array<Light*>& LightSorter::getLightsByDistance( const float3& worldpos, int maxlights )
 {
-	// compute light distance (squared) to object
-	int lights = m_lightData.size();
-	m_lightSorter.resize( lights );
+	return getLights( worldpos, maxlights, false );
+}
+
+Array<Light*>& LightSorter::getLightsInRange( const float3& worldpos, int maxlights )
+{
+	return getLights( worldpos, maxlights, true );
+}
+
+Array<Light*>& LightSorter::getLights( const float3& worldpos, int maxlights, bool inrange )
+{
+	if ( indexed(maxlights) )
+	{
+		updateIndex();
+		m_lights.resize( maxlights );
+		m_distances.resize( maxlights );
+		m_lights.resize( findNearest(worldpos,maxlights,inrange,m_lights.begin(),m_distances.begin()) );
+		return m_lights;
+	}
+
+	// compute light distance (squared) to object and sort all lights
+	const int lights = m_lightData.size();
+	m_lightSorter.clear();
 	for ( int i = 0 ; i < lights ; ++i )
 	{
-		m_lightData[i].v = (m_lightData[i].wpos - worldpos).lengthSquared();
-		m_lightSorter[i].data = &m_lightData[i];
+		LightData& data = m_lightData[i];
+		data.v = (data.wpos - worldpos).lengthSquared();
+		if ( !inrange || data.v < data.range2 )
+		{
+			LightSortValue sortval;
+			sortval.data = &data;
+			m_lightSorter.add( sortval );
+		}
 	}
 	LANG_SORT( m_lightSorter.begin(), m_lightSorter.end() );
 
 	// return lights
-	if ( lights > maxlights )
-		lights = maxlights;
-	m_lights.resize( lights );
-	for ( int i = 0 ; i < lights ; ++i )
+	const int count = Math::min( m_lightSorter.size(), maxlights );
+	m_lights.resize( count );
+	for ( int i = 0 ; i < count ; ++i )
 		m_lights[i] = m_lightSorter[i].data->obj;
 	return m_lights;
 }
 
+bool LightSorter::indexed( int maxlights ) const
+{
+	const int lights = m_lightData.size();
+	return lights > maxlights && lights >= MIN_INDEXED_LIGHTS;
+}
+
+int LightSorter::findNearest( const float3& worldpos, int maxlights, bool inrange, Light** lights, float* dist ) const
+{
+	int count = 0;
+
+	if ( !indexed(maxlights) )
+	{
+		for ( int i = 0 ; i < m_lightData.size() ; ++i )
+		{
+			const LightData& data = m_lightData[i];
+			float v = (data.wpos - worldpos).lengthSquared();
+			if ( !inrange || v < data.range2 )
+				count = insertNearest( data.obj, v, lights, dist, count, maxlights );
+		}
+		return count;
+	}
+
+	assert( !m_indexDirty ); // updateIndex() not called after adding lights
+
+	// directional lights are always in range
+	if ( inrange )
+	{
+		for ( int i = 0 ; i < m_globalLights.size() ; ++i )
+		{
+			const LightData& data = m_lightData[ m_globalLights[i] ];
+			count = insertNearest( data.obj, (data.wpos - worldpos).lengthSquared(), lights, dist, count, maxlights );
+		}
+	}
+
+	// visit cells in rings of increasing distance until
+	// the remaining cells cannot contain closer lights
+	int qc[3];
+	getCellCoords( worldpos, qc );
+	int maxr = 0;
+	for ( int k = 0 ; k < 3 ; ++k )
+		maxr = Math::max( maxr, Math::max(qc[k], m_gridSize[k]-1-qc[k]) );
+
+	for ( int r = 0 ; r <= maxr ; ++r )
+	{
+		if ( r > 1 )
+		{
+			float mindist = float(r-1) * m_cellSize;
+			float mindist2 = mindist * mindist;
+			if ( count == maxlights && mindist2 > dist[count-1] )
+				break;
+			if ( inrange && mindist2 >= m_maxRange2 )
+				break;
+		}
+
+		const int z0 = Math::max( qc[2]-r, 0 );
+		const int z1 = Math::min( qc[2]+r, m_gridSize[2]-1 );
+		const int y0 = Math::max( qc[1]-r, 0 );
+		const int y1 = Math::min( qc[1]+r, m_gridSize[1]-1 );
+		for ( int z = z0 ; z <= z1 ; ++z )
+		{
+			for ( int y = y0 ; y <= y1 ; ++y )
+			{
+				// inside the ring only the end cells of the row
+				const bool shell = Math::abs(z-qc[2]) == r || Math::abs(y-qc[1]) == r;
+				const int xstep = shell ? 1 : 2*r;
+				for ( int x = qc[0]-r ; x <= qc[0]+r ; x += xstep )
+				{
+					if ( x < 0 || x >= m_gridSize[0] )
+						continue;
+
+					const int cell = (z*m_gridSize[1] + y)*m_gridSize[0] + x;
+					for ( int i = m_cells[cell] ; i >= 0 ; i = m_lightData[i].next )
+					{
+						const LightData& data = m_lightData[i];
+						if ( inrange && data.global )
+							continue;
+
+						float v = (data.wpos - worldpos).lengthSquared();
+						if ( !inrange || v < data.range2 )
+							count = insertNearest( data.obj, v, lights, dist, count, maxlights );
+					}
+				}
+			}
+		}
+	}
+	return count;
+}
+
+int LightSorter::insertNearest( Light* obj, float v, Light** lights, float* dist, int count, int maxlights )
+{
+	// keep maxlights closest lights in ascending order
+	int i = count;
+	if ( i == maxlights )
+	{
+		if ( maxlights <= 0 || v >= dist[i-1] )
+			return count;
+		--i;
+	}
+	else
+	{
+		++count;
+	}
+
+	for ( ; i > 0 && dist[i-1] > v ; --i )
+	{
+		lights[i] = lights[i-1];
+		dist[i] = dist[i-1];
+	}
+	lights[i] = obj;
+	dist[i] = v;
+	return count;
+}
+
+void LightSorter::updateIndex()
+{
+	const int lights = m_lightData.size();
+	if ( !m_indexDirty || 0 == lights )
+		return;
+
+	float3 minp = m_lightData[0].wpos;
+	float3 maxp = minp;
+	m_maxRange2 = 0.f;
+	m_globalLights.clear();
+	for ( int i = 0 ; i < lights ; ++i )
+	{
+		const LightData& data = m_lightData[i];
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			minp[k] = Math::min( minp[k], data.wpos[k] );
+			maxp[k] = Math::max( maxp[k], data.wpos[k] );
+		}
+
+		if ( data.global )
+			m_globalLights.add( i );
+		else if ( data.range2 > m_maxRange2 )
+			m_maxRange2 = data.range2;
+	}
+
+	// cubic cells, about one light per cell on non-flat axes
+	float3 ext = maxp - minp;
+	float maxext = Math::max( ext.x, Math::max(ext.y,ext.z) );
+	float volume = 1.f;
+	int dims = 0;
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		if ( ext[k] > maxext*1e-3f )
+		{
+			volume *= ext[k];
+			++dims;
+		}
+	}
+	float cellsize = dims > 0 ? Math::pow( volume/float(lights), 1.f/float(dims) ) : 1.f;
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		m_gridSize[k] = Math::min( int(ext[k]/cellsize)+1, (int)MAX_GRID_SIZE );
+		cellsize = Math::max( cellsize, ext[k]/float(m_gridSize[k]) );
+	}
+
+	m_gridMin = minp;
+	m_cellSize = cellsize;
+	m_invCellSize = 1.f / cellsize;
+
+	// link lights to cells
+	m_cells.resize( m_gridSize[0]*m_gridSize[1]*m_gridSize[2] );
+	for ( int i = 0 ; i < m_cells.size() ; ++i )
+		m_cells[i] = -1;
+	for ( int i = 0 ; i < lights ; ++i )
+	{
+		LightData& data = m_lightData[i];
+		data.cell = getCell( data.wpos );
+		data.next = m_cells[data.cell];
+		m_cells[data.cell] = i;
+	}
+
+	m_indexDirty = false;
+}
+
+void LightSorter::getCellCoords( const float3& pos, int* coords ) const
+{
+	// positions outside the grid are clamped to the border cells
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		float x = (pos[k] - m_gridMin[k]) * m_invCellSize;
+		int c = 0;
+		if ( x >= float(m_gridSize[k]) )
+			c = m_gridSize[k]-1;
+		else if ( x > 0.f )
+			c = int(x);
+		coords[k] = c;
+	}
+}
+
+int LightSorter::getCell( const float3& pos ) const
+{
+	int c[3];
+	getCellCoords( pos, c );
+	return (c[2]*m_gridSize[1] + c[1])*m_gridSize[0] + c[0];
+}
+
+void LightSorter::setLightData( LightData& data )
+{
+	Light* obj = data.obj;
+	data.wpos = obj->worldTransform().translation();
+	data.global = Light::TYPE_DIRECTIONAL == obj->type();
+	data.range2 = data.global ? Float::MAX_VALUE : obj->farAttenEnd()*obj->farAttenEnd();
+}
+
+int LightSorter::updateLights()
+{
+	int relocated = 0;
+	m_maxRange2 = 0.f;
+	for ( int i = 0 ; i < m_lightData.size() ; ++i )
+	{
+		LightData& data = m_lightData[i];
+		setLightData( data );
+		if ( !data.global && data.range2 > m_maxRange2 )
+			m_maxRange2 = data.range2;
+
+		if ( m_indexDirty )
+			continue;
+
+		// move light to new cell
+		int cell = getCell( data.wpos );
+		if ( cell != data.cell )
+		{
+			int* link = &m_cells[data.cell];
+			while ( *link != i )
+				link = &m_lightData[*link].next;
+			*link = data.next;
+
+			data.cell = cell;
+			data.next = m_cells[cell];
+			m_cells[cell] = i;
+			++relocated;
+		}
+	}
+	return relocated;
+}
+
 void LightSorter::addLight( Light* obj )
 {
 	LightData objdata;
 	objdata.v = 0.f;
 	objdata.obj = obj;
-	objdata.wpos = obj->worldTransform().translation();
+	objdata.cell = -1;
+	objdata.next = -1;
+	setLightData( objdata );
 	m_lightData.add( objdata );
+	m_indexDirty = true;
 }
 
 void LightSorter::removeLights()
@@ -50,6 +324,8 @@ void LightSorter::removeLights()
 	m_lightData.clear();
 	m_lightSorter.clear();
 	m_lights.clear();
+	m_globalLights.clear();
+	m_indexDirty = true;
 }
 
 void LightSorter::collectLights( Node* root )
@@ -57,6 +333,7 @@ void LightSorter::collectLights( Node* root )
 	assert( !root->parent() );
 
 	m_lightData.clear();
+	m_indexDirty = true;
 	for ( Node* node = root ; node != 0 ; node = node->next(root) )
 	{
 		if ( Node::NODE_LIGHT == node->classId() )
@@ -6,7 +6,9 @@
 #include <lang/Math.h>
 #include <lang/Debug.h>
 #include <lang/String.h>
+#include <lang/ThreadPool.h>
 #include <lang/pp.h>
+#include <math/InterpolationUtil.h>
 #include <config.h>
 
 
@@ -18,7 +20,70 @@ USING_NAMESPACE(math)
 BEGIN_NAMESPACE(hgr) 
 
 
-Mesh::Mesh()
+/** Meshes per CPU skinning job. */
+const int SKIN_MESHES_PER_JOB = 4;
+
+
+/** Skins vertices of a range of meshes. */
+class SkinJob :
+	public ThreadPool::Job
+{
+public:
+	Mesh* const*					meshes;
+	Mesh::SkinnedVertices* const*	out;
+	int								begin;
+	int								end;
+	bool							updatebound;
+
+	void run()
+	{
+		for ( int i = begin ; i < end ; ++i )
+			meshes[i]->skinVertices( out[i], updatebound );
+	}
+};
+
+
+/**
+ * Gets 4 bone weights and mesh bone indices for each vertex of a skinned primitive.
+ * See InterpolationUtil::setSkinBones.
+ * Primitive needs to be locked for reading.
+ * @param tmp Temporary buffer for vertices of the primitive.
+ */
+static void getVertexBones( Primitive* prim, int bones, float4* weights, uint8_t* boneindices, float4* tmp )
+{
+	const int count = prim->vertices();
+	prim->getVertexBoneWeights( 0, weights, count );
+	prim->getVertexBoneIndices( 0, tmp, count );
+	const int dim = VertexFormat::getDataDim( prim->vertexFormat().getDataFormat(VertexFormat::DT_BONEWEIGHTS) );
+
+	// bone indices of the vertices refer to bone palette of the primitive
+	InterpolationUtil::setSkinBones( dim, tmp, prim->usedBoneArray(), prim->usedBones(), bones, 
+		weights, boneindices, count );
+}
+
+
+Mesh::SkinnedVertices::SkinnedVertices() :
+	boundMin( 0, 0, 0 ),
+	boundMax( 0, 0, 0 ),
+	boundRadius( 0.f ),
+	skinnedPrimitives( 0 ),
+	m_mesh( 0 ),
+	m_prepared( false ),
+	m_updated( false )
+{
+}
+
+void Mesh::SkinnedVertices::reset()
+{
+	m_prepared = false;
+	m_updated = false;
+}
+
+
+Mesh::Mesh() :
+	m_unweightedBoxMin( MAX_BOUND, MAX_BOUND, MAX_BOUND ),
+	m_unweightedBoxMax( -MAX_BOUND, -MAX_BOUND, -MAX_BOUND ),
+	m_boneBounds( false )
 {
 	setClassId( NODE_MESH );
 }
@@ -27,7 +92,10 @@ Mesh::Mesh( const Mesh& other ) :
 	Visual( other ),
 	m_primitives( other.m_primitives ),
 	m_lights( other.m_lights ),
-	m_bones( other.m_bones )
+	m_bones( other.m_bones ),
+	m_unweightedBoxMin( other.m_unweightedBoxMin ),
+	m_unweightedBoxMax( other.m_unweightedBoxMax ),
+	m_boneBounds( other.m_boneBounds )
 {
 }
 
@@ -48,7 +116,8 @@ void Mesh::render( Context* /*context*/, Camera* camera, int priority )
 	Camera::TempBuffers&	tmp = camera->tempBuffers();
 	const float4x4&			viewtminv = camera->cachedWorldTransform();
 	const float4x4&			viewprojtm = camera->cachedViewProjectionTransform();
-	Array<Light*>*			lights = 0;
+	Light* const*			lights = 0;
+	int						lightcount = 0;
 	float4x4				totaltm;
 	bool					init = true;
 #endif
@@ -70,7 +139,15 @@ void Mesh::render( Context* /*context*/, Camera* camera, int priority )
 				{
 					init = false;
 					totaltm = viewprojtm * worldtm;
-					lights = m_lights.size() > 0 ? &m_lights : &camera->getLightsSortedByDistance( worldtm.translation() );
+					if ( m_lights.size() > 0 )
+					{
+						lights = m_lights.begin();
+						lightcount = m_lights.size();
+					}
+					else
+					{
+						lightcount = camera->getAssignedLights( this, &lights );
+					}
 
 					// get transforms for all bones
 					if ( m_bones.size() > 0 )
@@ -85,9 +162,9 @@ void Mesh::render( Context* /*context*/, Camera* camera, int priority )
 				fx->setMatrix( Shader::PARAM_VIEWTMINV, viewtminv );
 				fx->setMatrix( Shader::PARAM_VIEWPROJTM, viewprojtm );
 
-				for ( int k = 0 ; k < lights->size() ; ++k )
+				for ( int k = 0 ; k < lightcount ; ++k )
 				{
-					Light* lt = lights->begin()[k];
+					Light* lt = lights[k];
 					fx->setVector( Shader::ParamType(Shader::PARAM_LIGHTP0+k), float4(camera->getCachedWorldTransform(lt).translation(),1.f) );
 					fx->setVector( Shader::ParamType(Shader::PARAM_LIGHTC0+k), float4(lt->color(),1.f) );
 				}
@@ -139,14 +216,17 @@ void Mesh::addBone( Node* bone, const float3x4& invresttm )
 
 	Bone bonedata;
 	bonedata.invresttm = invresttm;
+	bonedata.boxmin = bonedata.boxmax = float3(0,0,0);
 	bonedata.node = bone;
 	m_bones.add( bonedata );
+	m_boneBounds = false;
 }
 
 void Mesh::removeBone( int index )
 {
 	assert( index >= 0 && index < bones() );
 	m_bones.remove( index );
+	m_boneBounds = false;
 }
 
 Node* Mesh::getBone( int index ) const
@@ -175,6 +255,315 @@ void Mesh::getBoneMatrix4x3Array( Camera* camera, float4x4* tm, int count ) cons
 	}
 }
 
+void Mesh::computeBoneBounds()
+{
+	const int bones = m_bones.size();
+	for ( int i = 0 ; i < bones ; ++i )
+	{
+		m_bones[i].boxmin = float3( MAX_BOUND, MAX_BOUND, MAX_BOUND );
+		m_bones[i].boxmax = float3( -MAX_BOUND, -MAX_BOUND, -MAX_BOUND );
+	}
+
+	m_unweightedBoxMin = float3( MAX_BOUND, MAX_BOUND, MAX_BOUND );
+	m_unweightedBoxMax = float3( -MAX_BOUND, -MAX_BOUND, -MAX_BOUND );
+
+	Array<float4> pos;
+	Array<float4> weights;
+	Array<float4> tmp;
+	Array<uint8_t> boneindices;
+	for ( int i = 0 ; i < m_primitives.size() ; ++i )
+	{
+		Primitive* prim = m_primitives[i];
+		if ( !prim->vertexFormat().hasData(VertexFormat::DT_BONEWEIGHTS) || 0 == bones )
+		{
+			// primitive is not skinned, so its model space box moves with the mesh
+			const float3& bminv = prim->boundMin();
+			const float3& bmaxv = prim->boundMax();
+			m_unweightedBoxMin.x = Math::min( bminv.x, m_unweightedBoxMin.x );
+			m_unweightedBoxMin.y = Math::min( bminv.y, m_unweightedBoxMin.y );
+			m_unweightedBoxMin.z = Math::min( bminv.z, m_unweightedBoxMin.z );
+			m_unweightedBoxMax.x = Math::max( bmaxv.x, m_unweightedBoxMax.x );
+			m_unweightedBoxMax.y = Math::max( bmaxv.y, m_unweightedBoxMax.y );
+			m_unweightedBoxMax.z = Math::max( bmaxv.z, m_unweightedBoxMax.z );
+			continue;
+		}
+
+		Primitive::Lock lock( prim, Primitive::LOCK_READ );
+		const int count = prim->vertices();
+		pos.resize( count );
+		weights.resize( count );
+		tmp.resize( count );
+		boneindices.resize( count*4 );
+		prim->getVertexPositions( 0, pos.begin(), count );
+		getVertexBones( prim, bones, weights.begin(), boneindices.begin(), tmp.begin() );
+
+		for ( int k = 0 ; k < count ; ++k )
+		{
+			for ( int n = 0 ; n < 4 ; ++n )
+			{
+				if ( weights[k][n] == 0.f )
+					continue;
+
+				Bone& bone = m_bones[ boneindices[k*4+n] ];
+				float3 v = bone.invresttm.transform( float3(pos[k].x,pos[k].y,pos[k].z) );
+				bone.boxmin.x = Math::min( v.x, bone.boxmin.x );
+				bone.boxmin.y = Math::min( v.y, bone.boxmin.y );
+				bone.boxmin.z = Math::min( v.z, bone.boxmin.z );
+				bone.boxmax.x = Math::max( v.x, bone.boxmax.x );
+				bone.boxmax.y = Math::max( v.y, bone.boxmax.y );
+				bone.boxmax.z = Math::max( v.z, bone.boxmax.z );
+			}
+		}
+	}
+
+	m_boneBounds = bones > 0;
+	updateBoneBound();
+}
+
+void Mesh::mergeBoxWorld( const float3x4& tm, const float3& boxmin, const float3& boxmax, float3* minv, float3* maxv )
+{
+	if ( boxmin.x > boxmax.x )
+		return;
+
+	const float3 center = tm.transform( (boxmax + boxmin) * .5f );
+	const float3 extent = (boxmax - boxmin) * .5f;
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		const float r = Math::abs(tm(k,0))*extent.x + Math::abs(tm(k,1))*extent.y + Math::abs(tm(k,2))*extent.z;
+		(*minv)[k] = Math::min( center[k]-r, (*minv)[k] );
+		(*maxv)[k] = Math::max( center[k]+r, (*maxv)[k] );
+	}
+}
+
+bool Mesh::updateBoneBound( const Camera* camera )
+{
+	if ( !m_boneBounds )
+		return false;
+
+	// skinned vertex is weighted average of the vertex transformed 
+	// by its bones, so union of the transformed bone boxes contains it
+	float3 minv( MAX_BOUND, MAX_BOUND, MAX_BOUND );
+	float3 maxv( -MAX_BOUND, -MAX_BOUND, -MAX_BOUND );
+	for ( int i = 0 ; i < m_bones.size() ; ++i )
+	{
+		const Bone& bone = m_bones[i];
+		const float3x4 tm = 0 != camera ? camera->getCachedWorldTransform(bone.node) : bone.node->worldTransform();
+		mergeBoxWorld( tm, bone.boxmin, bone.boxmax, &minv, &maxv );
+	}
+
+	// primitives without bone weights are transformed by the mesh itself
+	const float3x4 tm = 0 != camera ? camera->getCachedWorldTransform(this) : worldTransform();
+	mergeBoxWorld( tm, m_unweightedBoxMin, m_unweightedBoxMax, &minv, &maxv );
+
+	if ( minv.x > maxv.x )
+		minv = maxv = float3(0,0,0);
+	setBoundBoxWorld( minv, maxv );
+	setBoundRadius( (maxv-minv).length() * .5f );
+	return true;
+}
+
+void Mesh::skinVertices( SkinnedVertices* out, bool updatebound )
+{
+	prepareSkinning( out );
+	updateSkinning( out, updatebound );
+}
+
+void Mesh::skinVertices( Mesh* const* meshes, SkinnedVertices* const* out, int count, ThreadPool* pool, bool updatebound )
+{
+	// primitives can be locked only from the calling thread
+	for ( int i = 0 ; i < count ; ++i )
+		meshes[i]->prepareSkinning( out[i] );
+
+	int jobcount = 1;
+	if ( pool != 0 && count > SKIN_MESHES_PER_JOB )
+		jobcount = (count+SKIN_MESHES_PER_JOB-1) / SKIN_MESHES_PER_JOB;
+	Array<SkinJob> jobs( jobcount );
+	for ( int i = 0 ; i < jobcount ; ++i )
+	{
+		SkinJob& job = jobs[i];
+		job.meshes = meshes;
+		job.out = out;
+		job.begin = i*count/jobcount;
+		job.end = (i+1)*count/jobcount;
+		job.updatebound = updatebound;
+	}
+
+	if ( jobcount > 1 )
+	{
+		ThreadPool::Batch batch;
+		for ( int i = 0 ; i < jobcount ; ++i )
+			pool->add( &jobs[i], &batch );
+		pool->wait( &batch );
+	}
+	else
+	{
+		jobs[0].run();
+	}
+}
+
+void Mesh::prepareSkinning( SkinnedVertices* out ) const
+{
+	if ( out->m_prepared && out->m_mesh == this && out->offsets.size() == m_primitives.size()+1 )
+		return;
+
+	out->m_mesh = this;
+	out->m_prepared = true;
+	out->m_updated = false;
+
+	const int prims = m_primitives.size();
+	out->offsets.resize( prims+1 );
+	int total = 0;
+	for ( int i = 0 ; i < prims ; ++i )
+	{
+		out->offsets[i] = total;
+		total += m_primitives[i]->vertices();
+	}
+	out->offsets[prims] = total;
+
+	out->positions.resize( total );
+	out->normals.resize( total );
+	out->m_srcPositions.resize( total );
+	out->m_srcNormals.resize( total );
+	out->m_weights.resize( total );
+	out->m_boneIndices.resize( total*4 );
+	out->m_primBoneOffsets.resize( prims+1 );
+	out->m_primBones.clear();
+
+	const int bones = m_bones.size();
+	Array<bool> boneused( bones );
+	for ( int i = 0 ; i < prims ; ++i )
+	{
+		Primitive* prim = m_primitives[i];
+		Primitive::Lock lock( prim, Primitive::LOCK_READ );
+		const VertexFormat& vf = prim->vertexFormat();
+		const int offset = out->offsets[i];
+		const int count = prim->vertices();
+		out->m_primBoneOffsets[i] = out->m_primBones.size();
+		if ( 0 == count )
+			continue;
+
+		float4* pos = &out->m_srcPositions[offset];
+		float4* nrm = &out->m_srcNormals[offset];
+		prim->getVertexPositions( 0, pos, count );
+		if ( vf.hasData(VertexFormat::DT_NORMAL) )
+			prim->getVertexNormals( 0, nrm, count );
+		for ( int k = 0 ; k < count ; ++k )
+		{
+			pos[k].w = 1.f;
+			if ( !vf.hasData(VertexFormat::DT_NORMAL) )
+				nrm[k] = float4(0,0,0,0);
+			nrm[k].w = 0.f;
+		}
+
+		if ( !vf.hasData(VertexFormat::DT_BONEWEIGHTS) || 0 == bones )
+			continue;
+
+		float4* weights = &out->m_weights[offset];
+		uint8_t* boneindices = &out->m_boneIndices[offset*4];
+		getVertexBones( prim, bones, weights, boneindices, &out->positions[offset] );
+
+		for ( int k = 0 ; k < bones ; ++k )
+			boneused[k] = false;
+		for ( int k = 0 ; k < count ; ++k )
+			for ( int n = 0 ; n < 4 ; ++n )
+				if ( weights[k][n] != 0.f )
+					boneused[ boneindices[k*4+n] ] = true;
+
+		for ( int k = 0 ; k < bones ; ++k )
+			if ( boneused[k] )
+				out->m_primBones.add( (uint8_t)k );
+	}
+	out->m_primBoneOffsets[prims] = out->m_primBones.size();
+}
+
+void Mesh::updateSkinning( SkinnedVertices* out, bool updatebound )
+{
+	assert( out->m_prepared && out->m_mesh == this );
+
+	const bool first = !out->m_updated;
+	const int bones = m_bones.size();
+	out->m_boneTms.resize( bones );
+	out->m_boneColumns.resize( bones*4 );
+	out->m_boneChanged.resize( bones );
+
+	// skin->model transforms of the bones
+	const float3x4 worldtminv = worldTransform().inverse();
+	for ( int i = 0 ; i < bones ; ++i )
+	{
+		const Bone& bone = m_bones[i];
+		float3x4 tm = worldtminv * (bone.node->worldTransform() * bone.invresttm);
+		const bool changed = first || tm != out->m_boneTms[i];
+		out->m_boneChanged[i] = changed;
+		if ( changed )
+		{
+			out->m_boneTms[i] = tm;
+			InterpolationUtil::setSkinBoneColumns( tm, &out->m_boneColumns[i*4] );
+		}
+	}
+
+	out->skinnedPrimitives = 0;
+	for ( int i = 0 ; i < m_primitives.size() ; ++i )
+	{
+		const int bonebegin = out->m_primBoneOffsets[i];
+		const int boneend = out->m_primBoneOffsets[i+1];
+		bool changed = first;
+		for ( int k = bonebegin ; k < boneend && !changed ; ++k )
+			changed = out->m_boneChanged[ out->m_primBones[k] ];
+		if ( !changed )
+			continue;
+
+		const int offset = out->offsets[i];
+		const int count = out->offsets[i+1] - offset;
+		if ( boneend > bonebegin )
+		{
+			InterpolationUtil::skinVertices( out->m_boneColumns.begin(), &out->m_srcPositions[offset], &out->m_srcNormals[offset],
+				&out->m_weights[offset], &out->m_boneIndices[offset*4], &out->positions[offset], &out->normals[offset], count );
+		}
+		else
+		{
+			for ( int k = 0 ; k < count ; ++k )
+			{
+				out->positions[offset+k] = out->m_srcPositions[offset+k];
+				out->normals[offset+k] = out->m_srcNormals[offset+k];
+			}
+		}
+		++out->skinnedPrimitives;
+	}
+	out->m_updated = true;
+
+	if ( out->skinnedPrimitives > 0 )
+	{
+		float3 minv( MAX_BOUND, MAX_BOUND, MAX_BOUND );
+		float3 maxv( -MAX_BOUND, -MAX_BOUND, -MAX_BOUND );
+		float maxr2 = 0.f;
+		const int total = out->positions.size();
+		for ( int i = 0 ; i < total ; ++i )
+		{
+			const float4& v = out->positions[i];
+			minv.x = Math::min( v.x, minv.x );
+			minv.y = Math::min( v.y, minv.y );
+			minv.z = Math::min( v.z, minv.z );
+			maxv.x = Math::max( v.x, maxv.x );
+			maxv.y = Math::max( v.y, maxv.y );
+			maxv.z = Math::max( v.z, maxv.z );
+			const float r2 = v.x*v.x + v.y*v.y + v.z*v.z;
+			if ( r2 > maxr2 )
+				maxr2 = r2;
+		}
+		if ( minv.x > maxv.x )
+			minv = maxv = float3(0,0,0);
+		out->boundMin = minv;
+		out->boundMax = maxv;
+		out->boundRadius = Math::sqrt( maxr2 );
+	}
+
+	if ( updatebound )
+	{
+		setBoundBox( out->boundMin, out->boundMax );
+		setBoundRadius( out->boundRadius );
+	}
+}
+
 const float3x4& Mesh::getBoneInverseRestTransform( int index ) const
 {
 	assert( index >= 0 && index < bones() );
@@ -216,7 +605,11 @@ void Mesh::computeBound()
 		Primitive* prim = m_primitives[i];
 		if ( prim->vertexFormat().hasData(VertexFormat::DT_BONEWEIGHTS) )
 		{
-			setBoundInfinity();
+			if ( !updateBoneBound() )
+			{
+				setBoundInfinity();
+				setBoundRadius( MAX_BOUND );
+			}
 			return;
 		}
 
@@ -25,6 +25,7 @@ particleEndColor
 #include <io/PathName.h>
 #include <io/IOException.h>
 #include <io/PropertyParser.h>
+#include <io/PropertyTokenizer.h>
 #include <io/FileInputStream.h>
 #include <io/FileOutputStream.h>
 #include <hgr/Camera.h>
@@ -38,7 +39,9 @@ particleEndColor
 #include <lang/algorithm/swap.h>
 #include <math/float.h>
 #include <math/float2.h>
+#include <math/RandomUtil.h>
 #include <math/toString.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -313,8 +316,10 @@ void ParticleSystem::Description::read( PropertyParser& prop, String& v, const c
 void ParticleSystem::Description::read( PropertyParser& prop, float3& v, const char* variablename )
 {
 	const char* buf = prop.getString( variablename );
-	if ( sscanf(buf,"%g %g %g",&v.x,&v.y,&v.z) != 3 )
+	float xyz[3];
+	if ( PropertyTokenizer::parseFloats(PropertyView(buf,strlen(buf)),xyz,3) != 3 )
 		throwError( IOException(Format("Failed to parse 3-vector {0} in file {1}", variablename, prop.name())) );
+	v = float3( xyz[0], xyz[1], xyz[2] );
 }
 
 void ParticleSystem::Description::read( PropertyParser& prop, ParticleSystem::AnimationType& v, const char* variablename )
@@ -349,24 +354,32 @@ void ParticleSystem::Description::read( PropertyParser& prop, ParticleSystem::Ki
 
 void ParticleSystem::Description::read( PropertyParser& prop, Domain& v, const char* variablename )
 {
-	TempBuffer<char> buf( 256 );
 	const char* val = prop.getString( variablename );
-	if ( sscanf(val,"%s",buf.begin()) != 1 )
+	const char* valend = val + strlen(val);
+
+	// domain type name is the first word of the value
+	const char* typebegin = val;
+	while ( *typebegin != 0 && isspace((unsigned char)*typebegin) )
+		++typebegin;
+	const char* typeend = typebegin;
+	while ( *typeend != 0 && !isspace((unsigned char)*typeend) )
+		++typeend;
+	if ( typeend == typebegin || typeend-typebegin >= 32 )
 		throwError( IOException(Format("Failed to value domain type string from variable {0} in file {1}", variablename, prop.name())) );
 
-	String typestr = String(buf.begin()).toUpperCase();
-	Domain::DomainType type = Domain::toDomainType( typestr.c_str() );
+	char typestr[32];
+	int typelen = typeend - typebegin;
+	for ( int i = 0 ; i < typelen ; ++i )
+		typestr[i] = (char)toupper( (unsigned char)typebegin[i] );
+	typestr[typelen] = 0;
+	Domain::DomainType type = Domain::toDomainType( typestr );
 	if ( type == Domain::DOMAIN_COUNT )
 		throwError( IOException(Format("Invalid value domain type string in variable {0} in file {1}", variablename, prop.name())) );
 
 	int paramcount = Domain::getParameterCount( type );
 	assert( paramcount <= 16 );
-	char valfmt[256];
-	strcpy( valfmt, "%s" );
-	for ( int i = 0 ; i < paramcount ; ++i )
-		strcat( valfmt+strlen(valfmt), " %g" );
 	float params[16];
-	if ( sscanf(val, valfmt, buf.begin(), params+0, params+1, params+2, params+3, params+4, params+5, params+6, params+7, params+8, params+9, params+10, params+11, params+12, params+13, params+14, params+15) != paramcount+1 )
+	if ( PropertyTokenizer::parseFloats(PropertyView(typeend,valend-typeend),params,paramcount) != paramcount )
 		throwError( IOException(Format("Failed to parse value domain {0} in file {1}", variablename, prop.name())) );
 
 	v.setType( type );
@@ -456,7 +469,8 @@ ParticleSystem::ParticleSystem( Context* context, const String& filename, Resour
 	m_systemStopTime( 0.f ),
 	m_systemLifeTime( 0.f ),
 	m_delay( 0.f ),
-	m_parentVelocity( 0, 0, 0 )
+	m_parentVelocity( 0, 0, 0 ),
+	m_random( RandomUtil::randomInt() )
 {
 	setClassId( NODE_PARTICLESYSTEM );
 
@@ -474,7 +488,8 @@ ParticleSystem::ParticleSystem( const ParticleSystem& other ) :
 	m_systemLifeTime( other.m_systemLifeTime ),
 	m_delay( other.m_delay ),
 	m_parentVelocity( other.m_parentVelocity ),
-	m_userRot( other.m_userRot )
+	m_userRot( other.m_userRot ),
+	m_random( RandomUtil::randomInt() )
 {
 	reset();
 }
@@ -489,7 +504,8 @@ ParticleSystem::ParticleSystem( Description* desc ) :
 	m_systemLifeTime( 0.f ),
 	m_delay( 0.f ),
 	m_parentVelocity( 0, 0, 0 ),
-	m_userRot( 1.f )
+	m_userRot( 1.f ),
+	m_random( RandomUtil::randomInt() )
 {
 	setClassId( NODE_PARTICLESYSTEM );
 
@@ -572,13 +588,13 @@ void ParticleSystem::update( float dt )
 	// create new emissions
 	if ( m_systemStopTime < 0.f || m_time-m_delay < m_systemStopTime )
 	{
-		m_newEmissions += m_desc->systemRate.getRandomFloat() * dt;
+		m_newEmissions += m_desc->systemRate.getRandomFloat( m_random ) * dt;
 		m_newEmissions = clamp( m_newEmissions, 0.f, (float)m_desc->systemMaxEmissions );
 
 		for ( ; m_newEmissions >= 1.f ; m_newEmissions -= 1.f )
 		{
 			// delete emissions by KillType if max limit reached
-			Emission* newitem = getNew( m_emissions, m_desc->systemMaxEmissions, m_desc->systemLimitKill );
+			Emission* newitem = getNew( m_emissions, m_desc->systemMaxEmissions, m_desc->systemLimitKill, m_random );
 
 			// a new emission can be created?
 			if ( newitem != 0 )
@@ -586,10 +602,10 @@ void ParticleSystem::update( float dt )
 				Emission& emission = *newitem;
 
 				emission.time = 0.f;
-				emission.stop = m_desc->emissionStopTime.getRandomFloat();
-				emission.life = m_desc->emissionLifeTime.getRandomFloat();
+				emission.stop = m_desc->emissionStopTime.getRandomFloat( m_random );
+				emission.life = m_desc->emissionLifeTime.getRandomFloat( m_random );
 				emission.newParticles = 0.f;
-				emission.position = m_desc->emissionPosition.getRandomFloat3();
+				emission.position = m_desc->emissionPosition.getRandomFloat3( m_random );
 				emission.particles.clear();
 			}
 		}
@@ -620,27 +636,37 @@ void ParticleSystem::update( float dt )
 		// create new particles
 		if ( emission.stop < 0.f || emission.time < emission.stop )
 		{
-			emission.newParticles += m_desc->emissionRate.getRandomFloat() * dt;
+			emission.newParticles += m_desc->emissionRate.getRandomFloat( m_random ) * dt;
 			emission.newParticles = clamp( emission.newParticles, 0.f, (float)m_desc->emissionMaxParticles );
 
-			for ( ; emission.newParticles >= 1.f ; emission.newParticles -= 1.f )
+			// randomize start velocities and positions of all new particles at once
+			const int newparticles = (int)emission.newParticles;
+			if ( newparticles > 0 )
+			{
+				m_spawnVelocities.resize( newparticles );
+				m_spawnPositions.resize( newparticles );
+				m_desc->particleStartVelocity.getRandomFloat3( m_random, m_spawnVelocities.begin(), newparticles );
+				m_desc->particleStartPosition.getRandomFloat3( m_random, m_spawnPositions.begin(), newparticles );
+			}
+
+			for ( int n = 0 ; emission.newParticles >= 1.f ; emission.newParticles -= 1.f, ++n )
 			{
 				// delete particles by KillType if max limit reached
-				Particle* newitem = getNew( emission.particles, m_desc->emissionMaxParticles, m_desc->emissionLimitKill );
+				Particle* newitem = getNew( emission.particles, m_desc->emissionMaxParticles, m_desc->emissionLimitKill, m_random );
 
 				// a new emission can be created?
 				if ( newitem != 0 )
 				{
 					Particle& particle = *newitem;
 
-					float life = m_desc->particleLifeTime.getRandomFloat();
+					float life = m_desc->particleLifeTime.getRandomFloat( m_random );
 					assert( life >= Float::MIN_VALUE );
 					float invlife = 1.f / life;
 
 					particle.time = 0.f;
 					particle.life = life;
-					particle.elasticity = m_desc->particleSpriteElasticity.getRandomFloat();
-					particle.rot = m_desc->particleSpriteRotation.getRandomFloat();
+					particle.elasticity = m_desc->particleSpriteElasticity.getRandomFloat( m_random );
+					particle.rot = m_desc->particleSpriteRotation.getRandomFloat( m_random );
 					particle.rot = Math::toRadians( particle.rot );
 
 					particle.size.set( m_desc->particleStartSize, m_desc->particleEndSize, invlife );
@@ -653,8 +679,9 @@ void ParticleSystem::update( float dt )
 					particle.rotspeed.dv = Math::toRadians( particle.rotspeed.dv );
 
 					particle.frame = 0;
-					particle.velocity = m_parentVelocity + worldtm.rotate( m_desc->wind + m_desc->particleStartVelocity.getRandomFloat3() );
-					particle.position = worldtm.transform( m_desc->particleStartPosition.getRandomFloat3() + emission.position );
+					assert( n < newparticles );
+					particle.velocity = m_parentVelocity + worldtm.rotate( m_desc->wind + m_spawnVelocities[n] );
+					particle.position = worldtm.transform( m_spawnPositions[n] + emission.position );
 
 					particle.userRot = m_userRot;
 				}
@@ -678,7 +705,7 @@ void ParticleSystem::update( float dt )
 					particle.frame = (int)lerp( 0.f, textureframesf, particle.time/particle.life );
 					break;
 				case ANIM_RANDOM:
-					particle.frame = rand() % textureframes;
+					particle.frame = m_random.nextInt( textureframes );
 					break;
 				case ANIM_COUNT:
 					assert( false );
@@ -1249,13 +1276,24 @@ int ParticleSystem::particles() const
 	return count;
 }
 
+int ParticleSystem::memoryUsed() const
+{
+	int bytes = sizeof(ParticleSystem) + m_emissions.size()*sizeof(Emission);
+	const Emission* end = m_emissions.end();
+	for ( const Emission* it = m_emissions.begin() ; it != end ; ++it )
+		bytes += it->particles.size() * sizeof(Particle);
+	if ( m_prim )
+		bytes += m_prim->memoryUsed();
+	return bytes;
+}
+
 void ParticleSystem::restart()
 {
 	m_time = 0.f;
 	m_timeSinceRender = -Float::MAX_VALUE;
 	m_newEmissions = 0.f;
-	m_systemStopTime = m_desc->systemStopTime.getRandomFloat();
-	m_systemLifeTime = m_desc->systemLifeTime.getRandomFloat();
+	m_systemStopTime = m_desc->systemStopTime.getRandomFloat( m_random );
+	m_systemLifeTime = m_desc->systemLifeTime.getRandomFloat( m_random );
 	m_emissions.clear();
 }
 
@@ -1346,7 +1384,7 @@ template <class T> void ParticleSystem::killOld( Array<T>& array )
 	}
 }
 
-template <class T> T* ParticleSystem::getNew( Array<T>& array, int limit, KillType killtype )
+template <class T> T* ParticleSystem::getNew( Array<T>& array, int limit, KillType killtype, Random& rng )
 {
 	if ( array.size() < limit )
 	{
@@ -1373,7 +1411,7 @@ template <class T> T* ParticleSystem::getNew( Array<T>& array, int limit, KillTy
 		return 0;}
 
 	case KILL_RANDOM:
-		return &array[ rand() % array.size() ];
+		return &array[ rng.nextInt(array.size()) ];
 
 	default:
 		return 0;
@@ -1391,6 +1429,11 @@ void ParticleSystem::setDelay( float time )
 	m_delay = time;
 }
 
+void ParticleSystem::setRandomSeed( uint32_t seed )
+{
+	m_random.setSeed( seed );
+}
+
 void ParticleSystem::setParentVelocity( const float3& vel )
 {
 	m_parentVelocity = vel;
@@ -4,6 +4,7 @@
 #include <hgr/Mesh.h>
 #include <hgr/Visual.h>
 #include <hgr/Camera.h>
+#include <lang/ThreadPool.h>
 #include <lang/algorithm/sort.h>
 #include <lang/algorithm/unique.h>
 #include <lang/algorithm/greater.h>
@@ -20,7 +21,8 @@ BEGIN_NAMESPACE(hgr)
 
 PipeSetup::PipeSetup( Context* context ) :
 	m_frameCounter( -1 ),
-	m_context( context )
+	m_context( context ),
+	m_pool( 0 )
 {
 }
 
@@ -34,12 +36,18 @@ void PipeSetup::setup( Camera* camera )
 	getLights( nodes, lights );
 	camera->cacheTransforms( m_context, nodes );
 	camera->cullVisuals( nodes, visuals );
+	camera->assignLights( visuals, &lights, m_pool );
 	getShaders( visuals, shaders );
 	getPriorities( shaders, priorities );
 
 	m_frameCounter = m_context->statistics.renderedFrames;
 }
 
+void PipeSetup::setThreadPool( ThreadPool* pool )
+{
+	m_pool = pool;
+}
+
 void PipeSetup::setTechnique( const char* name )
 {
 	assert( valid() ); // setup() not called in the same frame
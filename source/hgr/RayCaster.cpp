@@ -0,0 +1,891 @@
+#include <hgr/RayCaster.h>
+#include <hgr/Node.h>
+#include <gr/Primitive.h>
+#include <lang/Float.h>
+#include <lang/Math.h>
+#include <lang/ThreadPool.h>
+#include <math/IntersectionUtil.h>
+#ifdef MATH_SSE
+#include <xmmintrin.h>
+#endif
+#include <float.h>
+#include <config.h>
+
+
+USING_NAMESPACE(gr)
+USING_NAMESPACE(lang)
+USING_NAMESPACE(math)
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+/** Rays per ray cast job. Multiple of 4. */
+const int CAST_RAYS_PER_JOB = 256;
+
+/** Traversal stack size. Tree depth is limited so one entry per level is enough. */
+const int CAST_STACK_SIZE = BoundingVolumeTree::MAX_DEPTH + 1;
+
+
+/**
+ * Up to 4 rays traversed together. Stored as
+ * structure of arrays so that lanes can be processed with SSE.
+ */
+class RayCaster::RayPacket
+{
+public:
+	float	ox[4];
+	float	oy[4];
+	float	oz[4];
+	float	dx[4];
+	float	dy[4];
+	float	dz[4];
+	float	ix[4];
+	float	iy[4];
+	float	iz[4];
+	float	tmax[4];
+	int		instance[4];
+	int		triangle[4];
+	int		active;
+
+	/** Sets ray in lane and computes inverse direction. */
+	void	setRay( int lane, const float3& orig, const float3& dir, float maxdist )
+	{
+		ox[lane] = orig.x; oy[lane] = orig.y; oz[lane] = orig.z;
+		dx[lane] = dir.x; dy[lane] = dir.y; dz[lane] = dir.z;
+		ix[lane] = getInverse( dir.x );
+		iy[lane] = getInverse( dir.y );
+		iz[lane] = getInverse( dir.z );
+		tmax[lane] = maxdist;
+		instance[lane] = -1;
+		triangle[lane] = -1;
+	}
+
+	/** Copies ray from another lane to an unused lane. */
+	void	copyRay( int lane, int src )
+	{
+		ox[lane] = ox[src]; oy[lane] = oy[src]; oz[lane] = oz[src];
+		dx[lane] = dx[src]; dy[lane] = dy[src]; dz[lane] = dz[src];
+		ix[lane] = ix[src]; iy[lane] = iy[src]; iz[lane] = iz[src];
+		tmax[lane] = tmax[src];
+		instance[lane] = -1;
+		triangle[lane] = -1;
+	}
+
+	float3	orig( int lane ) const		{return float3(ox[lane],oy[lane],oz[lane]);}
+	float3	dir( int lane ) const		{return float3(dx[lane],dy[lane],dz[lane]);}
+
+private:
+	/** Returns inverse of direction component, avoiding infinities and NaNs in slab tests. */
+	static float getInverse( float x )	{return 1.f / (Math::abs(x) > 1e-20f ? x : (x < 0.f ? -1e-20f : 1e-20f));}
+};
+
+
+/** Casts range of rays in a job. */
+class RayCastJob :
+	public ThreadPool::Job
+{
+public:
+	const RayCaster*		caster;
+	const RayCaster::Ray*	rays;
+	RayCaster::Hit*			hits;
+	int						count;
+	int						hitcount;
+
+	void run()
+	{
+		hitcount = caster->castRays( rays, hits, count, 0 );
+	}
+};
+
+
+/**
+ * Returns bit mask of active rays which intersect the box
+ * between ray origin and tmax.
+ */
+static inline int testPacketBox( const RayCaster::RayPacket& p, int active, const float3& boxmin, const float3& boxmax )
+{
+#ifdef MATH_SSE
+	const __m128 ix = _mm_loadu_ps( p.ix );
+	const __m128 iy = _mm_loadu_ps( p.iy );
+	const __m128 iz = _mm_loadu_ps( p.iz );
+	const __m128 ox = _mm_loadu_ps( p.ox );
+	const __m128 oy = _mm_loadu_ps( p.oy );
+	const __m128 oz = _mm_loadu_ps( p.oz );
+
+	const __m128 x0 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmin.x),ox), ix );
+	const __m128 x1 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmax.x),ox), ix );
+	const __m128 y0 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmin.y),oy), iy );
+	const __m128 y1 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmax.y),oy), iy );
+	const __m128 z0 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmin.z),oz), iz );
+	const __m128 z1 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmax.z),oz), iz );
+
+	__m128 tnear = _mm_max_ps( _mm_min_ps(x0,x1), _mm_setzero_ps() );
+	tnear = _mm_max_ps( tnear, _mm_min_ps(y0,y1) );
+	tnear = _mm_max_ps( tnear, _mm_min_ps(z0,z1) );
+	__m128 tfar = _mm_min_ps( _mm_max_ps(x0,x1), _mm_loadu_ps(p.tmax) );
+	tfar = _mm_min_ps( tfar, _mm_max_ps(y0,y1) );
+	tfar = _mm_min_ps( tfar, _mm_max_ps(z0,z1) );
+
+	return _mm_movemask_ps( _mm_cmple_ps(tnear,tfar) ) & active;
+#else
+	int mask = 0;
+	for ( int i = 0 ; i < 4 ; ++i )
+	{
+		if ( 0 == (active & (1<<i)) )
+			continue;
+
+		const float x0 = (boxmin.x - p.ox[i]) * p.ix[i];
+		const float x1 = (boxmax.x - p.ox[i]) * p.ix[i];
+		const float y0 = (boxmin.y - p.oy[i]) * p.iy[i];
+		const float y1 = (boxmax.y - p.oy[i]) * p.iy[i];
+		const float z0 = (boxmin.z - p.oz[i]) * p.iz[i];
+		const float z1 = (boxmax.z - p.oz[i]) * p.iz[i];
+
+		float tnear = Math::max( Math::min(x0,x1), 0.f );
+		tnear = Math::max( tnear, Math::min(y0,y1) );
+		tnear = Math::max( tnear, Math::min(z0,z1) );
+		float tfar = Math::min( Math::max(x0,x1), p.tmax[i] );
+		tfar = Math::min( tfar, Math::max(y0,y1) );
+		tfar = Math::min( tfar, Math::max(z0,z1) );
+
+		if ( tnear <= tfar )
+			mask |= 1<<i;
+	}
+	return mask;
+#endif
+}
+
+/**
+ * Returns true if ray intersects box (inflated by radius) between ray origin and tmax.
+ */
+static inline bool testRayBox( const float3& orig, const float3& invdir, float tmax,
+	const float3& boxmin, const float3& boxmax, float radius )
+{
+	float tnear = 0.f;
+	float tfar = tmax;
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		const float t0 = (boxmin[k] - radius - orig[k]) * invdir[k];
+		const float t1 = (boxmax[k] + radius - orig[k]) * invdir[k];
+		tnear = Math::max( tnear, Math::min(t0,t1) );
+		tfar = Math::min( tfar, Math::max(t0,t1) );
+	}
+	return tnear <= tfar;
+}
+
+/**
+ * Returns index of the child node to visit first,
+ * the one which is closer to ray origin along ray direction.
+ */
+static inline int getNearChild( const BoundingVolumeTree::TreeNode* nodes, const BoundingVolumeTree::TreeNode& node, const float3& dir )
+{
+	const BoundingVolumeTree::TreeNode& a = nodes[node.first];
+	const BoundingVolumeTree::TreeNode& b = nodes[node.first+1];
+	const float da = dot( a.boxMin + a.boxMax, dir );
+	const float db = dot( b.boxMin + b.boxMax, dir );
+	return da <= db ? node.first : node.first+1;
+}
+
+/**
+ * Transforms axis aligned box and returns axis aligned bounding box of the result.
+ */
+static void transformBox( const float3x4& tm, const float3& boxmin, const float3& boxmax, float3* outmin, float3* outmax )
+{
+	const float3 center = tm.transform( (boxmin+boxmax)*.5f );
+	const float3 extent = (boxmax-boxmin)*.5f;
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		const float r = Math::abs(tm(k,0))*extent.x + Math::abs(tm(k,1))*extent.y + Math::abs(tm(k,2))*extent.z;
+		(*outmin)[k] = center[k] - r;
+		(*outmax)[k] = center[k] + r;
+	}
+}
+
+/**
+ * Returns true if point on triangle plane is inside the triangle.
+ */
+static bool testPointInTriangle( const float3& p, const float3& v0, const float3& v1, const float3& v2, const float3& n )
+{
+	const float c0 = dot( cross(v1-v0,p-v0), n );
+	const float c1 = dot( cross(v2-v1,p-v1), n );
+	const float c2 = dot( cross(v0-v2,p-v2), n );
+	return (c0 >= 0.f && c1 >= 0.f && c2 >= 0.f) || (c0 <= 0.f && c1 <= 0.f && c2 <= 0.f);
+}
+
+/**
+ * Finds intersection of ray and capsule around edge if any.
+ * Capsule end spheres are not tested.
+ */
+static bool findRayEdgeIntersection( const float3& orig, const float3& dir,
+	const float3& a, const float3& b, float radius, float* t )
+{
+	const float3 d = b - a;
+	const float3 m = orig - a;
+	const float dd = dot( d, d );
+	const float md = dot( m, d );
+	const float nd = dot( dir, d );
+	const float mn = dot( m, dir );
+	const float k = dot( m, m ) - radius*radius;
+	const float c = dd*k - md*md;
+
+	// origin inside infinite cylinder
+	if ( c <= 0.f )
+	{
+		if ( md < 0.f || md > dd )
+			return false;
+		*t = 0.f;
+		return true;
+	}
+
+	// ray parallel to edge
+	const float qa = dd*dot(dir,dir) - nd*nd;
+	if ( qa <= FLT_MIN )
+		return false;
+
+	const float qb = dd*mn - nd*md;
+	const float disc = qb*qb - qa*c;
+	if ( disc < 0.f )
+		return false;
+
+	const float u = (-qb - Math::sqrt(disc)) / qa;
+	if ( u < 0.f )
+		return false;
+
+	const float s = md + u*nd;
+	if ( s < 0.f || s > dd )
+		return false;
+
+	*t = u;
+	return true;
+}
+
+/**
+ * Finds the first contact of sphere moving along ray and a triangle.
+ * @param t [in/out] Maximum distance along ray, receives distance to contact if any.
+ * @param point [out] Receives contact point on the triangle if any.
+ */
+static bool findSphereTriangleIntersection( const float3& orig, const float3& dir, float radius,
+	const float3& v0, const float3& v1, const float3& v2, float* t, float3* point )
+{
+	float3 n = cross( v1-v0, v2-v0 );
+	const float len = n.length();
+	if ( len <= FLT_MIN )
+		return false;
+	n *= 1.f/len;
+
+	float dist = dot( n, orig-v0 );
+	if ( dist < 0.f )
+	{
+		n = -n;
+		dist = -dist;
+	}
+
+	// contact with face is always the first one if there is one,
+	// and edges can not be touched before the plane
+	float u0 = 0.f;
+	if ( dist <= radius )
+	{
+		const float3 p = orig - n*dist;
+		if ( testPointInTriangle(p,v0,v1,v2,n) )
+		{
+			*t = 0.f;
+			*point = p;
+			return true;
+		}
+	}
+	else
+	{
+		const float denom = dot( n, dir );
+		if ( denom >= 0.f )
+			return false;
+
+		const float u = (radius - dist) / denom;
+		if ( u >= *t )
+			return false;
+
+		const float3 p = orig + dir*u - n*radius;
+		if ( testPointInTriangle(p,v0,v1,v2,n) )
+		{
+			*t = u;
+			*point = p;
+			return true;
+		}
+		u0 = u;
+	}
+
+	// contact with edges and vertices, solved from the plane contact
+	// since far away origin loses precision of the radius
+	const float3 start = orig + dir*u0;
+	const float3* verts[3] = {&v0, &v1, &v2};
+	bool found = false;
+	for ( int i = 0 ; i < 3 ; ++i )
+	{
+		const float3& a = *verts[i];
+		const float3& b = *verts[i < 2 ? i+1 : 0];
+
+		float u;
+		if ( findRayEdgeIntersection(start,dir,a,b,radius,&u) && u0+u < *t )
+		{
+			const float3 d = b - a;
+			const float s = dot( start + dir*u - a, d ) / dot( d, d );
+			*t = u0 + u;
+			*point = a + d*Math::max( 0.f, Math::min(s,1.f) );
+			found = true;
+		}
+		if ( IntersectionUtil::findRaySphereIntersection(start,dir,a,radius,&u) && u0+u < *t )
+		{
+			*t = u0 + u;
+			*point = a;
+			found = true;
+		}
+	}
+	return found;
+}
+
+
+RayCaster::RayCaster() :
+	m_shapeMap( 64, 0.75f, -1 )
+{
+}
+
+RayCaster::~RayCaster()
+{
+	clear();
+}
+
+void RayCaster::clear()
+{
+	for ( int i = 0 ; i < m_shapes.size() ; ++i )
+		delete m_shapes[i];
+	m_shapes.clear();
+	m_shapeMap.clear();
+	m_instances.clear();
+	m_boxMin.clear();
+	m_boxMax.clear();
+	m_tree.clear();
+}
+
+void RayCaster::build( Node* root )
+{
+	clear();
+	for ( Node* node = root ; node != 0 ; node = node->next(root) )
+	{
+		if ( Node::NODE_MESH == node->classId() )
+			addMesh( static_cast<Mesh*>(node) );
+	}
+	update();
+}
+
+void RayCaster::addMesh( Mesh* mesh )
+{
+	if ( mesh->bones() > 0 )
+		return;
+
+	const float3x4 tm = mesh->worldTransform();
+	Array<float3> verts;
+	for ( int i = 0 ; i < mesh->primitives() ; ++i )
+	{
+		Primitive* prim = mesh->getPrimitive( i );
+		if ( prim->type() != Primitive::PRIM_TRI )
+			continue;
+
+		int shapeindex = m_shapeMap.get( prim );
+		if ( shapeindex < 0 )
+		{
+			{
+				Primitive::Lock lock( prim, Primitive::LOCK_READ );
+
+				Array<float4> pos( prim->vertices() );
+				if ( pos.size() > 0 )
+					prim->getVertexPositions( 0, pos.begin(), pos.size() );
+
+				Array<int> ind( prim->indices() > 0 ? prim->indices() : prim->vertices() );
+				if ( prim->indices() > 0 )
+					prim->getIndices( 0, ind.begin(), ind.size() );
+				else
+					for ( int k = 0 ; k < ind.size() ; ++k )
+						ind[k] = k;
+
+				const int tricount = ind.size() / 3;
+				verts.resize( tricount*3 );
+				for ( int k = 0 ; k < tricount*3 ; ++k )
+				{
+					const float4& v = pos[ ind[k] ];
+					verts[k] = float3( v.x, v.y, v.z );
+				}
+			}
+
+			shapeindex = addShape( verts.begin(), verts.size()/3 );
+			m_shapes[shapeindex]->primitive = prim;
+			m_shapeMap[prim] = shapeindex;
+		}
+
+		addInstance( mesh, i, shapeindex, tm );
+	}
+}
+
+int RayCaster::addTriangles( const float3* verts, int count, const float3x4& tm )
+{
+	assert( count > 0 );
+
+	const int instance = m_instances.size();
+	addInstance( 0, 0, addShape(verts,count), tm );
+	return instance;
+}
+
+void RayCaster::setTransform( int instance, const float3x4& tm )
+{
+	assert( instance >= 0 && instance < m_instances.size() );
+	assert( 0 == m_instances[instance].mesh );
+
+	m_instances[instance].tm = tm;
+}
+
+int RayCaster::addShape( const float3* verts, int tricount )
+{
+	Shape* shape = new Shape;
+
+	Array<float3> boxmin( tricount );
+	Array<float3> boxmax( tricount );
+	for ( int k = 0 ; k < tricount ; ++k )
+	{
+		const float3& a = verts[k*3];
+		const float3& b = verts[k*3+1];
+		const float3& c = verts[k*3+2];
+		boxmin[k] = float3( Math::min(a.x,Math::min(b.x,c.x)), Math::min(a.y,Math::min(b.y,c.y)), Math::min(a.z,Math::min(b.z,c.z)) );
+		boxmax[k] = float3( Math::max(a.x,Math::max(b.x,c.x)), Math::max(a.y,Math::max(b.y,c.y)), Math::max(a.z,Math::max(b.z,c.z)) );
+	}
+	shape->tree.build( boxmin.begin(), boxmax.begin(), tricount );
+
+	// store triangle vertices in leaf order so that leaves refer to consecutive triangles
+	shape->vertices.resize( tricount*3 );
+	shape->triangles.resize( tricount );
+	const int* items = shape->tree.items();
+	for ( int k = 0 ; k < tricount ; ++k )
+	{
+		const int tri = items[k];
+		shape->triangles[k] = tri;
+		for ( int j = 0 ; j < 3 ; ++j )
+			shape->vertices[k*3+j] = verts[tri*3+j];
+	}
+
+	// triangles of each leaf in separate blocks for batched ray tests
+	const int nodecount = shape->tree.nodeCount();
+	const BoundingVolumeTree::TreeNode* nodes = shape->tree.nodes();
+	shape->leafBlocks.resize( nodecount );
+	int blocksize = 0;
+	for ( int k = 0 ; k < nodecount ; ++k )
+	{
+		shape->leafBlocks[k] = blocksize;
+		if ( nodes[k].isLeaf() )
+			blocksize += IntersectionUtil::getTriangleBlockSize( nodes[k].count );
+	}
+	shape->blocks.resize( blocksize );
+	for ( int k = 0 ; k < nodecount ; ++k )
+	{
+		if ( nodes[k].isLeaf() )
+			IntersectionUtil::setTriangleBlocks( &shape->vertices[nodes[k].first*3], nodes[k].count, &shape->blocks[shape->leafBlocks[k]] );
+	}
+
+	m_shapes.add( shape );
+	return m_shapes.size()-1;
+}
+
+void RayCaster::addInstance( Mesh* mesh, int primitive, int shape, const float3x4& tm )
+{
+	if ( m_shapes[shape]->tree.nodeCount() == 0 )
+		return;
+
+	Instance inst;
+	inst.mesh = mesh;
+	inst.primitive = primitive;
+	inst.shape = shape;
+	inst.tm = tm;
+	m_instances.add( inst );
+}
+
+void RayCaster::update()
+{
+	updateInstanceBounds();
+	m_tree.build( m_boxMin.begin(), m_boxMax.begin(), m_instances.size() );
+}
+
+void RayCaster::refit()
+{
+	for ( int i = 0 ; i < m_instances.size() ; ++i )
+	{
+		Instance& inst = m_instances[i];
+		if ( inst.mesh != 0 )
+			inst.tm = inst.mesh->worldTransform();
+	}
+	updateInstanceBounds();
+	m_tree.refit( m_boxMin.begin(), m_boxMax.begin() );
+}
+
+void RayCaster::updateInstanceBounds()
+{
+	m_boxMin.resize( m_instances.size() );
+	m_boxMax.resize( m_instances.size() );
+	for ( int i = 0 ; i < m_instances.size() ; ++i )
+	{
+		Instance& inst = m_instances[i];
+		inst.invtm = inst.tm.inverse();
+
+		// upper bound of world to model space scaling, used to inflate model space boxes in sphere casts
+		float s = 0.f;
+		for ( int k = 0 ; k < 3 ; ++k )
+			s += inst.invtm.getColumn(k).lengthSquared();
+		inst.invscale = Math::sqrt( s );
+
+		const BoundingVolumeTree::TreeNode& root = m_shapes[inst.shape]->tree.nodes()[0];
+		transformBox( inst.tm, root.boxMin, root.boxMax, &m_boxMin[i], &m_boxMax[i] );
+	}
+}
+
+int RayCaster::triangles() const
+{
+	int count = 0;
+	for ( int i = 0 ; i < m_shapes.size() ; ++i )
+		count += m_shapes[i]->triangles.size();
+	return count;
+}
+
+int RayCaster::castShapePacket( const Shape& shape, RayPacket& packet, bool anyhit ) const
+{
+	const BoundingVolumeTree::TreeNode* nodes = shape.tree.nodes();
+	int hitmask = 0;
+
+	int stack[CAST_STACK_SIZE];
+	int sp = 0;
+	stack[sp++] = 0;
+	while ( sp > 0 && packet.active != 0 )
+	{
+		const int nodeindex = stack[--sp];
+		const BoundingVolumeTree::TreeNode& node = nodes[nodeindex];
+		const int mask = testPacketBox( packet, packet.active, node.boxMin, node.boxMax );
+		if ( 0 == mask )
+			continue;
+
+		if ( node.isLeaf() )
+		{
+			const float* blocks = shape.blocks.begin() + shape.leafBlocks[nodeindex];
+			for ( int lane = 0 ; lane < 4 ; ++lane )
+			{
+				if ( 0 == (mask & (1<<lane)) )
+					continue;
+
+				const int tri = IntersectionUtil::findRayTrianglesIntersection( packet.orig(lane), packet.dir(lane), blocks, node.count, &packet.tmax[lane] );
+				if ( tri >= 0 )
+				{
+					packet.triangle[lane] = node.first + tri;
+					hitmask |= 1<<lane;
+					if ( anyhit )
+						packet.active &= ~(1<<lane);
+				}
+			}
+		}
+		else
+		{
+			int lane = 0;
+			while ( 0 == (mask & (1<<lane)) )
+				++lane;
+			const int nearchild = getNearChild( nodes, node, packet.dir(lane) );
+			stack[sp++] = nearchild ^ node.first ^ (node.first+1);
+			stack[sp++] = nearchild;
+		}
+	}
+	return hitmask;
+}
+
+void RayCaster::castPacket( RayPacket& packet, bool anyhit ) const
+{
+	if ( m_tree.nodeCount() == 0 )
+		return;
+
+	const BoundingVolumeTree::TreeNode* nodes = m_tree.nodes();
+	const int* items = m_tree.items();
+
+	int stack[CAST_STACK_SIZE];
+	int sp = 0;
+	stack[sp++] = 0;
+	while ( sp > 0 && packet.active != 0 )
+	{
+		const BoundingVolumeTree::TreeNode& node = nodes[ stack[--sp] ];
+		const int mask = testPacketBox( packet, packet.active, node.boxMin, node.boxMax );
+		if ( 0 == mask )
+			continue;
+
+		if ( node.isLeaf() )
+		{
+			for ( int i = node.first ; i < node.first+node.count ; ++i )
+			{
+				const int active = mask & packet.active;
+				if ( 0 == active )
+					break;
+
+				const int instindex = items[i];
+				const Instance& inst = m_instances[instindex];
+
+				// model space transform keeps distances along rays unchanged
+				RayPacket local;
+				for ( int lane = 0 ; lane < 4 ; ++lane )
+					local.setRay( lane, inst.invtm.transform(packet.orig(lane)), inst.invtm.rotate(packet.dir(lane)), packet.tmax[lane] );
+				local.active = active;
+
+				const int hitmask = castShapePacket( *m_shapes[inst.shape], local, anyhit );
+				for ( int lane = 0 ; lane < 4 ; ++lane )
+				{
+					if ( hitmask & (1<<lane) )
+					{
+						packet.tmax[lane] = local.tmax[lane];
+						packet.instance[lane] = instindex;
+						packet.triangle[lane] = local.triangle[lane];
+					}
+				}
+				if ( anyhit )
+					packet.active &= ~hitmask;
+			}
+		}
+		else
+		{
+			int lane = 0;
+			while ( 0 == (mask & (1<<lane)) )
+				++lane;
+			const int nearchild = getNearChild( nodes, node, packet.dir(lane) );
+			stack[sp++] = nearchild ^ node.first ^ (node.first+1);
+			stack[sp++] = nearchild;
+		}
+	}
+}
+
+void RayCaster::getHitInfo( const RayPacket& packet, int lane, Hit* hit ) const
+{
+	const Instance& inst = m_instances[ packet.instance[lane] ];
+	const Shape& shape = *m_shapes[inst.shape];
+	const int tri = packet.triangle[lane];
+	const float3* v = shape.vertices.begin() + tri*3;
+
+	const float3 v0 = inst.tm.transform( v[0] );
+	float3 normal = cross( inst.tm.transform(v[1])-v0, inst.tm.transform(v[2])-v0 );
+	const float len = normal.length();
+	if ( len > FLT_MIN )
+		normal *= 1.f/len;
+	const float3 dir = packet.dir( lane );
+	if ( dot(normal,dir) > 0.f )
+		normal = -normal;
+
+	hit->t = packet.tmax[lane];
+	hit->point = packet.orig(lane) + dir * hit->t;
+	hit->normal = normal;
+	hit->mesh = inst.mesh;
+	hit->primitive = inst.primitive;
+	hit->triangle = shape.triangles[tri];
+	hit->instance = packet.instance[lane];
+}
+
+bool RayCaster::castRay( const float3& orig, const float3& dir, float maxdist, Hit* hit ) const
+{
+	RayPacket packet;
+	packet.setRay( 0, orig, dir, maxdist );
+	for ( int lane = 1 ; lane < 4 ; ++lane )
+		packet.copyRay( lane, 0 );
+	packet.active = 1;
+
+	castPacket( packet, false );
+	if ( packet.instance[0] < 0 )
+		return false;
+
+	getHitInfo( packet, 0, hit );
+	return true;
+}
+
+bool RayCaster::castSegment( const float3& start, const float3& end, Hit* hit ) const
+{
+	return castRay( start, end-start, 1.f, hit );
+}
+
+bool RayCaster::testSegment( const float3& start, const float3& end ) const
+{
+	RayPacket packet;
+	packet.setRay( 0, start, end-start, 1.f );
+	for ( int lane = 1 ; lane < 4 ; ++lane )
+		packet.copyRay( lane, 0 );
+	packet.active = 1;
+
+	castPacket( packet, true );
+	return packet.instance[0] >= 0;
+}
+
+int RayCaster::castRays( const Ray* rays, Hit* hits, int count, ThreadPool* pool ) const
+{
+	int jobcount = 1;
+	if ( pool != 0 && count > CAST_RAYS_PER_JOB )
+		jobcount = (count+CAST_RAYS_PER_JOB-1) / CAST_RAYS_PER_JOB;
+	if ( jobcount > 1 )
+	{
+		Array<RayCastJob> jobs( jobcount );
+		ThreadPool::Batch batch;
+		for ( int i = 0 ; i < jobcount ; ++i )
+		{
+			// job ranges are multiples of packet size
+			const int begin = (i*count/jobcount) & ~3;
+			const int end = i+1 < jobcount ? ((i+1)*count/jobcount) & ~3 : count;
+			RayCastJob& job = jobs[i];
+			job.caster = this;
+			job.rays = rays + begin;
+			job.hits = hits + begin;
+			job.count = end - begin;
+			job.hitcount = 0;
+			pool->add( &job, &batch );
+		}
+		pool->wait( &batch );
+
+		int hitcount = 0;
+		for ( int i = 0 ; i < jobcount ; ++i )
+			hitcount += jobs[i].hitcount;
+		return hitcount;
+	}
+
+	int hitcount = 0;
+	for ( int i = 0 ; i < count ; i += 4 )
+	{
+		const int n = Math::min( 4, count-i );
+		RayPacket packet;
+		for ( int lane = 0 ; lane < n ; ++lane )
+			packet.setRay( lane, rays[i+lane].orig, rays[i+lane].dir, rays[i+lane].maxDist );
+		for ( int lane = n ; lane < 4 ; ++lane )
+			packet.copyRay( lane, 0 );
+		packet.active = (1<<n) - 1;
+
+		castPacket( packet, false );
+
+		for ( int lane = 0 ; lane < n ; ++lane )
+		{
+			Hit& hit = hits[i+lane];
+			if ( packet.instance[lane] >= 0 )
+			{
+				getHitInfo( packet, lane, &hit );
+				++hitcount;
+			}
+			else
+			{
+				hit.t = rays[i+lane].maxDist;
+				hit.mesh = 0;
+				hit.primitive = -1;
+				hit.triangle = -1;
+				hit.instance = -1;
+			}
+		}
+	}
+	return hitcount;
+}
+
+bool RayCaster::castSphere( const float3& orig, const float3& dir, float radius, float maxdist, Hit* hit ) const
+{
+	hit->t = maxdist;
+	hit->mesh = 0;
+	hit->instance = -1;
+	if ( m_tree.nodeCount() == 0 )
+		return false;
+
+	RayPacket packet;
+	packet.setRay( 0, orig, dir, maxdist );
+	const float3 invdir( packet.ix[0], packet.iy[0], packet.iz[0] );
+
+	const BoundingVolumeTree::TreeNode* nodes = m_tree.nodes();
+	const int* items = m_tree.items();
+
+	bool found = false;
+	int stack[CAST_STACK_SIZE];
+	int sp = 0;
+	stack[sp++] = 0;
+	while ( sp > 0 )
+	{
+		const BoundingVolumeTree::TreeNode& node = nodes[ stack[--sp] ];
+		if ( !testRayBox(orig,invdir,hit->t,node.boxMin,node.boxMax,radius) )
+			continue;
+
+		if ( node.isLeaf() )
+		{
+			for ( int i = node.first ; i < node.first+node.count ; ++i )
+				found |= castSphereShape( items[i], orig, dir, radius, hit );
+		}
+		else
+		{
+			const int nearchild = getNearChild( nodes, node, dir );
+			stack[sp++] = nearchild ^ node.first ^ (node.first+1);
+			stack[sp++] = nearchild;
+		}
+	}
+	return found;
+}
+
+bool RayCaster::castSphereShape( int instindex, const float3& orig, const float3& dir, float radius, Hit* hit ) const
+{
+	const Instance& inst = m_instances[instindex];
+	const Shape& shape = *m_shapes[inst.shape];
+	const BoundingVolumeTree::TreeNode* nodes = shape.tree.nodes();
+
+	// traverse in model space with boxes inflated by upper bound of model space radius, test triangles in world space
+	RayPacket local;
+	local.setRay( 0, inst.invtm.transform(orig), inst.invtm.rotate(dir), hit->t );
+	const float3 localorig = local.orig( 0 );
+	const float3 localinvdir( local.ix[0], local.iy[0], local.iz[0] );
+	const float localradius = radius * inst.invscale;
+
+	bool found = false;
+	int stack[CAST_STACK_SIZE];
+	int sp = 0;
+	stack[sp++] = 0;
+	while ( sp > 0 )
+	{
+		const BoundingVolumeTree::TreeNode& node = nodes[ stack[--sp] ];
+		if ( !testRayBox(localorig,localinvdir,hit->t,node.boxMin,node.boxMax,localradius) )
+			continue;
+
+		if ( node.isLeaf() )
+		{
+			for ( int i = node.first ; i < node.first+node.count ; ++i )
+			{
+				const float3* v = shape.vertices.begin() + i*3;
+				const float3 v0 = inst.tm.transform( v[0] );
+				const float3 v1 = inst.tm.transform( v[1] );
+				const float3 v2 = inst.tm.transform( v[2] );
+
+				float t = hit->t;
+				float3 point;
+				if ( findSphereTriangleIntersection(orig,dir,radius,v0,v1,v2,&t,&point) )
+				{
+					float3 normal = cross( v1-v0, v2-v0 );
+					const float len = normal.length();
+					if ( len > FLT_MIN )
+						normal *= 1.f/len;
+					if ( dot(normal,orig-v0) < 0.f )
+						normal = -normal;
+
+					hit->t = t;
+					hit->point = point;
+					hit->normal = normal;
+					hit->mesh = inst.mesh;
+					hit->primitive = inst.primitive;
+					hit->triangle = shape.triangles[i];
+					hit->instance = instindex;
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			const int nearchild = getNearChild( nodes, node, local.dir(0) );
+			stack[sp++] = nearchild ^ node.first ^ (node.first+1);
+			stack[sp++] = nearchild;
+		}
+	}
+	return found;
+}
+
+
+END_NAMESPACE() // hgr
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
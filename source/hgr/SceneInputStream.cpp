@@ -21,14 +21,15 @@ BEGIN_NAMESPACE(hgr)
 
 
 const int SceneInputStream::MIN_VERSION = 170;
-const int SceneInputStream::MAX_VERSION = 193;
+const int SceneInputStream::MAX_VERSION = 195;
 
 
 SceneInputStream::SceneInputStream( InputStream* in ) :
-	DataInputStream( in ),
+	DataInputStream( in, 0 ),
 	m_ver( 0 ),
 	m_dataFlags( 0 ),
-	m_platformID( Context::PLATFORM_DX )
+	m_platformID( Context::PLATFORM_DX ),
+	m_optimizePrimitives( false )
 {
 	char magic[4];
 	read( magic, sizeof(magic) );
@@ -48,6 +49,17 @@ SceneInputStream::SceneInputStream( InputStream* in ) :
 
 	if ( m_ver >= 180 )
 		m_platformID = (Context::PlatformType)readShort();
+
+	// header is read unbuffered so that rest of the data can be decompressed
+	if ( m_dataFlags & DATA_COMPRESSED )
+	{
+		m_inflate = new InflateInputStream( in );
+		setSource( m_inflate, DEFAULT_BUFFER_SIZE );
+	}
+	else
+	{
+		setSource( in, DEFAULT_BUFFER_SIZE );
+	}
 }
 
 SceneInputStream::~SceneInputStream()
@@ -56,39 +68,34 @@ SceneInputStream::~SceneInputStream()
 
 float3 SceneInputStream::readFloat3()
 {
-	float3 obj;
-	obj.x = readFloat();
-	obj.y = readFloat();
-	obj.z = readFloat();
-	return obj;
+	float v[3];
+	readFloatArrayBE( v, 3 );
+	return float3( v[0], v[1], v[2] );
 }
 
 float4 SceneInputStream::readFloat4()
 {
-	float4 obj;
-	obj.x = readFloat();
-	obj.y = readFloat();
-	obj.z = readFloat();
-	obj.w = readFloat();
-	return obj;
+	float v[4];
+	readFloatArrayBE( v, 4 );
+	return float4( v[0], v[1], v[2], v[3] );
 }
 
 quaternion SceneInputStream::readQuaternion()
 {
-	quaternion obj;
-	obj.x = readFloat();
-	obj.y = readFloat();
-	obj.z = readFloat();
-	obj.w = readFloat();
-	return obj;
+	float v[4];
+	readFloatArrayBE( v, 4 );
+	return quaternion( v[0], v[1], v[2], v[3] );
 }
 
 float3x4 SceneInputStream::readFloat3x4()
 {
+	float v[float3x4::ROWS*float3x4::COLUMNS];
+	readFloatArrayBE( v, float3x4::ROWS*float3x4::COLUMNS );
+
 	float3x4 obj;
 	for ( int i = 0 ; i < float3x4::ROWS ; ++i )
 		for ( int j = 0 ; j < float3x4::COLUMNS ; ++j )
-			obj(i,j) = readFloat();
+			obj(i,j) = v[i*float3x4::COLUMNS+j];
 	return obj;
 }
 
@@ -164,15 +171,24 @@ void SceneInputStream::readFloat4Array16( float4* out, int count )
 		for ( int k = 0 ; k < 4 ; ++k )
 			delta[k] = maxv[k] - minv[k];
 
-		for ( int i = 0 ; i < count ; ++i )
+		// decode in blocks of 16-bit values
+		const int BLOCK = 64;
+		int16_t buf[BLOCK*4];
+		for ( int i = 0 ; i < count ; i += BLOCK )
 		{
-			for ( int k = 0 ; k < 4 ; ++k )
+			const int n = count-i < BLOCK ? count-i : BLOCK;
+			readInt16ArrayBE( buf, n*4 );
+
+			for ( int j = 0 ; j < n ; ++j )
 			{
-				int xi = (int)(uint16_t)readShort();
-				float x = float(xi) * (1.f/65535.f);
-				x *= delta[k];
-				x += minv[k];
-				out[i][k] = x;
+				for ( int k = 0 ; k < 4 ; ++k )
+				{
+					int xi = (int)(uint16_t)buf[j*4+k];
+					float x = float(xi) * (1.f/65535.f);
+					x *= delta[k];
+					x += minv[k];
+					out[i+j][k] = x;
+				}
 			}
 		}
 	}
@@ -194,15 +210,24 @@ void SceneInputStream::readFloat3Array16( float3* out, int count )
 		for ( int k = 0 ; k < 3 ; ++k )
 			delta[k] = maxv[k] - minv[k];
 
-		for ( int i = 0 ; i < count ; ++i )
+		// decode in blocks of 16-bit values
+		const int BLOCK = 64;
+		int16_t buf[BLOCK*3];
+		for ( int i = 0 ; i < count ; i += BLOCK )
 		{
-			for ( int k = 0 ; k < 3 ; ++k )
+			const int n = count-i < BLOCK ? count-i : BLOCK;
+			readInt16ArrayBE( buf, n*3 );
+
+			for ( int j = 0 ; j < n ; ++j )
 			{
-				int xi = (int)(uint16_t)readShort();
-				float x = float(xi) * (1.f/65535.f);
-				x *= delta[k];
-				x += minv[k];
-				out[i][k] = x;
+				for ( int k = 0 ; k < 3 ; ++k )
+				{
+					int xi = (int)(uint16_t)buf[j*3+k];
+					float x = float(xi) * (1.f/65535.f);
+					x *= delta[k];
+					x += minv[k];
+					out[i+j][k] = x;
+				}
 			}
 		}
 	}
@@ -284,6 +309,11 @@ void SceneInputStream::readVertexFormat( VertexFormat* vf )
 	}
 }
 
+void SceneInputStream::setOptimizePrimitives( bool enabled )
+{
+	m_optimizePrimitives = enabled;
+}
+
 P(Primitive) SceneInputStream::readPrimitive( Context* context, int* materialindex )
 {
     int verts = 0;
@@ -322,7 +352,7 @@ P(Primitive) SceneInputStream::readPrimitive( Context* context, int* materialind
 	if ( vf != prim->vertexFormat() )
 		throwError( IOException( Format("Failed to load scene \"{0}\". Primitive vertex format ({1}) should be ({2})", toString(), vf.toString(), prim->vertexFormat().toString()) ) );
 
-	Primitive::Lock lk( prim, Primitive::LOCK_WRITE );
+	Primitive::Lock lk( prim, m_optimizePrimitives ? Primitive::LOCK_READWRITE : Primitive::LOCK_WRITE );
 
 	float4 posscalebias(1,0,0,0);
 	float4 uvscalebias(1,0,0,0);
@@ -410,6 +440,9 @@ P(Primitive) SceneInputStream::readPrimitive( Context* context, int* materialind
 		throwError( IOException( Format("Failed to load scene \"{0}\". Too many bones ({1}).", toString(), usedbones) ) );
 	readFully( usedbonearray, usedbones );
 	prim->setUsedBones( usedbonearray, usedbones );
+
+	if ( m_optimizePrimitives )
+		PrimitiveOptimizer::optimize( prim, &m_primStats );
 	return prim;
 }
 
@@ -457,6 +490,12 @@ P(UserPropertySet) SceneInputStream::readUserPropertySet( Scene* scene )
 	return ups;
 }
 
+P(BakedScene) SceneInputStream::readBakedScene()
+{
+	int size = readInt();
+	return new BakedScene( this, size );
+}
+
 bool SceneInputStream::hasData( int flags ) const
 {
 	return 0 != (m_dataFlags & flags);
@@ -0,0 +1,1717 @@
+#include <hgr/SceneLoader.h>
+#include <hgr/Scene.h>
+#include <hgr/Mesh.h>
+#include <hgr/Lines.h>
+#include <hgr/Light.h>
+#include <hgr/Dummy.h>
+#include <hgr/Camera.h>
+#include <hgr/BakedScene.h>
+#include <hgr/LightSorter.h>
+#include <hgr/KeyframeSequence.h>
+#include <hgr/ResourceManager.h>
+#include <hgr/SceneInputStream.h>
+#include <hgr/SceneOutputStream.h>
+#include <hgr/DefaultResourceManager.h>
+#include <gr/Context.h>
+#include <gr/Texture.h>
+#include <gr/Primitive.h>
+#include <gr/CubeTexture.h>
+#include <io/IOException.h>
+#include <io/PropertySchema.h>
+#include <io/FileInputStream.h>
+#include <io/FileOutputStream.h>
+#include <io/ByteArrayInputStream.h>
+#include <lang/Math.h>
+#include <lang/Debug.h>
+#include <lang/System.h>
+#include <lang/Throwable.h>
+#include <math/float3x4.h>
+#include <string.h>
+#include <config.h>
+
+
+USING_NAMESPACE(gr)
+USING_NAMESPACE(io)
+USING_NAMESPACE(lang)
+USING_NAMESPACE(math)
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+static void getFloat3x4( const float3x4& tm, float* v )
+{
+	for ( int i = 0 ; i < float3x4::ROWS ; ++i )
+		for ( int j = 0 ; j < float3x4::COLUMNS ; ++j )
+			v[i*float3x4::COLUMNS+j] = tm(i,j);
+}
+
+static float3x4 toFloat3x4( const float* v )
+{
+	float3x4 tm;
+	for ( int i = 0 ; i < float3x4::ROWS ; ++i )
+		for ( int j = 0 ; j < float3x4::COLUMNS ; ++j )
+			tm(i,j) = v[i*float3x4::COLUMNS+j];
+	return tm;
+}
+
+static int indexOfNode( const Array<P(Node)>& nodes, const Node* node )
+{
+	for ( int i = 0 ; i < nodes.size() ; ++i )
+		if ( nodes[i].ptr() == node )
+			return i;
+	return -1;
+}
+
+static int indexOfNodeName( const Array<P(Node)>& nodes, const String& name )
+{
+	for ( int i = 0 ; i < nodes.size() ; ++i )
+		if ( nodes[i]->name() == name )
+			return i;
+	return -1;
+}
+
+/** Node user properties used by the loader. */
+struct NodeProperties
+{
+	float			perspectiveCorrection;
+	float			time;
+	PropertyView	particle;
+};
+
+/** Indices of the fields in NODE_PROPERTY_FIELDS. */
+enum NodePropertyField
+{
+	NODEPROPERTY_PERSPECTIVECORRECTION,
+	NODEPROPERTY_TIME,
+	NODEPROPERTY_PARTICLE,
+};
+
+static const PropertySchema::Field NODE_PROPERTY_FIELDS[] =
+{
+	PROPERTYSCHEMA_FIELD( NodeProperties, "perspectivecorrection", FIELD_FLOAT, perspectiveCorrection ),
+	PROPERTYSCHEMA_FIELD( NodeProperties, "time", FIELD_FLOAT, time ),
+	PROPERTYSCHEMA_FIELD( NodeProperties, "particle", FIELD_VIEW, particle ),
+};
+
+static const PropertySchema s_nodePropertySchema( NODE_PROPERTY_FIELDS, sizeof(NODE_PROPERTY_FIELDS)/sizeof(NODE_PROPERTY_FIELDS[0]) );
+
+/**
+ * Returns start of vertex data in locked primitive,
+ * distance between vertices and size of the vertex data.
+ */
+static void getVertexLayout( Primitive* prim, uint8_t** data, int* pitch, int* size )
+{
+	const VertexFormat& vf = prim->vertexFormat();
+	*pitch = 0;
+	for ( int k = 0 ; k < (int)VertexFormat::DT_SIZE && 0 == *pitch ; ++k )
+	{
+		VertexFormat::DataType dt = (VertexFormat::DataType)k;
+		if ( vf.hasData(dt) )
+		{
+			uint8_t* ptr;
+			prim->getVertexDataPtr( dt, &ptr, pitch );
+		}
+	}
+	prim->getVertexDataRange( data, size );
+}
+
+static void bakeTrack( BakedScene* baked, const KeyframeSequence* seq, BakedScene::Track* track )
+{
+	memset( track, 0, sizeof(BakedScene::Track) );
+	track->keys = -1;
+	if ( seq != 0 )
+	{
+		track->keys = seq->keys();
+		track->format = seq->format();
+		track->scale = seq->scale();
+		for ( int k = 0 ; k < 4 ; ++k )
+			track->bias[k] = seq->bias()[k];
+		if ( seq->keys() > 0 )
+			track->data = baked->addData( seq->data(), VertexFormat::getDataSize(seq->format(),seq->keys()) );
+	}
+}
+
+static void bakeTrack( BakedScene* baked, const TransformAnimation::Float3Anim* anim, BakedScene::Track* track )
+{
+	memset( track, 0, sizeof(BakedScene::Track) );
+	track->keys = -1;
+	if ( anim != 0 )
+	{
+		track->keys = anim->keys.size();
+		track->format = VertexFormat::DF_V4_32;
+		track->scale = 1.f;
+		if ( anim->keys.size() > 0 )
+			track->data = baked->addData( anim->keys.begin(), anim->keys.size()*sizeof(float4) );
+	}
+}
+
+static P(KeyframeSequence) createKeyframeSequence( BakedScene* baked, const BakedScene::Track& track )
+{
+	if ( track.keys < 0 )
+		return 0;
+	if ( track.format <= VertexFormat::DF_NONE || track.format >= VertexFormat::DF_SIZE )
+		throwError( IOException( Format("Invalid baked keyframe sequence format ({0})", track.format) ) );
+
+	VertexFormat::DataFormat format = (VertexFormat::DataFormat)track.format;
+	P(KeyframeSequence) seq = new KeyframeSequence( track.keys, format );
+	seq->setScale( track.scale );
+	seq->setBias( float4(track.bias[0],track.bias[1],track.bias[2],track.bias[3]) );
+	if ( track.keys > 0 )
+	{
+		int size = VertexFormat::getDataSize( format, track.keys );
+		memcpy( seq->data(), baked->getData(track.data,size), size );
+	}
+	return seq;
+}
+
+static P(TransformAnimation::Float3Anim) createFloat3Anim( BakedScene* baked, const BakedScene::Track& track )
+{
+	if ( track.keys < 0 )
+		return 0;
+
+	P(TransformAnimation::Float3Anim) anim = new TransformAnimation::Float3Anim;
+	anim->keys.resize( track.keys );
+	if ( track.keys > 0 )
+	{
+		int size = track.keys * sizeof(float4);
+		memcpy( anim->keys.begin(), baked->getData(track.data,size), size );
+	}
+	return anim;
+}
+
+
+/**
+ * Reads scene file and textures it references to memory in worker thread.
+ * Strings cannot be passed between threads so input and
+ * output of the job are plain character data.
+ */
+class SceneLoader::ReadJob :
+	public ThreadPool::Job
+{
+public:
+	class TextureData
+	{
+	public:
+		char			filename[PathName::MAXLEN];
+		Array<uint8_t>	data;
+	};
+
+	SceneLoader*		loader;
+	char				filename[PathName::MAXLEN];
+	char				texturepath[PathName::MAXLEN];
+	char				error[256];
+	Array<uint8_t>		data;
+	Array<TextureData>	textures;
+
+	void run()
+	{
+		error[0] = 0;
+
+		try
+		{
+			FileInputStream in( filename );
+			data.resize( in.available() );
+			if ( data.size() > 0 )
+				in.read( data.begin(), data.size() );
+		}
+		catch ( Throwable& e )
+		{
+			e.getMessage().format( error, sizeof(error) );
+			data.clear();
+		}
+
+		if ( data.size() > 0 )
+			readTextures();
+
+		loader->m_mutex.lock();
+		loader->m_readDone = true;
+		loader->m_readProgress = 1.f;
+		loader->m_mutex.unlock();
+	}
+
+	void readTextures()
+	{
+		// texture list is in the beginning of the scene file,
+		// errors are left to be reported when the scene is parsed
+		try
+		{
+			ByteArrayInputStream bytein( data.begin(), data.size() );
+			SceneInputStream in( &bytein );
+			if ( in.hasData(SceneInputStream::DATA_BAKED) )
+			{
+				P(BakedScene) baked = in.readBakedScene();
+				int n = baked->header().textures.count;
+				textures.resize( n );
+				for ( int i = 0 ; i < n ; ++i )
+				{
+					const BakedScene::Texture& tex = baked->textures()[i];
+					textures[i].filename[0] = 0;
+					if ( 0 == tex.type )
+						String::cpy( textures[i].filename, sizeof(textures[i].filename), PathName(texturepath,baked->getString(tex.filename)).toString() );
+				}
+				return;
+			}
+
+			in.readByte();
+			in.readFloat();
+			in.readFloat();
+			in.readFloat3();
+			in.readInt();
+
+			int n = in.readInt();
+			if ( n < 0 || n > 0x10000 )
+				return;
+			textures.resize( n );
+
+			Array<char> buf;
+			for ( int i = 0 ; i < n ; ++i )
+			{
+				in.readUTF( buf );
+				int type = 0;
+				if ( in.version() >= 160 )
+					type = in.readInt();
+
+				// cube textures are loaded directly from files
+				textures[i].filename[0] = 0;
+				if ( 0 == type )
+					String::cpy( textures[i].filename, sizeof(textures[i].filename), PathName(texturepath,buf.begin()).toString() );
+			}
+		}
+		catch ( Throwable& )
+		{
+			textures.clear();
+			return;
+		}
+
+		for ( int i = 0 ; i < textures.size() ; ++i )
+		{
+			TextureData& tex = textures[i];
+			if ( tex.filename[0] != 0 )
+			{
+				try
+				{
+					FileInputStream in( tex.filename );
+					tex.data.resize( in.available() );
+					if ( tex.data.size() > 0 )
+						in.read( tex.data.begin(), tex.data.size() );
+				}
+				catch ( Throwable& )
+				{
+					tex.data.clear();
+				}
+			}
+
+			loader->m_mutex.lock();
+			loader->m_readProgress = float(i+1) / float(textures.size()+1);
+			loader->m_mutex.unlock();
+		}
+	}
+};
+
+
+SceneLoader::SceneLoader( ThreadPool* pool, Context* context, const String& filename, ResourceManager* res,
+	const String& texturepath, const String& shaderpath, const String& particlepath, int loadflags ) :
+	m_scene( 0 ),
+	m_pool( pool ),
+	m_job( 0 ),
+	m_readProgress( 0.f ),
+	m_readDone( false ),
+	m_source( 0 ),
+	m_sourceSize( 0 ),
+	m_stage( STAGE_READ ),
+	m_count( -1 ),
+	m_index( 0 ),
+	m_checkId( 0 ),
+	m_exporterVersion( 0 )
+{
+	assert( pool != 0 );
+
+	m_sceneRef = new Scene;
+	m_scene = m_sceneRef;
+	m_scene->setName( filename );
+	init( context, res, filename, texturepath, shaderpath, particlepath, loadflags );
+
+	m_job = new ReadJob;
+	m_job->loader = this;
+	filename.get( m_job->filename, sizeof(m_job->filename) );
+	String::cpy( m_job->texturepath, sizeof(m_job->texturepath), m_texturePath );
+	m_pool->add( m_job, &m_batch );
+}
+
+SceneLoader::SceneLoader( Scene* scene, InputStream* in, Context* context, ResourceManager* res,
+	const String& texturepath, const String& shaderpath, const String& particlepath, int loadflags ) :
+	m_scene( scene ),
+	m_pool( 0 ),
+	m_job( 0 ),
+	m_readProgress( 1.f ),
+	m_readDone( true ),
+	m_source( in ),
+	m_sourceSize( in->available() ),
+	m_stage( STAGE_HEADER ),
+	m_count( -1 ),
+	m_index( 0 ),
+	m_checkId( 0 ),
+	m_exporterVersion( 0 )
+{
+	init( context, res, scene->name(), texturepath, shaderpath, particlepath, loadflags );
+}
+
+SceneLoader::~SceneLoader()
+{
+	if ( m_job != 0 )
+	{
+		m_pool->wait( &m_batch );
+
+		delete m_job;
+	}
+}
+
+void SceneLoader::init( Context* context, ResourceManager* res, const String& filename,
+	const String& texturepath, const String& shaderpath, const String& particlepath, int loadflags )
+{
+	// make sure we have some resource manager
+	if ( !res )
+		res = DefaultResourceManager::get( context );
+
+	m_context = context;
+	m_res = res;
+	m_loadFlags = loadflags;
+	m_texturePathString = texturepath;
+	if ( loadflags & Scene::LOAD_BAKE )
+		m_bake = new BakedScene;
+	m_shaderPathString = shaderpath;
+
+	// directories to read data from
+	// (char arrays used as memory usage optimization)
+	PathName parentpath = PathName(filename).parent();
+
+	if ( shaderpath != "" )
+		shaderpath.get( m_shaderPath, sizeof(m_shaderPath) );
+	else
+		String::cpy( m_shaderPath, sizeof(m_shaderPath), parentpath.toString() );
+
+	if ( texturepath != "" )
+		texturepath.get( m_texturePath, sizeof(m_texturePath) );
+	else
+		String::cpy( m_texturePath, sizeof(m_texturePath), parentpath.toString() );
+
+	if ( particlepath != "" )
+		particlepath.get( m_particlePath, sizeof(m_particlePath) );
+	else
+		String::cpy( m_particlePath, sizeof(m_particlePath), parentpath.toString() );
+}
+
+bool SceneLoader::update( int maxtime )
+{
+	if ( STAGE_READ == m_stage && !pollRead() )
+		return false;
+
+	int time = System::currentTimeMillis();
+	while ( m_stage != STAGE_DONE )
+	{
+		step();
+		if ( System::currentTimeMillis() - time >= maxtime )
+			break;
+	}
+	return STAGE_DONE == m_stage;
+}
+
+Scene* SceneLoader::finish()
+{
+	if ( STAGE_READ == m_stage )
+	{
+		m_pool->wait( &m_batch );
+
+		pollRead();
+		assert( m_stage != STAGE_READ );
+	}
+
+	while ( m_stage != STAGE_DONE )
+		step();
+	return m_scene;
+}
+
+bool SceneLoader::finished() const
+{
+	return STAGE_DONE == m_stage;
+}
+
+float SceneLoader::progress() const
+{
+	// reading in background is counted as quarter of the total
+	const float readshare = m_job != 0 ? .25f : 0.f;
+	if ( STAGE_DONE == m_stage )
+		return 1.f;
+
+	if ( STAGE_READ == m_stage )
+	{
+		Mutex::Lock lk( m_mutex );
+		return readshare * m_readProgress;
+	}
+
+	float parsed = 0.f;
+	if ( m_baked != 0 )
+		parsed = float(m_stage-STAGE_HEADER) / float(STAGE_DONE-STAGE_HEADER);
+	else if ( m_sourceSize > 0 )
+		parsed = 1.f - float(m_source->available()) / float(m_sourceSize);
+	return readshare + (1.f-readshare) * parsed * .99f;
+}
+
+Scene* SceneLoader::scene() const
+{
+	return STAGE_DONE == m_stage ? m_scene : 0;
+}
+
+bool SceneLoader::pollRead()
+{
+	assert( STAGE_READ == m_stage );
+
+	m_mutex.lock();
+	bool done = m_readDone;
+	m_mutex.unlock();
+	if ( !done )
+		return false;
+
+	if ( m_job->error[0] != 0 )
+		throwError( IOException( Format("Failed to load scene \"{0}\": {1}", m_scene->name(), String(m_job->error)) ) );
+
+	m_sourceRef = new ByteArrayInputStream( m_job->data.begin(), m_job->data.size() );
+	m_source = m_sourceRef;
+	m_sourceSize = m_job->data.size();
+	m_stage = STAGE_HEADER;
+	return true;
+}
+
+void SceneLoader::step()
+{
+	switch ( m_stage )
+	{
+	case STAGE_HEADER:
+		readHeader();
+		m_stage = STAGE_TEXTURES;
+		return;
+
+	case STAGE_LINK:
+		if ( m_baked != 0 )
+			linkBaked();
+		else
+			link();
+		m_stage = STAGE_DONE;
+		return;
+	}
+
+	if ( m_count < 0 )
+	{
+		if ( m_baked != 0 )
+			beginBakedSection();
+		else
+			beginSection();
+		return;
+	}
+
+	if ( m_index >= m_count )
+	{
+		if ( STAGE_PRIMITIVES == m_stage && (m_loadFlags & Scene::LOAD_OPTIMIZEPRIMITIVES) && !m_baked )
+		{
+			const PrimitiveOptimizer::Statistics& stats = m_in->primitiveStatistics();
+			Debug::printf( "hgr: Optimized %d primitives (%d triangles) in \"%s\": ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+				stats.primitives, stats.triangles, m_scene->name().c_str(), stats.acmrBefore(), stats.acmrAfter(), stats.atvrBefore(), stats.atvrAfter() );
+		}
+
+		++m_stage;
+		m_count = -1;
+		return;
+	}
+
+	int i = m_index++;
+	if ( m_baked != 0 )
+	{
+		switch ( m_stage )
+		{
+		case STAGE_TEXTURES:		createBakedTexture( i ); break;
+		case STAGE_MATERIALS:		createBakedMaterial( i ); break;
+		case STAGE_PRIMITIVES:		createBakedPrimitive( i ); break;
+		case STAGE_NODES:			createBakedNode( i ); break;
+		case STAGE_ANIMATIONS:		createBakedAnimation( i ); break;
+		case STAGE_USERPROPERTIES:	createBakedUserProperty( i ); break;
+		}
+		return;
+	}
+
+	switch ( m_stage )
+	{
+	case STAGE_TEXTURES:	readTexture( i ); break;
+	case STAGE_MATERIALS:	readMaterial( i ); break;
+	case STAGE_PRIMITIVES:	readPrimitive( i ); break;
+	case STAGE_MESHES:		readMesh( i ); break;
+	case STAGE_CAMERAS:		readCamera(); break;
+	case STAGE_LIGHTS:		readLight(); break;
+	case STAGE_DUMMIES:		readDummy(); break;
+	case STAGE_LINES:		readLines(); break;
+	case STAGE_NODES:		readOtherNode(); break;
+	case STAGE_ANIMATIONS:	readTransformAnimation( i ); break;
+	}
+}
+
+void SceneLoader::beginSection()
+{
+	// materials follow textures without check id
+	if ( m_stage != STAGE_MATERIALS )
+		readId();
+
+	m_index = 0;
+	if ( STAGE_USERPROPERTIES == m_stage )
+	{
+		m_scene->m_userProperties = m_in->readUserPropertySet( m_scene );
+		m_count = 0;
+		return;
+	}
+
+	m_count = m_in->readInt();
+	switch ( m_stage )
+	{
+	case STAGE_TEXTURES:	m_textures.resize( m_count ); break;
+	case STAGE_MATERIALS:	m_materials.resize( m_count ); break;
+	case STAGE_PRIMITIVES:	m_primitives.resize( m_count ); break;
+	case STAGE_MESHES:		m_meshBoneCounts.resize( m_count ); break;
+	case STAGE_ANIMATIONS:	m_scene->m_transformAnims = new TransformAnimationSet( m_count ); break;
+	}
+}
+
+void SceneLoader::beginBakedSection()
+{
+	const BakedScene::Header& header = m_baked->header();
+
+	// baked image has all records of a kind in a single table,
+	// nodes of every class are created in STAGE_NODES
+	m_index = 0;
+	m_count = 0;
+	switch ( m_stage )
+	{
+	case STAGE_TEXTURES:
+		m_count = header.textures.count;
+		m_textures.resize( m_count );
+		break;
+	case STAGE_MATERIALS:
+		m_count = header.materials.count;
+		m_materials.resize( m_count );
+		break;
+	case STAGE_PRIMITIVES:
+		m_count = header.primitives.count;
+		m_primitives.resize( m_count );
+		break;
+	case STAGE_NODES:
+		m_count = header.nodes.count;
+		m_nodes.resize( m_count );
+		break;
+	case STAGE_ANIMATIONS:
+		m_count = header.animations.count;
+		m_scene->m_transformAnims = new TransformAnimationSet( m_count );
+		break;
+	case STAGE_USERPROPERTIES:
+		m_count = header.userProperties.count;
+		if ( m_count > 0 )
+			m_scene->m_userProperties = new UserPropertySet( m_count );
+		break;
+	}
+}
+
+void SceneLoader::readHeader()
+{
+	const String& filename = m_scene->name();
+
+	m_in = new SceneInputStream( m_source );
+	m_in->setOptimizePrimitives( 0 != (m_loadFlags & Scene::LOAD_OPTIMIZEPRIMITIVES) );
+
+	if ( m_in->platform() != m_context->platform() )
+		throwError( IOException( Format("Cannot load scene file {0}, invalid platform (file:{1}, current:{2})", filename, Context::getString(m_in->platform()), m_context->platformString()) ) );
+
+	m_exporterVersion = m_in->exporterVersion();
+
+	if ( m_in->hasData(SceneInputStream::DATA_BAKED) )
+	{
+		if ( m_bake != 0 )
+			throwError( IOException( Format("Cannot bake scene file {0}, scene is already baked", filename) ) );
+
+		m_baked = m_in->readBakedScene();
+		const BakedScene::Header& header = m_baked->header();
+		m_scene->setFog( (Scene::FogType)header.fogType, header.fogStart, header.fogEnd, 
+			float3(header.fogColor[0],header.fogColor[1],header.fogColor[2]) );
+		return;
+	}
+
+	// read fog
+	Scene::FogType type = (Scene::FogType)m_in->readByte();
+	float start = m_in->readFloat();
+	float end = m_in->readFloat();
+	float3 color = m_in->readFloat3();
+	m_scene->setFog( type, start, end, color );
+
+	m_checkId = 0x12345600;
+}
+
+void SceneLoader::readTexture( int i )
+{
+	m_in->readUTF( m_buf );
+
+	int type = 0;
+	if ( m_in->version() >= 160 )
+		type = m_in->readInt();
+
+	if ( m_bake != 0 )
+	{
+		BakedScene::Texture rec;
+		rec.filename = m_bake->addString( m_buf.begin() );
+		rec.type = type;
+		m_bake->addTexture( rec );
+	}
+
+	loadTexture( i, m_buf.begin(), type );
+}
+
+void SceneLoader::loadTexture( int i, const char* filename, int type )
+{
+	String texfname = PathName(m_texturePath,filename).toString();
+
+	switch ( type )
+	{
+	case 0:
+		if ( m_job != 0 && i < m_job->textures.size() &&
+			m_job->textures[i].data.size() > 0 && texfname == m_job->textures[i].filename )
+		{
+			// use texture file data read in background
+			Array<uint8_t>& data = m_job->textures[i].data;
+			m_textures[i] = m_res->getTexture( texfname, data.begin(), data.size() );
+			Array<uint8_t>().swap( data );
+		}
+		else
+		{
+			m_textures[i] = m_res->getTexture( texfname );
+		}
+		break;
+	case 1:
+		m_textures[i] = m_res->getCubeTexture( texfname );
+		break;
+	default:
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid texture type (\"{1}\" type was {2})", m_scene->name(), texfname, type) ) );
+	}
+}
+
+void SceneLoader::readMaterial( int i )
+{
+	String name = m_in->readUTF();
+	m_in->readUTF( m_buf );
+	int flags = m_in->readInt();
+	P(Shader) fx = m_res->getShader( PathName(m_shaderPath,m_buf.begin()).toString(), flags );
+	fx->setName( name );
+
+	// shader parameters can't be enumerated afterwards,
+	// so material is recorded for baking while it is read
+	BakedScene::Material mat;
+	BakedScene::Param param;
+	memset( &param, 0, sizeof(param) );
+	if ( m_bake != 0 )
+	{
+		mat.name = m_bake->addString( name.c_str() );
+		mat.shader = m_bake->addString( m_buf.begin() );
+		mat.flags = flags;
+		mat.firstParam = 0;
+		mat.params = 0;
+	}
+
+	int texparams = m_in->readByte();
+	for ( int k = 0 ; k < texparams ; ++k )
+	{
+		m_in->readUTF( m_buf );
+		int ix = m_in->readShort();
+		if ( ix < 0 || ix > m_textures.size() )
+			throwError( IOException( Format("Failed to load scene \"{0}\". Invalid texture index ({1}) in material \"{2}\"", m_scene->name(), ix, name) ) );
+		fx->setTexture( &m_buf[0], m_textures[ix] );
+
+		if ( m_bake != 0 )
+		{
+			param.name = m_bake->addString( m_buf.begin() );
+			param.type = BakedScene::PARAM_TEXTURE;
+			param.texture = ix;
+			int paramix = m_bake->addParam( param );
+			if ( 0 == mat.params++ )
+				mat.firstParam = paramix;
+		}
+	}
+
+	int vec4params = m_in->readByte();
+	for ( int k = 0 ; k < vec4params ; ++k )
+	{
+		m_in->readUTF( m_buf );
+		float4 v = m_in->readFloat4();
+		fx->setVector( &m_buf[0], v );
+
+		if ( m_bake != 0 )
+		{
+			param.name = m_bake->addString( m_buf.begin() );
+			param.type = BakedScene::PARAM_VECTOR;
+			param.texture = -1;
+			for ( int j = 0 ; j < 4 ; ++j )
+				param.value[j] = v[j];
+			int paramix = m_bake->addParam( param );
+			if ( 0 == mat.params++ )
+				mat.firstParam = paramix;
+		}
+	}
+
+	int floatparams = m_in->readByte();
+	for ( int k = 0 ; k < floatparams ; ++k )
+	{
+		m_in->readUTF( m_buf );
+		float v = m_in->readFloat();
+		fx->setFloat( &m_buf[0], v );
+
+		if ( m_bake != 0 )
+		{
+			param.name = m_bake->addString( m_buf.begin() );
+			param.type = BakedScene::PARAM_FLOAT;
+			param.texture = -1;
+			param.value[0] = v;
+			param.value[1] = param.value[2] = param.value[3] = 0.f;
+			int paramix = m_bake->addParam( param );
+			if ( 0 == mat.params++ )
+				mat.firstParam = paramix;
+		}
+	}
+
+	if ( m_bake != 0 )
+		m_bake->addMaterial( mat );
+	m_materials[i] = fx;
+}
+
+void SceneLoader::readPrimitive( int i )
+{
+	int matix=-1;
+	P(Primitive) prim = m_in->readPrimitive( m_context, &matix );
+	if ( matix < 0 || matix >= m_materials.size() )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid material index ({1}), maximum is {2}.", m_scene->name(), matix, m_materials.size()) ) );
+
+	P(Shader) shader = m_materials[matix];
+	prim->setShader( shader );
+	if ( m_loadFlags & Scene::LOAD_SHAREDATA )
+		m_res->shareVertexData( prim );
+	m_primitives[i] = prim;
+
+	if ( m_bake != 0 )
+		bakePrimitive( prim, matix );
+}
+
+void SceneLoader::readMesh( int i )
+{
+	P(Mesh) obj = new Mesh;
+	readNode( obj );
+
+	// add primitives
+	int count = m_in->readInt();
+	for ( int k = 0 ; k < count ; ++k )
+	{
+		int ix = m_in->readInt();
+		if ( ix < 0 || ix >= m_primitives.size() )
+			throwError( IOException( Format("Failed to load scene \"{0}\". Invalid primitive index ({1}) in primitive {2}.", m_scene->name(), ix, i) ) );
+		obj->addPrimitive( m_primitives[ix] );
+	}
+
+	// add bones
+	MeshBoneCount& mbc = m_meshBoneCounts[i];
+	mbc.mesh = obj;
+	mbc.bonecount = m_in->readInt();
+	for ( int k = 0 ; k < mbc.bonecount ; ++k )
+	{
+		MeshBone mb;
+		mb.boneindex = m_in->readInt();
+		mb.invresttm = m_in->readFloat3x4();
+		m_meshBones.add( mb );
+	}
+
+	obj->computeBound();
+}
+
+void SceneLoader::readCamera()
+{
+	P(Camera) obj = new Camera;
+	readNode( obj );
+
+	float front = m_in->readFloat();
+	float back = m_in->readFloat();
+	float fov = m_in->readFloat();
+
+	if ( front < 1e-4f || back < front || back > 1e9f )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid front/back plane ({1}/{2}) in \"{3}\".", m_scene->name(), front, back, obj->name()) ) );
+	if ( fov < Math::toRadians(1.5f) || fov > Math::toRadians(179.f) )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid horizontal field-of-view ({1}) in \"{2}\".", m_scene->name(), fov, obj->name()) ) );
+
+	obj->setFront( front );
+	obj->setBack( back );
+	obj->setVerticalFov( fov );
+}
+
+void SceneLoader::readLight()
+{
+	P(Light) obj = new Light;
+	readNode( obj );
+
+	float3 v3 = m_in->readFloat3();
+	obj->setColor( v3 );
+
+	m_in->readFloat();
+	m_in->readFloat();
+
+	float v = m_in->readFloat();
+	obj->setFarAttenStart( v );
+	v = m_in->readFloat();
+	obj->setFarAttenEnd( v );
+
+	v = m_in->readFloat();
+	if ( v < Math::toRadians(0.f) || v > Math::toRadians(180.f) )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Light inner cone ({1}) invalid in object \"{2}\".", m_scene->name(), v, obj->name()) ) );
+	obj->setInnerCone( v );
+
+	v = m_in->readFloat();
+	if ( v < Math::toRadians(0.f) || v > Math::toRadians(180.f) )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Light outer cone ({1}) invalid in object \"{2}\".", m_scene->name(), v, obj->name()) ) );
+	obj->setOuterCone( v );
+
+	Light::Type type = (Light::Type)m_in->readByte();
+	if ( type <= Light::TYPE_UNKNOWN || type >= Light::TYPE_COUNT )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Light type ({1}) invalid in object \"{2}\".", m_scene->name(), int(type), obj->name()) ) );
+	obj->setType( type );
+}
+
+void SceneLoader::readDummy()
+{
+	P(Dummy) obj = new Dummy;
+	readNode( obj );
+
+	float3 boxmin = m_in->readFloat3();
+	float3 boxmax = m_in->readFloat3();
+	obj->setBox( boxmin, boxmax );
+}
+
+void SceneLoader::readLines()
+{
+	P(Lines) obj = new Lines( m_context );
+	readNode( obj );
+
+	int lines = m_in->readInt();
+	int paths = m_in->readInt();
+	if ( lines > 100000 || paths > 100000 || paths > lines )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid line/path count ({1}/{2})", m_scene->name(), lines, paths) ) );
+	obj->reserve( lines, paths );
+
+	for ( int k = 0 ; k < lines ; ++k )
+	{
+		float3 start = m_in->readFloat3();
+		float3 end = m_in->readFloat3();
+		obj->addLine( start, end, float4(1,1,1,1) );
+	}
+
+	for ( int k = 0 ; k < paths ; ++k )
+	{
+		int begin = m_in->readInt();
+		int end = m_in->readInt();
+		obj->addPath( begin, end );
+	}
+
+	obj->computeBound();
+}
+
+void SceneLoader::readOtherNode()
+{
+	P(Node) obj = new Node;
+	readNode( obj );
+}
+
+void SceneLoader::readTransformAnimation( int i )
+{
+	String name = m_in->readUTF();
+
+	// re-use existing string to save memory
+	if ( m_nodeNames.size() > 0 )
+	{
+		if ( m_count != m_nodeNames.size() )
+			throwError( IOException( Format("Failed to load scene \"{0}\". Transform animation count ({1}) does not match node count ({2}).", m_scene->name(), m_count, m_nodeNames.size()) ) );
+		if ( name == m_nodeNames[i] )
+			name = m_nodeNames[i];
+		else
+			throwError( IOException( Format("Failed to load scene \"{0}\". Transform animation ({1}) does not match node name ({2}).", m_scene->name(), name, m_nodeNames[i]) ) );
+	}
+
+	m_scene->m_transformAnims->put( name, shareAnimation(m_in->readTransformAnimation()) );
+}
+
+P(TransformAnimation) SceneLoader::shareAnimation( TransformAnimation* anim )
+{
+	if ( !(m_loadFlags & Scene::LOAD_SHAREDATA) )
+		return anim;
+
+	// animation object itself is not shared since it has playback state
+	ResourceManager* res = m_res;
+	KeyframeSequence* rot = res->getSharedKeyframeSequence( anim->rotationKeyframeSequence() );
+	if ( !anim->positionKeyframeSequence() && !anim->scaleKeyframeSequence() )
+	{
+		return new TransformAnimation( anim->endBehaviour(), 
+			res->getSharedFloat3Anim(anim->positionAnimation()), rot, res->getSharedFloat3Anim(anim->scaleAnimation()),
+			anim->positionKeyRate(), anim->rotationKeyRate(), anim->scaleKeyRate(), anim->endTime() );
+	}
+	else
+	{
+		return new TransformAnimation( anim->endBehaviour(), 
+			res->getSharedKeyframeSequence(anim->positionKeyframeSequence()), rot, res->getSharedKeyframeSequence(anim->scaleKeyframeSequence()),
+			anim->positionKeyRate(), anim->rotationKeyRate(), anim->scaleKeyRate() );
+	}
+}
+
+void SceneLoader::link()
+{
+	Scene* scene = m_scene;
+	const String& filename = scene->name();
+
+	// connect parents
+	assert( m_nodes.size() == m_nodeParents.size() );
+	for ( int i = 0 ; i < m_nodes.size() ; ++i )
+	{
+		int ix = m_nodeParents[i];
+		if ( ix >= m_nodes.size() )
+			throwError( IOException( Format("Failed to load scene \"{0}\". Invalid node parent index ({1}) in \"{2}\".", filename, ix, m_nodeNames[i]) ) );
+		if ( ix >= 0 )
+			m_nodes[i]->linkTo( m_nodes[ix] );
+		else
+			m_nodes[i]->linkTo( scene );
+	}
+
+	// connect bones
+	int n = 0;
+	for ( int i = 0 ; i < m_meshBoneCounts.size() ; ++i )
+	{
+		const MeshBoneCount& mbc = m_meshBoneCounts[i];
+		int bonecount = mbc.bonecount;
+		for ( int k = 0 ; k < bonecount ; ++k )
+		{
+			const MeshBone& mb = m_meshBones[n++];
+			int ix = mb.boneindex;
+			if ( ix < 0 || ix >= m_nodes.size() )
+				throwError( IOException( Format("Failed to load scene \"{0}\". Invalid bone index ({1}) in \"{2}\".", filename, ix, mbc.mesh->name()) ) );
+
+			mbc.mesh->addBone( m_nodes[ix], mb.invresttm );
+		}
+		if ( bonecount > 0 )
+			mbc.mesh->computeBoneBounds();
+	}
+	assert( m_meshBones.size() == n );
+
+	// connect lights to meshes
+	LightSorter lightsorter;
+	lightsorter.collectLights( scene );
+	if ( lightsorter.lights() > 0 )
+	{
+		for ( int i = 0 ; i < m_meshBoneCounts.size() ; ++i )
+		{
+			Mesh* mesh = m_meshBoneCounts[i].mesh;
+
+			float3 meshpos;
+			if ( mesh->isBoundWorld() )
+				meshpos = (mesh->boundBoxMaxWorld()+mesh->boundBoxMinWorld())*.5f;
+			else
+				meshpos = mesh->worldTransform().transform( (mesh->boundBoxMax()+mesh->boundBoxMin())*.5f );
+			Array<Light*>& lights = lightsorter.getLightsByDistance( meshpos );
+
+			if ( lights.size() > 0 )
+				mesh->addLight( lights[0] );
+		}
+	}
+
+	linkUserProperties();
+	releaseLoadingData();
+}
+
+void SceneLoader::linkUserProperties()
+{
+	Scene* scene = m_scene;
+	const String& filename = scene->name();
+
+	// create particle systems based on user properties Particle=<name>
+	if ( scene->m_userProperties != 0 )
+	{
+		for ( HashtableIterator<String,String> it = scene->m_userProperties->begin() ; it != scene->m_userProperties->end() ; ++it )
+		{
+			// parse from own copies, views of prop point to m_propText
+			const String& props = it.value();
+			m_propText.resize( props.length()+1 );
+			props.get( m_propText.begin(), m_propText.size() );
+			m_propName.resize( it.key().length()+1 );
+			it.key().get( m_propName.begin(), m_propName.size() );
+
+			NodeProperties prop;
+			prop.time = 0.f;
+			uint32_t found = s_nodePropertySchema.parse( m_propText.begin(), props.length(), &prop, m_propName.begin() );
+			if ( 0 == found )
+				continue;
+
+			if ( found & (1<<NODEPROPERTY_PERSPECTIVECORRECTION) )
+			{
+				int persp = (int)prop.perspectiveCorrection;
+				if ( persp < 0 || persp > 10 )
+					throwError( IOException( Format("Failed parse PerspectiveCorrection=<level 0-10> User Property field from object \"{0}\" in scene \"{1}\"", it.key(), filename) ) );
+
+				Node* node = scene->getNodeByName( it.key() );
+				if ( node->classId() == Node::NODE_MESH )
+				{
+					Mesh* mesh = static_cast<Mesh*>( node );
+					for ( int i = 0 ; i < mesh->primitives() ; ++i )
+						mesh->getPrimitive(i)->setPerspectiveCorrection( persp );
+				}
+			}
+
+#ifndef HGR_NOPARTICLES
+			if ( found & (1<<NODEPROPERTY_PARTICLE) )
+			{
+				m_buf.resize( prop.particle.length+1 );
+				prop.particle.get( m_buf.begin(), m_buf.size() );
+				PathName particlepathname( m_particlePath, m_buf.begin() );
+
+				// append .prs extension
+				m_buf.resize( strlen(particlepathname.toString()) + 1 );
+				strcpy( m_buf.begin(), particlepathname.toString() );
+				m_buf.resize( m_buf.size()-1 );
+				m_buf.add( '.' );
+				m_buf.add( 'p' );
+				m_buf.add( 'r' );
+				m_buf.add( 's' );
+				m_buf.add( 0 );
+
+				// create particle system from file <particlename>
+				P(ParticleSystem) particle = m_res->getParticleSystem( m_buf.begin(), m_texturePathString, m_shaderPathString );
+
+				// set particle instance specific properties
+				particle->setDelay( prop.time );
+
+				// link particle to node
+				Node* node = scene->getNodeByName( it.key() );
+				particle->linkTo( node );
+			}
+#endif // HGR_NOPARTICLES
+		}
+	}
+
+}
+
+void SceneLoader::releaseLoadingData()
+{
+	m_in = 0;
+	m_baked = 0;
+	m_sourceRef = 0;
+	m_textures.clear();
+	m_materials.clear();
+	if ( m_job != 0 )
+	{
+		m_job->data.clear();
+		m_job->textures.clear();
+	}
+
+	// objects are kept until the scene is baked
+	if ( !m_bake )
+	{
+		m_primitives.clear();
+		m_nodes.clear();
+		m_nodeNames.clear();
+		m_nodeParents.clear();
+		m_meshBoneCounts.clear();
+		m_meshBones.clear();
+	}
+}
+
+void SceneLoader::bakePrimitive( Primitive* prim, int material )
+{
+	BakedScene::Primitive rec;
+	memset( &rec, 0, sizeof(rec) );
+	rec.type = prim->type();
+	rec.material = material;
+	rec.vertices = prim->vertices();
+	rec.indices = prim->indices();
+
+	const VertexFormat& vf = prim->vertexFormat();
+	for ( int k = 0 ; k < (int)VertexFormat::DT_SIZE ; ++k )
+		rec.dataFormat[k] = (uint8_t)vf.getDataFormat( (VertexFormat::DataType)k );
+
+	const float4& posscalebias = prim->vertexPositionScaleBias();
+	const float4& uvscalebias = prim->vertexTextureCoordinateScaleBias();
+	for ( int k = 0 ; k < 4 ; ++k )
+	{
+		rec.posScaleBias[k] = posscalebias[k];
+		rec.uvScaleBias[k] = uvscalebias[k];
+	}
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		rec.boundMin[k] = prim->boundMin()[k];
+		rec.boundMax[k] = prim->boundMax()[k];
+	}
+	rec.boundRadius = prim->boundRadius();
+
+	// vertex and index data are stored as they are in device buffers
+	Primitive::Lock lk( prim, Primitive::LOCK_READ );
+	if ( rec.vertices > 0 )
+	{
+		uint8_t* data;
+		int pitch;
+		getVertexLayout( prim, &data, &pitch, &rec.vertexDataSize );
+		rec.vertexSize = pitch;
+		rec.vertexData = m_bake->addData( data, rec.vertexDataSize );
+	}
+	if ( rec.indices > 0 )
+	{
+		uint16_t* indexdata;
+		int indexsize;
+		prim->getIndexDataPtr( &indexdata, &indexsize );
+		rec.indexData = m_bake->addData( indexdata, rec.indices*indexsize );
+	}
+
+	rec.usedBones = prim->usedBones();
+	if ( rec.usedBones > 0 )
+		memcpy( rec.usedBoneArray, prim->usedBoneArray(), rec.usedBones );
+
+	m_bake->addPrimitive( rec );
+}
+
+P(BakedScene) SceneLoader::bake()
+{
+	if ( m_stage != STAGE_DONE || !m_bake )
+		throwError( IOException( Format("Cannot bake scene \"{0}\", scene must be loaded with LOAD_BAKE flag", m_scene->name()) ) );
+
+	Scene* scene = m_scene;
+	P(BakedScene) baked = m_bake;
+
+	BakedScene::Header& header = baked->header();
+	header.fogType = scene->fogType();
+	header.fogStart = scene->fogStart();
+	header.fogEnd = scene->fogEnd();
+	for ( int k = 0 ; k < 3 ; ++k )
+		header.fogColor[k] = scene->fogColor()[k];
+
+	// nodes in file order, records refer to each other by node index
+	for ( int i = 0 ; i < m_nodes.size() ; ++i )
+	{
+		Node* node = m_nodes[i];
+
+		BakedScene::Node rec;
+		rec.classId = node->classId();
+		rec.name = baked->addString( node->name().c_str() );
+		rec.parent = m_nodeParents[i];
+		rec.flags = node->flags();
+		rec.id = node->id();
+		rec.data = -1;
+		getFloat3x4( node->transform(), rec.transform );
+
+		switch ( node->classId() )
+		{
+		case Node::NODE_MESH:{
+			Mesh* obj = static_cast<Mesh*>( node );
+			BakedScene::Mesh mesh;
+			mesh.firstPrimitive = 0;
+			mesh.primitives = obj->primitives();
+			for ( int k = 0 ; k < obj->primitives() ; ++k )
+			{
+				int ix = m_primitives.indexOf( obj->getPrimitive(k) );
+				assert( ix >= 0 );
+				int meshprimix = baked->addMeshPrimitive( ix );
+				if ( 0 == k )
+					mesh.firstPrimitive = meshprimix;
+			}
+
+			mesh.firstBone = 0;
+			mesh.bones = obj->bones();
+			for ( int k = 0 ; k < obj->bones() ; ++k )
+			{
+				BakedScene::Bone bone;
+				bone.node = indexOfNode( m_nodes, obj->getBone(k) );
+				assert( bone.node >= 0 );
+				getFloat3x4( obj->getBoneInverseRestTransform(k), bone.invRestTransform );
+				int boneix = baked->addBone( bone );
+				if ( 0 == k )
+					mesh.firstBone = boneix;
+			}
+
+			mesh.light = obj->lights() > 0 ? indexOfNode( m_nodes, obj->getLight(0) ) : -1;
+			rec.data = baked->addMesh( mesh );
+			break;}
+
+		case Node::NODE_CAMERA:{
+			Camera* obj = static_cast<Camera*>( node );
+			BakedScene::Camera camera;
+			camera.front = obj->front();
+			camera.back = obj->back();
+			camera.verticalFov = obj->verticalFov();
+			rec.data = baked->addCamera( camera );
+			break;}
+
+		case Node::NODE_LIGHT:{
+			Light* obj = static_cast<Light*>( node );
+			BakedScene::Light light;
+			for ( int k = 0 ; k < 3 ; ++k )
+				light.color[k] = obj->color()[k];
+			light.farAttenStart = obj->farAttenStart();
+			light.farAttenEnd = obj->farAttenEnd();
+			light.innerCone = obj->innerCone();
+			light.outerCone = obj->outerCone();
+			light.type = obj->type();
+			rec.data = baked->addLight( light );
+			break;}
+
+		case Node::NODE_DUMMY:{
+			Dummy* obj = static_cast<Dummy*>( node );
+			BakedScene::Dummy dummy;
+			for ( int k = 0 ; k < 3 ; ++k )
+			{
+				dummy.boxMin[k] = obj->boxMin()[k];
+				dummy.boxMax[k] = obj->boxMax()[k];
+			}
+			rec.data = baked->addDummy( dummy );
+			break;}
+
+		case Node::NODE_LINES:{
+			Lines* obj = static_cast<Lines*>( node );
+			BakedScene::Lines lines;
+			lines.firstLine = 0;
+			lines.lines = obj->lines();
+			for ( int k = 0 ; k < obj->lines() ; ++k )
+			{
+				BakedScene::Line line;
+				for ( int j = 0 ; j < 3 ; ++j )
+				{
+					line.start[j] = obj->getLineStart(k)[j];
+					line.end[j] = obj->getLineEnd(k)[j];
+				}
+				int lineix = baked->addLine( line );
+				if ( 0 == k )
+					lines.firstLine = lineix;
+			}
+
+			lines.firstPath = 0;
+			lines.paths = obj->paths();
+			for ( int k = 0 ; k < obj->paths() ; ++k )
+			{
+				BakedScene::Path path;
+				path.begin = obj->getPathBegin(k);
+				path.end = obj->getPathEnd(k);
+				int pathix = baked->addPath( path );
+				if ( 0 == k )
+					lines.firstPath = pathix;
+			}
+			rec.data = baked->addLines( lines );
+			break;}
+
+		default:
+			// other nodes have no class specific data
+			break;
+		}
+
+		baked->addNode( rec );
+	}
+
+	// transform animations
+	TransformAnimationSet* tmanims = scene->transformAnimations();
+	if ( tmanims != 0 )
+	{
+		for ( HashtableIterator<String,P(TransformAnimation)> it = tmanims->begin() ; it != tmanims->end() ; ++it )
+		{
+			TransformAnimation* anim = it.value();
+
+			BakedScene::Animation rec;
+			rec.name = baked->addString( it.key().c_str() );
+			rec.node = indexOfNodeName( m_nodes, it.key() );
+			rec.endBehaviour = anim->endBehaviour();
+			rec.posKeyRate = anim->positionKeyRate();
+			rec.rotKeyRate = anim->rotationKeyRate();
+			rec.sclKeyRate = anim->scaleKeyRate();
+			rec.optimized = anim->isOptimized() ? 1 : 0;
+			rec.endTime = anim->endTime();
+
+			bakeTrack( baked, anim->rotationKeyframeSequence(), &rec.rot );
+			if ( anim->isOptimized() )
+			{
+				bakeTrack( baked, anim->positionAnimation(), &rec.pos );
+				bakeTrack( baked, anim->scaleAnimation(), &rec.scl );
+			}
+			else
+			{
+				bakeTrack( baked, anim->positionKeyframeSequence(), &rec.pos );
+				bakeTrack( baked, anim->scaleKeyframeSequence(), &rec.scl );
+			}
+			baked->addAnimation( rec );
+		}
+	}
+
+	// user properties
+	UserPropertySet* userprops = scene->userProperties();
+	if ( userprops != 0 )
+	{
+		for ( HashtableIterator<String,String> it = userprops->begin() ; it != userprops->end() ; ++it )
+		{
+			BakedScene::UserProperty rec;
+			rec.key = baked->addString( it.key().c_str() );
+			rec.node = indexOfNodeName( m_nodes, it.key() );
+			rec.value = baked->addString( it.value().c_str() );
+			baked->addUserProperty( rec );
+		}
+	}
+
+	m_bake = 0;
+	releaseLoadingData();
+	return baked;
+}
+
+int SceneLoader::bakeFile( Context* context, const String& filename,
+	const String& bakedfilename, ResourceManager* res,
+	const String& texturepath, const String& shaderpath, const String& particlepath,
+	int loadflags, bool compress )
+{
+	P(Scene) scene = new Scene;
+	scene->setName( filename );
+
+	FileInputStream fin( filename );
+	P(SceneLoader) loader = new SceneLoader( scene, &fin, context, res, texturepath, shaderpath, particlepath, loadflags | Scene::LOAD_BAKE );
+	loader->finish();
+	P(BakedScene) baked = loader->bake();
+
+	FileOutputStream fout( bakedfilename );
+	int dataflags = SceneInputStream::DATA_BAKED;
+	if ( compress )
+		dataflags |= SceneInputStream::DATA_COMPRESSED;
+	SceneOutputStream out( &fout, dataflags, context->platform(), loader->m_exporterVersion );
+	out.writeBakedScene( baked );
+	out.finish();
+	return baked->header().size;
+}
+
+void SceneLoader::createBakedTexture( int i )
+{
+	const BakedScene::Texture& rec = m_baked->textures()[i];
+	loadTexture( i, m_baked->getString(rec.filename), rec.type );
+}
+
+void SceneLoader::createBakedMaterial( int i )
+{
+	BakedScene* baked = m_baked;
+	const BakedScene::Material& rec = baked->materials()[i];
+	baked->checkRange( rec.firstParam, rec.params, baked->header().params.count );
+
+	P(Shader) fx = m_res->getShader( PathName(m_shaderPath,baked->getString(rec.shader)).toString(), rec.flags );
+	fx->setName( baked->getString(rec.name) );
+
+	for ( int k = 0 ; k < rec.params ; ++k )
+	{
+		const BakedScene::Param& param = baked->params()[rec.firstParam+k];
+		const char* name = baked->getString( param.name );
+		switch ( param.type )
+		{
+		case BakedScene::PARAM_TEXTURE:
+			baked->checkIndex( param.texture, m_textures.size() );
+			fx->setTexture( name, m_textures[param.texture] );
+			break;
+		case BakedScene::PARAM_VECTOR:
+			fx->setVector( name, float4(param.value[0],param.value[1],param.value[2],param.value[3]) );
+			break;
+		case BakedScene::PARAM_FLOAT:
+			fx->setFloat( name, param.value[0] );
+			break;
+		default:
+			throwError( IOException( Format("Failed to load scene \"{0}\". Invalid baked material parameter type ({1}) in \"{2}\"", m_scene->name(), param.type, fx->name()) ) );
+		}
+	}
+
+	m_materials[i] = fx;
+}
+
+void SceneLoader::createBakedPrimitive( int i )
+{
+	BakedScene* baked = m_baked;
+	const BakedScene::Primitive& rec = baked->primitives()[i];
+	baked->checkIndex( rec.material, m_materials.size() );
+	if ( rec.type < 0 || rec.type >= Primitive::PRIM_INVALID )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Primitive type ({1}) invalid", m_scene->name(), rec.type) ) );
+	if ( rec.vertices < 0 || rec.vertices >= 0x10000 || rec.indices < 0 )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid baked primitive vertex/index count ({1}/{2}).", m_scene->name(), rec.vertices, rec.indices) ) );
+	if ( rec.usedBones < 0 || rec.usedBones > Primitive::MAX_BONES )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Too many bones ({1}).", m_scene->name(), rec.usedBones) ) );
+
+	VertexFormat vf;
+	for ( int k = 0 ; k < (int)VertexFormat::DT_SIZE ; ++k )
+	{
+		if ( rec.dataFormat[k] >= VertexFormat::DF_SIZE )
+			throwError( IOException( Format("Failed to load scene \"{0}\". Invalid baked vertex data format ({1}).", m_scene->name(), rec.dataFormat[k]) ) );
+		vf.setDataFormat( (VertexFormat::DataType)k, (VertexFormat::DataFormat)rec.dataFormat[k] );
+	}
+
+	P(Primitive) prim = m_context->createPrimitive( (Primitive::PrimType)rec.type, vf, rec.vertices, rec.indices, Context::USAGE_STATIC );
+	if ( vf != prim->vertexFormat() )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Primitive vertex format ({1}) should be ({2})", m_scene->name(), vf.toString(), prim->vertexFormat().toString()) ) );
+
+	{
+		Primitive::Lock lk( prim, Primitive::LOCK_WRITE );
+		prim->setVertexPositionScaleBias( float4(rec.posScaleBias[0],rec.posScaleBias[1],rec.posScaleBias[2],rec.posScaleBias[3]) );
+		prim->setVertexTextureCoordinateScaleBias( float4(rec.uvScaleBias[0],rec.uvScaleBias[1],rec.uvScaleBias[2],rec.uvScaleBias[3]) );
+
+		// device layout must match the layout the scene was baked with
+		if ( rec.vertices > 0 )
+		{
+			uint8_t* data;
+			int pitch, size;
+			getVertexLayout( prim, &data, &pitch, &size );
+			if ( pitch != rec.vertexSize || size != rec.vertexDataSize )
+				throwError( IOException( Format("Failed to load scene \"{0}\". Baked vertex size ({1}) does not match device vertex size ({2}), scene needs to be baked again.", m_scene->name(), rec.vertexSize, pitch) ) );
+			memcpy( data, baked->getData(rec.vertexData,rec.vertexDataSize), rec.vertexDataSize );
+		}
+
+		if ( rec.indices > 0 )
+		{
+			uint16_t* indexdata = 0;
+			int indexsize = 0;
+			prim->getIndexDataPtr( &indexdata, &indexsize );
+			if ( indexsize != 2 )
+				throwError( IOException( Format("Failed to load scene \"{0}\". Invalid face index size ({1}).", m_scene->name(), indexsize) ) );
+			memcpy( indexdata, baked->getData(rec.indexData,rec.indices*indexsize), rec.indices*indexsize );
+		}
+	}
+
+	prim->setBound( float3(rec.boundMin[0],rec.boundMin[1],rec.boundMin[2]), 
+		float3(rec.boundMax[0],rec.boundMax[1],rec.boundMax[2]), rec.boundRadius );
+	prim->setUsedBones( rec.usedBoneArray, rec.usedBones );
+	prim->setShader( m_materials[rec.material] );
+	if ( m_loadFlags & Scene::LOAD_SHAREDATA )
+		m_res->shareVertexData( prim );
+	m_primitives[i] = prim;
+}
+
+void SceneLoader::createBakedNode( int i )
+{
+	BakedScene* baked = m_baked;
+	const BakedScene::Node& rec = baked->nodes()[i];
+
+	P(Node) node;
+	switch ( rec.classId )
+	{
+	case Node::NODE_MESH:{
+		baked->checkIndex( rec.data, baked->header().meshes.count );
+		const BakedScene::Mesh& mesh = baked->meshes()[rec.data];
+		baked->checkRange( mesh.firstPrimitive, mesh.primitives, baked->header().meshPrimitives.count );
+		baked->checkRange( mesh.firstBone, mesh.bones, baked->header().bones.count );
+
+		P(Mesh) obj = new Mesh;
+		for ( int k = 0 ; k < mesh.primitives ; ++k )
+		{
+			int ix = baked->meshPrimitives()[mesh.firstPrimitive+k];
+			baked->checkIndex( ix, m_primitives.size() );
+			obj->addPrimitive( m_primitives[ix] );
+		}
+		obj->computeBound();
+		node = obj.ptr();
+		break;}
+
+	case Node::NODE_CAMERA:{
+		baked->checkIndex( rec.data, baked->header().cameras.count );
+		const BakedScene::Camera& camera = baked->cameras()[rec.data];
+		P(Camera) obj = new Camera;
+		obj->setFront( camera.front );
+		obj->setBack( camera.back );
+		obj->setVerticalFov( camera.verticalFov );
+		node = obj.ptr();
+		break;}
+
+	case Node::NODE_LIGHT:{
+		baked->checkIndex( rec.data, baked->header().lights.count );
+		const BakedScene::Light& light = baked->lights()[rec.data];
+		if ( light.type <= Light::TYPE_UNKNOWN || light.type >= Light::TYPE_COUNT )
+			throwError( IOException( Format("Failed to load scene \"{0}\". Light type ({1}) invalid in object \"{2}\".", m_scene->name(), light.type, baked->getString(rec.name)) ) );
+		P(Light) obj = new Light;
+		obj->setColor( float3(light.color[0],light.color[1],light.color[2]) );
+		obj->setFarAttenStart( light.farAttenStart );
+		obj->setFarAttenEnd( light.farAttenEnd );
+		obj->setInnerCone( light.innerCone );
+		obj->setOuterCone( light.outerCone );
+		obj->setType( (Light::Type)light.type );
+		node = obj.ptr();
+		break;}
+
+	case Node::NODE_DUMMY:{
+		baked->checkIndex( rec.data, baked->header().dummies.count );
+		const BakedScene::Dummy& dummy = baked->dummies()[rec.data];
+		P(Dummy) obj = new Dummy;
+		obj->setBox( float3(dummy.boxMin[0],dummy.boxMin[1],dummy.boxMin[2]), float3(dummy.boxMax[0],dummy.boxMax[1],dummy.boxMax[2]) );
+		node = obj.ptr();
+		break;}
+
+	case Node::NODE_LINES:{
+		baked->checkIndex( rec.data, baked->header().lines.count );
+		const BakedScene::Lines& lines = baked->lines()[rec.data];
+		baked->checkRange( lines.firstLine, lines.lines, baked->header().linePoints.count );
+		baked->checkRange( lines.firstPath, lines.paths, baked->header().paths.count );
+
+		P(Lines) obj = new Lines( m_context );
+		obj->reserve( lines.lines, lines.paths );
+		for ( int k = 0 ; k < lines.lines ; ++k )
+		{
+			const BakedScene::Line& line = baked->linePoints()[lines.firstLine+k];
+			obj->addLine( float3(line.start[0],line.start[1],line.start[2]), float3(line.end[0],line.end[1],line.end[2]), float4(1,1,1,1) );
+		}
+		for ( int k = 0 ; k < lines.paths ; ++k )
+		{
+			const BakedScene::Path& path = baked->paths()[lines.firstPath+k];
+			obj->addPath( path.begin, path.end );
+		}
+		obj->computeBound();
+		node = obj.ptr();
+		break;}
+
+	case Node::NODE_OTHER:
+		node = new Node;
+		break;
+
+	default:
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid baked node class ({1,x}) in \"{2}\".", m_scene->name(), rec.classId, baked->getString(rec.name)) ) );
+	}
+
+	// flags are set after class specific setup, but class id is kept
+	node->setName( baked->getString(rec.name) );
+	node->setTransform( toFloat3x4(rec.transform) );
+	node->setFlags( (rec.flags & ~Node::NODE_CLASS) | (node->flags() & Node::NODE_CLASS) );
+	node->setID( rec.id );
+	m_nodes[i] = node;
+}
+
+void SceneLoader::createBakedAnimation( int i )
+{
+	BakedScene* baked = m_baked;
+	const BakedScene::Animation& rec = baked->animations()[i];
+	if ( rec.endBehaviour < 0 || rec.endBehaviour >= TransformAnimation::BEHAVIOUR_COUNT )
+		throwError( IOException( Format("Failed to load scene \"{0}\". Invalid transform animation end behaviour ({1}).", m_scene->name(), rec.endBehaviour) ) );
+	TransformAnimation::BehaviourType endbehaviour = (TransformAnimation::BehaviourType)rec.endBehaviour;
+
+	// re-use node name string to save memory
+	String name;
+	if ( rec.node >= 0 )
+	{
+		baked->checkIndex( rec.node, m_nodes.size() );
+		name = m_nodes[rec.node]->name();
+	}
+	else
+	{
+		name = baked->getString( rec.name );
+	}
+
+	P(TransformAnimation) anim;
+	P(KeyframeSequence) rot = createKeyframeSequence( baked, rec.rot );
+	if ( rec.optimized )
+	{
+		P(TransformAnimation::Float3Anim) pos = createFloat3Anim( baked, rec.pos );
+		P(TransformAnimation::Float3Anim) scl = createFloat3Anim( baked, rec.scl );
+		anim = new TransformAnimation( endbehaviour, pos, rot, scl, rec.posKeyRate, rec.rotKeyRate, rec.sclKeyRate, rec.endTime );
+	}
+	else
+	{
+		P(KeyframeSequence) pos = createKeyframeSequence( baked, rec.pos );
+		P(KeyframeSequence) scl = createKeyframeSequence( baked, rec.scl );
+		anim = new TransformAnimation( endbehaviour, pos, rot, scl, rec.posKeyRate, rec.rotKeyRate, rec.sclKeyRate );
+	}
+
+	m_scene->m_transformAnims->put( name, shareAnimation(anim) );
+}
+
+void SceneLoader::createBakedUserProperty( int i )
+{
+	BakedScene* baked = m_baked;
+	const BakedScene::UserProperty& rec = baked->userProperties()[i];
+
+	// re-use node name string to save memory
+	String key;
+	if ( rec.node >= 0 )
+	{
+		baked->checkIndex( rec.node, m_nodes.size() );
+		key = m_nodes[rec.node]->name();
+	}
+	else
+	{
+		key = baked->getString( rec.key );
+	}
+
+	m_scene->m_userProperties->put( key, baked->getString(rec.value) );
+}
+
+void SceneLoader::linkBaked()
+{
+	BakedScene* baked = m_baked;
+	Scene* scene = m_scene;
+
+	// link in file order so that child order matches normally loaded scene
+	for ( int i = 0 ; i < m_nodes.size() ; ++i )
+	{
+		int ix = baked->nodes()[i].parent;
+		if ( ix >= 0 )
+		{
+			baked->checkIndex( ix, m_nodes.size() );
+			m_nodes[i]->linkTo( m_nodes[ix] );
+		}
+		else
+		{
+			m_nodes[i]->linkTo( scene );
+		}
+	}
+
+	// connect bones and lights with pre-computed indices
+	for ( int i = 0 ; i < m_nodes.size() ; ++i )
+	{
+		const BakedScene::Node& rec = baked->nodes()[i];
+		if ( rec.classId != Node::NODE_MESH )
+			continue;
+
+		Mesh* mesh = static_cast<Mesh*>( m_nodes[i].ptr() );
+		const BakedScene::Mesh& meshrec = baked->meshes()[rec.data];
+		for ( int k = 0 ; k < meshrec.bones ; ++k )
+		{
+			const BakedScene::Bone& bone = baked->bones()[meshrec.firstBone+k];
+			baked->checkIndex( bone.node, m_nodes.size() );
+			mesh->addBone( m_nodes[bone.node], toFloat3x4(bone.invRestTransform) );
+		}
+		if ( meshrec.bones > 0 )
+			mesh->computeBoneBounds();
+
+		if ( meshrec.light >= 0 )
+		{
+			baked->checkIndex( meshrec.light, m_nodes.size() );
+			Node* light = m_nodes[meshrec.light];
+			if ( light->classId() != Node::NODE_LIGHT )
+				throwError( IOException( Format("Failed to load scene \"{0}\". Invalid light index ({1}) in \"{2}\".", scene->name(), meshrec.light, mesh->name()) ) );
+			mesh->addLight( static_cast<Light*>(light) );
+		}
+	}
+
+	linkUserProperties();
+	releaseLoadingData();
+}
+
+void SceneLoader::readId()
+{
+	int was = m_in->readInt();
+	if ( m_checkId != was )
+		throwError( IOException(Format("Failed to load scene file \"{0}\", check id was {1,x} but should be {2,x}", m_in->toString(), was, m_checkId)) );
+	++m_checkId;
+}
+
+void SceneLoader::readNode( Node* node )
+{
+	int parentindex;
+	m_in->readNode( node, &parentindex );
+
+	m_nodeNames.add( node->name() );
+	m_nodeParents.add( parentindex );
+	m_nodes.add( node );
+}
+
+
+END_NAMESPACE() // hgr
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
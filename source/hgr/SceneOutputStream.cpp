@@ -1,9 +1,11 @@
 #include <hgr/SceneOutputStream.h>
+#include <hgr/SceneInputStream.h>
 #include <gr/Context.h>
 #include <gr/Primitive.h>
 #include <gr/VertexFormat.h>
 #include <io/IOException.h>
 #include <hgr/Mesh.h>
+#include <hgr/BakedScene.h>
 #include <hgr/Lines.h>
 #include <hgr/Light.h>
 #include <hgr/Dummy.h>
@@ -26,7 +28,7 @@ USING_NAMESPACE(math)
 BEGIN_NAMESPACE(hgr) 
 
 
-const int SceneOutputStream::VERSION = 193;
+const int SceneOutputStream::VERSION = 195;
 
 
 SceneOutputStream::SceneOutputStream( OutputStream* out, int dataflags, NS(gr,Context)::PlatformType platformid, int exporterversion ) :
@@ -38,6 +40,12 @@ SceneOutputStream::SceneOutputStream( OutputStream* out, int dataflags, NS(gr,Co
 	writeInt( exporterversion );
 	writeShort( dataflags );
 	writeShort( platformid );
+
+	if ( dataflags & SceneInputStream::DATA_COMPRESSED )
+	{
+		m_deflate = new DeflateOutputStream( out );
+		setTarget( m_deflate );
+	}
 }
 
 SceneOutputStream::~SceneOutputStream()
@@ -416,6 +424,20 @@ void SceneOutputStream::writeUserPropertySet( UserPropertySet* obj )
 	}
 }
 
+void SceneOutputStream::writeBakedScene( BakedScene* obj )
+{
+	assert( hasData(SceneInputStream::DATA_BAKED) );
+
+	writeInt( obj->layout() );
+	obj->write( this );
+}
+
+void SceneOutputStream::finish()
+{
+	if ( m_deflate )
+		m_deflate->finish();
+}
+
 bool SceneOutputStream::hasData( int flags ) const
 {
 	return 0 != (m_dataFlags & flags);
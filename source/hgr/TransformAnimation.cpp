@@ -626,7 +626,7 @@ void TransformAnimation::eval( float time, float3* pos, quaternion* rot, float3*
 	quaternion rotq2 = getRotationKey( frames[2] );
 	if ( rotq1.dot(rotq2) < 0.f )
 		rotq2 = -rotq2;
-	*rot = rotq1.slerp( u, rotq2 ).normalize();
+	*rot = rotq1.fastSlerp( u, rotq2 );
 
 	// scale
 	if ( scaleKeys() > 0 )
@@ -110,7 +110,7 @@ void TransformAnimationSet::blend( TransformAnimationSet** animlist, const float
 		{
 			if ( blendrot.dot(rot) < 0.f )
 				rot = -rot;
-			blendrot = blendrot.slerp( weight/sumweight, rot );
+			blendrot = blendrot.fastSlerp( weight/sumweight, rot );
 		}
 	}
 
@@ -0,0 +1,390 @@
+#include <hgr/all.h>
+#include <gr/Context.h>
+#include <gr/Primitive.h>
+#include <gr/Shader.h>
+#include <io/all.h>
+#include <lang/all.h>
+#include <math/float4.h>
+#include <math/float3x4.h>
+#include <math/quaternion.h>
+#include <math/Random.h>
+#include <math/IntersectionUtil.h>
+#include <stdio.h>
+#include <config.h>
+
+
+USING_NAMESPACE(gr)
+USING_NAMESPACE(io)
+USING_NAMESPACE(lang)
+USING_NAMESPACE(math)
+
+
+BEGIN_NAMESPACE(hgr)
+
+
+/** Returns vertex positions and indices of a primitive. */
+static void getPrimitiveData( Primitive* prim, Array<float4>& verts, Array<int>& indices )
+{
+	Primitive::Lock lk( prim, Primitive::LOCK_READ );
+	verts.resize( prim->vertices() );
+	if ( verts.size() > 0 )
+		prim->getVertexPositions( 0, verts.begin(), verts.size() );
+	indices.resize( prim->indices() );
+	if ( indices.size() > 0 )
+		prim->getIndices( 0, indices.begin(), indices.size() );
+}
+
+/** Checks that two scenes have the same nodes, meshes and materials. Scene names are not compared. */
+static void compareScenes( Scene* a, Scene* b )
+{
+	Array<float4> va, vb;
+	Array<int> ia, ib;
+
+	Node* nb = b;
+	for ( Node* na = a ; na != 0 ; na = na->next(a) )
+	{
+		assert( nb != 0 );
+		assert( na == a || na->name() == nb->name() );
+		assert( na->classId() == nb->classId() );
+		assert( na->transform() == nb->transform() );
+
+		if ( Node::NODE_MESH == na->classId() )
+		{
+			Mesh* ma = static_cast<Mesh*>( na );
+			Mesh* mb = static_cast<Mesh*>( nb );
+			assert( ma->primitives() == mb->primitives() );
+			assert( ma->bones() == mb->bones() );
+
+			for ( int i = 0 ; i < ma->primitives() ; ++i )
+			{
+				Primitive* pa = ma->getPrimitive(i);
+				Primitive* pb = mb->getPrimitive(i);
+				assert( pa->type() == pb->type() );
+				assert( pa->shader()->name() == pb->shader()->name() );
+
+				getPrimitiveData( pa, va, ia );
+				getPrimitiveData( pb, vb, ib );
+				assert( va.size() == vb.size() && ia.size() == ib.size() );
+				for ( int k = 0 ; k < va.size() ; ++k )
+					assert( va[k] == vb[k] );
+				for ( int k = 0 ; k < ia.size() ; ++k )
+					assert( ia[k] == ib[k] );
+			}
+		}
+
+		nb = nb->next(b);
+	}
+	assert( nb == 0 );
+}
+
+static void testSceneLoader( Context* context, const String& datapath )
+{
+	// load all scenes at the same time with shared pool and compare to scenes loaded in calling thread
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	Array<String> filenames;
+	for ( FindFile ff(PathName(datapath,"*.hgr").toString()) ; ff.more() ; ff.next() )
+		filenames.add( ff.data().path.toString() );
+
+	int time = System::currentTimeMillis();
+	Array<P(Scene)> serial;
+	for ( int i = 0 ; i < filenames.size() ; ++i )
+		serial.add( new Scene(context,filenames[i]) );
+	int serialtime = System::currentTimeMillis() - time;
+
+	time = System::currentTimeMillis();
+	ThreadPool pool;
+	Array<P(SceneLoader)> loaders;
+	for ( int i = 0 ; i < filenames.size() ; ++i )
+		loaders.add( new SceneLoader(&pool,context,filenames[i]) );
+	for ( int done = 0 ; done < loaders.size() ; )
+	{
+		done = 0;
+		for ( int i = 0 ; i < loaders.size() ; ++i )
+			done += loaders[i]->update(10) ? 1 : 0;
+	}
+	int pooltime = System::currentTimeMillis() - time;
+
+	for ( int i = 0 ; i < loaders.size() ; ++i )
+		compareScenes( serial[i], loaders[i]->scene() );
+	loaders.clear();
+
+	Debug::printf( "hgr: Loaded %d scenes in %d ms serially, in %d ms with SceneLoader (%d threads)\n",
+		filenames.size(), serialtime, pooltime, pool.threads() );
+#endif
+}
+
+static void testBakedScenes( Context* context, const String& datapath )
+{
+	// bake scenes and check that baked scenes load to the same as the originals
+	int times[2] = {0,0};
+	int bytes = 0;
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	const String tempname = PathName(datapath,"hgrtest.tmp").toString();
+	for ( FindFile ff(PathName(datapath,"*.hgr").toString()) ; ff.more() ; ff.next() )
+	{
+		String filename = ff.data().path.toString();
+		bytes += SceneLoader::bakeFile( context, filename, tempname );
+
+		int time = System::currentTimeMillis();
+		P(Scene) scene = new Scene( context, filename );
+		times[0] += System::currentTimeMillis() - time;
+
+		time = System::currentTimeMillis();
+		P(Scene) baked = new Scene( context, tempname );
+		times[1] += System::currentTimeMillis() - time;
+
+		compareScenes( scene, baked );
+	}
+	remove( tempname.c_str() );
+#endif
+
+	Debug::printf( "hgr: Loaded scenes in %d ms, baked scenes (%d KB) in %d ms\n",
+		times[0], bytes>>10, times[1] );
+}
+
+/** Returns point on triangle closest to p. */
+static float3 getClosestPointOnTriangle( const float3& p, const float3& a, const float3& b, const float3& c )
+{
+	const float3 ab = b - a;
+	const float3 ac = c - a;
+	const float3 ap = p - a;
+	const float d1 = dot( ab, ap );
+	const float d2 = dot( ac, ap );
+	if ( d1 <= 0.f && d2 <= 0.f )
+		return a;
+
+	const float3 bp = p - b;
+	const float d3 = dot( ab, bp );
+	const float d4 = dot( ac, bp );
+	if ( d3 >= 0.f && d4 <= d3 )
+		return b;
+
+	const float vc = d1*d4 - d3*d2;
+	if ( vc <= 0.f && d1 >= 0.f && d3 <= 0.f )
+		return a + ab * (d1 / (d1-d3));
+
+	const float3 cp = p - c;
+	const float d5 = dot( ab, cp );
+	const float d6 = dot( ac, cp );
+	if ( d6 >= 0.f && d5 <= d6 )
+		return c;
+
+	const float vb = d5*d2 - d1*d6;
+	if ( vb <= 0.f && d2 >= 0.f && d6 <= 0.f )
+		return a + ac * (d2 / (d2-d6));
+
+	const float va = d3*d6 - d5*d4;
+	if ( va <= 0.f && d4-d3 >= 0.f && d5-d6 >= 0.f )
+		return b + (c-b) * ((d4-d3) / ((d4-d3)+(d5-d6)));
+
+	const float denom = 1.f / (va+vb+vc);
+	return a + ab*(vb*denom) + ac*(vc*denom);
+}
+
+/** Finds the closest ray hit by testing all world space triangles. Returns index of the triangle or -1. */
+static int castRayBruteForce( const Array<float3>& verts, const RayCaster::Ray& ray, float* t )
+{
+	int hit = -1;
+	*t = ray.maxDist;
+	for ( int i = 0 ; i < verts.size() ; i += 3 )
+	{
+		float u;
+		if ( IntersectionUtil::findRayTriangleIntersection(ray.orig,ray.dir,verts[i],verts[i+1],verts[i+2],&u) && u < *t )
+		{
+			*t = u;
+			hit = i/3;
+		}
+	}
+	return hit;
+}
+
+/** Checks RayCaster queries against tests of all world space triangles. */
+static void checkRayCaster( const RayCaster& caster, const Array<float3>& verts, int tricount,
+	const Array<RayCaster::Ray>& rays, ThreadPool* pool )
+{
+	const int raycount = rays.size();
+	Array<int> bruteindex( raycount );
+	Array<float> brutet( raycount );
+	for ( int i = 0 ; i < raycount ; ++i )
+		bruteindex[i] = castRayBruteForce( verts, rays[i], &brutet[i] );
+
+	// hit of world space triangle soup index, ties of equally distant triangles are not errors
+	#define HGR_CHECK_HIT( HITFOUND, HIT, I ) \
+		if ( (HITFOUND) != (bruteindex[I] >= 0) || \
+			((HITFOUND) && (HIT).instance*tricount+(HIT).triangle != bruteindex[I] && Math::abs((HIT).t-brutet[I]) > 1e-5f) || \
+			((HITFOUND) && Math::abs((HIT).t-brutet[I]) > 1e-3f) ) \
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+	Array<RayCaster::Hit> hits( raycount );
+	Array<RayCaster::Hit> poolhits( raycount );
+	int hitcount = caster.castRays( rays.begin(), hits.begin(), raycount );
+	int poolhitcount = caster.castRays( rays.begin(), poolhits.begin(), raycount, pool );
+	if ( hitcount != poolhitcount || 0 == hitcount || hitcount == raycount )
+		throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+	for ( int i = 0 ; i < raycount ; ++i )
+	{
+		const RayCaster::Ray& ray = rays[i];
+		HGR_CHECK_HIT( hits[i].instance >= 0, hits[i], i );
+		HGR_CHECK_HIT( poolhits[i].instance >= 0, poolhits[i], i );
+
+		RayCaster::Hit hit;
+		bool found = caster.castRay( ray.orig, ray.dir, ray.maxDist, &hit );
+		HGR_CHECK_HIT( found, hit, i );
+
+		found = caster.testSegment( ray.orig, ray.orig+ray.dir*ray.maxDist );
+		if ( found != (bruteindex[i] >= 0) )
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+	}
+
+	#undef HGR_CHECK_HIT
+
+	// sphere casts: sphere touches hit triangle at hit distance, 
+	// samples along the path before it do not touch any triangle,
+	// and ray hit can not be before sphere hit
+	const float radius = .3f;
+	for ( int i = 0 ; i < raycount ; i += 8 )
+	{
+		const RayCaster::Ray& ray = rays[i];
+		RayCaster::Hit hit;
+		const bool found = caster.castSphere( ray.orig, ray.dir, radius, ray.maxDist, &hit );
+		const float pathlen = ray.dir.length() * hit.t;
+		if ( found )
+		{
+			const float3* v = &verts[ (hit.instance*tricount+hit.triangle)*3 ];
+			const float3 center = ray.orig + ray.dir*hit.t;
+			const float dist = (center - getClosestPointOnTriangle(center,v[0],v[1],v[2])).length();
+			if ( dist > radius+1e-3f || (hit.t > 0.f && dist < radius-1e-3f) || (center-hit.point).length() > radius+1e-3f )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		}
+		if ( bruteindex[i] >= 0 && (!found || hit.t > brutet[i]+1e-4f) )
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+		const float3 end = ray.orig + ray.dir*hit.t;
+		for ( int k = 0 ; k < verts.size() ; k += 3 )
+		{
+			// skip triangles which are far from the path
+			const float3 tricenter = (verts[k] + verts[k+1] + verts[k+2]) * (1.f/3.f);
+			const float trir = Math::max( (verts[k]-tricenter).length(), Math::max((verts[k+1]-tricenter).length(),(verts[k+2]-tricenter).length()) );
+			const float3 closest = getClosestPointOnTriangle( tricenter, ray.orig, end, end ); // path as degenerate triangle
+			if ( (closest-tricenter).length() > trir + radius )
+				continue;
+
+			const int samples = int( pathlen / (radius*.5f) );
+			for ( int n = 0 ; n < samples ; ++n )
+			{
+				const float3 center = ray.orig + (end-ray.orig) * (float(n)/float(samples));
+				if ( (center - getClosestPointOnTriangle(center,verts[k],verts[k+1],verts[k+2])).length() < radius-1e-3f )
+					throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+			}
+		}
+	}
+}
+
+static void testRayCaster()
+{
+	// random triangle soups with different transforms
+	Random rng( 7 );
+	const int tricount = 2000;
+	const int instances = 3;
+	Array<float3> modelverts( tricount*3 );
+	for ( int i = 0 ; i < tricount ; ++i )
+	{
+		const float3 center( rng.nextFloat(-10,10), rng.nextFloat(-10,10), rng.nextFloat(-10,10) );
+		for ( int k = 0 ; k < 3 ; ++k )
+			modelverts[i*3+k] = center + float3( rng.nextFloat(-.5f,.5f), rng.nextFloat(-.5f,.5f), rng.nextFloat(-.5f,.5f) );
+	}
+
+	RayCaster caster;
+	float3x4 tms[instances];
+	for ( int i = 0 ; i < instances ; ++i )
+	{
+		tms[i] = float3x4( quaternion(float3(0,1,0),float(i)), float3(float(i)*25.f,0,0), float3(1,1.f+float(i)*.5f,1) );
+		if ( caster.addTriangles(modelverts.begin(),tricount,tms[i]) != i )
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+	}
+	caster.update();
+	if ( caster.instances() != instances || caster.triangles() != instances*tricount )
+		throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+	const int raycount = 1000;
+	Array<RayCaster::Ray> rays( raycount );
+	for ( int i = 0 ; i < raycount ; ++i )
+	{
+		RayCaster::Ray& ray = rays[i];
+		ray.orig = float3( rng.nextFloat(-20,70), rng.nextFloat(-20,20), -30.f );
+		ray.dir = float3( rng.nextFloat(-.3f,.3f), rng.nextFloat(-.3f,.3f), 1.f );
+		ray.maxDist = 60.f;
+	}
+
+	// check before and after refitting moved instances
+	ThreadPool pool;
+	Array<float3> verts( instances*tricount*3 );
+	for ( int pass = 0 ; pass < 2 ; ++pass )
+	{
+		if ( pass > 0 )
+		{
+			for ( int i = 0 ; i < instances ; ++i )
+			{
+				tms[i] = float3x4( quaternion(normalize(float3(1,1,0)),float(i)+.5f), float3(float(i)*20.f,float(i)*5.f-5.f,3.f), float3(1,1,1) );
+				caster.setTransform( i, tms[i] );
+			}
+			caster.refit();
+		}
+
+		for ( int i = 0 ; i < instances ; ++i )
+			for ( int k = 0 ; k < tricount*3 ; ++k )
+				verts[i*tricount*3+k] = tms[i].transform( modelverts[k] );
+
+		checkRayCaster( caster, verts, tricount, rays, &pool );
+	}
+
+	// rays per second
+	const int rounds = 100;
+	Array<RayCaster::Hit> hits( raycount );
+	int time = System::currentTimeMillis();
+	for ( int i = 0 ; i < rounds ; ++i )
+		caster.castRays( rays.begin(), hits.begin(), raycount );
+	int casttime = System::currentTimeMillis() - time;
+
+	time = System::currentTimeMillis();
+	for ( int i = 0 ; i < rounds ; ++i )
+		caster.castRays( rays.begin(), hits.begin(), raycount, &pool );
+	int pooltime = System::currentTimeMillis() - time;
+
+	time = System::currentTimeMillis();
+	float t;
+	for ( int i = 0 ; i < raycount ; ++i )
+		castRayBruteForce( verts, rays[i], &t );
+	int brutetime = System::currentTimeMillis() - time;
+
+	Debug::printf( "hgr: %d triangles, %d rays/s, %d rays/s with %d threads, %d rays/s without tree\n",
+		verts.size()/3, int(rounds*raycount*1000.0/Math::max(casttime,1)), int(rounds*raycount*1000.0/Math::max(pooltime,1)), 
+		pool.threads(), int(raycount*1000.0/Math::max(brutetime,1)) );
+}
+
+static void run( Context* context, const String& datapath )
+{
+	testRayCaster();
+	if ( context != 0 )
+	{
+		testSceneLoader( context, datapath );
+		testBakedScenes( context, datapath );
+	}
+}
+
+void test( Context* context, const String& datapath )
+{
+	String libname = "hgr";
+
+	Debug::printf( "\n-------------------------------------------------------------------------\n" );
+	Debug::printf( (libname + " library test begin").c_str() );
+	Debug::printf( "\n-------------------------------------------------------------------------\n" );
+	run( context, datapath );
+	Debug::printf( (libname + " library test ok\n").c_str() );
+}
+
+
+END_NAMESPACE() // hgr
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
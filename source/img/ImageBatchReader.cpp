@@ -0,0 +1,229 @@
+#include <img/ImageBatchReader.h>
+#include <img/ImageReader.h>
+#include <io/PathName.h>
+#include <io/FileInputStream.h>
+#include <io/ByteArrayInputStream.h>
+#include <lang/ThreadPool.h>
+#include <lang/Throwable.h>
+#include <string.h>
+#include <config.h>
+
+
+USING_NAMESPACE(gr)
+USING_NAMESPACE(io)
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(img)
+
+
+/**
+ * Decodes single image file in worker thread.
+ * Strings cannot be passed between threads so input and
+ * output of the job are plain character data.
+ */
+class ImageBatchReader::DecodeJob :
+	public ThreadPool::Job
+{
+public:
+	ImageBatchReader*	reader;
+	int					index;
+	char				filename[PathName::MAXLEN];
+	char				error[256];
+	SurfaceFormat		format;
+	int					mipLevels;
+	bool				cubeMap;
+	Array<Surface>		surfaces;
+	int					bytes;
+
+	void run()
+	{
+		error[0] = 0;
+		surfaces.clear();
+		mipLevels = 1;
+		cubeMap = false;
+		bytes = 0;
+
+		try
+		{
+			// read whole file at once
+			FileInputStream in( filename );
+			Array<uint8_t> data( in.available() );
+			if ( data.size() > 0 )
+				in.read( data.begin(), data.size() );
+			ByteArrayInputStream bytein( data.begin(), data.size() );
+
+			ImageReader rd( &bytein, ImageReader::guessFileFormat(filename) );
+			mipLevels = rd.mipLevels();
+			cubeMap = rd.cubeMap();
+			surfaces.resize( rd.surfaces() > 0 ? rd.surfaces() : 1 );
+			for ( int i = 0 ; i < surfaces.size() ; ++i )
+			{
+				Surface& s = surfaces[i];
+				s.width = rd.surfaceWidth();
+				s.height = rd.surfaceHeight();
+				s.pitch = format.getMemoryUsage( s.width, 1 );
+				s.data.resize( format.getMemoryUsage(s.width,s.height) );
+				rd.readSurface( s.data.begin(), s.pitch, s.width, s.height, format, 0, SurfaceFormat() );
+				bytes += s.data.size();
+			}
+		}
+		catch ( Throwable& e )
+		{
+			e.getMessage().format( error, sizeof(error) );
+			surfaces.clear();
+			bytes = 0;
+		}
+
+		reader->finishJob( this );
+	}
+};
+
+
+ImageBatchReader::Result::Result() :
+	index( 0 ),
+	mipLevels( 1 ),
+	cubeMap( false )
+{
+}
+
+int ImageBatchReader::Result::bytes() const
+{
+	int size = 0;
+	for ( int i = 0 ; i < surfaces.size() ; ++i )
+		size += surfaces[i].data.size();
+	return size;
+}
+
+ImageBatchReader::ImageBatchReader( ThreadPool* pool, SurfaceFormat format, int maxbytes, int maxjobs ) :
+	m_pool( pool ),
+	m_format( format ),
+	m_maxBytes( maxbytes ),
+	m_nextFile( 0 ),
+	m_running( 0 ),
+	m_bufferedBytes( 0 ),
+	m_returned( 0 ),
+	m_completedEvent( false, false )
+{
+	assert( pool != 0 );
+	assert( !format.compressed() && !format.palettized() );
+
+	if ( maxjobs <= 0 )
+		maxjobs = pool->threads() + 1;
+
+	for ( int i = 0 ; i < maxjobs ; ++i )
+	{
+		DecodeJob* job = new DecodeJob;
+		job->reader = this;
+		job->format = m_format;
+		m_jobs.add( job );
+		m_freeJobs.add( job );
+	}
+}
+
+ImageBatchReader::~ImageBatchReader()
+{
+	// wait for running jobs
+	m_pool->wait( &m_batch );
+
+	for ( int i = 0 ; i < m_jobs.size() ; ++i )
+		delete m_jobs[i];
+}
+
+void ImageBatchReader::add( const String& filename )
+{
+	Mutex::Lock lk( m_mutex );
+	m_files.add( filename );
+}
+
+P(ImageBatchReader::Result) ImageBatchReader::next()
+{
+	for (;;)
+	{
+		startJobs();
+
+		m_mutex.lock();
+		if ( m_completed.size() > 0 )
+		{
+			// pass decoded data to result object in calling thread
+			DecodeJob* job = m_completed[0];
+			m_completed.remove( 0 );
+			m_bufferedBytes -= job->bytes;
+			m_returned += 1;
+
+			P(Result) res = new Result;
+			res->filename = m_files[job->index];
+			res->index = job->index;
+			res->format = job->format;
+			res->mipLevels = job->mipLevels;
+			res->cubeMap = job->cubeMap;
+			res->surfaces.swap( job->surfaces );
+			res->error = job->error;
+
+			m_freeJobs.add( job );
+			m_mutex.unlock();
+			return res;
+		}
+
+		bool done = m_running == 0 && m_nextFile >= m_files.size();
+		m_mutex.unlock();
+		if ( done )
+			return 0;
+
+		// wait for next completed job
+		if ( m_pool->threads() == 0 )
+			m_pool->wait( &m_batch );
+		else
+			m_completedEvent.wait();
+	}
+}
+
+void ImageBatchReader::startJobs()
+{
+	Array<DecodeJob*> started;
+
+	m_mutex.lock();
+	while ( m_nextFile < m_files.size() &&
+		m_freeJobs.size() > 0 &&
+		(m_bufferedBytes < m_maxBytes || (m_running == 0 && m_completed.size() == 0)) )
+	{
+		DecodeJob* job = m_freeJobs.last();
+		m_freeJobs.resize( m_freeJobs.size()-1 );
+		job->index = m_nextFile++;
+		m_files[job->index].get( job->filename, sizeof(job->filename) );
+		started.add( job );
+		++m_running;
+	}
+	m_mutex.unlock();
+
+	for ( int i = 0 ; i < started.size() ; ++i )
+		m_pool->add( started[i], &m_batch );
+}
+
+void ImageBatchReader::finishJob( DecodeJob* job )
+{
+	m_mutex.lock();
+	m_completed.add( job );
+	m_bufferedBytes += job->bytes;
+	--m_running;
+	m_mutex.unlock();
+
+	m_completedEvent.set();
+}
+
+int ImageBatchReader::remaining() const
+{
+	Mutex::Lock lk( m_mutex );
+	return m_files.size() - m_returned;
+}
+
+int ImageBatchReader::bufferedBytes() const
+{
+	Mutex::Lock lk( m_mutex );
+	return m_bufferedBytes;
+}
+
+
+END_NAMESPACE() // img
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -92,6 +92,17 @@ void ImageReader::readSurface( void* bits, int pitch, int w, int h, SurfaceForma
 	switch ( m_filefmt )
 	{
 	case FILEFORMAT_NTX:
+		readScanlines( bits, pitch, w, h, fmt, pal, palfmt );
+
+		// iterate to next mipmap level
+		if ( ++m_surfaceIndex < m_surfaces )
+		{
+			m_width = m_width > 1 ? m_width>>1 : 1;
+			m_height = m_height > 1 ? m_height>>1 : 1;
+			m_pitch = m_width * (m_fmt.bitsPerPixel()>>3);
+		}
+		break;
+
 	case FILEFORMAT_BMP:
 	case FILEFORMAT_TGA:
 		readScanlines( bits, pitch, w, h, fmt, pal, palfmt );
@@ -236,6 +247,24 @@ void ImageReader::readScanlines( void* bits, int pitch, int w, int h, SurfaceFor
 	// optimized loading (of NTX files)
 	if ( m_filefmt == FILEFORMAT_NTX )
 	{
+		if ( m_fmt.compressed() )
+		{
+			// rows of 4x4 blocks, decompressed if needed
+			const int rowbytes = m_fmt.getMemoryUsage( w, 1 );
+			if ( fmt == m_fmt )
+			{
+				for ( int j = 0 ; j < h ; j += 4 )
+					readFully( m_in, (uint8_t*)bits + (j>>2)*pitch, rowbytes );
+			}
+			else
+			{
+				Array<uint8_t> data( m_fmt.getMemoryUsage(w,h) );
+				readFully( m_in, data.begin(), data.size() );
+				fmt.copyPixels( bits, pitch, palfmt, pal, m_fmt, data.begin(), rowbytes, SurfaceFormat(), 0, w, h );
+			}
+			return;
+		}
+
 		if ( fmt == m_fmt && palfmt == SurfaceFormat::SURFACE_UNKNOWN && pitch == w*(m_fmt.bitsPerPixel()>>3) )
 		{
 			int bytesperpixel = (m_fmt.bitsPerPixel()>>3);
@@ -363,8 +392,9 @@ void ImageReader::readHeader_ntx()
 	NTXHeader header;
 	readFully( m_in, &header, sizeof(NTXHeader) );
 
-	const int VERSION = 0x103;
-	if ( header.version != VERSION )
+	const int MIN_VERSION = 0x103;
+	const int VERSION = 0x105;
+	if ( header.version < MIN_VERSION || header.version > VERSION )
 		throwError( IOException( Format("NTX file {0} has incorrect version ({1}, expected {2}", m_in->toString(), (int)header.version, VERSION) ) );
 
 	m_width = header.width;
@@ -373,6 +403,15 @@ void ImageReader::readHeader_ntx()
 	m_palfmt = SurfaceFormat();
 	m_colorKeyEnabled = (header.flags & NTXHeader::FLAG_COLORKEY) != 0;
 
+	m_mipLevels = 1;
+	if ( header.flags & NTXHeader::FLAG_MIPMAPS )
+	{
+		uint8_t levels[2];
+		readFully( m_in, levels, sizeof(levels) );
+		m_mipLevels = getUInt16LE( levels, 0 );
+	}
+	m_surfaces = m_mipLevels;
+
 	if ( header.palettesize > 0 )
 	{
 		m_palfmt = m_fmt;
@@ -3,6 +3,7 @@
 #include <img/ImageReader.h>
 #include <io/InputStream.h>
 #include <io/IOException.h>
+#include <lang/Mutex.h>
 #include <string.h>
 #include <stdint.h>
 #include "il/il.h"
@@ -17,8 +18,20 @@ USING_NAMESPACE(lang)
 BEGIN_NAMESPACE(img) 
 
 
+/** DevIL has global state so images are loaded one at a time. */
+static Mutex s_ilMutex;
+
+
 void ImageReader::readHeader_il()
 {
+	// read image file
+	Array<char> lump;
+	lump.resize( m_in->available() );
+	if ( lump.size() != m_in->read( &lump[0], lump.size() ) )
+		throwError( IOException(Format("Failed to load image \"{0}\"", m_in->toString())) );
+
+	s_ilMutex.lock();
+
 	// init
 	ilInit();
     ilEnable( IL_ORIGIN_SET );
@@ -27,11 +40,6 @@ void ImageReader::readHeader_il()
 	ilGenImages( 1, &img );
 	ilBindImage( img );
 
-	// read image file
-	Array<char> lump;
-	lump.resize( m_in->available() );
-	if ( lump.size() != m_in->read( &lump[0], lump.size() ) )
-		throwError( IOException(Format("Failed to load image \"{0}\"", m_in->toString())) );
 	bool ok = ilLoadL( IL_TYPE_UNKNOWN, &lump[0], lump.size() ) != 0;
 	if ( ok )
 	{
@@ -83,6 +91,8 @@ void ImageReader::readHeader_il()
 	ilDeleteImages( 1, &img );
 	ilShutDown();
 
+	s_ilMutex.unlock();
+
 	// error occured?
 	if ( err != 0 )
 		throwError( IOException(Format("Failed to load image \"{0}\" (err={1})", m_in->toString(), err)) );
@@ -14,9 +14,11 @@
 #include <config.h>
 
 
-#define FILE_VERSION 0x103
+#define FILE_VERSION 0x105
 /*
 changes:
+- 0x105: DXT1/DXT3/DXT5 block compressed pixel data
+- 0x104: optional mipmap levels
 - 0x103: color key fix
 - 0x102: fixed palette size
 - 0x101: fixed pixel data writing bug
@@ -33,33 +35,57 @@ BEGIN_NAMESPACE(img)
 
 int ImageWriter::writeNTX( const String& filename, const void* bits, int w, int h, int pitch,
 	SurfaceFormat format, int flags, int userflags )
+{
+	return writeNTX( filename, &bits, &pitch, 1, w, h, format, flags, userflags );
+}
+
+int ImageWriter::writeNTX( const String& filename, const void* const* levelbits, const int* levelpitches, int levels,
+	int w, int h, SurfaceFormat format, int flags, int userflags )
 {
 	assert( flags >= 0 && flags < 0x10000 );
 	assert( userflags >= 0 && userflags < 0x10000 );
+	assert( levels >= 1 && levels < 0x10000 );
 
 	ByteArrayOutputStream byteout;
 	FilterOutputStream out( &byteout );
 
+	flags &= ~ImageReader::NTXHeader::FLAG_MIPMAPS;
+	if ( levels > 1 )
+		flags |= ImageReader::NTXHeader::FLAG_MIPMAPS;
+
 	// find unique pal
+	const void* bits = levelbits[0];
+	int pitch = levelpitches[0];
 	int bytesperpixel = format.bitsPerPixel()/8;
-	int pixels = w*h;
-	Array<uint32_t> pal( pixels );
-	for ( int j = 0 ; j < h ; ++j )
+	Array<uint32_t> pal;
+	if ( levels == 1 && !format.compressed() )
 	{
-		for ( int i = 0 ; i < w ; ++i )
+		int pixels = w*h;
+		pal.resize( pixels );
+		for ( int j = 0 ; j < h ; ++j )
 		{
-			const uint8_t* s = (const uint8_t*)bits + i*bytesperpixel + j*pitch;
-			pal[j*w+i] = getBytesLE( s, bytesperpixel );
+			for ( int i = 0 ; i < w ; ++i )
+			{
+				const uint8_t* s = (const uint8_t*)bits + i*bytesperpixel + j*pitch;
+				pal[j*w+i] = getBytesLE( s, bytesperpixel );
+			}
 		}
+		LANG_SORT( pal.begin(), pal.end() );
+		pal.resize( lang::unique(pal.begin(),pal.end()) - pal.begin() );
+
+		// calculate optimal needed storage size
+		int size1 = w * h * bytesperpixel;
+		int size2 = w * h + pal.size()*bytesperpixel;
+		if ( size2 >= size1 || pal.size() > 256 )
+			pal.resize( 0 );
 	}
-	LANG_SORT( pal.begin(), pal.end() );
-	pal.resize( lang::unique(pal.begin(),pal.end()) - pal.begin() );
 
-	// calculate optimal needed storage size
-	int size1 = w * h * bytesperpixel;
-	int size2 = w * h + pal.size()*bytesperpixel;
-	if ( size2 >= size1 || pal.size() > 256 )
-		pal.resize( 0 );
+	// write mipmap level count
+	if ( levels > 1 )
+	{
+		uint16_t levels16 = (uint16_t)levels;
+		out.write( &levels16, sizeof(levels16) );
+	}
 
 	// write pal
 	if ( pal.size() > 0 )
@@ -73,33 +99,58 @@ int ImageWriter::writeNTX( const String& filename, const void* bits, int w, int
 	}
 
 	// write pixel data
-	for ( int j = 0 ; j < h ; ++j )
+	int levelw = w;
+	int levelh = h;
+	for ( int level = 0 ; level < levels ; ++level )
 	{
-		for ( int i = 0 ; i < w ; ++i )
+		bits = levelbits[level];
+		pitch = levelpitches[level];
+
+		// compressed data is written as rows of 4x4 blocks
+		if ( format.compressed() )
 		{
-			const uint8_t* s = (const uint8_t*)bits + i*bytesperpixel + j*pitch;
-			uint32_t d = getBytesLE( s, bytesperpixel );
+			const int rowbytes = format.getMemoryUsage( levelw, 1 );
+			for ( int j = 0 ; j < levelh ; j += 4 )
+				out.write( (const uint8_t*)bits + (j>>2)*pitch, rowbytes );
 
-			if ( pal.size() > 0 )
-			{
-				int index = pal.indexOf( d );
-				assert( index != -1 );
-				assert( index >= 0 && index < 256 );
-				uint8_t index8 = (uint8_t)index;
-				out.write( &index8, 1 );
-			}
-			else
+			levelw = levelw > 1 ? levelw>>1 : 1;
+			levelh = levelh > 1 ? levelh>>1 : 1;
+			continue;
+		}
+
+		for ( int j = 0 ; j < levelh ; ++j )
+		{
+			for ( int i = 0 ; i < levelw ; ++i )
 			{
-				out.write( s, bytesperpixel );
+				const uint8_t* s = (const uint8_t*)bits + i*bytesperpixel + j*pitch;
+				uint32_t d = getBytesLE( s, bytesperpixel );
+
+				if ( pal.size() > 0 )
+				{
+					int index = pal.indexOf( d );
+					assert( index != -1 );
+					assert( index >= 0 && index < 256 );
+					uint8_t index8 = (uint8_t)index;
+					out.write( &index8, 1 );
+				}
+				else
+				{
+					out.write( s, bytesperpixel );
+				}
 			}
 		}
+
+		levelw = levelw > 1 ? levelw>>1 : 1;
+		levelh = levelh > 1 ? levelh>>1 : 1;
 	}
 
 	// write file
 	{
-		Array<uint8_t> data = byteout.toByteArray();
-		if ( data.size() & 1 )
-			data.add( 0 );
+		if ( byteout.size() & 1 )
+		{
+			uint8_t pad = 0;
+			byteout.write( &pad, 1 );
+		}
 
 		// write header
 		FileOutputStream out( filename );
@@ -126,8 +177,8 @@ int ImageWriter::writeNTX( const String& filename, const void* bits, int w, int
 		}*/
 
 		// write data
-		out.write( &data[0], data.size() );
-		return data.size() + sizeof(ImageReader::NTXHeader);
+		byteout.writeTo( &out );
+		return byteout.size() + sizeof(ImageReader::NTXHeader);
 	}
 }
 
@@ -0,0 +1,427 @@
+#include <img/MipMapGenerator.h>
+#include <img/ImageReader.h>
+#include <img/ImageWriter.h>
+#include <gr/SurfaceFormat.h>
+#include <lang/Math.h>
+#include <lang/String.h>
+#include <lang/ThreadPool.h>
+#include <math.h>
+#include <string.h>
+#include <config.h>
+
+
+USING_NAMESPACE(gr)
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(img)
+
+
+/** Kaiser filter support radius in destination pixels. */
+static const float	KAISER_RADIUS = 2.f;
+
+/** Kaiser window shape parameter. */
+static const float	KAISER_ALPHA = 4.f;
+
+/** Number of destination rows filtered by a single job. */
+static const int	ROWS_PER_JOB = 16;
+
+/** Levels smaller than this (in pixels) are filtered in calling thread. */
+static const int	MIN_PARALLEL_PIXELS = 64*64;
+
+static float		s_srgbToLinear[256];
+static uint8_t		s_linearToSrgb[4096];
+static bool			s_tablesInitialized = false;
+
+
+/** Single filter tap: source pixel index and weight. */
+class FilterTap
+{
+public:
+	int		index;
+	float	weight;
+};
+
+
+/** Filters horizontal band of destination level. */
+class FilterJob :
+	public ThreadPool::Job
+{
+public:
+	const float*		src;
+	int					srcw;
+	float*				dst;
+	uint32_t*			out;
+	int					dstw;
+	int					y0;
+	int					y1;
+	bool				srgb;
+	const int*			xoffsets;
+	const FilterTap*	xtaps;
+	const int*			yoffsets;
+	const FilterTap*	ytaps;
+	Array<float>		row;
+
+	void run()
+	{
+		row.resize( srcw*4 );
+		float* const rowbuf = row.begin();
+		const int rowsize = srcw*4;
+
+		for ( int y = y0 ; y < y1 ; ++y )
+		{
+			// vertical pass to temporary row
+			memset( rowbuf, 0, sizeof(float)*rowsize );
+			for ( int t = yoffsets[y] ; t < yoffsets[y+1] ; ++t )
+			{
+				const float* s = src + ytaps[t].index*rowsize;
+				const float w = ytaps[t].weight;
+				for ( int i = 0 ; i < rowsize ; ++i )
+					rowbuf[i] += s[i]*w;
+			}
+
+			// horizontal pass to destination
+			float* d = dst + y*dstw*4;
+			uint32_t* o = out + y*dstw;
+			for ( int x = 0 ; x < dstw ; ++x )
+			{
+				float c[4] = {0.f,0.f,0.f,0.f};
+				for ( int t = xoffsets[x] ; t < xoffsets[x+1] ; ++t )
+				{
+					const float* s = rowbuf + (xtaps[t].index<<2);
+					const float w = xtaps[t].weight;
+					c[0] += s[0]*w;
+					c[1] += s[1]*w;
+					c[2] += s[2]*w;
+					c[3] += s[3]*w;
+				}
+
+				for ( int k = 0 ; k < 4 ; ++k )
+				{
+					if ( c[k] < 0.f )
+						c[k] = 0.f;
+					else if ( c[k] > 1.f )
+						c[k] = 1.f;
+					d[k] = c[k];
+				}
+				d += 4;
+
+				uint32_t r, g, b;
+				if ( srgb )
+				{
+					r = s_linearToSrgb[ int(c[0]*4095.f+.5f) ];
+					g = s_linearToSrgb[ int(c[1]*4095.f+.5f) ];
+					b = s_linearToSrgb[ int(c[2]*4095.f+.5f) ];
+				}
+				else
+				{
+					r = uint32_t( c[0]*255.f+.5f );
+					g = uint32_t( c[1]*255.f+.5f );
+					b = uint32_t( c[2]*255.f+.5f );
+				}
+				uint32_t a = uint32_t( c[3]*255.f+.5f );
+				o[x] = (a<<24) + (r<<16) + (g<<8) + b;
+			}
+		}
+	}
+};
+
+
+static void initTables()
+{
+	if ( !s_tablesInitialized )
+	{
+		for ( int i = 0 ; i < 256 ; ++i )
+		{
+			float c = float(i) / 255.f;
+			s_srgbToLinear[i] = c <= 0.04045f ? c/12.92f : (float)pow( (c+0.055f)/1.055f, 2.4f );
+		}
+		for ( int i = 0 ; i < 4096 ; ++i )
+		{
+			float c = float(i) / 4095.f;
+			float s = c <= 0.0031308f ? c*12.92f : 1.055f*(float)pow( c, 1.f/2.4f ) - 0.055f;
+			s_linearToSrgb[i] = (uint8_t)( s*255.f + .5f );
+		}
+		s_tablesInitialized = true;
+	}
+}
+
+/** Zero-order modified Bessel function of the first kind. */
+static float besselI0( float x )
+{
+	float sum = 1.f;
+	float term = 1.f;
+	float x2 = x*x*.25f;
+	for ( int k = 1 ; k < 32 && term > sum*1e-7f ; ++k )
+	{
+		term *= x2 / float(k*k);
+		sum += term;
+	}
+	return sum;
+}
+
+static float kaiser( float x )
+{
+	// x in [-1,1]
+	float t = 1.f - x*x;
+	if ( t <= 0.f )
+		return 0.f;
+	return besselI0( KAISER_ALPHA*Math::sqrt(t) ) / besselI0( KAISER_ALPHA );
+}
+
+static float sinc( float x )
+{
+	if ( Math::abs(x) < 1e-6f )
+		return 1.f;
+	x *= Math::PI;
+	return Math::sin(x) / x;
+}
+
+/**
+ * Computes filter taps for each destination pixel along one axis.
+ * Taps of destination pixel i are in range [offsets[i],offsets[i+1]).
+ */
+static void getTaps( MipMapGenerator::FilterType filter, int srcsize, int dstsize,
+	Array<int>& offsets, Array<FilterTap>& taps )
+{
+	offsets.resize( dstsize+1 );
+	taps.clear();
+
+	const float scale = float(srcsize) / float(dstsize);
+	for ( int i = 0 ; i < dstsize ; ++i )
+	{
+		offsets[i] = taps.size();
+		float sum = 0.f;
+
+		if ( srcsize == dstsize )
+		{
+			FilterTap tap;
+			tap.index = i;
+			tap.weight = 1.f;
+			taps.add( tap );
+			sum = 1.f;
+		}
+		else if ( filter == MipMapGenerator::FILTER_KAISER )
+		{
+			const float center = (float(i)+.5f) * scale;
+			const float radius = KAISER_RADIUS * scale;
+			const int k0 = (int)Math::floor( center-radius );
+			const int k1 = (int)Math::ceil( center+radius );
+			for ( int k = k0 ; k < k1 ; ++k )
+			{
+				float d = (float(k)+.5f-center) / scale;
+				float w = sinc(d) * kaiser(d/KAISER_RADIUS);
+				if ( w != 0.f )
+				{
+					FilterTap tap;
+					tap.index = k < 0 ? 0 : (k >= srcsize ? srcsize-1 : k);
+					tap.weight = w;
+					taps.add( tap );
+					sum += w;
+				}
+			}
+		}
+		else
+		{
+			// area-weighted box
+			const float a = float(i) * scale;
+			const float b = float(i+1) * scale;
+			const int k0 = (int)Math::floor( a );
+			const int k1 = Math::min( (int)Math::ceil(b), srcsize );
+			for ( int k = k0 ; k < k1 ; ++k )
+			{
+				float w = Math::min( b, float(k+1) ) - Math::max( a, float(k) );
+				if ( w > 0.f )
+				{
+					FilterTap tap;
+					tap.index = k;
+					tap.weight = w;
+					taps.add( tap );
+					sum += w;
+				}
+			}
+		}
+
+		// normalize
+		for ( int k = offsets[i] ; k < taps.size() ; ++k )
+			taps[k].weight /= sum;
+	}
+	offsets[dstsize] = taps.size();
+}
+
+
+MipMapGenerator::MipMapGenerator( FilterType filter, bool srgb, ThreadPool* pool ) :
+	m_filter( filter ),
+	m_srgb( srgb ),
+	m_pool( pool )
+{
+	initTables();
+}
+
+MipMapGenerator::~MipMapGenerator()
+{
+}
+
+void MipMapGenerator::generate( const Image* img, Array<P(Image)>& levels, int maxlevels ) const
+{
+	int w = img->width();
+	int h = img->height();
+	int count = getLevelCount( w, h );
+	if ( maxlevels > 0 && maxlevels < count )
+		count = maxlevels;
+
+	levels.clear();
+	P(Image) top = new Image( w, h );
+	memcpy( top->bits(), img->bits(), w*h*4 );
+	levels.add( top );
+
+	// top level to linear floating point RGBA
+	Array<float> src( w*h*4 );
+	Array<float> dst;
+	const uint32_t* bits = img->bits();
+	for ( int i = 0 ; i < w*h ; ++i )
+	{
+		uint32_t c = bits[i];
+		float* d = &src[i<<2];
+		if ( m_srgb )
+		{
+			d[0] = s_srgbToLinear[ (c>>16)&0xFF ];
+			d[1] = s_srgbToLinear[ (c>>8)&0xFF ];
+			d[2] = s_srgbToLinear[ c&0xFF ];
+		}
+		else
+		{
+			d[0] = float( (c>>16)&0xFF ) * (1.f/255.f);
+			d[1] = float( (c>>8)&0xFF ) * (1.f/255.f);
+			d[2] = float( c&0xFF ) * (1.f/255.f);
+		}
+		d[3] = float( c>>24 ) * (1.f/255.f);
+	}
+
+	Array<int> xoffsets;
+	Array<int> yoffsets;
+	Array<FilterTap> xtaps;
+	Array<FilterTap> ytaps;
+	Array<FilterJob> jobs;
+
+	for ( int level = 1 ; level < count ; ++level )
+	{
+		const int dw = w > 1 ? w>>1 : 1;
+		const int dh = h > 1 ? h>>1 : 1;
+		getTaps( m_filter, w, dw, xoffsets, xtaps );
+		getTaps( m_filter, h, dh, yoffsets, ytaps );
+
+		P(Image) lev = new Image( dw, dh );
+		dst.resize( dw*dh*4 );
+
+		// split level to bands if worth it
+		int jobcount = 1;
+		if ( m_pool != 0 && dw*dh >= MIN_PARALLEL_PIXELS )
+			jobcount = (dh+ROWS_PER_JOB-1) / ROWS_PER_JOB;
+		jobs.resize( jobcount );
+		for ( int i = 0 ; i < jobcount ; ++i )
+		{
+			FilterJob& job = jobs[i];
+			job.src = src.begin();
+			job.srcw = w;
+			job.dst = dst.begin();
+			job.out = lev->bits();
+			job.dstw = dw;
+			job.y0 = i*dh/jobcount;
+			job.y1 = (i+1)*dh/jobcount;
+			job.srgb = m_srgb;
+			job.xoffsets = xoffsets.begin();
+			job.xtaps = xtaps.begin();
+			job.yoffsets = yoffsets.begin();
+			job.ytaps = ytaps.begin();
+		}
+
+		if ( jobcount > 1 )
+		{
+			ThreadPool::Batch batch;
+			for ( int i = 0 ; i < jobcount ; ++i )
+				m_pool->add( &jobs[i], &batch );
+			m_pool->wait( &batch );
+		}
+		else
+		{
+			jobs[0].run();
+		}
+
+		levels.add( lev );
+		src.swap( dst );
+		w = dw;
+		h = dh;
+	}
+}
+
+void MipMapGenerator::generate( ImageReader* reader, Array<P(Image)>& levels, int maxlevels ) const
+{
+	const int w = reader->surfaceWidth();
+	const int h = reader->surfaceHeight();
+	P(Image) img = new Image( w, h );
+	reader->readSurface( img->bits(), img->pitch(), w, h, SurfaceFormat::SURFACE_A8R8G8B8, 0, SurfaceFormat() );
+	generate( img, levels, maxlevels );
+}
+
+void MipMapGenerator::setFilter( FilterType filter )
+{
+	m_filter = filter;
+}
+
+void MipMapGenerator::setThreadPool( ThreadPool* pool )
+{
+	m_pool = pool;
+}
+
+MipMapGenerator::FilterType MipMapGenerator::filter() const
+{
+	return m_filter;
+}
+
+int MipMapGenerator::getLevelCount( int w, int h )
+{
+	int count = 1;
+	while ( w > 1 || h > 1 )
+	{
+		w >>= 1;
+		h >>= 1;
+		++count;
+	}
+	return count;
+}
+
+int MipMapGenerator::writeNTX( const String& filename, const Array<P(Image)>& levels,
+	SurfaceFormat format, int flags, int userflags )
+{
+	assert( levels.size() > 0 );
+
+	// convert levels to output format
+	int size = 0;
+	for ( int i = 0 ; i < levels.size() ; ++i )
+		size += format.getMemoryUsage( levels[i]->width(), levels[i]->height() );
+
+	Array<uint8_t> data( size );
+	Array<const void*> levelbits( levels.size() );
+	Array<int> levelpitches( levels.size() );
+	int offset = 0;
+	for ( int i = 0 ; i < levels.size() ; ++i )
+	{
+		Image* lev = levels[i];
+		const int pitch = format.getMemoryUsage( lev->width(), 1 );
+		format.copyPixels( &data[offset], pitch, SurfaceFormat(), 0,
+			SurfaceFormat::SURFACE_A8R8G8B8, lev->bits(), lev->pitch(), SurfaceFormat(), 0,
+			lev->width(), lev->height() );
+		levelbits[i] = &data[offset];
+		levelpitches[i] = pitch;
+		offset += format.getMemoryUsage( lev->width(), lev->height() );
+	}
+
+	return ImageWriter::writeNTX( filename, levelbits.begin(), levelpitches.begin(), levels.size(),
+		levels[0]->width(), levels[0]->height(), format, flags, userflags );
+}
+
+
+END_NAMESPACE() // img
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
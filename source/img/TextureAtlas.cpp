@@ -0,0 +1,320 @@
+#include <img/TextureAtlas.h>
+#include <img/ImageWriter.h>
+#include <io/FileOutputStream.h>
+#include <lang/Math.h>
+#include <lang/Exception.h>
+#include <lang/algorithm/sort.h>
+#include <stdio.h>
+#include <string.h>
+#include <config.h>
+
+
+USING_NAMESPACE(gr)
+USING_NAMESPACE(io)
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(img)
+
+
+/** Segment of packing skyline. */
+class SkylineNode
+{
+public:
+	int		x;
+	int		y;
+	int		width;
+};
+
+/** Packing order key: taller (then wider) images first. */
+class PackOrder
+{
+public:
+	int		height;
+	int		width;
+	int		index;
+
+	bool operator<( const PackOrder& other ) const
+	{
+		if ( height != other.height )
+			return height > other.height;
+		if ( width != other.width )
+			return width > other.width;
+		return index < other.index;
+	}
+};
+
+
+/**
+ * Returns y-coordinate where rectangle of specified size fits
+ * when placed at the beginning of ith skyline node, or -1 if it doesn't fit.
+ */
+static int fitSkyline( const Array<SkylineNode>& skyline, int i, int w, int h, int atlasw, int atlash )
+{
+	int x = skyline[i].x;
+	if ( x+w > atlasw )
+		return -1;
+
+	int y = skyline[i].y;
+	for ( int left = w ; left > 0 ; ++i )
+	{
+		assert( i < skyline.size() );
+		y = Math::max( y, skyline[i].y );
+		if ( y+h > atlash )
+			return -1;
+		left -= skyline[i].width;
+	}
+	return y;
+}
+
+/**
+ * Adds placed rectangle to skyline at node i.
+ */
+static void addSkyline( Array<SkylineNode>& skyline, int i, int x, int y, int w, int h )
+{
+	SkylineNode node;
+	node.x = x;
+	node.y = y+h;
+	node.width = w;
+	skyline.add( i, node );
+
+	// shrink or remove nodes covered by the new one
+	for ( int k = i+1 ; k < skyline.size() ; )
+	{
+		SkylineNode& prev = skyline[k-1];
+		SkylineNode& cur = skyline[k];
+		int overlap = prev.x + prev.width - cur.x;
+		if ( overlap <= 0 )
+			break;
+
+		cur.x += overlap;
+		cur.width -= overlap;
+		if ( cur.width > 0 )
+			break;
+		skyline.remove( k );
+	}
+
+	// merge neighbors at the same height
+	for ( int k = 0 ; k+1 < skyline.size() ; )
+	{
+		if ( skyline[k].y == skyline[k+1].y )
+		{
+			skyline[k].width += skyline[k+1].width;
+			skyline.remove( k+1 );
+		}
+		else
+		{
+			++k;
+		}
+	}
+}
+
+
+TextureAtlas::Entry::Entry() :
+	x( 0 ),
+	y( 0 ),
+	width( 0 ),
+	height( 0 ),
+	uscale( 1.f ),
+	vscale( 1.f ),
+	ubias( 0.f ),
+	vbias( 0.f )
+{
+}
+
+TextureAtlas::TextureAtlas( int maxwidth, int maxheight, int padding ) :
+	m_maxWidth( maxwidth ),
+	m_maxHeight( maxheight ),
+	m_padding( padding )
+{
+	assert( padding >= 0 );
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+int TextureAtlas::add( const String& name, Image* img )
+{
+	assert( img != 0 );
+
+	Entry e;
+	e.name = name;
+	e.width = img->width();
+	e.height = img->height();
+	m_entries.add( e );
+	m_images.add( img );
+	m_image = 0;
+	return m_entries.size()-1;
+}
+
+void TextureAtlas::build()
+{
+	// initial guess from total area
+	int area = 0;
+	int minw = 1;
+	int minh = 1;
+	for ( int i = 0 ; i < m_entries.size() ; ++i )
+	{
+		int w = m_entries[i].width + m_padding*2;
+		int h = m_entries[i].height + m_padding*2;
+		area += w*h;
+		minw = Math::max( minw, w );
+		minh = Math::max( minh, h );
+	}
+
+	// square guess might be wider than allowed even if a taller image would fit
+	int w = 1;
+	int h = 1;
+	while ( w < minw || w*w < area )
+		w <<= 1;
+	while ( w > m_maxWidth && (w>>1) >= minw )
+		w >>= 1;
+	while ( h < minh || w*h < area )
+		h <<= 1;
+	while ( h > m_maxHeight && (h>>1) >= minh )
+		h >>= 1;
+
+	// grow until everything fits
+	while ( w > m_maxWidth || h > m_maxHeight || !pack(w,h) )
+	{
+		if ( w <= h && w < m_maxWidth )
+			w <<= 1;
+		else if ( h < m_maxHeight )
+			h <<= 1;
+		else if ( w < m_maxWidth )
+			w <<= 1;
+		else
+			throwError( Exception( Format("Texture atlas: {0} images do not fit to {1}x{2} image", m_entries.size(), m_maxWidth, m_maxHeight) ) );
+	}
+
+	// copy images with edge-replicated padding
+	m_image = new Image( w, h );
+	uint32_t* dst = m_image->bits();
+	for ( int k = 0 ; k < m_entries.size() ; ++k )
+	{
+		Entry& e = m_entries[k];
+		const uint32_t* src = m_images[k]->bits();
+
+		for ( int j = -m_padding ; j < e.height+m_padding ; ++j )
+		{
+			int sy = Math::min( Math::max(j,0), e.height-1 );
+			uint32_t* d = dst + (e.y+j)*w + e.x;
+			const uint32_t* s = src + sy*e.width;
+			for ( int i = -m_padding ; i < 0 ; ++i )
+				d[i] = s[0];
+			memcpy( d, s, e.width*sizeof(uint32_t) );
+			for ( int i = e.width ; i < e.width+m_padding ; ++i )
+				d[i] = s[e.width-1];
+		}
+
+		e.uscale = float(e.width) / float(w);
+		e.vscale = float(e.height) / float(h);
+		e.ubias = float(e.x) / float(w);
+		e.vbias = float(e.y) / float(h);
+	}
+}
+
+bool TextureAtlas::pack( int w, int h )
+{
+	Array<PackOrder> order( m_entries.size() );
+	for ( int i = 0 ; i < m_entries.size() ; ++i )
+	{
+		order[i].width = m_entries[i].width;
+		order[i].height = m_entries[i].height;
+		order[i].index = i;
+	}
+	LANG_SORT( order.begin(), order.end() );
+
+	Array<SkylineNode> skyline;
+	SkylineNode root;
+	root.x = 0;
+	root.y = 0;
+	root.width = w;
+	skyline.add( root );
+
+	for ( int k = 0 ; k < order.size() ; ++k )
+	{
+		Entry& e = m_entries[ order[k].index ];
+		const int pw = e.width + m_padding*2;
+		const int ph = e.height + m_padding*2;
+
+		// bottom-left: lowest top edge, then narrowest node
+		int best = -1;
+		int besty = 0;
+		int bestwidth = 0;
+		for ( int i = 0 ; i < skyline.size() ; ++i )
+		{
+			int y = fitSkyline( skyline, i, pw, ph, w, h );
+			if ( y >= 0 && (best < 0 || y < besty || (y == besty && skyline[i].width < bestwidth)) )
+			{
+				best = i;
+				besty = y;
+				bestwidth = skyline[i].width;
+			}
+		}
+		if ( best < 0 )
+			return false;
+
+		e.x = skyline[best].x + m_padding;
+		e.y = besty + m_padding;
+		addSkyline( skyline, best, skyline[best].x, besty, pw, ph );
+	}
+	return true;
+}
+
+Image* TextureAtlas::image() const
+{
+	return m_image;
+}
+
+int TextureAtlas::entries() const
+{
+	return m_entries.size();
+}
+
+const TextureAtlas::Entry& TextureAtlas::getEntry( int i ) const
+{
+	return m_entries[i];
+}
+
+int TextureAtlas::indexOf( const String& name ) const
+{
+	for ( int i = 0 ; i < m_entries.size() ; ++i )
+		if ( m_entries[i].name == name )
+			return i;
+	return -1;
+}
+
+int TextureAtlas::writeNTX( const String& filename, SurfaceFormat format, int flags, int userflags ) const
+{
+	assert( m_image != 0 );
+
+	const int w = m_image->width();
+	const int h = m_image->height();
+	const int pitch = format.getMemoryUsage( w, 1 );
+	Array<uint8_t> data( format.getMemoryUsage(w,h) );
+	format.copyPixels( data.begin(), pitch, SurfaceFormat(), 0,
+		SurfaceFormat::SURFACE_A8R8G8B8, m_image->bits(), m_image->pitch(), SurfaceFormat(), 0,
+		w, h );
+
+	return ImageWriter::writeNTX( filename, data.begin(), w, h, pitch, format, flags, userflags );
+}
+
+void TextureAtlas::writeUVTable( const String& filename ) const
+{
+	FileOutputStream out( filename );
+	for ( int i = 0 ; i < m_entries.size() ; ++i )
+	{
+		const Entry& e = m_entries[i];
+		char buf[256];
+		sprintf( buf, "=%d %d %d %d %g %g %g %g\n", e.x, e.y, e.width, e.height, e.uscale, e.vscale, e.ubias, e.vbias );
+		String line = e.name + buf;
+		out.write( line.c_str(), line.length() );
+	}
+}
+
+
+END_NAMESPACE() // img
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
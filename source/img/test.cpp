@@ -1,13 +1,20 @@
 #include <io/PathName.h>
 #include <io/FileInputStream.h>
 #include <io/FileOutputStream.h>
+#include <io/FindFile.h>
+#include <gr/DXTCodec.h>
 #include <gr/SurfaceFormat.h>
 #include <img/ImageReader.h>
 #include <img/ImageWriter.h>
+#include <img/ImageBatchReader.h>
+#include <img/MipMapGenerator.h>
+#include <img/TextureAtlas.h>
 #include <math/float2.h>
 #include <math/float3.h>
 #include <math/RandomUtil.h>
 #include <lang/all.h>
+#include <math.h>
+#include <string.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <config.h>
@@ -344,8 +351,263 @@ static void loadCubeMap( const String& datapath )
 	}
 }
 
+static void generateMipMaps( const String& datapath )
+{
+	// 50% black/white checker, box filtered to 1x1 in linear space should be sRGB ~188
+	P(Image) img = new Image( 96, 64 );
+	for ( int j = 0 ; j < img->height() ; ++j )
+		for ( int i = 0 ; i < img->width() ; ++i )
+			img->setPixel( i, j, (i^j)&1 ? 0xFFFFFFFF : 0xFF000000 );
+
+	ThreadPool pool( 2 );
+	MipMapGenerator serialgen( MipMapGenerator::FILTER_BOX, true, 0 );
+	MipMapGenerator poolgen( MipMapGenerator::FILTER_BOX, true, &pool );
+	Array<P(Image)> levels;
+	Array<P(Image)> levels2;
+	serialgen.generate( img, levels );
+	poolgen.generate( img, levels2 );
+	assert( levels.size() == MipMapGenerator::getLevelCount(96,64) );
+	assert( levels.size() == 7 );
+	for ( int i = 0 ; i < levels.size() ; ++i )
+		assert( !memcmp(levels[i]->bits(), levels2[i]->bits(), levels[i]->width()*levels[i]->height()*4) );
+	
+	uint32_t c = levels[levels.size()-1]->getPixel(0,0);
+	assert( levels[levels.size()-1]->width() == 1 );
+	assert( (c&0xFF) >= 186 && (c&0xFF) <= 189 );
+	assert( (c>>24) == 0xFF );
+
+	// store and read back
+	String filename = PathName(datapath,"images/out-test-mipmaps.ntx").toString();
+	MipMapGenerator::writeNTX( filename, levels, SurfaceFormat::SURFACE_A8R8G8B8 );
+	FileInputStream in( filename );
+	ImageReader rd( &in, ImageReader::FILEFORMAT_NTX );
+	assert( rd.mipLevels() == levels.size() );
+	Array<uint32_t> data;
+	for ( int i = 0 ; i < rd.surfaces() ; ++i )
+	{
+		int w = rd.surfaceWidth();
+		int h = rd.surfaceHeight();
+		assert( w == levels[i]->width() && h == levels[i]->height() );
+		data.resize( w*h );
+		rd.readSurface( data.begin(), w*4, w, h, SurfaceFormat::SURFACE_A8R8G8B8, 0, SurfaceFormat() );
+		assert( !memcmp(data.begin(), levels[i]->bits(), w*h*4) );
+	}
+
+	// store as DXT5, read back compressed and decompressed
+	SurfaceFormat dxtfmt( SurfaceFormat::SURFACE_DXT5 );
+	String dxtfilename = PathName(datapath,"images/out-test-mipmaps-dxt5.ntx").toString();
+	MipMapGenerator::writeNTX( dxtfilename, levels, dxtfmt );
+	FileInputStream dxtin( dxtfilename );
+	ImageReader dxtrd( &dxtin, ImageReader::FILEFORMAT_NTX );
+	assert( dxtrd.format() == dxtfmt );
+	assert( dxtrd.mipLevels() == levels.size() );
+	Array<uint8_t> dxtdata;
+	Array<uint8_t> dxtdata2;
+	for ( int i = 0 ; i < dxtrd.surfaces() ; ++i )
+	{
+		int w = dxtrd.surfaceWidth();
+		int h = dxtrd.surfaceHeight();
+		int pitch = dxtfmt.getMemoryUsage( w, 1 );
+		dxtdata.resize( dxtfmt.getMemoryUsage(w,h) );
+		dxtdata2.resize( dxtdata.size() );
+		dxtrd.readSurface( dxtdata.begin(), pitch, w, h, dxtfmt, 0, SurfaceFormat() );
+		DXTCodec::compress( dxtdata2.begin(), pitch, dxtfmt, levels[i]->bits(), levels[i]->pitch(), w, h );
+		assert( !memcmp(dxtdata.begin(), dxtdata2.begin(), dxtdata.size()) );
+	}
+
+	FileInputStream dxtin2( dxtfilename );
+	ImageReader dxtrd2( &dxtin2, ImageReader::FILEFORMAT_NTX );
+	data.resize( 96*64 );
+	dxtrd2.readSurface( data.begin(), 96*4, 96, 64, SurfaceFormat::SURFACE_A8R8G8B8, 0, SurfaceFormat() );
+	assert( data[0] == 0xFF000000 && data[1] == 0xFFFFFFFF );
+}
+
+static void buildTextureAtlas( const String& datapath )
+{
+	TextureAtlas atlas( 256, 256, 1 );
+	for ( int k = 0 ; k < 20 ; ++k )
+	{
+		P(Image) img = new Image( 4+k*5%23, 3+k*7%19 );
+		for ( int j = 0 ; j < img->height() ; ++j )
+			for ( int i = 0 ; i < img->width() ; ++i )
+				img->setPixel( i, j, 0xFF000000+k );
+		atlas.add( Format("img{0}",k).format(), img );
+	}
+	atlas.build();
+
+	// every image and its padding is intact
+	Image* img = atlas.image();
+	for ( int k = 0 ; k < atlas.entries() ; ++k )
+	{
+		const TextureAtlas::Entry& e = atlas.getEntry(k);
+		for ( int j = e.y-1 ; j < e.y+e.height+1 ; ++j )
+			for ( int i = e.x-1 ; i < e.x+e.width+1 ; ++i )
+				assert( img->getPixel(i,j) == 0xFF000000u+k );
+		assert( e.ubias == float(e.x)/float(img->width()) );
+		assert( e.uscale == float(e.width)/float(img->width()) );
+	}
+	assert( atlas.indexOf("img7") == 7 );
+
+	atlas.writeNTX( PathName(datapath,"images/out-test-atlas.ntx").toString(), SurfaceFormat::SURFACE_A8R8G8B8 );
+	atlas.writeUVTable( PathName(datapath,"images/out-test-atlas.txt").toString() );
+
+	// narrow and tall atlas, area alone suggests too wide image
+	TextureAtlas tall( 256, 4096, 0 );
+	for ( int k = 0 ; k < 16 ; ++k )
+		tall.add( Format("strip{0}",k).format(), new Image(256,64) );
+	tall.build();
+	assert( tall.image()->width() == 256 && tall.image()->height() == 1024 );
+}
+
+static int decodeBatch( const Array<String>& filenames, ThreadPool* pool, Array<P(ImageBatchReader::Result)>& results )
+{
+	int time = System::currentTimeMillis();
+
+	ImageBatchReader reader( pool, SurfaceFormat::SURFACE_A8R8G8B8, 4<<20 );
+	for ( int i = 0 ; i < filenames.size() ; ++i )
+		reader.add( filenames[i] );
+
+	results.clear();
+	results.resize( filenames.size() );
+	for ( P(ImageBatchReader::Result) res = reader.next() ; res != 0 ; res = reader.next() )
+	{
+		assert( results[res->index] == 0 );
+		assert( res->filename == filenames[res->index] );
+		results[res->index] = res;
+	}
+	assert( reader.remaining() == 0 );
+
+	return System::currentTimeMillis() - time;
+}
+
+static void findImageFiles( const String& datapath, Array<String>& filenames )
+{
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	for ( FindFile ff(PathName(datapath,"images/*").toString()) ; ff.more() ; ff.next() )
+	{
+		String filename = ff.data().path.toString();
+		if ( ImageReader::guessFileFormat(filename) != ImageReader::FILEFORMAT_UNKNOWN )
+			filenames.add( filename );
+	}
+#endif
+	filenames.add( PathName(datapath,"images/rgb_corners-8b.bmp").toString() );
+}
+
+static void benchmarkBatchDecode( const String& datapath )
+{
+	// decode every image in data/images/ serially and in parallel
+	Array<String> filenames;
+	findImageFiles( datapath, filenames );
+	filenames.add( PathName(datapath,"images/does-not-exist.tga").toString() );
+
+	ThreadPool serialpool( 0 );
+	ThreadPool parallelpool;
+	Array<P(ImageBatchReader::Result)> serial;
+	Array<P(ImageBatchReader::Result)> parallel;
+	int serialtime = decodeBatch( filenames, &serialpool, serial );
+	int paralleltime = decodeBatch( filenames, &parallelpool, parallel );
+
+	int bytes = 0;
+	for ( int i = 0 ; i < filenames.size() ; ++i )
+	{
+		assert( serial[i]->failed() == parallel[i]->failed() );
+		assert( serial[i]->bytes() == parallel[i]->bytes() );
+		for ( int k = 0 ; k < serial[i]->surfaces.size() ; ++k )
+			assert( !memcmp(serial[i]->surfaces[k].data.begin(), parallel[i]->surfaces[k].data.begin(), serial[i]->surfaces[k].data.size()) );
+		bytes += serial[i]->bytes();
+	}
+	assert( parallel.last()->failed() );
+
+	Debug::printf( "img: Decoded %d images (%d KB): serial %d ms, %d threads %d ms\n", 
+		filenames.size(), bytes>>10, serialtime, parallelpool.threads()+1, paralleltime );
+}
+
+/**
+ * Returns peak signal-to-noise ratio in dB of RGB (and alpha) channels.
+ * Transparent pixels are ignored if alpha is not compared.
+ */
+static float getPSNR( const uint32_t* a, const uint32_t* b, int pixels, bool alpha )
+{
+	double err = 0.0;
+	int count = 0;
+	for ( int i = 0 ; i < pixels ; ++i )
+	{
+		if ( !alpha && (a[i]>>24) < 128 )
+			continue;
+
+		for ( int k = 0 ; k < (alpha ? 4 : 3) ; ++k )
+		{
+			double d = double((a[i]>>(k*8))&0xFF) - double((b[i]>>(k*8))&0xFF);
+			err += d*d;
+			++count;
+		}
+	}
+	if ( count == 0 || err == 0.0 )
+		return 99.f;
+	return float( 10.0 * log10(255.0*255.0*count/err) );
+}
+
+static void benchmarkDXT( const String& datapath )
+{
+	// compress every image in data/images/ and measure speed and quality
+	Array<String> filenames;
+	findImageFiles( datapath, filenames );
+	ThreadPool pool( 0 );
+	Array<P(ImageBatchReader::Result)> images;
+	decodeBatch( filenames, &pool, images );
+
+	const SurfaceFormat::SurfaceFormatType formats[] = {SurfaceFormat::SURFACE_DXT1, SurfaceFormat::SURFACE_DXT5};
+	const char* const qualitynames[] = {"range fit", "cluster fit"};
+	for ( int f = 0 ; f < (int)countof(formats) ; ++f )
+	{
+		for ( int q = 0 ; q < 2 ; ++q )
+		{
+			SurfaceFormat fmt( formats[f] );
+			int bytes = 0;
+			int time = 0;
+			int count = 0;
+			float psnr = 0.f;
+			Array<uint8_t> dxt;
+			Array<uint32_t> decoded;
+
+			for ( int i = 0 ; i < images.size() ; ++i )
+			{
+				if ( images[i]->failed() )
+					continue;
+
+				const ImageBatchReader::Surface& s = images[i]->surfaces[0];
+				const int pitch = fmt.getMemoryUsage( s.width, 1 );
+				dxt.resize( fmt.getMemoryUsage(s.width,s.height) );
+				decoded.resize( s.width*s.height );
+
+				int t0 = System::currentTimeMillis();
+				DXTCodec::compress( dxt.begin(), pitch, fmt, (const uint32_t*)s.data.begin(), s.pitch, s.width, s.height, (DXTCodec::Quality)q );
+				time += System::currentTimeMillis() - t0;
+
+				DXTCodec::decompress( decoded.begin(), s.width*4, fmt, dxt.begin(), pitch, s.width, s.height );
+				psnr += getPSNR( (const uint32_t*)s.data.begin(), decoded.begin(), s.width*s.height, fmt.type() != SurfaceFormat::SURFACE_DXT1 );
+				bytes += s.width * s.height * 4;
+				++count;
+			}
+
+			if ( count > 0 )
+			{
+				psnr /= float(count);
+				assert( psnr > 25.f );
+				Debug::printf( "img: %s %s: %d images (%d KB), %.1f MB/s, average PSNR %.2f dB\n",
+					fmt.toString(), qualitynames[q], count, bytes>>10, 
+					float(bytes)/float(1<<20) * 1000.f/float(time > 0 ? time : 1), psnr );
+			}
+		}
+	}
+}
+
 static void run( const String& datapath )
 {
+	benchmarkBatchDecode( datapath );
+	benchmarkDXT( datapath );
+	generateMipMaps( datapath );
+	buildTextureAtlas( datapath );
 	loadCubeMap( datapath );
 	saveRandomDist( datapath );
 	loadBmpAndTga( datapath );
@@ -6,19 +6,28 @@
 USING_NAMESPACE(lang)
 
 
-BEGIN_NAMESPACE(io) 
+BEGIN_NAMESPACE(io)
 
 
 ByteArrayOutputStream::ByteArrayOutputStream( int size ) :
-	m_buffer( new Array<uint8_t>(size) ),
-	m_userDefined( false )
+	m_buffer( new Array<uint8_t> ),
+	m_chunk( -1 ),
+	m_size( 0 ),
+	m_nextChunkSize( size > 0 ? size : DEFAULT_CHUNK_SIZE ),
+	m_userDefined( false ),
+	m_bufferValid( false )
 {
-	m_buffer->resize( 0 );
+	if ( size > 0 )
+		nextChunk( size );
 }
 
 ByteArrayOutputStream::ByteArrayOutputStream( Array<uint8_t>* buffer ) :
 	m_buffer( buffer ),
-	m_userDefined( true )
+	m_chunk( -1 ),
+	m_size( 0 ),
+	m_nextChunkSize( DEFAULT_CHUNK_SIZE ),
+	m_userDefined( true ),
+	m_bufferValid( true )
 {
 	assert( 0 != m_buffer );
 
@@ -27,6 +36,9 @@ ByteArrayOutputStream::ByteArrayOutputStream( Array<uint8_t>* buffer ) :
 
 ByteArrayOutputStream::~ByteArrayOutputStream()
 {
+	for ( int i = 0 ; i < m_chunks.size() ; ++i )
+		delete[] m_chunks[i].data;
+
 	if ( !m_userDefined )
 	{
 		delete m_buffer;
@@ -36,25 +48,198 @@ ByteArrayOutputStream::~ByteArrayOutputStream()
 
 void ByteArrayOutputStream::reset()
 {
-	m_buffer->resize( 0 );
+	if ( m_userDefined )
+	{
+		m_buffer->resize( 0 );
+		return;
+	}
+
+	for ( int i = 0 ; i < m_chunks.size() ; ++i )
+		m_chunks[i].size = 0;
+	m_chunk = m_chunks.size() > 0 ? 0 : -1;
+	m_size = 0;
+	m_bufferValid = false;
+}
+
+void ByteArrayOutputStream::reserve( int bytes )
+{
+	assert( bytes >= 0 );
+
+	if ( m_userDefined )
+	{
+		int oldsize = m_buffer->size();
+		if ( oldsize+bytes > m_buffer->allocatedCapacity() )
+		{
+			m_buffer->resize( oldsize+bytes );
+			m_buffer->resize( oldsize );
+		}
+	}
+	else if ( m_chunk < 0 || m_chunks[m_chunk].capacity - m_chunks[m_chunk].size < bytes )
+	{
+		nextChunk( bytes );
+	}
 }
 
 void ByteArrayOutputStream::write( const void* data, int size )
 {
-	int oldsize = m_buffer->size();
-	m_buffer->resize( oldsize + size );
-	for ( int i = 0 ; i < size ; ++i )
-		(*m_buffer)[oldsize+i] = reinterpret_cast<const char*>(data)[i];
+	assert( size >= 0 );
+
+	if ( m_userDefined )
+	{
+		writeUser( data, size );
+		return;
+	}
+
+	const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+	m_size += size;
+	m_bufferValid = false;
+
+	while ( size > 0 )
+	{
+		if ( m_chunk < 0 || m_chunks[m_chunk].size == m_chunks[m_chunk].capacity )
+			nextChunk( 1 );
+
+		Chunk& chunk = m_chunks[m_chunk];
+		int bytes = chunk.capacity - chunk.size;
+		if ( bytes > size )
+			bytes = size;
+		memcpy( chunk.data+chunk.size, src, bytes );
+		chunk.size += bytes;
+		src += bytes;
+		size -= bytes;
+	}
+}
+
+void ByteArrayOutputStream::writeUser( const void* data, int size )
+{
+	if ( size > 0 )
+	{
+		int oldsize = m_buffer->size();
+		m_buffer->resize( oldsize + size );
+		memcpy( m_buffer->begin()+oldsize, data, size );
+	}
+}
+
+void ByteArrayOutputStream::nextChunk( int bytes )
+{
+	// empty current chunk is replaced instead of skipped
+	if ( m_chunk < 0 || m_chunks[m_chunk].size > 0 )
+		++m_chunk;
+
+	if ( m_chunk == m_chunks.size() )
+	{
+		Chunk chunk;
+		chunk.data = 0;
+		chunk.size = 0;
+		chunk.capacity = 0;
+		m_chunks.add( chunk );
+	}
+
+	Chunk& chunk = m_chunks[m_chunk];
+	chunk.size = 0;
+	if ( chunk.capacity < bytes )
+	{
+		int cap = m_nextChunkSize;
+		if ( cap < bytes )
+			cap = bytes;
+
+		delete[] chunk.data;
+		chunk.data = 0;
+		chunk.capacity = 0;
+
+		chunk.data = new uint8_t[cap];
+		chunk.capacity = cap;
+
+		if ( m_nextChunkSize < MAX_CHUNK_SIZE )
+			m_nextChunkSize *= 2;
+	}
+}
+
+void ByteArrayOutputStream::writeTo( OutputStream* out ) const
+{
+	if ( m_userDefined )
+	{
+		out->write( m_buffer->begin(), m_buffer->size() );
+		return;
+	}
+
+	const int MAX_BUFFERS = 16;
+	const void* data[MAX_BUFFERS];
+	int sizes[MAX_BUFFERS];
+	int count = 0;
+
+	const int n = chunks();
+	for ( int i = 0 ; i < n ; ++i )
+	{
+		data[count] = m_chunks[i].data;
+		sizes[count] = m_chunks[i].size;
+		if ( ++count == MAX_BUFFERS )
+		{
+			out->writev( data, sizes, count );
+			count = 0;
+		}
+	}
+
+	if ( count > 0 )
+		out->writev( data, sizes, count );
+}
+
+const Array<uint8_t>& ByteArrayOutputStream::toByteArray() const
+{
+	if ( !m_bufferValid )
+	{
+		m_buffer->resize( m_size );
+
+		int pos = 0;
+		const int n = chunks();
+		for ( int i = 0 ; i < n ; ++i )
+		{
+			memcpy( m_buffer->begin()+pos, m_chunks[i].data, m_chunks[i].size );
+			pos += m_chunks[i].size;
+		}
+		assert( pos == m_size );
+
+		m_bufferValid = true;
+	}
+	return *m_buffer;
+}
+
+int ByteArrayOutputStream::chunks() const
+{
+	if ( m_userDefined )
+		return m_buffer->size() > 0 ? 1 : 0;
+
+	if ( m_chunk < 0 )
+		return 0;
+	if ( 0 == m_chunks[m_chunk].size )
+		return m_chunk;
+	return m_chunk + 1;
+}
+
+const uint8_t* ByteArrayOutputStream::chunk( int i, int* size ) const
+{
+	assert( i >= 0 && i < chunks() );
+
+	if ( m_userDefined )
+	{
+		*size = m_buffer->size();
+		return m_buffer->begin();
+	}
+
+	*size = m_chunks[i].size;
+	return m_chunks[i].data;
 }
 
 int ByteArrayOutputStream::size() const
 {
-	return m_buffer->size();
+	if ( m_userDefined )
+		return m_buffer->size();
+	return m_size;
 }
 
 String ByteArrayOutputStream::toString() const
 {
-	return "ByteArrayInputStream";
+	return "ByteArrayOutputStream";
 }
 
 
@@ -2,6 +2,7 @@
 #include <io/IOException.h>
 #include <lang/UTFConverter.h>
 #include <stdint.h>
+#include <string.h>
 #include <config.h>
 
 
@@ -10,9 +11,23 @@ USING_NAMESPACE(lang)
 
 BEGIN_NAMESPACE(io) 
 
-DataInputStream::DataInputStream( InputStream* in ) :
-	FilterInputStream(in)
+/** 
+ * Returns true if the platform is little-endian.
+ */
+static inline bool isLittleEndian()
 {
+	int x = 1;
+	return 0 != *reinterpret_cast<char*>(&x);
+}
+
+
+DataInputStream::DataInputStream( InputStream* in, int bufsize ) :
+	FilterInputStream(in),
+	m_readBuffer( bufsize ),
+	m_readPos( 0 ),
+	m_readEnd( 0 )
+{
+	assert( bufsize >= 0 );
 }
 
 DataInputStream::~DataInputStream()
@@ -21,42 +36,96 @@ DataInputStream::~DataInputStream()
 
 int DataInputStream::skip( int n )
 {
-	int skipped = FilterInputStream::skip( n );
+	int skipped = m_readEnd - m_readPos;
+	if ( skipped > n )
+		skipped = n;
+	m_readPos += skipped;
+
+	if ( skipped < n )
+		skipped += FilterInputStream::skip( n-skipped );
 	return skipped;
 }
 
 int DataInputStream::read( void* data, int size )
 {
-	int bytesread = FilterInputStream::read( data, size );
+	uint8_t* dst = reinterpret_cast<uint8_t*>(data);
+
+	// buffered data first
+	int bytesread = m_readEnd - m_readPos;
+	if ( bytesread > size )
+		bytesread = size;
+	if ( bytesread > 0 )
+	{
+		memcpy( dst, m_readPos, bytesread );
+		m_readPos += bytesread;
+	}
+
+	int left = size - bytesread;
+	if ( left > 0 )
+	{
+		// large reads go directly to the destination
+		if ( left < m_readBuffer.size() )
+			fillBuffer();
+
+		int buffered = m_readEnd - m_readPos;
+		if ( buffered > 0 )
+		{
+			if ( buffered > left )
+				buffered = left;
+			memcpy( dst+bytesread, m_readPos, buffered );
+			m_readPos += buffered;
+			bytesread += buffered;
+		}
+		else
+		{
+			bytesread += FilterInputStream::read( dst+bytesread, left );
+		}
+	}
 	return bytesread;
 }
 
 void DataInputStream::readFully( void* data, int size )
 {
-	int bytesread = FilterInputStream::read( data, size );
+	int bytesread = DataInputStream::read( data, size );
 	if ( bytesread != size )
 		throwError( IOException( Format("Unexpected end of file in {0}.",toString()) ) );
 }
 
-bool DataInputStream::readBoolean()
+int DataInputStream::available() const
 {
-	uint8_t v;
-	readFully( &v, sizeof(v) );
-	return v != 0;
+	return (m_readEnd - m_readPos) + FilterInputStream::available();
 }
 
-uint8_t DataInputStream::readByte()
+int DataInputStream::bytesRead() const
 {
-	int8_t v;
-	readFully( &v, sizeof(v) );
-	return v;
+	return FilterInputStream::bytesRead() - (m_readEnd - m_readPos);
 }
 
-char DataInputStream::readChar()
+void DataInputStream::setSource( InputStream* in, int bufsize )
 {
-	uint8_t v;
-	readFully( &v, sizeof(v) );
-	return (char)v;
+	assert( m_readPos == m_readEnd );
+	assert( bufsize >= 0 );
+
+	FilterInputStream::setSource( in );
+	m_readBuffer.resize( bufsize );
+	m_readPos = m_readEnd = 0;
+}
+
+void DataInputStream::fillBuffer()
+{
+	assert( m_readPos == m_readEnd );
+
+	// don't request more than available, some streams assert on reading past the end
+	int size = FilterInputStream::available();
+	if ( size > m_readBuffer.size() )
+		size = m_readBuffer.size();
+
+	int bytes = 0;
+	if ( size > 0 )
+		bytes = FilterInputStream::read( m_readBuffer.begin(), size );
+
+	m_readPos = m_readBuffer.begin();
+	m_readEnd = m_readPos + bytes;
 }
 
 String DataInputStream::readChars( int n )
@@ -89,30 +158,6 @@ double DataInputStream::readDouble()
 	return v;
 }
 
-float DataInputStream::readFloat()
-{
-	uint8_t bytes[ sizeof(float) ];
-	readBE( bytes, sizeof(bytes) );
-	float v = *reinterpret_cast<float*>(bytes);
-	return v;
-}
-
-int DataInputStream::readInt()
-{
-	uint8_t bytes[ sizeof(int32_t) ];
-	readBE( bytes, sizeof(bytes) );
-	int32_t v = *reinterpret_cast<int32_t*>(bytes);
-	return (int)v;
-}
-
-int DataInputStream::readShort()
-{
-	uint8_t bytes[ sizeof(int16_t) ];
-	readBE( bytes, sizeof(bytes) );
-	int16_t v = *reinterpret_cast<int16_t*>(bytes);
-	return (int)v;
-}
-
 String DataInputStream::readUTF()
 {
 	int encodedbytes = readShort();
@@ -152,12 +197,37 @@ void DataInputStream::readUTF( Array<char>& buf )
 	buf[encodedbytes] = 0;
 }
 
+void DataInputStream::readFloatArrayBE( float* data, int count )
+{
+	assert( sizeof(float) == sizeof(uint32_t) );
+
+	readFully( data, count*sizeof(float) );
+	if ( isLittleEndian() )
+	{
+		uint32_t* v = reinterpret_cast<uint32_t*>( data );
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			uint32_t x = v[i];
+			v[i] = (x>>24) + ((x>>8)&0xFF00) + ((x<<8)&0xFF0000) + (x<<24);
+		}
+	}
+}
+
+void DataInputStream::readInt16ArrayBE( int16_t* data, int count )
+{
+	readFully( data, count*sizeof(int16_t) );
+	if ( isLittleEndian() )
+	{
+		uint16_t* v = reinterpret_cast<uint16_t*>( data );
+		for ( int i = 0 ; i < count ; ++i )
+			v[i] = uint16_t( (v[i]>>8) + (v[i]<<8) );
+	}
+}
+
 void DataInputStream::readBE( void* data, int size )
 {
 	readFully( data, size );
-
-	int x = 1;
-	if ( 0 != *reinterpret_cast<char*>(&x) )
+	if ( isLittleEndian() )
 	{
 		uint8_t* begin = reinterpret_cast<uint8_t*>(data);
 		uint8_t* end = begin + size;
@@ -0,0 +1,143 @@
+#include <io/DeflateOutputStream.h>
+#include <io/IOException.h>
+#include <string.h>
+#include "zlib-1.2.1/zlib.h"
+#include <config.h>
+
+
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(io)
+
+
+DeflateOutputStream::DeflateOutputStream( OutputStream* target, int level, int blocksize ) :
+	m_target( target ),
+	m_zs( new z_stream ),
+	m_level( level ),
+	m_block( blocksize ),
+	m_compressed( compressBound(blocksize) ),
+	m_pos( 0 ),
+	m_bytesWritten( 0 ),
+	m_compressedBytesWritten( 0 ),
+	m_finished( false )
+{
+	assert( blocksize > 0 && blocksize <= MAX_BLOCK_SIZE );
+	assert( level >= 1 && level <= 9 );
+
+	memset( m_zs, 0, sizeof(z_stream) );
+	if ( Z_OK != deflateInit(m_zs,level) )
+	{
+		delete m_zs;
+		throwError( IOException( Format("Failed to initialize compression of {0}", target->toString()) ) );
+	}
+}
+
+DeflateOutputStream::~DeflateOutputStream()
+{
+	deflateEnd( m_zs );
+	delete m_zs;
+}
+
+void DeflateOutputStream::reset( OutputStream* target )
+{
+	m_target = target;
+	m_pos = 0;
+	m_bytesWritten = 0;
+	m_compressedBytesWritten = 0;
+	m_finished = false;
+}
+
+void DeflateOutputStream::write( const void* data, int size )
+{
+	assert( !m_finished );
+
+	const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+	while ( size > 0 )
+	{
+		int bytes = m_block.size() - m_pos;
+		if ( bytes > size )
+			bytes = size;
+		memcpy( m_block.begin()+m_pos, src, bytes );
+		m_pos += bytes;
+		src += bytes;
+		size -= bytes;
+		m_bytesWritten += bytes;
+
+		if ( m_pos == m_block.size() )
+			writeBlock();
+	}
+}
+
+void DeflateOutputStream::finish()
+{
+	if ( !m_finished )
+	{
+		if ( m_pos > 0 )
+			writeBlock();
+		writeHeader( 0, 0 );
+		m_finished = true;
+	}
+}
+
+void DeflateOutputStream::writeBlock()
+{
+	deflateReset( m_zs );
+	m_zs->next_in = m_block.begin();
+	m_zs->avail_in = m_pos;
+	m_zs->next_out = m_compressed.begin();
+	m_zs->avail_out = m_compressed.size();
+	if ( Z_STREAM_END != deflate(m_zs,Z_FINISH) )
+		throwError( IOException( Format("Failed to compress data to {0}", toString()) ) );
+
+	// store incompressible blocks as is
+	int compressedsize = (int)m_zs->total_out;
+	if ( compressedsize >= m_pos )
+	{
+		writeHeader( m_pos, m_pos );
+		m_target->write( m_block.begin(), m_pos );
+		m_compressedBytesWritten += m_pos;
+	}
+	else
+	{
+		writeHeader( m_pos, compressedsize );
+		m_target->write( m_compressed.begin(), compressedsize );
+		m_compressedBytesWritten += compressedsize;
+	}
+	m_pos = 0;
+}
+
+void DeflateOutputStream::writeHeader( int size, int compressedsize )
+{
+	uint8_t header[8];
+	header[0] = uint8_t( size >> 24 );
+	header[1] = uint8_t( size >> 16 );
+	header[2] = uint8_t( size >> 8 );
+	header[3] = uint8_t( size );
+	header[4] = uint8_t( compressedsize >> 24 );
+	header[5] = uint8_t( compressedsize >> 16 );
+	header[6] = uint8_t( compressedsize >> 8 );
+	header[7] = uint8_t( compressedsize );
+	m_target->write( header, sizeof(header) );
+	m_compressedBytesWritten += sizeof(header);
+}
+
+int DeflateOutputStream::bytesWritten() const
+{
+	return m_bytesWritten;
+}
+
+int DeflateOutputStream::compressedBytesWritten() const
+{
+	return m_compressedBytesWritten;
+}
+
+String DeflateOutputStream::toString() const
+{
+	return m_target->toString();
+}
+
+
+END_NAMESPACE() // io
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -44,6 +44,11 @@ int FilterInputStream::bytesRead() const
 	return m_bytesRead;
 }
 
+void FilterInputStream::setSource( InputStream* source )
+{
+	m_source = source;
+}
+
 
 END_NAMESPACE() // io
 
@@ -20,6 +20,13 @@ void FilterOutputStream::write( const void* data, int size )
 	m_bytesWritten += size;
 }
 
+void FilterOutputStream::writev( const void* const* data, const int* sizes, int count )
+{
+	m_target->writev( data, sizes, count );
+	for ( int i = 0 ; i < count ; ++i )
+		m_bytesWritten += sizes[i];
+}
+
 String FilterOutputStream::toString() const
 {
 	return m_target->toString();
@@ -30,6 +37,11 @@ int FilterOutputStream::bytesWritten() const
 	return m_bytesWritten;
 }
 
+void FilterOutputStream::setTarget( OutputStream* target )
+{
+	m_target = target;
+}
+
 
 END_NAMESPACE() // io
 
@@ -0,0 +1,140 @@
+#include <io/InflateInputStream.h>
+#include <io/DeflateOutputStream.h>
+#include <io/IOException.h>
+#include <string.h>
+#include "zlib-1.2.1/zlib.h"
+#include <config.h>
+
+
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(io)
+
+
+InflateInputStream::InflateInputStream( InputStream* source ) :
+	m_source( source ),
+	m_zs( new z_stream ),
+	m_pos( 0 ),
+	m_end( 0 ),
+	m_bytesRead( 0 )
+{
+	memset( m_zs, 0, sizeof(z_stream) );
+	if ( Z_OK != inflateInit(m_zs) )
+	{
+		delete m_zs;
+		throwError( IOException( Format("Failed to initialize decompression of {0}", source->toString()) ) );
+	}
+
+	readBlock();
+}
+
+InflateInputStream::~InflateInputStream()
+{
+	inflateEnd( m_zs );
+	delete m_zs;
+}
+
+void InflateInputStream::reset( InputStream* source )
+{
+	m_source = source;
+	m_pos = 0;
+	m_end = 0;
+	m_bytesRead = 0;
+	readBlock();
+}
+
+int InflateInputStream::read( void* data, int size )
+{
+	uint8_t* dst = reinterpret_cast<uint8_t*>(data);
+	int bytesread = 0;
+	while ( bytesread < size && m_pos < m_end )
+	{
+		int bytes = m_end - m_pos;
+		if ( bytes > size-bytesread )
+			bytes = size-bytesread;
+		memcpy( dst+bytesread, m_block.begin()+m_pos, bytes );
+		m_pos += bytes;
+		bytesread += bytes;
+
+		if ( m_pos == m_end )
+			readBlock();
+	}
+
+	m_bytesRead += bytesread;
+	return bytesread;
+}
+
+int InflateInputStream::available() const
+{
+	return m_end - m_pos;
+}
+
+int InflateInputStream::bytesRead() const
+{
+	return m_bytesRead;
+}
+
+String InflateInputStream::toString() const
+{
+	return m_source->toString();
+}
+
+void InflateInputStream::readBlock()
+{
+	m_pos = m_end = 0;
+
+	uint8_t header[8];
+	readSource( header, sizeof(header) );
+	int size = (header[0]<<24) + (header[1]<<16) + (header[2]<<8) + header[3];
+	int compressedsize = (header[4]<<24) + (header[5]<<16) + (header[6]<<8) + header[7];
+	if ( size < 0 || size > DeflateOutputStream::MAX_BLOCK_SIZE || compressedsize < 0 || compressedsize > size )
+		throwError( IOException( Format("Invalid compressed block in {0}", toString()) ) );
+
+	// end of stream
+	if ( 0 == size )
+		return;
+
+	if ( size > m_block.size() )
+		m_block.resize( size );
+
+	if ( compressedsize == size )
+	{
+		// stored block
+		readSource( m_block.begin(), size );
+	}
+	else
+	{
+		if ( compressedsize > m_compressed.size() )
+			m_compressed.resize( compressedsize );
+		readSource( m_compressed.begin(), compressedsize );
+
+		inflateReset( m_zs );
+		m_zs->next_in = m_compressed.begin();
+		m_zs->avail_in = compressedsize;
+		m_zs->next_out = m_block.begin();
+		m_zs->avail_out = size;
+		if ( Z_STREAM_END != inflate(m_zs,Z_FINISH) || (int)m_zs->total_out != size )
+			throwError( IOException( Format("Corrupted compressed data in {0}", toString()) ) );
+	}
+
+	m_end = size;
+}
+
+void InflateInputStream::readSource( void* data, int size )
+{
+	uint8_t* dst = reinterpret_cast<uint8_t*>(data);
+	while ( size > 0 )
+	{
+		int bytes = m_source->read( dst, size );
+		if ( bytes <= 0 )
+			throwError( IOException( Format("Unexpected end of compressed data in {0}", toString()) ) );
+		dst += bytes;
+		size -= bytes;
+	}
+}
+
+
+END_NAMESPACE() // io
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
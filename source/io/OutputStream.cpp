@@ -0,0 +1,19 @@
+#include <io/OutputStream.h>
+#include <config.h>
+
+
+BEGIN_NAMESPACE(io) 
+
+
+void OutputStream::writev( const void* const* data, const int* sizes, int count )
+{
+	assert( count >= 0 );
+
+	for ( int i = 0 ; i < count ; ++i )
+		write( data[i], sizes[i] );
+}
+
+
+END_NAMESPACE() // io
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
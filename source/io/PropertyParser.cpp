@@ -1,4 +1,5 @@
 #include <io/PropertyParser.h>
+#include <io/PropertyTokenizer.h>
 #include <io/IOException.h>
 #include <lang/Debug.h>
 #include <lang/algorithm/sort.h>
@@ -8,7 +9,6 @@
 #include <core/GCCResolver.h>
 #else
 #include <ctype.h>
-#include <stdio.h>
 #include <string.h>
 #endif
 
@@ -18,52 +18,47 @@ USING_NAMESPACE(lang)
 BEGIN_NAMESPACE(io) 
 
 
-PropertyParser::ConstIterator::ConstIterator( const PropertyParser* parser, int pos, int line ) :
+PropertyParser::ConstIterator::ConstIterator( const PropertyParser* parser, int index ) :
 	m_parser( parser ),
-	m_pos( pos ),
-	m_line( line )
+	m_index( index )
 {
-	if ( parser != 0 )
-		this->operator++();
 }
 
 PropertyParser::ConstIterator& PropertyParser::ConstIterator::operator++()
 {
 	assert( m_parser != 0 );
 
-	if ( m_parser->skipComments(m_pos,m_line) )
-	{
-		m_parser->parsePair( m_pos, m_line, m_parser->m_temp );
-	}
-	else
+	if ( ++m_index >= m_parser->m_pairs.size() )
 	{
 		m_parser = 0;
-		m_pos = 0;
+		m_index = 0;
 	}
 	return *this;
 }
 
 bool PropertyParser::ConstIterator::operator!=( const ConstIterator& other ) const
 {
-	return m_pos != other.m_pos || m_parser != other.m_parser;
+	return m_index != other.m_index || m_parser != other.m_parser;
 }
 
 const char* PropertyParser::ConstIterator::key() const
 {
-	const Array<char>& x = m_parser->m_temp;
-	return x.begin();
+	return m_parser->m_pairs[m_index].key;
 }
 
 const char* PropertyParser::ConstIterator::value() const
 {
-	const Array<char>& x = m_parser->m_temp;
-	return x.begin() + strlen(x.begin()) + 1;
+	return m_parser->m_pairs[m_index].value;
 }
 
 
-PropertyParser::PropertyParser() :
-	m_buf(),
-	m_len( 0 )
+bool PropertyParser::Pair::operator<( const Pair& other ) const
+{
+	return strcmp( key, other.key ) < 0;
+}
+
+
+PropertyParser::PropertyParser()
 {
 }
 
@@ -74,81 +69,100 @@ PropertyParser::PropertyParser( const String& buf, const String& name )
 
 void PropertyParser::reset( const String& buf, const String& name )
 {
-	// ignore comments in the text buffer
-	m_temp.clear();
-	for ( int i = 0 ; i < buf.length() ; ++i )
-	{
-		if ( i+1 < buf.length() && buf.charAt(i) == '-' && buf.charAt(i+1) == '-' )
-		{
-			for ( ; i < buf.length() && buf.charAt(i) != '\n' ; ++i )
-			{
-			}
-			for ( ; i < buf.length() && isspace(buf.charAt(i)) ; ++i )
-			{
-			}
-			--i;
-			continue;
-		}
-
-		m_temp.add( buf.charAt(i) );
-	}
-	m_temp.add( 0 );
-
-	m_buf = m_temp.begin();
-	m_len = m_buf.length();
 	m_name = name;
-	m_temp.clear();
-
-	// parse pairs to abc order
 	m_pairs.clear();
-	for ( ConstIterator it = begin() ; it != end() ; ++it )
+	m_sorted.clear();
+
+	// copy text once, pairs are 0-terminated in place
+	const int len = buf.length();
+	m_text.resize( len+1 );
+	buf.get( m_text.begin(), len+1 );
+
+	// tokenizer keeps name pointer, so use own copy instead of c_str()
+	m_nameText.resize( name.length()+1 );
+	name.get( m_nameText.begin(), m_nameText.size() );
+
+	// find (key,value) pairs, buffer cannot be modified until all pairs are found
+	char* text = m_text.begin();
+	PropertyTokenizer tokenizer( text, len, m_nameText.begin() );
+	PropertyView key, value;
+	while ( tokenizer.next(&key,&value) )
 	{
 		Pair pair;
-		pair.key = it.key();
-		pair.value = it.value();
+		pair.key = key.begin;
+		pair.value = value.begin;
+		pair.keyLength = key.length;
+		pair.valueLength = value.length;
 		m_pairs.add( pair );
 	}
-	LANG_SORT( m_pairs.begin(), m_pairs.end() );
+
+	// terminate pairs and convert keys to lower-case
+	for ( int i = 0 ; i < m_pairs.size() ; ++i )
+	{
+		char* key = text + (m_pairs[i].key - text);
+		for ( int k = 0 ; k < m_pairs[i].keyLength ; ++k )
+		{
+			if ( key[k] > 0 )
+				key[k] = (char)tolower( key[k] );
+		}
+		key[m_pairs[i].keyLength] = 0;
+		text[m_pairs[i].value - text + m_pairs[i].valueLength] = 0;
+	}
+
+	// sorted copy for binary search
+	m_sorted = m_pairs;
+	LANG_SORT( m_sorted.begin(), m_sorted.end() );
 }
 
-inline char PropertyParser::get( int pos ) const
+const char* PropertyParser::find( const char* key ) const
 {
-	assert( pos >= 0 && pos <= m_len );
-	return pos < m_len ? m_buf.charAt(pos) : 0;
+	// binary search
+	int i = 0;
+	int count = m_sorted.size();
+	while ( count > 0 )
+	{
+		int count2 = count >> 1;
+		int mid = i + count2;
+		if ( strcmp(m_sorted[mid].key,key) < 0 )
+		{
+			i = mid + 1;
+			count -= count2 + 1;
+		}
+		else
+			count = count2;
+	}
+
+	if ( i < m_sorted.size() && !strcmp(m_sorted[i].key,key) )
+		return m_sorted[i].value;
+	return 0;
 }
 
 const char* PropertyParser::getString( const char* key ) const
 {
 	assert( hasKey(key) );
-	if ( this->get(key,m_temp) )
-		return m_temp.begin();
-	return 0;
+	return find( key );
 }
 
 bool PropertyParser::getBoolean( const char* key ) const
 {
-	bool haskey = this->get( key, m_temp );
-	if ( !haskey )
+	const char* value = find( key );
+	if ( !value )
 		throwError( IOException(Format("Failed to parse boolean, no key {0} in \"{1}\"", key, m_name)) );
 
-	toLowerCase( m_temp );
-	if ( !strcmp(&m_temp[0],"enabled") || !strcmp(&m_temp[0],"true") || !strcmp(&m_temp[0],"1") || !strcmp(&m_temp[0],"yes") )
-		return true;
-	else if ( !strcmp(&m_temp[0],"disabled") || !strcmp(&m_temp[0],"false") || !strcmp(&m_temp[0],"0") || !strcmp(&m_temp[0],"no") )
-		return false;
-	else
+	bool v = false;
+	if ( !PropertyTokenizer::parseBoolean(PropertyView(value,strlen(value)),&v) )
 		throwError( IOException(Format("Failed to parse boolean {0} from \"{1}\"", key, m_name)) );
-	return false;
+	return v;
 }
 
 int PropertyParser::getInt( const char* key ) const
 {
-	bool haskey = this->get( key, m_temp );
-	if ( !haskey )
+	const char* value = find( key );
+	if ( !value )
 		throwError( IOException(Format("Failed to parse number, no key {0} in \"{1}\"", key, m_name)) );
 
 	double num = 0;
-	if ( sscanf(m_temp.begin(), "%lg", &num) != 1 )
+	if ( 0 == PropertyTokenizer::parseNumber(value,value+strlen(value),&num) )
 		throwError( IOException(Format("Failed to parse integer {0} from \"{1}\"", key, m_name)) );
 
 	int numi = (int)num;
@@ -160,181 +174,43 @@ int PropertyParser::getInt( const char* key ) const
 
 float PropertyParser::getFloat( const char* key ) const
 {
-	bool haskey = this->get( key, m_temp );
-	if ( !haskey )
+	const char* value = find( key );
+	if ( !value )
 		throwError( IOException(Format("Failed to parse number, no key {0} in \"{1}\"", key, m_name)) );
 
-	float num = 0.0f;
-	if ( sscanf(m_temp.begin(), "%g", &num) != 1 )
+	double num = 0;
+	if ( 0 == PropertyTokenizer::parseNumber(value,value+strlen(value),&num) )
 		throwError( IOException(Format("Failed to parse number {0} from \"{1}\"", key, m_name)) );
-	return num;
+	return (float)num;
 }
 
 bool PropertyParser::hasKey( const char* key ) const
 {
-	return this->get( key, m_temp );
+	return 0 != find( key );
 }
 
 bool PropertyParser::get( const char* key, Array<char>& x ) const
 {
-	// binary search
-	int i = 0;
-	int count = m_pairs.size();
-	while ( count > 0 )
-	{
-		int count2 = count >> 1;
-		int mid = i + count2;
-		if ( m_pairs[mid].key < key )
-		{
-			i = mid + 1;
-			count -= count2 + 1;
-		}
-		else
-			count = count2;
-	}
-
-	if ( i < m_pairs.size() && m_pairs[i].key == key )
-	{
-		const String& s = m_pairs[i].value;
-		x.resize( s.length()+1 );
-		s.get( x.begin(), x.size() );
-		return true;
-	}
-	return false;
-
-/*	for ( int i = 0 ; i < m_pairs.size() ; ++i )
-	{
-		if ( m_pairs[i].key == key )
-		{
-			const String& s = m_pairs[i].value;
-			x.resize( s.length()+1 );
-			s.get( x.begin(), x.size() );
-			return true;
-		}
-	}
-	return false;
-*/
-
-/*	
-	x.resize( 128 );
-	x.clear();
-	m_temp.clear();
-
-	int line = 1;
-	for ( int pos = 0 ; skipComments(pos,line) ; )
-	{
-		parsePair( pos, line, x );
-		if ( !strcmp(x.begin(),key) )
-		{
-			x.remove( 0, strlen(key)+1 );
-			return true;
-		}
-	}
-
-	x.clear();
-	return false;
-*/
-}
-
-void PropertyParser::parsePair( int& pos, int& line, Array<char>& x ) const
-{
-	// empty output buffer
-	x.clear();
-
-	// parse key
-	skipSpace( pos, line );
-	parseKey( pos, line, x );
-
-	// parse value
-	skipSpace( pos, line );
-	char ch = get(pos);
-	if ( ch != '=' )
-		throwError( IOException(Format("Missing \"{0}=<value>\" on line {1} of property set \"{2}\":\n{3}", x.begin(), line, m_name, m_buf)) );
-	skipSpace( ++pos, line );
-	parseValue( pos, line, x );
-}
-
-void PropertyParser::parseKey( int& pos, int& /*line*/, Array<char>& value ) const
-{
-	// read until whitespace or '=', eol or eof
-	for ( char ch=get(pos) ; 
-		ch != 0 && !isspace(ch) && ch != '=' ; 
-		ch=get(++pos) )
-	{
-		if ( ch > 0 )
-			ch = (char)tolower( ch );
-		value.add( ch );
-	}
-
-	value.add( 0 );
-}
-
-void PropertyParser::parseValue( int& pos, int& /*line*/, Array<char>& value ) const
-{
-	// read until eol or eof
-	for ( char ch = get(pos) ; ch != 0 && ch != '\n' && ch != ';' ; ch = get(++pos) )
-		value.add( ch );
-
-	// trim trailing whitespace
-	while ( value.size() > 0 && isspace(value.last()) )
-		value.resize( value.size()-1 );
-
-	value.add( 0 );
-}
-
-bool PropertyParser::skipLine( int& pos, int& line ) const
-{
-	while ( pos < m_len && get(pos) != '\n' )
-		++pos;
-	++line;
-	return pos < m_len;
-}
-
-bool PropertyParser::skipSpace( int& pos, int& line ) const
-{
-	for ( char ch = get(pos) ; pos < m_len && isspace(ch) ; ch = get(++pos) )
-	{
-		if ( ch == '\n' )
-			++line;
-	}
-	return get(pos) != 0;
-}
-
-bool PropertyParser::skipComments( int& pos, int& line ) const
-{
-	while ( skipSpace(pos,line) )
-	{
-		if ( isComment(pos) )
-			skipLine( pos, line );
-		else if ( !isspace(get(pos)) )
-			break;
-	}
-	return get(pos) != 0;
-}
+	const char* value = find( key );
+	if ( !value )
+		return false;
 
-bool PropertyParser::isComment( int pos ) const
-{
-	return pos+1 < m_len && get(pos) == '-' && get(pos+1) == '-';
+	int len = strlen( value );
+	x.resize( len+1 );
+	memcpy( x.begin(), value, len+1 );
+	return true;
 }
 
 PropertyParser::ConstIterator PropertyParser::begin() const
 {
-	return ConstIterator( this, 0, 1 );
+	if ( m_pairs.size() > 0 )
+		return ConstIterator( this, 0 );
+	return end();
 }
 
 PropertyParser::ConstIterator PropertyParser::end() const
 {
-	return ConstIterator( 0, 0, -1 );
-}
-
-void PropertyParser::toLowerCase( Array<char>& temp )
-{
-	// ignore case of boolean 
-	for ( int i = 0 ; i < temp.size() ; ++i )
-	{
-		if ( temp[i] > 0 )
-			temp[i] = (char)tolower( temp[i] );
-	}
+	return ConstIterator( 0, 0 );
 }
 
 
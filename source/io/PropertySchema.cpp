@@ -0,0 +1,125 @@
+#include <io/PropertySchema.h>
+#include <io/IOException.h>
+#include <lang/String.h>
+#include <lang/UTFConverter.h>
+#include <config.h>
+
+
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(io)
+
+
+PropertySchema::PropertySchema( const Field* fields, int count ) :
+	m_fields( fields ),
+	m_count( count )
+{
+	assert( count <= MAX_FIELDS );
+
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		const char* key = fields[i].key;
+		int len = 0;
+		while ( key[len] != 0 )
+			++len;
+		m_hashes[i] = hash( key, len );
+	}
+}
+
+uint32_t PropertySchema::hash( const char* s, int len )
+{
+	// FNV-1a of lower-case characters
+	uint32_t h = 2166136261U;
+	for ( int i = 0 ; i < len ; ++i )
+	{
+		char ch = s[i];
+		if ( ch >= 'A' && ch <= 'Z' )
+			ch = char( ch-'A'+'a' );
+		h = (h ^ uint8_t(ch)) * 16777619U;
+	}
+	return h;
+}
+
+int PropertySchema::getFieldIndex( const PropertyView& key ) const
+{
+	const uint32_t h = hash( key.begin, key.length );
+	for ( int i = 0 ; i < m_count ; ++i )
+	{
+		if ( m_hashes[i] == h && key.equalsIgnoreCase(m_fields[i].key) )
+			return i;
+	}
+	return -1;
+}
+
+uint32_t PropertySchema::parse( const char* buf, int len, void* obj, const char* name ) const
+{
+	uint32_t found = 0;
+	PropertyTokenizer tokenizer( buf, len, name );
+	PropertyView key, value;
+	while ( tokenizer.next(&key,&value) )
+	{
+		int i = getFieldIndex( key );
+		if ( i >= 0 )
+		{
+			setField( m_fields[i], value, obj, name, tokenizer.line() );
+			found |= 1U << i;
+		}
+	}
+	return found;
+}
+
+void PropertySchema::setField( const Field& field, const PropertyView& value, void* obj, const char* name, int line )
+{
+	uint8_t* dst = reinterpret_cast<uint8_t*>(obj) + field.offset;
+	bool ok = true;
+
+	switch ( field.type )
+	{
+	case FIELD_BOOLEAN:
+		ok = PropertyTokenizer::parseBoolean( value, reinterpret_cast<bool*>(dst) );
+		break;
+
+	case FIELD_INT:
+		ok = PropertyTokenizer::parseInt( value, reinterpret_cast<int*>(dst) );
+		break;
+
+	case FIELD_FLOAT:
+		ok = PropertyTokenizer::parseFloats( value, reinterpret_cast<float*>(dst), 1 ) == 1;
+		break;
+
+	case FIELD_FLOATS:
+		ok = PropertyTokenizer::parseFloats( value, reinterpret_cast<float*>(dst), field.count ) == field.count;
+		break;
+
+	case FIELD_VIEW:
+		*reinterpret_cast<PropertyView*>(dst) = value;
+		break;
+
+	case FIELD_STRING:
+		*reinterpret_cast<String*>(dst) = String( value.begin, value.length, UTFConverter(UTFConverter::ENCODING_UTF8) );
+		break;
+
+	case FIELD_ENUM:
+		{
+			int i = 0;
+			while ( i < field.count && !value.equalsIgnoreCase(field.names[i]) )
+				++i;
+			*reinterpret_cast<int*>(dst) = i;
+			ok = i < field.count;
+		}
+		break;
+	}
+
+	if ( !ok )
+	{
+		char valuebuf[256];
+		value.get( valuebuf, sizeof(valuebuf) );
+		throwError( IOException(Format("Failed to parse {0}={1} on line {2} of property set \"{3}\"", field.key, valuebuf, line, name)) );
+	}
+}
+
+
+END_NAMESPACE() // io
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -0,0 +1,266 @@
+#include <io/PropertyTokenizer.h>
+#include <io/IOException.h>
+#include <config.h>
+
+#ifdef REALVIEW_COMPILER
+#include <core/GCCResolver.h>
+#else
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(io)
+
+
+inline static bool isSpace( char ch )
+{
+	return 0 != isspace( (unsigned char)ch );
+}
+
+inline static bool isDigit( char ch )
+{
+	return ch >= '0' && ch <= '9';
+}
+
+inline static char toLower( char ch )
+{
+	return ch >= 'A' && ch <= 'Z' ? char(ch-'A'+'a') : ch;
+}
+
+/** 
+ * Parses number with strtod, accepts the same input as sscanf("%g")
+ * did before (e.g. inf, nan and hex values depending on C library). 
+ */
+static int parseNumberLibc( const char* s, const char* end, double* v )
+{
+	char buf[64];
+	int len = end - s;
+	if ( len >= (int)sizeof(buf) )
+		len = sizeof(buf)-1;
+	memcpy( buf, s, len );
+	buf[len] = 0;
+
+	char* bufend = buf;
+	double x = strtod( buf, &bufend );
+	if ( bufend == buf )
+		return 0;
+	*v = x;
+	return bufend - buf;
+}
+
+
+bool PropertyView::operator==( const char* sz ) const
+{
+	return 0 == strncmp(begin,sz,length) && 0 == sz[length];
+}
+
+bool PropertyView::equalsIgnoreCase( const char* sz ) const
+{
+	for ( int i = 0 ; i < length ; ++i )
+	{
+		if ( toLower(begin[i]) != toLower(sz[i]) || 0 == sz[i] )
+			return false;
+	}
+	return 0 == sz[length];
+}
+
+void PropertyView::get( char* buf, int bufsize ) const
+{
+	assert( bufsize > 0 );
+
+	int len = length < bufsize ? length : bufsize-1;
+	memcpy( buf, begin, len );
+	buf[len] = 0;
+}
+
+
+PropertyTokenizer::PropertyTokenizer( const char* buf, int len, const char* name ) :
+	m_buf( buf ),
+	m_end( buf+len ),
+	m_name( name ),
+	m_pos( 0 ),
+	m_line( 1 ),
+	m_nextLine( 1 )
+{
+}
+
+void PropertyTokenizer::skipSpaceAndComments()
+{
+	const int len = m_end - m_buf;
+	while ( m_pos < len )
+	{
+		char ch = m_buf[m_pos];
+		if ( ch == '\n' )
+		{
+			++m_nextLine;
+			++m_pos;
+		}
+		else if ( ch == ';' || isSpace(ch) )
+		{
+			++m_pos;
+		}
+		else if ( ch == '-' && m_pos+1 < len && m_buf[m_pos+1] == '-' )
+		{
+			while ( m_pos < len && m_buf[m_pos] != '\n' )
+				++m_pos;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+bool PropertyTokenizer::next( PropertyView* key, PropertyView* value )
+{
+	skipSpaceAndComments();
+
+	const int len = m_end - m_buf;
+	if ( m_pos >= len )
+		return false;
+	m_line = m_nextLine;
+
+	// key until whitespace or '='
+	int pos = m_pos;
+	while ( pos < len && m_buf[pos] != '=' && m_buf[pos] != ';' && !isSpace(m_buf[pos]) )
+		++pos;
+	*key = PropertyView( m_buf+m_pos, pos-m_pos );
+
+	while ( pos < len && m_buf[pos] != '\n' && isSpace(m_buf[pos]) )
+		++pos;
+	if ( pos >= len || m_buf[pos] != '=' )
+	{
+		char keybuf[256];
+		key->get( keybuf, sizeof(keybuf) );
+		throwError( IOException(Format("Missing \"{0}=<value>\" on line {1} of property set \"{2}\"", keybuf, m_line, m_name)) );
+	}
+
+	// value until eol, ';' or comment
+	++pos;
+	while ( pos < len && m_buf[pos] != '\n' && isSpace(m_buf[pos]) )
+		++pos;
+	int valuepos = pos;
+	while ( pos < len && m_buf[pos] != '\n' && m_buf[pos] != ';' &&
+		!(m_buf[pos] == '-' && pos+1 < len && m_buf[pos+1] == '-') )
+		++pos;
+	m_pos = pos;
+
+	// trim trailing whitespace
+	while ( pos > valuepos && isSpace(m_buf[pos-1]) )
+		--pos;
+	*value = PropertyView( m_buf+valuepos, pos-valuepos );
+	return true;
+}
+
+int PropertyTokenizer::parseNumber( const char* s, const char* end, double* v )
+{
+	static const double POW10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const int MAX_POW10 = sizeof(POW10)/sizeof(POW10[0]) - 1;
+
+	const char* p = s;
+	while ( p < end && isSpace(*p) )
+		++p;
+
+	bool neg = false;
+	if ( p < end && (*p == '-' || *p == '+') )
+		neg = ('-' == *p++);
+
+	// mantissa digits
+	double mantissa = 0.0;
+	int digits = 0;
+	int exp10 = 0;
+	for ( ; p < end && isDigit(*p) ; ++p, ++digits )
+		mantissa = mantissa*10.0 + double(*p-'0');
+	if ( p < end && *p == '.' )
+	{
+		for ( ++p ; p < end && isDigit(*p) ; ++p, ++digits, --exp10 )
+			mantissa = mantissa*10.0 + double(*p-'0');
+	}
+	if ( 0 == digits )
+		return parseNumberLibc( s, end, v );
+
+	// optional exponent
+	if ( p < end && (*p == 'e' || *p == 'E') )
+	{
+		const char* q = p+1;
+		bool expneg = false;
+		if ( q < end && (*q == '-' || *q == '+') )
+			expneg = ('-' == *q++);
+		if ( q < end && isDigit(*q) )
+		{
+			int e = 0;
+			for ( ; q < end && isDigit(*q) ; ++q )
+			{
+				if ( e < 10000 )
+					e = e*10 + (*q-'0');
+			}
+			exp10 += expneg ? -e : e;
+			p = q;
+		}
+	}
+
+	// let C library handle anything else than plain decimal number, e.g. 0x10
+	if ( p < end && isalpha((unsigned char)*p) )
+		return parseNumberLibc( s, end, v );
+
+	if ( exp10 < 0 )
+		mantissa = -exp10 <= MAX_POW10 ? mantissa / POW10[-exp10] : mantissa * pow( 10.0, exp10 );
+	else if ( exp10 > 0 )
+		mantissa = exp10 <= MAX_POW10 ? mantissa * POW10[exp10] : mantissa * pow( 10.0, exp10 );
+
+	*v = neg ? -mantissa : mantissa;
+	return p - s;
+}
+
+int PropertyTokenizer::parseFloats( const PropertyView& str, float* v, int count )
+{
+	const char* p = str.begin;
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		double x;
+		int n = parseNumber( p, str.end(), &x );
+		if ( 0 == n )
+			return i;
+		v[i] = (float)x;
+		p += n;
+	}
+	return count;
+}
+
+bool PropertyTokenizer::parseInt( const PropertyView& str, int* v )
+{
+	double num;
+	if ( 0 == parseNumber(str.begin,str.end(),&num) )
+		return false;
+
+	int numi = (int)num;
+	if ( numi != num )
+		return false;
+	*v = numi;
+	return true;
+}
+
+bool PropertyTokenizer::parseBoolean( const PropertyView& str, bool* v )
+{
+	if ( str.equalsIgnoreCase("enabled") || str.equalsIgnoreCase("true") || str == "1" || str.equalsIgnoreCase("yes") )
+		*v = true;
+	else if ( str.equalsIgnoreCase("disabled") || str.equalsIgnoreCase("false") || str == "0" || str.equalsIgnoreCase("no") )
+		*v = false;
+	else
+		return false;
+	return true;
+}
+
+
+END_NAMESPACE() // io
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
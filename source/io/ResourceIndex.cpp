@@ -0,0 +1,218 @@
+#include <io/ResourceIndex.h>
+#include <io/FindFile.h>
+#include <io/PathName.h>
+#include <io/IOException.h>
+#include <io/FileInputStream.h>
+#include <io/FileOutputStream.h>
+#include <io/DataInputStream.h>
+#include <io/DataOutputStream.h>
+#include <io/ByteArrayOutputStream.h>
+#include <lang/Debug.h>
+#include <config.h>
+
+
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(io)
+
+
+const char* const ResourceIndex::INDEX_FILENAME = "resources.idx";
+
+
+ResourceIndex::ResourceIndex( const String& path, bool update, const String& indexfilename ) :
+	m_path( path ),
+	m_indexFilename( indexfilename ),
+	m_names( 64, 0.75f, -1 ),
+	m_paths( 64, 0.75f, -1 )
+{
+	if ( m_indexFilename.length() == 0 )
+		m_indexFilename = PathName( m_path, INDEX_FILENAME ).toString();
+
+	if ( !load() || update )
+		this->update();
+}
+
+ResourceIndex::~ResourceIndex()
+{
+}
+
+bool ResourceIndex::load()
+{
+	// without FindFile the index cannot be built, so it must exist
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	if ( !FindFile::isFileExist(m_indexFilename,FindFile::FIND_FILESONLY) )
+		return false;
+#endif
+
+	FileInputStream filein( m_indexFilename );
+	DataInputStream in( &filein );
+
+	if ( in.readInt() != MAGIC || in.readInt() != VERSION )
+	{
+		Debug::printf( "io: Ignored resource index \"%s\" of old version\n", m_indexFilename.c_str() );
+		return false;
+	}
+
+	const int count = in.readInt();
+	if ( count < 0 )
+		throwError( IOException( Format("Invalid resource index {0}", m_indexFilename) ) );
+
+	m_entries.resize( count );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		Entry& entry = m_entries[i];
+		entry.path = PathName( m_path, in.readUTF() ).toString();
+		entry.size = in.readInt();
+		entry.writeTime = in.readInt();
+		uint32_t hi = (uint32_t)in.readInt();
+		uint32_t lo = (uint32_t)in.readInt();
+		entry.hash = (uint64_t(hi) << 32) | uint64_t(lo);
+	}
+
+	rebuildLookup();
+	return true;
+}
+
+void ResourceIndex::save()
+{
+	// paths are stored relative to the data directory
+	String prefix = PathName( m_path, "x" ).parent().toString();
+	int prefixlen = prefix.length();
+	if ( prefixlen > 0 && prefix.charAt(prefixlen-1) != '/' && prefix.charAt(prefixlen-1) != '\\' )
+		++prefixlen;
+
+	ByteArrayOutputStream bytes;
+	DataOutputStream out( &bytes );
+	out.writeInt( MAGIC );
+	out.writeInt( VERSION );
+	out.writeInt( m_entries.size() );
+	for ( int i = 0 ; i < m_entries.size() ; ++i )
+	{
+		const Entry& entry = m_entries[i];
+		if ( entry.path.startsWith(prefix) && entry.path.length() > prefixlen )
+			out.writeUTF( entry.path.substring(prefixlen) );
+		else
+			out.writeUTF( entry.path );
+		out.writeInt( entry.size );
+		out.writeInt( entry.writeTime );
+		out.writeInt( int(entry.hash >> 32) );
+		out.writeInt( int(entry.hash) );
+	}
+
+	FileOutputStream fileout( m_indexFilename );
+	bytes.writeTo( &fileout );
+}
+
+int ResourceIndex::update()
+{
+	int hashed = 0;
+
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+
+	Array<Entry> entries;
+	bool changed = false;
+	for ( FindFile ff( PathName(m_path,"*").toString() ) ; ff.more() ; ff.next() )
+	{
+		const FindFile::Data& data = ff.data();
+		if ( data.path.filename() == INDEX_FILENAME || m_indexFilename == data.path.toString() )
+			continue;
+
+		Entry entry;
+		entry.path = data.path.toString();
+		entry.size = (int)data.size;
+		entry.writeTime = (int)data.writeTime;
+
+		// rehash only new or modified files
+		const Entry* old = findByPath( entry.path );
+		if ( old != 0 && old->size == entry.size && old->writeTime == entry.writeTime )
+		{
+			entry.hash = old->hash;
+		}
+		else
+		{
+			entry.hash = hashFile( entry.path );
+			++hashed;
+			changed = true;
+		}
+		entries.add( entry );
+	}
+
+	if ( changed || entries.size() != m_entries.size() )
+	{
+		m_entries = entries;
+		rebuildLookup();
+		save();
+	}
+
+#endif // PLATFORM_SUPPORTS_FINDFILE
+
+	return hashed;
+}
+
+void ResourceIndex::rebuildLookup()
+{
+	m_names.clear();
+	m_paths.clear();
+	for ( int i = 0 ; i < m_entries.size() ; ++i )
+	{
+		const Entry& entry = m_entries[i];
+		m_paths[entry.path] = i;
+
+		String basename = PathName(entry.path).basename();
+		if ( m_names.get(basename) < 0 )
+			m_names[basename] = i;
+	}
+}
+
+const ResourceIndex::Entry* ResourceIndex::findByName( const String& basename ) const
+{
+	int i = m_names.get( basename );
+	return i >= 0 ? &m_entries[i] : 0;
+}
+
+const ResourceIndex::Entry* ResourceIndex::findByPath( const String& path ) const
+{
+	int i = m_paths.get( path );
+	return i >= 0 ? &m_entries[i] : 0;
+}
+
+uint64_t ResourceIndex::hashData( const void* data, int size )
+{
+	const uint64_t FNV_OFFSET_BASIS = (uint64_t(0xCBF29CE4U) << 32) | uint64_t(0x84222325U);
+	return hashData( data, size, FNV_OFFSET_BASIS );
+}
+
+uint64_t ResourceIndex::hashData( const void* data, int size, uint64_t hash )
+{
+	const uint64_t FNV_PRIME = (uint64_t(0x100U) << 32) | uint64_t(0x1B3U);
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+	for ( int i = 0 ; i < size ; ++i )
+		hash = (hash ^ p[i]) * FNV_PRIME;
+	return hash;
+}
+
+uint64_t ResourceIndex::hashFile( const String& filename )
+{
+	FileInputStream in( filename );
+	uint64_t hash = hashData( 0, 0 );
+	uint8_t buf[4096];
+	for ( int bytes = in.read(buf,sizeof(buf)) ; bytes > 0 ; bytes = in.read(buf,sizeof(buf)) )
+		hash = hashData( buf, bytes, hash );
+	return hash;
+}
+
+String ResourceIndex::toString( uint64_t hash )
+{
+	const char* const HEX = "0123456789abcdef";
+	char buf[17];
+	for ( int i = 0 ; i < 16 ; ++i )
+		buf[i] = HEX[ int(hash >> (60-i*4)) & 15 ];
+	buf[16] = 0;
+	return buf;
+}
+
+
+END_NAMESPACE() // io
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
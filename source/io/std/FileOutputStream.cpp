@@ -41,6 +41,21 @@ void FileOutputStream::write( const void* data, int size )
 		throwError( IOException( Format("Failed to write {1} bytes to {0}", toString(), size) ) );
 }
 
+void FileOutputStream::writev( const void* const* data, const int* sizes, int count )
+{
+	// stdio has no gather write, but small buffers are combined
+	// by the FILE buffer and large ones are passed through
+	// without copying, so one fwrite per buffer is enough
+	FILE* fh = reinterpret_cast<FILE*>(m_fh);
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		int size = sizes[i];
+		int bytes = fwrite( data[i], 1, size, fh );
+		if ( bytes < size && ferror(fh) )
+			throwError( IOException( Format("Failed to write {1} bytes to {0}", toString(), size) ) );
+	}
+}
+
 String FileOutputStream::toString() const
 {
 	return m_filename;
@@ -1,5 +1,7 @@
 #include <io/all.h> 
 #include <lang/all.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <config.h>
 
@@ -10,8 +12,421 @@ USING_NAMESPACE(lang)
 BEGIN_NAMESPACE(io) 
 
 
-static void run()
+/**
+ * Reads file as 32-bit big-endian values.
+ * @return Time in milliseconds.
+ */
+static int readBigEndianFile( const String& filename, int bufsize, bool bulk, uint32_t* checksum )
 {
+	int time = System::currentTimeMillis();
+
+	FileInputStream filein( filename );
+	DataInputStream in( &filein, bufsize );
+	const int count = in.available() / 4;
+
+	uint32_t sum = 0;
+	if ( bulk )
+	{
+		const int BLOCK = 256;
+		float buf[BLOCK];
+		for ( int i = 0 ; i < count ; i += BLOCK )
+		{
+			const int n = count-i < BLOCK ? count-i : BLOCK;
+			in.readFloatArrayBE( buf, n );
+			for ( int k = 0 ; k < n ; ++k )
+				sum += *reinterpret_cast<uint32_t*>( &buf[k] );
+		}
+	}
+	else
+	{
+		for ( int i = 0 ; i < count ; ++i )
+			sum += (uint32_t)in.readInt();
+	}
+
+	*checksum = sum;
+	return System::currentTimeMillis() - time;
+}
+
+static void benchmarkDataInputStream( const String& datapath )
+{
+	// read scene files value by value unbuffered and buffered, and in blocks
+	int bytes = 0;
+	int times[3] = {0,0,0};
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	for ( FindFile ff(PathName(datapath,"*.hgr").toString()) ; ff.more() ; ff.next() )
+	{
+		String filename = ff.data().path.toString();
+		uint32_t sums[3];
+		times[0] += readBigEndianFile( filename, 0, false, &sums[0] );
+		times[1] += readBigEndianFile( filename, DataInputStream::DEFAULT_BUFFER_SIZE, false, &sums[1] );
+		times[2] += readBigEndianFile( filename, DataInputStream::DEFAULT_BUFFER_SIZE, true, &sums[2] );
+		assert( sums[0] == sums[1] && sums[1] == sums[2] );
+		bytes += ff.data().size;
+	}
+#endif
+
+	Debug::printf( "io: Read %d KB of scene files: unbuffered %d ms, buffered %d ms, bulk %d ms\n",
+		bytes>>10, times[0], times[1], times[2] );
+}
+
+static void benchmarkCompression( const String& datapath )
+{
+	// compress scene files and load them raw and compressed
+	int bytes = 0;
+	int compressedbytes = 0;
+	int times[3] = {0,0,0};
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	const char* tempname = "iotest.tmp";
+	Array<uint8_t> data;
+	Array<uint8_t> data2;
+	Array<uint8_t> compressed;
+	for ( FindFile ff(PathName(datapath,"*.hgr").toString()) ; ff.more() ; ff.next() )
+	{
+		String filename = ff.data().path.toString();
+
+		int time = System::currentTimeMillis();
+		{
+			FileInputStream in( filename );
+			data.resize( in.available() );
+			in.read( data.begin(), data.size() );
+		}
+		times[0] += System::currentTimeMillis() - time;
+
+		time = System::currentTimeMillis();
+		ByteArrayOutputStream byteout( &compressed );
+		DeflateOutputStream out( &byteout, 9, DeflateOutputStream::LARGE_BLOCK_SIZE );
+		out.write( data.begin(), data.size() );
+		out.finish();
+		times[2] += System::currentTimeMillis() - time;
+
+		{
+			FileOutputStream fout( tempname );
+			fout.write( compressed.begin(), compressed.size() );
+		}
+
+		time = System::currentTimeMillis();
+		{
+			FileInputStream fin( tempname );
+			InflateInputStream in( &fin );
+			data2.resize( data.size() );
+			assert( in.read(data2.begin(),data2.size()) == data2.size() );
+			assert( in.available() == 0 );
+		}
+		times[1] += System::currentTimeMillis() - time;
+		assert( !memcmp(data.begin(),data2.begin(),data.size()) );
+
+		bytes += data.size();
+		compressedbytes += compressed.size();
+	}
+	remove( tempname );
+#endif
+
+	Debug::printf( "io: Loaded %d KB of scene files in %d ms, compressed to %d KB in %d ms, loaded compressed in %d ms\n",
+		bytes>>10, times[0], compressedbytes>>10, times[2], times[1] );
+}
+
+static int exportBigEndianFile( const Array<uint8_t>& data, ByteArrayOutputStream* byteout )
+{
+	int time = System::currentTimeMillis();
+
+	// write 32-bit values one by one like scene exporter does
+	DataOutputStream out( byteout );
+	const int count = data.size() / 4;
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		const uint8_t* p = data.begin() + i*4;
+		out.writeInt( (p[0]<<24) + (p[1]<<16) + (p[2]<<8) + p[3] );
+	}
+	out.write( data.begin()+count*4, data.size()-count*4 );
+
+	return System::currentTimeMillis() - time;
+}
+
+static void benchmarkByteArrayOutputStream( const String& datapath )
+{
+	// re-export scene files to contiguous and chunked memory buffers and save them
+	int bytes = 0;
+	int times[3] = {0,0,0};
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	const char* tempname = "iotest.tmp";
+	Array<uint8_t> data;
+	Array<uint8_t> contiguous;
+	ByteArrayOutputStream chunked;
+	for ( FindFile ff(PathName(datapath,"*.hgr").toString()) ; ff.more() ; ff.next() )
+	{
+		String filename = ff.data().path.toString();
+		{
+			FileInputStream in( filename );
+			data.resize( in.available() );
+			in.read( data.begin(), data.size() );
+		}
+
+		{
+			ByteArrayOutputStream byteout( &contiguous );
+			times[0] += exportBigEndianFile( data, &byteout );
+		}
+
+		chunked.reset();
+		times[1] += exportBigEndianFile( data, &chunked );
+
+		int time = System::currentTimeMillis();
+		{
+			FileOutputStream fout( tempname );
+			chunked.writeTo( &fout );
+		}
+		times[2] += System::currentTimeMillis() - time;
+
+		assert( contiguous.size() == data.size() );
+		assert( !memcmp(contiguous.begin(),data.begin(),data.size()) );
+		assert( chunked.size() == data.size() );
+		assert( !memcmp(chunked.toByteArray().begin(),data.begin(),data.size()) );
+		{
+			FileInputStream in( tempname );
+			assert( in.available() == data.size() );
+		}
+
+		bytes += data.size();
+	}
+	remove( tempname );
+#endif
+
+	Debug::printf( "io: Exported %d KB of scene files: contiguous buffer %d ms, chunked buffer %d ms, gather write to file %d ms\n",
+		bytes>>10, times[0], times[1], times[2] );
+}
+
+/**
+ * Builds resource index of the data directory and
+ * compares index lookups to directory scans.
+ */
+static void testResourceIndex( const String& datapath )
+{
+#ifdef PLATFORM_SUPPORTS_FINDFILE
+	const char* tempname = "iotest-resources.tmp";
+
+	int time = System::currentTimeMillis();
+	P(ResourceIndex) index = new ResourceIndex( datapath, true, tempname );
+	int buildtime = System::currentTimeMillis() - time;
+
+	int files = 0;
+	time = System::currentTimeMillis();
+	for ( FindFile ff(PathName(datapath,"*.hgr").toString()) ; ff.more() ; ff.next() )
+	{
+		const ResourceIndex::Entry* entry = index->findByName( ff.data().path.basename() );
+		assert( entry != 0 );
+		assert( entry->size == (int)ff.data().size );
+		assert( entry->hash == ResourceIndex::hashFile(entry->path) );
+		assert( index->findByPath(entry->path) == entry );
+		++files;
+	}
+	int scantime = System::currentTimeMillis() - time;
+
+	// reopened index is trusted without rehashing
+	time = System::currentTimeMillis();
+	P(ResourceIndex) index2 = new ResourceIndex( datapath, false, tempname );
+	int loadtime = System::currentTimeMillis() - time;
+	assert( index2->entries() == index->entries() );
+	for ( int i = 0 ; i < index->entries() ; ++i )
+		assert( index2->findByPath(index->getEntry(i).path)->hash == index->getEntry(i).hash );
+	assert( index2->update() == 0 );
+	remove( tempname );
+
+	Debug::printf( "io: Resource index of %d files: built in %d ms, loaded in %d ms, %d files verified by scan and hash in %d ms\n", index->entries(), buildtime, loadtime, files, scantime );
+#endif
+}
+
+/** Typical object user properties used by the property parsing tests. */
+struct TestProperties
+{
+	float			time;
+	float			mass;
+	int				count;
+	bool			visible;
+	float			color[3];
+	int				shape;
+	PropertyView	particle;
+};
+
+static const char* const TEST_SHAPES[] = {"box", "sphere", "trimesh"};
+
+static const PropertySchema::Field TEST_PROPERTY_FIELDS[] =
+{
+	PROPERTYSCHEMA_FIELD( TestProperties, "time", FIELD_FLOAT, time ),
+	PROPERTYSCHEMA_FIELD( TestProperties, "mass", FIELD_FLOAT, mass ),
+	PROPERTYSCHEMA_FIELD( TestProperties, "count", FIELD_INT, count ),
+	PROPERTYSCHEMA_FIELD( TestProperties, "visible", FIELD_BOOLEAN, visible ),
+	PROPERTYSCHEMA_FIELDN( TestProperties, "color", FIELD_FLOATS, color, 3, 0 ),
+	PROPERTYSCHEMA_FIELDN( TestProperties, "physics", FIELD_ENUM, shape, 3, TEST_SHAPES ),
+	PROPERTYSCHEMA_FIELD( TestProperties, "particle", FIELD_VIEW, particle ),
+};
+
+static const PropertySchema s_testPropertySchema( TEST_PROPERTY_FIELDS, sizeof(TEST_PROPERTY_FIELDS)/sizeof(TEST_PROPERTY_FIELDS[0]) );
+
+/**
+ * Compares PropertyParser and PropertySchema by parsing
+ * user properties of a large number of objects.
+ */
+static void benchmarkPropertyParsing()
+{
+	const char* props = "Physics=box\nMass = 12.5\n-- spawn settings\nParticle=smoke_01; Time=0.25\nColor=1 0.5 0.25\nVisible=true\nCount=3\n";
+	const String propstr = props;
+	const int objects = 10000;
+
+	int time = System::currentTimeMillis();
+	PropertyParser parser;
+	float sum1 = 0.f;
+	for ( int i = 0 ; i < objects ; ++i )
+	{
+		parser.reset( propstr, "object" );
+		sum1 += parser.getFloat("mass") + parser.getFloat("time") + (float)parser.getInt("count");
+	}
+	int parsertime = System::currentTimeMillis() - time;
+
+	time = System::currentTimeMillis();
+	float sum2 = 0.f;
+	const int len = propstr.length();
+	for ( int i = 0 ; i < objects ; ++i )
+	{
+		TestProperties prop;
+		s_testPropertySchema.parse( props, len, &prop, "object" );
+		sum2 += prop.mass + prop.time + (float)prop.count;
+	}
+	int schematime = System::currentTimeMillis() - time;
+	assert( sum1 == sum2 );
+
+	Debug::printf( "io: Parsed user properties of %d objects: PropertyParser %d ms, PropertySchema %d ms\n", objects, parsertime, schematime );
+}
+
+static void run( const String& datapath )
+{
+	// test DataInputStream
+	{
+		uint8_t data[100];
+		for ( int i = 0 ; i < (int)sizeof(data) ; ++i )
+			data[i] = uint8_t( i*7+3 );
+
+		// small buffer to test reads crossing buffer boundaries
+		for ( int bufsize = 0 ; bufsize <= 16 ; bufsize += 5 )
+		{
+			ByteArrayInputStream bytein( data, sizeof(data) );
+			DataInputStream in( &bytein, bufsize );
+			assert( in.readShort() == int16_t((data[0]<<8)+data[1]) );
+			assert( in.readByte() == data[2] );
+			assert( in.readInt() == int((data[3]<<24)+(data[4]<<16)+(data[5]<<8)+data[6]) );
+
+			int16_t v16[9];
+			in.readInt16ArrayBE( v16, 9 );
+			for ( int i = 0 ; i < 9 ; ++i )
+				assert( v16[i] == int16_t((data[7+i*2]<<8)+data[8+i*2]) );
+
+			assert( in.skip(5) == 5 );
+			float f[17];
+			in.readFloatArrayBE( f, 17 );
+			for ( int i = 0 ; i < 17 ; ++i )
+			{
+				const uint8_t* p = data + 30 + i*4;
+				uint32_t v = (p[0]<<24) + (p[1]<<16) + (p[2]<<8) + p[3];
+				assert( !memcmp(&f[i],&v,4) );
+			}
+
+			assert( in.bytesRead() == 98 );
+			assert( in.available() == 2 );
+			assert( in.readShort() == int16_t((data[98]<<8)+data[99]) );
+			assert( in.available() == 0 );
+		}
+	}
+
+	// test ByteArrayOutputStream
+	{
+		uint8_t data[1000];
+		for ( int i = 0 ; i < (int)sizeof(data) ; ++i )
+			data[i] = uint8_t( i*7+3 );
+
+		ByteArrayOutputStream byteout( 16 );
+		assert( byteout.chunks() == 0 );
+		for ( int pass = 0 ; pass < 2 ; ++pass )
+		{
+			byteout.reset();
+			for ( int i = 0 ; i < 500 ; i += 5 )
+				byteout.write( data+i, 5 );
+			byteout.reserve( 300 );
+			byteout.write( data+500, 300 );
+			byteout.write( data+800, 200 );
+			assert( byteout.size() == 1000 );
+
+			// reserved bytes are contiguous
+			int pos = 0;
+			bool found = false;
+			for ( int i = 0 ; i < byteout.chunks() ; ++i )
+			{
+				int size;
+				const uint8_t* chunk = byteout.chunk( i, &size );
+				assert( size > 0 );
+				assert( !memcmp(chunk,data+pos,size) );
+				found |= (pos <= 500 && pos+size >= 800);
+				pos += size;
+			}
+			assert( found );
+			assert( pos == 1000 );
+			assert( byteout.chunks() > 1 );
+
+			const Array<uint8_t>& bytes = byteout.toByteArray();
+			assert( bytes.size() == 1000 );
+			assert( !memcmp(bytes.begin(),data,1000) );
+
+			Array<uint8_t> copy;
+			ByteArrayOutputStream copyout( &copy );
+			FilterOutputStream out( &copyout );
+			byteout.writeTo( &out );
+			assert( out.bytesWritten() == 1000 );
+			assert( copyout.chunks() == 1 );
+			assert( !memcmp(copy.begin(),data,1000) );
+		}
+	}
+
+	// test DeflateOutputStream and InflateInputStream
+	{
+		// compressible and incompressible data, several blocks
+		Array<uint8_t> data;
+		uint32_t rnd = 1;
+		for ( int i = 0 ; i < 10000 ; ++i )
+		{
+			rnd = rnd*1664525 + 1013904223;
+			data.add( uint8_t(i < 5000 ? i/100 : rnd>>24) );
+		}
+
+		Array<uint8_t> compressed;
+		ByteArrayOutputStream byteout( &compressed );
+		DeflateOutputStream out( &byteout, 6, 4096 );
+		for ( int i = 0 ; i < data.size() ; i += 1000 )
+			out.write( data.begin()+i, 1000 );
+		out.finish();
+		assert( out.bytesWritten() == data.size() );
+		assert( out.compressedBytesWritten() == compressed.size() );
+		assert( compressed.size() < data.size() );
+
+		for ( int bufsize = 0 ; bufsize <= 100 ; bufsize += 100 )
+		{
+			ByteArrayInputStream bytein( compressed.begin(), compressed.size() );
+			InflateInputStream inflatein( &bytein );
+			DataInputStream in( &inflatein, bufsize );
+			assert( in.available() > 0 );
+			for ( int i = 0 ; i < data.size() ; ++i )
+				assert( in.readByte() == data[i] );
+			assert( in.available() == 0 );
+			assert( inflatein.bytesRead() == data.size() );
+		}
+
+		// empty stream
+		out.reset( &byteout );
+		byteout.reset();
+		out.finish();
+		ByteArrayInputStream bytein( compressed.begin(), compressed.size() );
+		InflateInputStream inflatein( &bytein );
+		uint8_t tmp[1];
+		assert( inflatein.available() == 0 );
+		assert( inflatein.read(tmp,1) == 0 );
+	}
+
 	// test PathName
 	{
 		assert( String("C:") == PathName("C:/mydocs/test.doc").drive() );
@@ -41,16 +456,91 @@ static void run()
 		PropertyParser::ConstIterator it = parser.begin();
 		assert( it == parser.end() );
 	}
+
+	// test PropertyParser (3)
+	{
+		PropertyParser parser( "Particle=smoke;Time = 1.5e1 -- comment\nFlag=Yes\nN=7", "test" );
+		PropertyParser::ConstIterator it = parser.begin();
+		assert( !strcmp(it.key(),"particle") && !strcmp(it.value(),"smoke") );
+		++it;
+		assert( !strcmp(it.key(),"time") && !strcmp(it.value(),"1.5e1") );
+		assert( parser.getFloat("time") == 15.f );
+		assert( parser.getBoolean("flag") );
+		assert( parser.getInt("n") == 7 );
+		assert( !parser.hasKey("Particle") );
+	}
+
+	// test PropertyParser (4), text longer than String::c_str() buffer
+	{
+		String text = "";
+		for ( int i = 0 ; i < 500 ; ++i )
+			text = text + Format("Key{0}={0}\n",i).format();
+		assert( text.length() > 4000 );
+		PropertyParser parser( text, "test" );
+		assert( parser.getInt("key0") == 0 );
+		assert( parser.getInt("key499") == 499 );
+	}
+
+	// test PropertyTokenizer number parsing accepts same input as C library
+	{
+		const char* nums[] = {"1.5", "  -2e3 ", "inf", "-INF", "nan", "0x10", "1e", ".5x", "abc", "-"};
+		for ( int i = 0 ; i < (int)(sizeof(nums)/sizeof(nums[0])) ; ++i )
+		{
+			char* end = 0;
+			double x = strtod( nums[i], &end );
+			double v = 0;
+			int n = PropertyTokenizer::parseNumber( nums[i], nums[i]+strlen(nums[i]), &v );
+			assert( n == end-nums[i] );
+			assert( v == x || (v != v && x != x) );
+		}
+	}
+
+	// test PropertyTokenizer
+	{
+		const char buf[] = "  key = some value \n-- comment\nX=-0.5 2 3e2";
+		PropertyTokenizer tokenizer( buf, sizeof(buf)-1, "test" );
+		PropertyView key, value;
+		assert( tokenizer.next(&key,&value) );
+		assert( key == "key" && value == "some value" );
+		assert( tokenizer.next(&key,&value) );
+		assert( key.equalsIgnoreCase("x") && tokenizer.line() == 3 );
+		float v[3];
+		assert( PropertyTokenizer::parseFloats(value,v,3) == 3 );
+		assert( v[0] == -0.5f && v[1] == 2.f && v[2] == 300.f );
+		assert( !tokenizer.next(&key,&value) );
+	}
+
+	// test PropertySchema
+	{
+		const char* props = "PHYSICS=sphere\nColor=1 0.5 0.25\nvisible=disabled\nunknown=1\nParticle=fire";
+		TestProperties prop;
+		uint32_t found = s_testPropertySchema.parse( props, strlen(props), &prop, "test" );
+		assert( found == ((1<<4)|(1<<5)|(1<<3)|(1<<6)) );
+		assert( prop.shape == 1 );
+		assert( prop.color[1] == .5f );
+		assert( !prop.visible );
+		assert( prop.particle == "fire" );
+
+		// enum names are matched without case
+		const char* props2 = "Physics=TriMesh";
+		assert( s_testPropertySchema.parse(props2,strlen(props2),&prop,"test") == (1<<5) );
+		assert( prop.shape == 2 );
+	}
 }
 
-void test()
+void test( const String& datapath )
 {
 	String libname = "io";
 
 	Debug::printf( "\n-------------------------------------------------------------------------\n" );
 	Debug::printf( "%s library test begin\n", libname.c_str() );
 	Debug::printf( "-------------------------------------------------------------------------\n" );
-	run();
+	run( datapath );
+	benchmarkDataInputStream( datapath );
+	benchmarkCompression( datapath );
+	benchmarkByteArrayOutputStream( datapath );
+	benchmarkPropertyParsing();
+	testResourceIndex( datapath );
 	Debug::printf( "%s library test ok\n", libname.c_str() );
 }
 
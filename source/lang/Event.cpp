@@ -0,0 +1,57 @@
+#include <lang/Event.h>
+#include <lang/pp.h>
+
+#ifdef PLATFORM_WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#include <config.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+Event::Event( bool manualreset, bool signaled ) :
+	m_handle( 0 )
+{
+#ifdef PLATFORM_WIN32
+	m_handle = CreateEvent( 0, manualreset ? TRUE : FALSE, signaled ? TRUE : FALSE, 0 );
+#else
+	(void)manualreset;
+	(void)signaled;
+#endif
+}
+
+Event::~Event()
+{
+#ifdef PLATFORM_WIN32
+	CloseHandle( m_handle );
+#endif
+}
+
+void Event::set()
+{
+#ifdef PLATFORM_WIN32
+	SetEvent( m_handle );
+#endif
+}
+
+void Event::reset()
+{
+#ifdef PLATFORM_WIN32
+	ResetEvent( m_handle );
+#endif
+}
+
+void Event::wait()
+{
+#ifdef PLATFORM_WIN32
+	WaitForSingleObject( m_handle, INFINITE );
+#endif
+}
+
+
+END_NAMESPACE() // lang
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
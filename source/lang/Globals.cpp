@@ -5,9 +5,11 @@
 
 #ifdef PLATFORM_WIN32
 	#define DEFAULT_STRING_MEMORY	100000
+	#define THREAD_STRING_MEMORY	10000
 	#define TEMPBUFFER_MEMORY		0x10000
 #else
 	#define DEFAULT_STRING_MEMORY	10000
+	#define THREAD_STRING_MEMORY	10000
 	#define TEMPBUFFER_MEMORY		0x10000
 #endif
 
@@ -15,6 +17,11 @@
 BEGIN_NAMESPACE(lang) 
 
 
+#ifdef LANG_THREADLOCAL
+LANG_THREADLOCAL lang_Globals* lang_Globals::sm_threadGlobals = 0;
+#endif
+
+
 lang_Globals::lang_Globals( int stringmem, int tempmem ) :
 	stringPool(stringmem,0,"String"),
 	cstrBufferIndex(0)
@@ -49,6 +56,22 @@ void lang_Globals::cleanup()
 	GlobalStorage::get().langGlobals = 0;
 }
 
+void lang_Globals::initThread()
+{
+#ifdef LANG_THREADLOCAL
+	cleanupThread();
+	sm_threadGlobals = new lang_Globals( THREAD_STRING_MEMORY, TEMPBUFFER_MEMORY );
+#endif
+}
+
+void lang_Globals::cleanupThread()
+{
+#ifdef LANG_THREADLOCAL
+	delete sm_threadGlobals;
+	sm_threadGlobals = 0;
+#endif
+}
+
 
 END_NAMESPACE() // lang
 
@@ -0,0 +1,51 @@
+#include <lang/Mutex.h>
+#include <lang/pp.h>
+
+#ifdef PLATFORM_WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#include <config.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+Mutex::Mutex() :
+	m_handle( 0 )
+{
+#ifdef PLATFORM_WIN32
+	CRITICAL_SECTION* cs = new CRITICAL_SECTION;
+	InitializeCriticalSection( cs );
+	m_handle = cs;
+#endif
+}
+
+Mutex::~Mutex()
+{
+#ifdef PLATFORM_WIN32
+	CRITICAL_SECTION* cs = reinterpret_cast<CRITICAL_SECTION*>( m_handle );
+	DeleteCriticalSection( cs );
+	delete cs;
+#endif
+}
+
+void Mutex::lock()
+{
+#ifdef PLATFORM_WIN32
+	EnterCriticalSection( reinterpret_cast<CRITICAL_SECTION*>(m_handle) );
+#endif
+}
+
+void Mutex::unlock()
+{
+#ifdef PLATFORM_WIN32
+	LeaveCriticalSection( reinterpret_cast<CRITICAL_SECTION*>(m_handle) );
+#endif
+}
+
+
+END_NAMESPACE() // lang
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -26,9 +26,26 @@ static int allocateString( int len )
 
 static int allocateString( const void* data, int bytes, const Converter& decoder )
 {
+	// bulk conversion, short strings are converted only once via stack buffer
+	char tmp[256];
+	int len = decoder.toUTF8( data, bytes, tmp, sizeof(tmp) );
+	if ( len >= 0 )
+	{
+		int strh = allocateString( len );
+		if ( len > 0 )
+		{
+			char* s = lang_Globals::get().stringPool.get(strh);
+			if ( len <= (int)sizeof(tmp) )
+				memcpy( s, tmp, len );
+			else
+				decoder.toUTF8( data, bytes, s, len );
+		}
+		return strh;
+	}
+
 	// find out UTF-8 length
 	const uint8_t* databytes = reinterpret_cast<const uint8_t*>(data);
-	int len = 0;
+	len = 0;
 	UTFConverter encoder( UTFConverter::ENCODING_UTF8 );
 	char buf[32];
 	for ( int i = 0 ; i < bytes ; )
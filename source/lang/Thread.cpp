@@ -0,0 +1,88 @@
+#include <lang/Thread.h>
+#include <lang/Globals.h>
+#include <lang/pp.h>
+
+#ifdef PLATFORM_WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <process.h>
+#endif
+
+#include <config.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+#ifdef PLATFORM_WIN32
+static unsigned __stdcall threadMain( void* arg )
+{
+	// thread has private string pool and temporary buffers
+	lang_Globals::initThread();
+	reinterpret_cast<Thread*>(arg)->run();
+	lang_Globals::cleanupThread();
+	return 0;
+}
+#endif
+
+Thread::Thread() :
+	m_handle( 0 )
+{
+}
+
+Thread::~Thread()
+{
+	join();
+}
+
+void Thread::start()
+{
+	join();
+
+#ifdef PLATFORM_WIN32
+	// _beginthreadex instead of CreateThread so that CRT is initialized for the thread
+	unsigned id = 0;
+	m_handle = reinterpret_cast<void*>( _beginthreadex( 0, 0, threadMain, this, 0, &id ) );
+	if ( m_handle == 0 )
+		run();
+#else
+	run();
+#endif
+}
+
+void Thread::join()
+{
+#ifdef PLATFORM_WIN32
+	if ( m_handle != 0 )
+	{
+		WaitForSingleObject( m_handle, INFINITE );
+		CloseHandle( m_handle );
+		m_handle = 0;
+	}
+#endif
+}
+
+void Thread::sleep( int millis )
+{
+#ifdef PLATFORM_WIN32
+	Sleep( millis );
+#else
+	(void)millis;
+#endif
+}
+
+int Thread::processors()
+{
+#ifdef PLATFORM_WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+	return 1;
+#endif
+}
+
+
+END_NAMESPACE() // lang
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -0,0 +1,214 @@
+#include <lang/ThreadPool.h>
+#include <lang/pp.h>
+
+#ifdef PLATFORM_WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#include <config.h>
+
+
+BEGIN_NAMESPACE(lang) 
+
+
+class ThreadPool::Worker :
+	public Thread
+{
+public:
+	explicit Worker( ThreadPool* pool ) : m_pool(pool) {}
+	~Worker() {join();}
+	void run() {m_pool->workerMain();}
+
+private:
+	ThreadPool* m_pool;
+};
+
+
+ThreadPool::Batch::Batch() :
+	m_pending( 0 ),
+	m_done( true, true )
+{
+}
+
+ThreadPool::Batch::~Batch()
+{
+	assert( 0 == m_pending );
+}
+
+
+ThreadPool::ThreadPool( int threads ) :
+	m_next( 0 ),
+	m_pending( 0 ),
+	m_quit( false ),
+	m_jobSema( 0 ),
+	m_done( true, true )
+{
+	if ( threads < 0 )
+		threads = Thread::processors() - 1;
+
+#ifdef PLATFORM_WIN32
+	if ( threads > 0 )
+	{
+		m_jobSema = CreateSemaphore( 0, 0, 0x7FFFFFFF, 0 );
+		for ( int i = 0 ; i < threads ; ++i )
+		{
+			Worker* worker = new Worker( this );
+			m_workers.add( worker );
+			worker->start();
+		}
+	}
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+
+	m_mutex.lock();
+	m_quit = true;
+	m_mutex.unlock();
+
+#ifdef PLATFORM_WIN32
+	if ( m_workers.size() > 0 )
+	{
+		ReleaseSemaphore( m_jobSema, m_workers.size(), 0 );
+		for ( int i = 0 ; i < m_workers.size() ; ++i )
+			delete m_workers[i];
+		CloseHandle( m_jobSema );
+	}
+#endif
+}
+
+void ThreadPool::add( Job* job )
+{
+	add( job, 0 );
+}
+
+void ThreadPool::add( Job* job, Batch* batch )
+{
+	assert( job != 0 );
+
+	m_mutex.lock();
+	job->m_batch = batch;
+	if ( batch != 0 && batch->m_pending++ == 0 )
+		batch->m_done.reset();
+	m_jobs.add( job );
+	if ( m_pending++ == 0 )
+		m_done.reset();
+	m_mutex.unlock();
+
+#ifdef PLATFORM_WIN32
+	if ( m_jobSema != 0 )
+		ReleaseSemaphore( m_jobSema, 1, 0 );
+#endif
+}
+
+void ThreadPool::wait()
+{
+	for ( Job* job = nextJob(0) ; job != 0 ; job = nextJob(0) )
+	{
+		Batch* batch = job->m_batch;
+		job->run();
+		finishJob( batch );
+	}
+
+	m_done.wait();
+}
+
+void ThreadPool::wait( Batch* batch )
+{
+	assert( batch != 0 );
+
+	for ( Job* job = nextJob(batch) ; job != 0 ; job = nextJob(batch) )
+	{
+		job->run();
+		finishJob( batch );
+	}
+
+	batch->m_done.wait();
+
+	// make sure the thread which finished the last job has released the batch
+	Mutex::Lock lk( m_mutex );
+}
+
+int ThreadPool::threads() const
+{
+	return m_workers.size();
+}
+
+int ThreadPool::pending() const
+{
+	Mutex::Lock lk( m_mutex );
+	return m_pending;
+}
+
+ThreadPool::Job* ThreadPool::nextJob( Batch* batch )
+{
+	Mutex::Lock lk( m_mutex );
+	for ( int i = m_next ; i < m_jobs.size() ; ++i )
+	{
+		// jobs are executed in arbitrary order, so job can be swapped to the front
+		Job* job = m_jobs[i];
+		if ( 0 == batch || job->m_batch == batch )
+		{
+			m_jobs[i] = m_jobs[m_next];
+			m_jobs[m_next++] = job;
+			return job;
+		}
+	}
+
+	// all queued jobs taken
+	if ( m_next == m_jobs.size() )
+	{
+		m_jobs.clear();
+		m_next = 0;
+	}
+	return 0;
+}
+
+void ThreadPool::finishJob( Batch* batch )
+{
+	Mutex::Lock lk( m_mutex );
+	if ( batch != 0 )
+	{
+		assert( batch->m_pending > 0 );
+		if ( --batch->m_pending == 0 )
+			batch->m_done.set();
+	}
+
+	assert( m_pending > 0 );
+	if ( --m_pending == 0 )
+		m_done.set();
+}
+
+void ThreadPool::workerMain()
+{
+#ifdef PLATFORM_WIN32
+	for (;;)
+	{
+		// semaphore is signaled once per added job and once per worker at exit
+		WaitForSingleObject( m_jobSema, INFINITE );
+
+		m_mutex.lock();
+		bool quit = m_quit;
+		m_mutex.unlock();
+		if ( quit )
+			break;
+
+		// job might have been already taken by thread in wait()
+		Job* job = nextJob( 0 );
+		if ( job != 0 )
+		{
+			Batch* batch = job->m_batch;
+			job->run();
+			finishJob( batch );
+		}
+	}
+#endif
+}
+
+
+END_NAMESPACE() // lang
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
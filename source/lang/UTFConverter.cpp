@@ -211,6 +211,33 @@ static bool encode_ASCII7( uint8_t* dst, int dstsize, int* dstbytes, int cp )
 	return !err;
 }
 
+static bool encode_LATIN1( uint8_t* dst, int dstsize, int* dstbytes, int cp )
+{
+	const uint8_t*	dst0	= dst;
+	int				err		= 0;
+
+	if ( dstsize >= 1 )
+	{
+		if ( cp < 0 || cp >= 256 )
+		{
+			// ERROR: Out-of-range Latin-1 code
+			err = 1;
+		}
+		else
+		{
+			*dst++ = (uint8_t)cp;
+		}
+	}
+	else
+	{
+		// ERROR: Not enough buffer space
+		err = 5;
+	}
+
+	*dstbytes = (dst-dst0);
+	return !err;
+}
+
 static bool encode_UTF8( uint8_t* dst, int dstsize, int* dstbytes, int cp )
 {
 	const uint8_t*	dst0	= dst;
@@ -363,6 +390,186 @@ static bool encode_UTF32( uint8_t* dst, int dstsize, int* dstbytes, int cp, bool
 	return !err;
 }
 
+/**
+ * Returns true if 16 bytes are all ASCII-7.
+ * Bytes are tested four at a time in 32-bit words.
+ */
+inline static bool isASCII16( const uint8_t* src )
+{
+	uint32_t v[4];
+	memcpy( v, src, sizeof(v) );
+	return 0 == ( (v[0]|v[1]|v[2]|v[3]) & 0x80808080U );
+}
+
+/**
+ * Validates single multibyte UTF-8 sequence.
+ * @return Length of the sequence or 0 if the sequence is malformed.
+ */
+static int validateUTF8Sequence( const uint8_t* src, int srcsize )
+{
+	const uint8_t first = src[0];
+	int bytes;
+	int cp;
+	if ( first >= 0xC2 && first <= 0xDF )
+	{
+		bytes = 2;
+		cp = first & 0x1F;
+	}
+	else if ( first >= 0xE0 && first <= 0xEF )
+	{
+		bytes = 3;
+		cp = first & 0x0F;
+	}
+	else if ( first >= 0xF0 && first <= 0xF4 )
+	{
+		bytes = 4;
+		cp = first & 0x07;
+	}
+	else
+	{
+		return 0;
+	}
+
+	if ( srcsize < bytes )
+		return 0;
+	for ( int i = 1 ; i < bytes ; ++i )
+	{
+		if ( 0x80 != (src[i] & 0xC0) )
+			return 0;
+		cp = (cp << 6) + (src[i] & 0x3F);
+	}
+
+	// reject overlong forms, surrogates and too large code points
+	if ( 3 == bytes && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF)) )
+		return 0;
+	if ( 4 == bytes && (cp < 0x10000 || cp > 0x10FFFF) )
+		return 0;
+	return bytes;
+}
+
+static int toUTF8_UTF8( const uint8_t* src, int srcsize, char* dst, int dstsize )
+{
+	if ( srcsize > dstsize )
+		dst = 0;
+
+	int i = 0;
+	while ( i < srcsize )
+	{
+		// copy ASCII run
+		int run = i;
+		while ( run+16 <= srcsize && isASCII16(src+run) )
+			run += 16;
+		while ( run < srcsize && src[run] < 0x80 )
+			++run;
+		if ( dst )
+			memcpy( dst+i, src+i, run-i );
+		i = run;
+
+		if ( i < srcsize )
+		{
+			int bytes = validateUTF8Sequence( src+i, srcsize-i );
+			if ( 0 == bytes )
+				return -1;
+			if ( dst )
+				memcpy( dst+i, src+i, bytes );
+			i += bytes;
+		}
+	}
+	return srcsize;
+}
+
+static int toUTF8_LATIN1( const uint8_t* src, int srcsize, char* dst, int dstsize )
+{
+	int len = 0;
+	int i = 0;
+	while ( i < srcsize )
+	{
+		// copy ASCII run
+		int run = i;
+		while ( run+16 <= srcsize && isASCII16(src+run) )
+			run += 16;
+		while ( run < srcsize && src[run] < 0x80 )
+			++run;
+		if ( len+(run-i) > dstsize )
+			dst = 0;
+		if ( dst )
+			memcpy( dst+len, src+i, run-i );
+		len += run-i;
+		i = run;
+
+		if ( i < srcsize )
+		{
+			if ( len+2 > dstsize )
+				dst = 0;
+			if ( dst )
+			{
+				dst[len] = char( 0xC0 | (src[i]>>6) );
+				dst[len+1] = char( 0x80 | (src[i]&0x3F) );
+			}
+			len += 2;
+			++i;
+		}
+	}
+	return len;
+}
+
+static int toUTF8_ASCII7( const uint8_t* src, int srcsize, char* dst, int dstsize )
+{
+	if ( UTFConverter::countASCII(src,srcsize) != srcsize )
+		return -1;
+	if ( dst && srcsize <= dstsize )
+		memcpy( dst, src, srcsize );
+	return srcsize;
+}
+
+static int toUTF8_UTF16( const uint8_t* src, int srcsize, char* dst, int dstsize, bool bigendian )
+{
+	const int hi = bigendian ? 0 : 1;
+	const int lo = 1-hi;
+	const int units = srcsize >> 1;
+	int len = 0;
+
+	for ( int i = 0 ; i < units ; ++i )
+	{
+		int cp = (int(src[i*2+hi])<<8) + int(src[i*2+lo]);
+		int bytes;
+		if ( cp < 0x80 )
+		{
+			bytes = 1;
+		}
+		else if ( cp < 0x800 )
+		{
+			bytes = 2;
+		}
+		else if ( cp < 0xD800 || cp > 0xDFFF )
+		{
+			bytes = 3;
+		}
+		else
+		{
+			// surrogate pair, unpaired surrogates are left to per code point decoding
+			if ( cp >= 0xDC00 || i+1 >= units )
+				return -1;
+			int cp2 = (int(src[i*2+2+hi])<<8) + int(src[i*2+2+lo]);
+			if ( cp2 < 0xDC00 || cp2 > 0xDFFF )
+				return -1;
+			cp = ((cp-0xD800)<<10) + (cp2-0xDC00) + 0x10000;
+			bytes = 4;
+			++i;
+		}
+
+		if ( len+bytes > dstsize )
+			dst = 0;
+		if ( dst )
+		{
+			int encodedbytes;
+			encode_UTF8( reinterpret_cast<uint8_t*>(dst+len), bytes, &encodedbytes, cp );
+		}
+		len += bytes;
+	}
+	return len;
+}
+
 inline static bool littleEndian()
 {
 	int x = 1;
@@ -399,6 +606,7 @@ bool UTFConverter::decode( const void* src, const void* srcend, int* srcbytes, i
 	{
 	case ENCODING_UNKNOWN:	return false;
 	case ENCODING_ASCII7:	return decode_ASCII7( bsrc, srcsize, srcbytes, dst );
+	case ENCODING_LATIN1:	return decode_ASCII7( bsrc, srcsize, srcbytes, dst );
 	case ENCODING_UTF8:		return decode_UTF8	( bsrc, srcsize, srcbytes, dst );
 	case ENCODING_UTF16BE:	return decode_UTF16	( bsrc, srcsize, srcbytes, dst, true );
 	case ENCODING_UTF16LE:	return decode_UTF16	( bsrc, srcsize, srcbytes, dst, false );
@@ -420,6 +628,7 @@ bool UTFConverter::encode( void* dst, void* dstend, int* dstbytes, int src ) con
 	{
 	case ENCODING_UNKNOWN:	return false;
 	case ENCODING_ASCII7:	return encode_ASCII7( bdst, dstsize, dstbytes, src );
+	case ENCODING_LATIN1:	return encode_LATIN1( bdst, dstsize, dstbytes, src );
 	case ENCODING_UTF8:		return encode_UTF8	( bdst, dstsize, dstbytes, src );
 	case ENCODING_UTF16BE:	return encode_UTF16	( bdst, dstsize, dstbytes, src, true );
 	case ENCODING_UTF16LE:	return encode_UTF16	( bdst, dstsize, dstbytes, src, false );
@@ -431,6 +640,39 @@ bool UTFConverter::encode( void* dst, void* dstend, int* dstbytes, int src ) con
 	return false;
 }
 
+int UTFConverter::toUTF8( const void* src, int srcsize, char* dst, int dstsize ) const
+{
+	const uint8_t* bsrc = reinterpret_cast<const uint8_t*>( src );
+	if ( !dst )
+		dstsize = 0;
+
+	switch ( EncodingType(m_type) )
+	{
+	case ENCODING_ASCII7:	return toUTF8_ASCII7( bsrc, srcsize, dst, dstsize );
+	case ENCODING_LATIN1:	return toUTF8_LATIN1( bsrc, srcsize, dst, dstsize );
+	case ENCODING_UTF8:		return toUTF8_UTF8	( bsrc, srcsize, dst, dstsize );
+	case ENCODING_UTF16BE:	return toUTF8_UTF16	( bsrc, srcsize, dst, dstsize, true );
+	case ENCODING_UTF16LE:	return toUTF8_UTF16	( bsrc, srcsize, dst, dstsize, false );
+	default:				return -1;
+	}
+}
+
+int UTFConverter::countASCII( const void* src, int srcsize )
+{
+	const uint8_t* bsrc = reinterpret_cast<const uint8_t*>( src );
+	int i = 0;
+	while ( i+16 <= srcsize && isASCII16(bsrc+i) )
+		i += 16;
+	while ( i < srcsize && bsrc[i] < 0x80 )
+		++i;
+	return i;
+}
+
+bool UTFConverter::isValidUTF8( const void* src, int srcsize )
+{
+	return toUTF8_UTF8( reinterpret_cast<const uint8_t*>(src), srcsize, 0, 0 ) == srcsize;
+}
+
 
 END_NAMESPACE() // lang
 
@@ -1,5 +1,6 @@
 #include <lang/all.h> 
 #include <stdio.h>
+#include <string.h>
 #include <config.h>
 
 
@@ -16,6 +17,48 @@ private:
 	TestItem& operator=( const TestItem& );
 };
 
+class TestJob : public ThreadPool::Job
+{
+public:
+	int		value;
+	int		result;
+
+	void run() {result = value*value;}
+};
+
+
+/** Forwards per code point conversion only, so String uses the legacy path. */
+class PerCodePointConverter : public Converter
+{
+public:
+	explicit PerCodePointConverter( const Converter& conv ) : m_conv(conv) {}
+
+	bool decode( const void* src, const void* srcend, int* srcbytes, int* dst ) const	{return m_conv.decode(src,srcend,srcbytes,dst);}
+	bool encode( void* dst, void* dstend, int* dstbytes, int src ) const				{return m_conv.encode(dst,dstend,dstbytes,src);}
+
+private:
+	const Converter& m_conv;
+
+	PerCodePointConverter( const PerCodePointConverter& );
+	PerCodePointConverter& operator=( const PerCodePointConverter& );
+};
+
+/** Converts a table of node names repeatedly, returns time in milliseconds. */
+static int benchmarkUTF8( const Converter& conv, const char** names, int count, int rounds )
+{
+	int time = System::currentTimeMillis();
+	int total = 0;
+	for ( int k = 0 ; k < rounds ; ++k )
+	{
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			String str( names[i], strlen(names[i]), conv );
+			total += str.length();
+		}
+	}
+	assert( total > 0 );
+	return System::currentTimeMillis() - time;
+}
 
 static void run()
 {
@@ -99,6 +142,67 @@ static void run()
 		assert( str2 == "../../data/images/rgb_text-4b.bmp" );
 	}
 	
+	// UTF conversion test
+	{
+		UTFConverter utf8( UTFConverter::ENCODING_UTF8 );
+		UTFConverter latin1( UTFConverter::ENCODING_LATIN1 );
+		UTFConverter utf16le( UTFConverter::ENCODING_UTF16LE );
+
+		const char* ascii = "Bip01 L Forearm and some more text to fill 16 byte blocks";
+		int asciilen = strlen(ascii);
+		assert( UTFConverter::countASCII(ascii,asciilen) == asciilen );
+		assert( UTFConverter::isValidUTF8(ascii,asciilen) );
+		assert( String(ascii,asciilen,utf8) == ascii );
+
+		// a-umlaut, euro sign and G clef
+		const char multi[] = "k\xC3\xA4si \xE2\x82\xAC \xF0\x9D\x84\x9E";
+		int multilen = sizeof(multi)-1;
+		assert( UTFConverter::countASCII(multi,multilen) == 1 );
+		assert( UTFConverter::isValidUTF8(multi,multilen) );
+		assert( String(multi,multilen,utf8) == multi );
+		assert( String(multi,multilen,utf8) == String(multi,multilen,PerCodePointConverter(utf8)) );
+
+		// overlong, surrogate and truncated sequences fall back to per code point conversion
+		const char* invalid[] = {"a\xC0\xAF", "\xED\xA0\x80" "b", "abc\xE2\x82"};
+		for ( int i = 0 ; i < int(sizeof(invalid)/sizeof(invalid[0])) ; ++i )
+		{
+			int n = strlen(invalid[i]);
+			assert( !UTFConverter::isValidUTF8(invalid[i],n) );
+			assert( utf8.toUTF8(invalid[i],n,0,0) == -1 );
+			assert( String(invalid[i],n,utf8) == String(invalid[i],n,PerCodePointConverter(utf8)) );
+		}
+
+		const char latin[] = "k\xE4si";
+		assert( String(latin,sizeof(latin)-1,latin1) == "k\xC3\xA4si" );
+
+		const uint8_t wide[] = {'a',0, 0xAC,0x20, 0x34,0xD8, 0x1E,0xDD};
+		assert( utf16le.toUTF8(wide,sizeof(wide),0,0) == 1+3+4 );
+		assert( String(wide,sizeof(wide),utf16le) == String(wide,sizeof(wide),PerCodePointConverter(utf16le)) );
+
+		// too small buffer returns required size
+		char buf[4];
+		assert( utf8.toUTF8(multi,multilen,buf,sizeof(buf)) == multilen );
+	}
+
+	// UTF-8 string construction benchmark
+	{
+		const char* names[] =
+		{
+			"Bip01", "Bip01 Pelvis", "Bip01 Spine", "Bip01 Spine1", "Bip01 Neck",
+			"Bip01 L Clavicle", "Bip01 L UpperArm", "Bip01 L Forearm", "Bip01 L Hand",
+			"Bip01 R Clavicle", "Bip01 R UpperArm", "Bip01 R Forearm", "Bip01 R Hand",
+			"mesh_042", "mesh_043", "Camera01", "Omni01", "Dummy_weapon_attach",
+			"textures/characters/soldier_diffuse.dds", "k\xC3\xA4si_vasen", "\xC3\xA9" "p\xC3\xA9" "e",
+		};
+		const int count = sizeof(names)/sizeof(names[0]);
+		const int rounds = 2000;
+
+		UTFConverter utf8( UTFConverter::ENCODING_UTF8 );
+		int fasttime = benchmarkUTF8( utf8, names, count, rounds );
+		int legacytime = benchmarkUTF8( PerCodePointConverter(utf8), names, count, rounds );
+		Debug::printf( "lang: UTF-8 String construction (%d strings): %d ms bulk, %d ms per code point\n", count*rounds, fasttime, legacytime );
+	}
+
 	// Format test
 	{
 		char buff[512];
@@ -151,6 +255,67 @@ static void run()
 	{
 		
 	}
+
+	// ThreadPool test
+	{
+		ThreadPool pool( 2 );
+		TestJob jobs[64];
+		for ( int k = 0 ; k < 2 ; ++k )
+		{
+			for ( int i = 0 ; i < 64 ; ++i )
+			{
+				jobs[i].value = i+k;
+				jobs[i].result = -1;
+				pool.add( &jobs[i] );
+			}
+			pool.wait();
+			assert( pool.pending() == 0 );
+			for ( int i = 0 ; i < 64 ; ++i )
+				assert( jobs[i].result == (i+k)*(i+k) );
+		}
+	}
+
+	// ThreadPool batch test
+	{
+		// without worker threads, jobs of other batches stay queued
+		ThreadPool pool( 0 );
+		ThreadPool::Batch batch1;
+		ThreadPool::Batch batch2;
+		TestJob jobs[8];
+		for ( int i = 0 ; i < 8 ; ++i )
+		{
+			jobs[i].value = i;
+			jobs[i].result = -1;
+			pool.add( &jobs[i], i&1 ? &batch1 : &batch2 );
+		}
+		pool.wait( &batch1 );
+		for ( int i = 0 ; i < 8 ; ++i )
+			assert( jobs[i].result == (i&1 ? i*i : -1) );
+		assert( pool.pending() == 4 );
+		pool.wait( &batch2 );
+		for ( int i = 0 ; i < 8 ; ++i )
+			assert( jobs[i].result == i*i );
+		assert( pool.pending() == 0 );
+
+		// with worker threads
+		ThreadPool pool2( 2 );
+		TestJob jobs2[64];
+		for ( int k = 0 ; k < 4 ; ++k )
+		{
+			for ( int i = 0 ; i < 64 ; ++i )
+			{
+				jobs2[i].value = i+k;
+				jobs2[i].result = -1;
+				pool2.add( &jobs2[i], i&1 ? &batch1 : &batch2 );
+			}
+			pool2.wait( &batch1 );
+			for ( int i = 1 ; i < 64 ; i += 2 )
+				assert( jobs2[i].result == (i+k)*(i+k) );
+			pool2.wait( &batch2 );
+			for ( int i = 0 ; i < 64 ; ++i )
+				assert( jobs2[i].result == (i+k)*(i+k) );
+		}
+	}
 }
 
 void test()
@@ -1,5 +1,6 @@
 #include <math/Domain.h>
 #include <math/RandomUtil.h>
+#include <math/float3x3.h>
 #include <string.h>
 #include <config.h>
 
@@ -166,6 +167,119 @@ float3 Domain::getRandomFloat3() const
 	return float3(0,0,0);
 }
 
+float Domain::getRandomFloat( Random& rng ) const
+{
+	return getRandomFloat3(rng).x;
+}
+
+float3 Domain::getRandomFloat3( Random& rng ) const
+{
+	assert( m_type < DOMAIN_COUNT );
+	assert( m_type != DOMAIN_NONE ); // undefined domain? sounds programming error
+	assert( DOMAIN_COUNT == 11 ); // make sure all cases are defined below
+
+	switch ( m_type )
+	{
+	case DOMAIN_NONE:		return float3(0,0,0);
+	case DOMAIN_CONSTANT:	return float3(m_data.constant.c, 0, 0);
+	case DOMAIN_RANGE:		return float3(RandomUtil::getRandom(rng, m_data.range.x0, m_data.range.x1), 0, 0);
+	case DOMAIN_POINT:		return float3(m_data.point.x, m_data.point.y, m_data.point.z);
+	case DOMAIN_SPHERE:		return RandomUtil::getPointInSphere( rng, m_data.sphere.r1, m_data.sphere.r2 ) + float3(m_data.sphere.x, m_data.sphere.y, m_data.sphere.z);
+	case DOMAIN_LINE:		return RandomUtil::getPointOnLine( rng, float3(m_data.line.x1, m_data.line.y1, m_data.line.z1), float3(m_data.line.x2, m_data.line.y2, m_data.line.z2) );
+	case DOMAIN_BOX:		return RandomUtil::getPointInBox( rng, float3(m_data.box.x1, m_data.box.y1, m_data.box.z1), float3(m_data.box.x2, m_data.box.y2, m_data.box.z2) );
+	case DOMAIN_CYLINDER:	return RandomUtil::getPointInCylinder( rng, float3(m_data.cylinder.x1, m_data.cylinder.y1, m_data.cylinder.z1), float3(m_data.cylinder.x2, m_data.cylinder.y2, m_data.cylinder.z2), m_data.cylinder.r1, m_data.cylinder.r2 );
+	case DOMAIN_DISK:		return RandomUtil::getPointOnDisk( rng, float3(m_data.disk.ox, m_data.disk.oy, m_data.disk.oz), float3(m_data.disk.nx, m_data.disk.ny, m_data.disk.nz), m_data.disk.r1, m_data.disk.r2 );
+	case DOMAIN_RECTANGLE:	return RandomUtil::getPointOnRectangle( rng, float3(m_data.rectangle.ox, m_data.rectangle.oy, m_data.rectangle.oz), float3(m_data.rectangle.ux, m_data.rectangle.uy, m_data.rectangle.uz), float3(m_data.rectangle.vx, m_data.rectangle.vy, m_data.rectangle.vz) );
+	case DOMAIN_TRIANGLE:	return RandomUtil::getPointOnTriangle( rng, float3(m_data.rectangle.ox, m_data.rectangle.oy, m_data.rectangle.oz), float3(m_data.rectangle.ux, m_data.rectangle.uy, m_data.rectangle.uz), float3(m_data.rectangle.vx, m_data.rectangle.vy, m_data.rectangle.vz) );
+	default:				assert( false ); // switch case doesnt cover all
+	}
+
+	return float3(0,0,0);
+}
+
+void Domain::getRandomFloat3( Random& rng, float3* v, int count ) const
+{
+	assert( m_type < DOMAIN_COUNT );
+	assert( m_type != DOMAIN_NONE ); // undefined domain? sounds programming error
+
+	switch ( m_type )
+	{
+	case DOMAIN_CONSTANT:
+	case DOMAIN_POINT:
+		{
+			const float3 c = getRandomFloat3( rng );
+			for ( int i = 0 ; i < count ; ++i )
+				v[i] = c;
+		}
+		break;
+
+	case DOMAIN_RANGE:
+		{
+			const float x0 = m_data.range.x0;
+			const float dx = m_data.range.x1 - x0;
+			for ( int i = 0 ; i < count ; ++i )
+				v[i] = float3( dx*rng.nextFloat() + x0, 0, 0 );
+		}
+		break;
+
+	case DOMAIN_BOX:
+		{
+			// uniform numbers in bulk, then scale and offset in place
+			const float3 p1( m_data.box.x1, m_data.box.y1, m_data.box.z1 );
+			const float3 d = float3( m_data.box.x2, m_data.box.y2, m_data.box.z2 ) - p1;
+			assert( sizeof(float3) == 3*sizeof(float) );
+			if ( count > 0 )
+				rng.nextFloats( &v[0].x, count*3 );
+			for ( int i = 0 ; i < count ; ++i )
+			{
+				float3& p = v[i];
+				p.x = d.x*p.x + p1.x;
+				p.y = d.y*p.y + p1.y;
+				p.z = d.z*p.z + p1.z;
+			}
+		}
+		break;
+
+	case DOMAIN_DISK:
+		{
+			// disk basis is computed once
+			const float3 o( m_data.disk.ox, m_data.disk.oy, m_data.disk.oz );
+			float3x3 rot;
+			rot.generateOrthonormalBasisFromZ( normalize0(float3(m_data.disk.nx, m_data.disk.ny, m_data.disk.nz)) );
+			const float3 bx = rot.getColumn(0);
+			const float3 by = rot.getColumn(1);
+			for ( int i = 0 ; i < count ; ++i )
+			{
+				float3 p = RandomUtil::getPointOnDisk( rng, m_data.disk.r1, m_data.disk.r2 );
+				v[i] = o + bx*p.x + by*p.y;
+			}
+		}
+		break;
+
+	case DOMAIN_CYLINDER:
+		{
+			// cylinder basis is computed once
+			const float3 p1( m_data.cylinder.x1, m_data.cylinder.y1, m_data.cylinder.z1 );
+			const float3 lenv = float3( m_data.cylinder.x2, m_data.cylinder.y2, m_data.cylinder.z2 ) - p1;
+			float3x3 rot;
+			rot.generateOrthonormalBasisFromZ( normalize0(lenv) );
+			const float3 bx = rot.getColumn(0);
+			const float3 by = rot.getColumn(1);
+			for ( int i = 0 ; i < count ; ++i )
+			{
+				float3 p = RandomUtil::getPointOnDisk( rng, m_data.cylinder.r1, m_data.cylinder.r2 );
+				v[i] = p1 + lenv*rng.nextFloat() + bx*p.x + by*p.y;
+			}
+		}
+		break;
+
+	default:
+		for ( int i = 0 ; i < count ; ++i )
+			v[i] = getRandomFloat3( rng );
+		break;
+	}
+}
+
 const char* Domain::toString() const
 {
 	return DOMAIN_NAMES[m_type];
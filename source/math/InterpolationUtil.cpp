@@ -1,4 +1,9 @@
 #include <math/InterpolationUtil.h>
+#include <math/float3x4.h>
+#include <math/float4.h>
+#ifdef MATH_SSE
+#include <xmmintrin.h>
+#endif
 #include <xmath.h>
 #include <config.h>
 #include <lang/assert.h>
@@ -140,6 +145,125 @@ void InterpolationUtil::interpolateVectorCatmullRom( int dim, float u,
 		result[i] = h1 * key1[i] + h2 * key2[i] + h3 * out[i] + h4 * in[i];
 }
 
+void InterpolationUtil::setSkinBones( int dim, const float4* vertexbones, 
+	const uint8_t* palette, int palettesize, int bones,
+	float4* weights, uint8_t* boneindices, int count )
+{
+	assert( dim >= 1 && dim <= 4 );
+
+	for ( int k = 0 ; k < count ; ++k )
+	{
+		float4& w = weights[k];
+		if ( dim < 4 )
+		{
+			float sum = 0.f;
+			for ( int n = 0 ; n < dim ; ++n )
+				sum += w[n];
+			w[dim] = 1.f - sum;
+			for ( int n = dim+1 ; n < 4 ; ++n )
+				w[n] = 0.f;
+		}
+
+		uint8_t* ix = boneindices + k*4;
+		for ( int n = 0 ; n < 4 ; ++n )
+		{
+			int bone = 0;
+			if ( w[n] != 0.f )
+			{
+				bone = (int)vertexbones[k][n];
+				if ( palette != 0 && palettesize > 0 )
+				{
+					assert( bone >= 0 && bone < palettesize );
+					bone = palette[bone];
+				}
+				assert( bone >= 0 && bone < bones ); bones=bones;
+			}
+			ix[n] = (uint8_t)bone;
+		}
+	}
+}
+
+void InterpolationUtil::setSkinBoneColumns( const float3x4& tm, float4* columns )
+{
+	for ( int k = 0 ; k < 3 ; ++k )
+		columns[k] = float4( tm(0,k), tm(1,k), tm(2,k), 0.f );
+	columns[3] = float4( tm(0,3), tm(1,3), tm(2,3), 1.f );
+}
+
+void InterpolationUtil::skinVertices( const float4* bonecolumns, const float4* pos, const float4* nrm,
+	const float4* weights, const uint8_t* boneindices, 
+	float4* outpos, float4* outnrm, int count )
+{
+#ifdef MATH_SSE
+
+	#define MATH_SSE_SPLAT(V,I) _mm_shuffle_ps( V, V, _MM_SHUFFLE(I,I,I,I) )
+
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		const uint8_t* ix = boneindices + i*4;
+		const __m128 w = _mm_loadu_ps( &weights[i].x );
+
+		const float4* b = bonecolumns + ix[0]*4;
+		__m128 wk = MATH_SSE_SPLAT( w, 0 );
+		__m128 c0 = _mm_mul_ps( wk, _mm_loadu_ps(&b[0].x) );
+		__m128 c1 = _mm_mul_ps( wk, _mm_loadu_ps(&b[1].x) );
+		__m128 c2 = _mm_mul_ps( wk, _mm_loadu_ps(&b[2].x) );
+		__m128 c3 = _mm_mul_ps( wk, _mm_loadu_ps(&b[3].x) );
+
+		#define MATH_SSE_BLEND(K) \
+			b = bonecolumns + ix[K]*4; \
+			wk = MATH_SSE_SPLAT( w, K ); \
+			c0 = _mm_add_ps( c0, _mm_mul_ps(wk,_mm_loadu_ps(&b[0].x)) ); \
+			c1 = _mm_add_ps( c1, _mm_mul_ps(wk,_mm_loadu_ps(&b[1].x)) ); \
+			c2 = _mm_add_ps( c2, _mm_mul_ps(wk,_mm_loadu_ps(&b[2].x)) ); \
+			c3 = _mm_add_ps( c3, _mm_mul_ps(wk,_mm_loadu_ps(&b[3].x)) );
+
+		MATH_SSE_BLEND(1)
+		MATH_SSE_BLEND(2)
+		MATH_SSE_BLEND(3)
+
+		const __m128 p = _mm_loadu_ps( &pos[i].x );
+		__m128 r = _mm_add_ps( _mm_mul_ps(c0,MATH_SSE_SPLAT(p,0)), _mm_mul_ps(c1,MATH_SSE_SPLAT(p,1)) );
+		r = _mm_add_ps( r, _mm_add_ps(_mm_mul_ps(c2,MATH_SSE_SPLAT(p,2)),c3) );
+		_mm_storeu_ps( &outpos[i].x, r );
+
+		const __m128 n = _mm_loadu_ps( &nrm[i].x );
+		r = _mm_add_ps( _mm_mul_ps(c0,MATH_SSE_SPLAT(n,0)), _mm_mul_ps(c1,MATH_SSE_SPLAT(n,1)) );
+		r = _mm_add_ps( r, _mm_mul_ps(c2,MATH_SSE_SPLAT(n,2)) );
+		_mm_storeu_ps( &outnrm[i].x, r );
+	}
+
+#else
+
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		const uint8_t* ix = boneindices + i*4;
+		const float4& w = weights[i];
+
+		const float4* b = bonecolumns + ix[0]*4;
+		float4 c0 = b[0] * w.x;
+		float4 c1 = b[1] * w.x;
+		float4 c2 = b[2] * w.x;
+		float4 c3 = b[3] * w.x;
+		for ( int k = 1 ; k < 4 ; ++k )
+		{
+			b = bonecolumns + ix[k]*4;
+			const float wk = w[k];
+			c0 += b[0] * wk;
+			c1 += b[1] * wk;
+			c2 += b[2] * wk;
+			c3 += b[3] * wk;
+		}
+
+		const float4& p = pos[i];
+		outpos[i] = c0*p.x + c1*p.y + c2*p.z + c3;
+		const float4& n = nrm[i];
+		outnrm[i] = c0*n.x + c1*n.y + c2*n.z;
+	}
+
+#endif // MATH_SSE
+}
+
 
 END_NAMESPACE() // math
 
@@ -1,5 +1,8 @@
 #include <math/IntersectionUtil.h>
 #include <math/float4x4.h>
+#ifdef MATH_SSE
+#include <xmmintrin.h>
+#endif
 #include <math.h>
 #include <float.h>
 #include <config.h>
@@ -108,6 +111,242 @@ bool IntersectionUtil::findRayTriangleIntersection(
 	return true;
 }
 
+void IntersectionUtil::setTriangleBlocks( const float3* verts, int count, float* blocks )
+{
+	const int blockcount = (count+3) >> 2;
+	for ( int b = 0 ; b < blockcount ; ++b )
+	{
+		float* block = blocks + b*36;
+		for ( int i = 0 ; i < 4 ; ++i )
+		{
+			const int tri = b*4 + i;
+			float3 v0( 0, 0, 0 );
+			float3 edge1( 0, 0, 0 );
+			float3 edge2( 0, 0, 0 );
+			if ( tri < count )
+			{
+				v0 = verts[tri*3];
+				edge1 = verts[tri*3+1] - v0;
+				edge2 = verts[tri*3+2] - v0;
+			}
+			block[i] = v0.x;
+			block[4+i] = v0.y;
+			block[8+i] = v0.z;
+			block[12+i] = edge1.x;
+			block[16+i] = edge1.y;
+			block[20+i] = edge1.z;
+			block[24+i] = edge2.x;
+			block[28+i] = edge2.y;
+			block[32+i] = edge2.z;
+		}
+	}
+}
+
+int IntersectionUtil::findRayTrianglesIntersection( 
+	const float3& orig, const float3& dir,
+	const float* blocks, int count, float* t )
+{
+	const int blockcount = (count+3) >> 2;
+
+	// closest hit distance and triangle index are tracked per lane, lanes are combined at the end
+	float tbest[4];
+	float ibest[4];
+
+#ifdef MATH_SSE
+
+	const __m128 ox = _mm_set1_ps( orig.x );
+	const __m128 oy = _mm_set1_ps( orig.y );
+	const __m128 oz = _mm_set1_ps( orig.z );
+	const __m128 dx = _mm_set1_ps( dir.x );
+	const __m128 dy = _mm_set1_ps( dir.y );
+	const __m128 dz = _mm_set1_ps( dir.z );
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.f );
+	const __m128 four = _mm_set1_ps( 4.f );
+	const __m128 detmin = _mm_set1_ps( FLT_MIN );
+	const __m128 signbit = _mm_set1_ps( -0.f );
+
+	__m128 tmin = _mm_set1_ps( *t );
+	__m128 imin = _mm_set1_ps( -1.f );
+	__m128 index = _mm_set_ps( 3.f, 2.f, 1.f, 0.f );
+
+	for ( int b = 0 ; b < blockcount ; ++b, blocks += 36 )
+	{
+		const __m128 e1x = _mm_loadu_ps( blocks+12 );
+		const __m128 e1y = _mm_loadu_ps( blocks+16 );
+		const __m128 e1z = _mm_loadu_ps( blocks+20 );
+		const __m128 e2x = _mm_loadu_ps( blocks+24 );
+		const __m128 e2y = _mm_loadu_ps( blocks+28 );
+		const __m128 e2z = _mm_loadu_ps( blocks+32 );
+
+		// pvec = cross( dir, edge2 ), det = dot( edge1, pvec )
+		const __m128 px = _mm_sub_ps( _mm_mul_ps(dy,e2z), _mm_mul_ps(dz,e2y) );
+		const __m128 py = _mm_sub_ps( _mm_mul_ps(dz,e2x), _mm_mul_ps(dx,e2z) );
+		const __m128 pz = _mm_sub_ps( _mm_mul_ps(dx,e2y), _mm_mul_ps(dy,e2x) );
+		const __m128 det = _mm_add_ps( _mm_add_ps(_mm_mul_ps(e1x,px), _mm_mul_ps(e1y,py)), _mm_mul_ps(e1z,pz) );
+		const __m128 invdet = _mm_div_ps( one, det );
+
+		// tvec = orig - vert0, u = dot( tvec, pvec ) / det
+		const __m128 tx = _mm_sub_ps( ox, _mm_loadu_ps(blocks) );
+		const __m128 ty = _mm_sub_ps( oy, _mm_loadu_ps(blocks+4) );
+		const __m128 tz = _mm_sub_ps( oz, _mm_loadu_ps(blocks+8) );
+		const __m128 u = _mm_mul_ps( _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx,px), _mm_mul_ps(ty,py)), _mm_mul_ps(tz,pz)), invdet );
+
+		// qvec = cross( tvec, edge1 ), v = dot( dir, qvec ) / det, s = dot( edge2, qvec ) / det
+		const __m128 qx = _mm_sub_ps( _mm_mul_ps(ty,e1z), _mm_mul_ps(tz,e1y) );
+		const __m128 qy = _mm_sub_ps( _mm_mul_ps(tz,e1x), _mm_mul_ps(tx,e1z) );
+		const __m128 qz = _mm_sub_ps( _mm_mul_ps(tx,e1y), _mm_mul_ps(ty,e1x) );
+		const __m128 v = _mm_mul_ps( _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,qx), _mm_mul_ps(dy,qy)), _mm_mul_ps(dz,qz)), invdet );
+		const __m128 s = _mm_mul_ps( _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x,qx), _mm_mul_ps(e2y,qy)), _mm_mul_ps(e2z,qz)), invdet );
+
+		__m128 mask = _mm_cmpgt_ps( _mm_andnot_ps(signbit,det), detmin );
+		mask = _mm_and_ps( mask, _mm_cmpge_ps(u,zero) );
+		mask = _mm_and_ps( mask, _mm_cmple_ps(u,one) );
+		mask = _mm_and_ps( mask, _mm_cmpge_ps(v,zero) );
+		mask = _mm_and_ps( mask, _mm_cmple_ps(_mm_add_ps(u,v),one) );
+		mask = _mm_and_ps( mask, _mm_cmpge_ps(s,zero) );
+		mask = _mm_and_ps( mask, _mm_cmplt_ps(s,tmin) );
+
+		tmin = _mm_or_ps( _mm_and_ps(mask,s), _mm_andnot_ps(mask,tmin) );
+		imin = _mm_or_ps( _mm_and_ps(mask,index), _mm_andnot_ps(mask,imin) );
+		index = _mm_add_ps( index, four );
+	}
+
+	_mm_storeu_ps( tbest, tmin );
+	_mm_storeu_ps( ibest, imin );
+
+#else
+
+	for ( int i = 0 ; i < 4 ; ++i )
+	{
+		tbest[i] = *t;
+		ibest[i] = -1.f;
+	}
+
+	for ( int b = 0 ; b < blockcount ; ++b, blocks += 36 )
+	{
+		for ( int i = 0 ; i < 4 ; ++i )
+		{
+			const float3 edge1( blocks[12+i], blocks[16+i], blocks[20+i] );
+			const float3 edge2( blocks[24+i], blocks[28+i], blocks[32+i] );
+			const float3 pvec = cross( dir, edge2 );
+			const float det = dot( edge1, pvec );
+			if ( fabsf(det) <= FLT_MIN )
+				continue;
+			const float invdet = 1.f / det;
+
+			const float3 tvec = orig - float3( blocks[i], blocks[4+i], blocks[8+i] );
+			const float u = dot(tvec,pvec) * invdet;
+			if ( u < 0.f || u > 1.f )
+				continue;
+
+			const float3 qvec = cross( tvec, edge1 );
+			const float v = dot(dir,qvec) * invdet;
+			if ( v < 0.f || u + v > 1.f )
+				continue;
+
+			const float s = dot(edge2,qvec) * invdet;
+			if ( s < 0.f || s >= tbest[i] )
+				continue;
+
+			tbest[i] = s;
+			ibest[i] = float( b*4 + i );
+		}
+	}
+
+#endif // MATH_SSE
+
+	int best = -1;
+	for ( int i = 0 ; i < 4 ; ++i )
+	{
+		const int index = int( ibest[i] );
+		if ( index >= 0 && (best < 0 || tbest[i] < *t || (tbest[i] == *t && index < best)) )
+		{
+			best = index;
+			*t = tbest[i];
+		}
+	}
+	return best;
+}
+
+int IntersectionUtil::findRaysBoxIntersection(
+	const float3* orig, const float3* dir, int count,
+	const float3& boxmin, const float3& boxmax,
+	float* t, bool* hit )
+{
+	int hitcount = 0;
+	for ( int i = 0 ; i < count ; i += 4 )
+	{
+		// gather 4 rays as structure of arrays, unused lanes repeat the first ray
+		const int n = count-i < 4 ? count-i : 4;
+		float o[3][4];
+		float id[3][4];
+		float tmax[4];
+		for ( int lane = 0 ; lane < 4 ; ++lane )
+		{
+			const int k = i + (lane < n ? lane : 0);
+			for ( int j = 0 ; j < 3 ; ++j )
+			{
+				// avoid infinities and NaNs in slab test
+				const float d = dir[k][j];
+				o[j][lane] = orig[k][j];
+				id[j][lane] = 1.f / (fabsf(d) > 1e-20f ? d : (d < 0.f ? -1e-20f : 1e-20f));
+			}
+			tmax[lane] = t[k];
+		}
+
+		float tnear[4];
+		int mask = 0;
+
+#ifdef MATH_SSE
+
+		__m128 tn = _mm_setzero_ps();
+		__m128 tf = _mm_loadu_ps( tmax );
+		for ( int j = 0 ; j < 3 ; ++j )
+		{
+			const __m128 ov = _mm_loadu_ps( o[j] );
+			const __m128 iv = _mm_loadu_ps( id[j] );
+			const __m128 t0 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmin[j]),ov), iv );
+			const __m128 t1 = _mm_mul_ps( _mm_sub_ps(_mm_set1_ps(boxmax[j]),ov), iv );
+			tn = _mm_max_ps( tn, _mm_min_ps(t0,t1) );
+			tf = _mm_min_ps( tf, _mm_max_ps(t0,t1) );
+		}
+		_mm_storeu_ps( tnear, tn );
+		mask = _mm_movemask_ps( _mm_cmple_ps(tn,tf) );
+
+#else
+
+		for ( int lane = 0 ; lane < n ; ++lane )
+		{
+			float tn = 0.f;
+			float tf = tmax[lane];
+			for ( int j = 0 ; j < 3 ; ++j )
+			{
+				const float t0 = (boxmin[j] - o[j][lane]) * id[j][lane];
+				const float t1 = (boxmax[j] - o[j][lane]) * id[j][lane];
+				tn = t0 < t1 ? (t0 > tn ? t0 : tn) : (t1 > tn ? t1 : tn);
+				tf = t0 < t1 ? (t1 < tf ? t1 : tf) : (t0 < tf ? t0 : tf);
+			}
+			tnear[lane] = tn;
+			if ( tn <= tf )
+				mask |= 1<<lane;
+		}
+
+#endif // MATH_SSE
+
+		for ( int lane = 0 ; lane < n ; ++lane )
+		{
+			hit[i+lane] = 0 != (mask & (1<<lane));
+			if ( hit[i+lane] )
+			{
+				t[i+lane] = tnear[lane];
+				++hitcount;
+			}
+		}
+	}
+	return hitcount;
+}
+
 bool IntersectionUtil::testPointBox( const float3& point, const float4x4& box, const float3& dim )
 {
 	float3 d = point - box.translation();
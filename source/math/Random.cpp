@@ -0,0 +1,48 @@
+#include <math/Random.h>
+#include <config.h>
+
+
+BEGIN_NAMESPACE(math)
+
+
+Random::Random( uint32_t seed )
+{
+	setSeed( m_s, seed );
+}
+
+void Random::setSeed( uint32_t seed )
+{
+	setSeed( m_s, seed );
+}
+
+void Random::setSeed( uint32_t* s, uint32_t seed )
+{
+	// expand seed to state by 32-bit variant of splitmix
+	for ( int i = 0 ; i < 4 ; ++i )
+	{
+		seed += 0x9E3779B9U;
+		uint32_t z = seed;
+		z = (z ^ (z >> 16)) * 0x85EBCA6BU;
+		z = (z ^ (z >> 13)) * 0xC2B2AE35U;
+		s[i] = z ^ (z >> 16);
+	}
+
+	// all-zero state would produce only zeros
+	if ( 0 == (s[0]|s[1]|s[2]|s[3]) )
+		s[0] = 1;
+}
+
+void Random::nextFloats( float* v, int count )
+{
+	// local copy of the state lets compiler keep it in registers
+	uint32_t s[4] = {m_s[0], m_s[1], m_s[2], m_s[3]};
+	for ( int i = 0 ; i < count ; ++i )
+		v[i] = nextFloat( s );
+	for ( int i = 0 ; i < 4 ; ++i )
+		m_s[i] = s[i];
+}
+
+
+END_NAMESPACE() // math
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
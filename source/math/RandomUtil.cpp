@@ -1,8 +1,9 @@
 #include <math/RandomUtil.h>
 #include <math/float3x3.h>
 #include <math/float4x4.h>
+#include <lang/Globals.h>
+#include <lang/Mutex.h>
 #include <float.h>
-#include <stdlib.h>
 #include <config.h>
 
 
@@ -11,44 +12,66 @@ BEGIN_NAMESPACE(math)
 
 const float PI = 3.141592653589793f;
 
+#ifdef LANG_THREADLOCAL
+static LANG_THREADLOCAL uint32_t	s_threadState[4];
+static LANG_THREADLOCAL bool		s_threadSeeded = false;
+#else
+static uint32_t						s_threadState[4];
+static bool							s_threadSeeded = false;
+#endif
+static uint32_t						s_threadSeeds = 0;
+static NS(lang,Mutex)				s_threadSeedsMutex;
 
-float RandomUtil::random()
-{
-	const float RAND_SCALE = 1.0f / (float(RAND_MAX)+1.0f);
-	return float(rand()) * RAND_SCALE;
-}
 
-float RandomUtil::getRandom( float begin, float end )
+/** Returns generator state of the calling thread. */
+static uint32_t* getThreadState()
 {
-	return (end-begin)*random() + begin;
+	if ( !s_threadSeeded )
+	{
+		// threads start concurrently, each needs an unique seed
+		uint32_t seed;
+		{
+			NS(lang,Mutex)::Lock lock( s_threadSeedsMutex );
+			seed = s_threadSeeds++;
+		}
+		Random::setSeed( s_threadState, seed );
+		s_threadSeeded = true;
+	}
+	return s_threadState;
 }
 
-float3 RandomUtil::getPointOnDisk( float r1, float r2 )
+static void randomPointOnDisk( uint32_t* s, float r1, float r2, float* x, float* y )
 {
-	float x,y;
-	getPointOnDisk(r1,r2,&x,&y);
-	return float3(x,y,0.f);
+	assert( r1 >= 0.f );
+	assert( r2 >= 0.f );
+
+	float u0 = Random::nextFloat( s );
+	float u = u0*u0;
+	float d = (r1-r2)*u + r2;
+	float t = 2.f * PI * Random::nextFloat( s );
+	*x = d * cosf( t );
+	*y = d * sinf( t );
 }
 
-float3 RandomUtil::getPointOnDisk( const float3& o, const float3& n, float r1, float r2 )
+static float3 randomPointOnDisk( uint32_t* s, const float3& o, const float3& n, float r1, float r2 )
 {
 	float3x3 rot;
 	rot.generateOrthonormalBasisFromZ( normalize0(n) );
 	
 	float x,y;
-	getPointOnDisk(r1,r2,&x,&y);
+	randomPointOnDisk( s, r1, r2, &x, &y );
 
 	return o + rot.getColumn(0)*x + rot.getColumn(1)*y;
 }
 
-float3	RandomUtil::getPointInSphere( float r1, float r2 )
+static float3 randomPointInSphere( uint32_t* s, float r1, float r2 )
 {
-	float z = (random() - .5f) * 2.f;
-	float t = 2.f * PI * random();
+	float z = (Random::nextFloat(s) - .5f) * 2.f;
+	float t = 2.f * PI * Random::nextFloat(s);
 	float w = sqrtf( 1.f - z*z );
 	float x = w * cosf( t );
 	float y = w * sinf( t );
-	float u0 = random();
+	float u0 = Random::nextFloat(s);
 	float u = u0*u0*u0;
 	float d = (r1-r2)*u + r2;
 	x *= d;
@@ -57,25 +80,23 @@ float3	RandomUtil::getPointInSphere( float r1, float r2 )
 	return float3(x,y,z);
 }
 
-float3	RandomUtil::getPointOnLine( const float3& p1, const float3& p2 )
-{
-	return p1 + (p2-p1)*random();
-}
-
-float3	RandomUtil::getPointInBox( const float3& p1, const float3& p2 )
+static float3 randomPointInBox( uint32_t* s, const float3& p1, const float3& p2 )
 {
-	return float3( (p2.x-p1.x)*random()+p1.x, (p2.y-p1.y)*random()+p1.y, (p2.z-p1.z)*random()+p1.z );
+	float x = (p2.x-p1.x)*Random::nextFloat(s) + p1.x;
+	float y = (p2.y-p1.y)*Random::nextFloat(s) + p1.y;
+	float z = (p2.z-p1.z)*Random::nextFloat(s) + p1.z;
+	return float3( x, y, z );
 }
 
-float3	RandomUtil::getPointInCylinder( float len, float r1, float r2 )
+static float3 randomPointInCylinder( uint32_t* s, float len, float r1, float r2 )
 {
 	float x, y;
-	getPointOnDisk( r1, r2, &x, &y );
-	float z = random() * len;
+	randomPointOnDisk( s, r1, r2, &x, &y );
+	float z = Random::nextFloat(s) * len;
 	return float3(x,y,z);
 }
 
-float3 RandomUtil::getPointInCylinder( const float3& p1, const float3& p2, float r1, float r2 )
+static float3 randomPointInCylinder( uint32_t* s, const float3& p1, const float3& p2, float r1, float r2 )
 {
 	float3 lenv = p2 - p1;
 	float3 dir = normalize0(lenv);
@@ -84,33 +105,22 @@ float3 RandomUtil::getPointInCylinder( const float3& p1, const float3& p2, float
 	rot.generateOrthonormalBasisFromZ( dir );
 
 	float x, y;
-	getPointOnDisk( r1, r2, &x, &y );
+	randomPointOnDisk( s, r1, r2, &x, &y );
 	
-	return p1 + lenv*random() + rot.getColumn(0)*x + rot.getColumn(1)*y;
-}
-
-void RandomUtil::getPointOnDisk( float r1, float r2, float* x, float* y )
-{
-	assert( r1 >= 0.f );
-	assert( r2 >= 0.f );
-
-	float u0 = random();
-	float u = u0*u0;
-	float d = (r1-r2)*u + r2;
-	float t = 2.f * PI * random();
-	*x = d * cosf( t );
-	*y = d * sinf( t );
+	return p1 + lenv*Random::nextFloat(s) + rot.getColumn(0)*x + rot.getColumn(1)*y;
 }
 
-float3 RandomUtil::getPointOnRectangle( const float3& o, const float3& e1, const float3& e2 )
+static float3 randomPointOnRectangle( uint32_t* s, const float3& o, const float3& e1, const float3& e2 )
 {
-	return o + e1*random() + e2*random();
+	float u = Random::nextFloat(s);
+	float v = Random::nextFloat(s);
+	return o + e1*u + e2*v;
 }
 
-float3 RandomUtil::getPointOnTriangle( const float3& o, const float3& e1, const float3& e2 )
+static float3 randomPointOnTriangle( uint32_t* s, const float3& o, const float3& e1, const float3& e2 )
 {
-	float u = random();
-	float v = random();
+	float u = Random::nextFloat(s);
+	float v = Random::nextFloat(s);
 	if ( u+v >= 1.f )
 	{
 		u = 1.f - u;
@@ -120,6 +130,127 @@ float3 RandomUtil::getPointOnTriangle( const float3& o, const float3& e1, const
 }
 
 
+void RandomUtil::setSeed( uint32_t seed )
+{
+	Random::setSeed( s_threadState, seed );
+	s_threadSeeded = true;
+}
+
+uint32_t RandomUtil::randomInt()
+{
+	return Random::next( getThreadState() );
+}
+
+float RandomUtil::random()
+{
+	return Random::nextFloat( getThreadState() );
+}
+
+float RandomUtil::getRandom( float begin, float end )
+{
+	return (end-begin)*random() + begin;
+}
+
+float RandomUtil::getRandom( Random& rng, float begin, float end )
+{
+	return rng.nextFloat( begin, end );
+}
+
+float3 RandomUtil::getPointOnDisk( float r1, float r2 )
+{
+	float x,y;
+	randomPointOnDisk( getThreadState(), r1, r2, &x, &y );
+	return float3(x,y,0.f);
+}
+
+float3 RandomUtil::getPointOnDisk( Random& rng, float r1, float r2 )
+{
+	float x,y;
+	randomPointOnDisk( rng.state(), r1, r2, &x, &y );
+	return float3(x,y,0.f);
+}
+
+float3 RandomUtil::getPointOnDisk( const float3& o, const float3& n, float r1, float r2 )
+{
+	return randomPointOnDisk( getThreadState(), o, n, r1, r2 );
+}
+
+float3 RandomUtil::getPointOnDisk( Random& rng, const float3& o, const float3& n, float r1, float r2 )
+{
+	return randomPointOnDisk( rng.state(), o, n, r1, r2 );
+}
+
+float3 RandomUtil::getPointInSphere( float r1, float r2 )
+{
+	return randomPointInSphere( getThreadState(), r1, r2 );
+}
+
+float3 RandomUtil::getPointInSphere( Random& rng, float r1, float r2 )
+{
+	return randomPointInSphere( rng.state(), r1, r2 );
+}
+
+float3 RandomUtil::getPointOnLine( const float3& p1, const float3& p2 )
+{
+	return p1 + (p2-p1)*random();
+}
+
+float3 RandomUtil::getPointOnLine( Random& rng, const float3& p1, const float3& p2 )
+{
+	return p1 + (p2-p1)*rng.nextFloat();
+}
+
+float3 RandomUtil::getPointInBox( const float3& p1, const float3& p2 )
+{
+	return randomPointInBox( getThreadState(), p1, p2 );
+}
+
+float3 RandomUtil::getPointInBox( Random& rng, const float3& p1, const float3& p2 )
+{
+	return randomPointInBox( rng.state(), p1, p2 );
+}
+
+float3 RandomUtil::getPointInCylinder( float len, float r1, float r2 )
+{
+	return randomPointInCylinder( getThreadState(), len, r1, r2 );
+}
+
+float3 RandomUtil::getPointInCylinder( Random& rng, float len, float r1, float r2 )
+{
+	return randomPointInCylinder( rng.state(), len, r1, r2 );
+}
+
+float3 RandomUtil::getPointInCylinder( const float3& p1, const float3& p2, float r1, float r2 )
+{
+	return randomPointInCylinder( getThreadState(), p1, p2, r1, r2 );
+}
+
+float3 RandomUtil::getPointInCylinder( Random& rng, const float3& p1, const float3& p2, float r1, float r2 )
+{
+	return randomPointInCylinder( rng.state(), p1, p2, r1, r2 );
+}
+
+float3 RandomUtil::getPointOnRectangle( const float3& o, const float3& e1, const float3& e2 )
+{
+	return randomPointOnRectangle( getThreadState(), o, e1, e2 );
+}
+
+float3 RandomUtil::getPointOnRectangle( Random& rng, const float3& o, const float3& e1, const float3& e2 )
+{
+	return randomPointOnRectangle( rng.state(), o, e1, e2 );
+}
+
+float3 RandomUtil::getPointOnTriangle( const float3& o, const float3& e1, const float3& e2 )
+{
+	return randomPointOnTriangle( getThreadState(), o, e1, e2 );
+}
+
+float3 RandomUtil::getPointOnTriangle( Random& rng, const float3& o, const float3& e1, const float3& e2 )
+{
+	return randomPointOnTriangle( rng.state(), o, e1, e2 );
+}
+
+
 END_NAMESPACE() // math
 
 // Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
@@ -207,6 +207,32 @@ quaternion quaternion::slerp( float t, const quaternion& q ) const
 	}
 }
 
+quaternion quaternion::nlerp( float t, const quaternion& q ) const
+{
+	const quaternion& p = *this;
+
+	float s = p.dot(q) < 0.f ? -t : t;
+	quaternion r = p*(1.f-t) + q*s;
+
+	float len2 = r.normSquared();
+	assert( len2 > FLT_MIN );
+	return r * (1.f/sqrtf(len2));
+}
+
+quaternion quaternion::fastSlerp( float t, const quaternion& q ) const
+{
+	const quaternion& p = *this;
+
+	// correct phase by polynomial fitted to slerp, depending on
+	// cosine of the angle between quaternions
+	float cos = fabsf( p.dot(q) );
+	float a = 1.0904f + cos*(-3.2452f + cos*(3.55645f - cos*1.43519f));
+	float b = 0.848013f + cos*(-1.06021f + cos*0.215638f);
+	float k = a*(t-.5f)*(t-.5f) + b;
+	float u = t + t*(t-.5f)*(t-1.f)*k;
+	return nlerp( u, q );
+}
+
 quaternion quaternion::squad( float t, const quaternion& a, const quaternion& b, const quaternion& q ) const
 {
 	const quaternion& p = *this;
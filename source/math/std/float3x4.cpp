@@ -5,6 +5,9 @@
 #include <math/float3x3.h>
 #include <math/float4x4.h>
 #include <float.h>
+#ifdef MATH_SSE
+#include <xmmintrin.h>
+#endif
 #include <config.h>
 
 
@@ -16,6 +19,23 @@
 BEGIN_NAMESPACE(math) 
 
 
+#ifdef MATH_SSE
+
+#define MATH_SSE_SPLAT(V,I) _mm_shuffle_ps( V, V, _MM_SHUFFLE(I,I,I,I) )
+
+/** Returns cross product of xyz-components, w-component will be 0. */
+static inline __m128 crossSSE( __m128 a, __m128 b )
+{
+	__m128 a1 = _mm_shuffle_ps( a, a, _MM_SHUFFLE(3,0,2,1) );
+	__m128 b1 = _mm_shuffle_ps( b, b, _MM_SHUFFLE(3,0,2,1) );
+	__m128 a2 = _mm_shuffle_ps( a, a, _MM_SHUFFLE(3,1,0,2) );
+	__m128 b2 = _mm_shuffle_ps( b, b, _MM_SHUFFLE(3,1,0,2) );
+	return _mm_sub_ps( _mm_mul_ps(a1,b2), _mm_mul_ps(a2,b1) );
+}
+
+#endif // MATH_SSE
+
+
 float3x4::float3x4( float diagonal )
 {
 	m[0][0] = diagonal;
@@ -117,6 +137,26 @@ float3x4 float3x4::operator*( const float3x4& other ) const
 {
 	float3x4 r;
 
+#ifdef MATH_SSE
+
+	// rows are loaded unaligned so that layout stays the same as in portable version
+	const __m128 b0 = _mm_loadu_ps( other.m[0] );
+	const __m128 b1 = _mm_loadu_ps( other.m[1] );
+	const __m128 b2 = _mm_loadu_ps( other.m[2] );
+	const __m128 b3 = _mm_set_ps( 1.f, 0.f, 0.f, 0.f );
+
+	for ( int j = 0 ; j < ROWS ; ++j )
+	{
+		__m128 a = _mm_loadu_ps( m[j] );
+		__m128 v = _mm_mul_ps( MATH_SSE_SPLAT(a,0), b0 );
+		v = _mm_add_ps( v, _mm_mul_ps(MATH_SSE_SPLAT(a,1),b1) );
+		v = _mm_add_ps( v, _mm_mul_ps(MATH_SSE_SPLAT(a,2),b2) );
+		v = _mm_add_ps( v, _mm_mul_ps(MATH_SSE_SPLAT(a,3),b3) );
+		_mm_storeu_ps( r.m[j], v );
+	}
+
+#else
+
 	#define MATRIX3X4MUL_x(j,i) \
 		r.m[j][i] = m[j][0]*other.m[0][i] +	\
 					m[j][1]*other.m[1][i] + \
@@ -141,6 +181,8 @@ float3x4 float3x4::operator*( const float3x4& other ) const
 	MATRIX3X4MUL_x(2,2)
 	MATRIX3X4MUL_3(2,3)
 
+#endif // MATH_SSE
+
 	return r;
 }
 
@@ -352,6 +394,45 @@ float float3x4::determinant3() const
 
 float3x4 float3x4::inverse() const
 {
+#ifdef MATH_SSE
+
+	const __m128 r0 = _mm_loadu_ps( m[0] );
+	const __m128 r1 = _mm_loadu_ps( m[1] );
+	const __m128 r2 = _mm_loadu_ps( m[2] );
+
+	// columns of the adjugate of the rotation part
+	__m128 c0 = crossSSE( r1, r2 );
+	__m128 c1 = crossSSE( r2, r0 );
+	__m128 c2 = crossSSE( r0, r1 );
+
+	__m128 d = _mm_mul_ps( r0, c0 );
+	d = _mm_add_ps( d, _mm_movehl_ps(d,d) );
+	d = _mm_add_ss( d, MATH_SSE_SPLAT(d,1) );
+	float det;
+	_mm_store_ss( &det, d );
+	assert( det > FLT_MIN || det < -FLT_MIN ); 
+	const __m128 invdet = _mm_set1_ps( 1.f / det );
+
+	c0 = _mm_mul_ps( c0, invdet );
+	c1 = _mm_mul_ps( c1, invdet );
+	c2 = _mm_mul_ps( c2, invdet );
+
+	// translation = -rot^-1 * t
+	__m128 t = _mm_mul_ps( c0, MATH_SSE_SPLAT(r0,3) );
+	t = _mm_add_ps( t, _mm_mul_ps(c1,MATH_SSE_SPLAT(r1,3)) );
+	t = _mm_add_ps( t, _mm_mul_ps(c2,MATH_SSE_SPLAT(r2,3)) );
+	t = _mm_sub_ps( _mm_setzero_ps(), t );
+
+	_MM_TRANSPOSE4_PS( c0, c1, c2, t );
+
+	float3x4 inv;
+	_mm_storeu_ps( inv.m[0], c0 );
+	_mm_storeu_ps( inv.m[1], c1 );
+	_mm_storeu_ps( inv.m[2], c2 );
+	return inv;
+
+#else
+
 	const float det = determinant3();
 	assert( det > FLT_MIN || det < -FLT_MIN ); 
 	const float invdet = 1.f / det;
@@ -371,8 +452,9 @@ float3x4 float3x4::inverse() const
 	inv.m[2][3] = -( m[0][3]*inv.m[2][0] + m[1][3]*inv.m[2][1] + m[2][3]*inv.m[2][2] );
 
 	return inv;
-}
 
+#endif // MATH_SSE
+}
 
 END_NAMESPACE() // math
 
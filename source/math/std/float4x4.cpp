@@ -4,6 +4,9 @@
 #include <math/float3x3.h>
 #include <math/float3x4.h>
 #include <float.h>
+#ifdef MATH_SSE
+#include <xmmintrin.h>
+#endif
 #include <config.h>
 
 
@@ -15,6 +18,23 @@
 BEGIN_NAMESPACE(math) 
 
 
+#ifdef MATH_SSE
+
+#define MATH_SSE_SPLAT(V,I) _mm_shuffle_ps( V, V, _MM_SHUFFLE(I,I,I,I) )
+
+/** Returns row vector a multiplied by matrix with rows b0,b1,b2,b3. */
+static inline __m128 mulRowSSE( __m128 a, __m128 b0, __m128 b1, __m128 b2, __m128 b3 )
+{
+	__m128 v = _mm_mul_ps( MATH_SSE_SPLAT(a,0), b0 );
+	v = _mm_add_ps( v, _mm_mul_ps(MATH_SSE_SPLAT(a,1),b1) );
+	v = _mm_add_ps( v, _mm_mul_ps(MATH_SSE_SPLAT(a,2),b2) );
+	v = _mm_add_ps( v, _mm_mul_ps(MATH_SSE_SPLAT(a,3),b3) );
+	return v;
+}
+
+#endif // MATH_SSE
+
+
 float4x4::float4x4( float diagonal )
 {
 	m[0][0] = diagonal;
@@ -168,6 +188,19 @@ float4x4 float4x4::operator*( const float4x4& other ) const
 {
 	float4x4 r;
 
+#ifdef MATH_SSE
+
+	// rows are loaded unaligned so that layout stays the same as in portable version
+	const __m128 b0 = _mm_loadu_ps( other.m[0] );
+	const __m128 b1 = _mm_loadu_ps( other.m[1] );
+	const __m128 b2 = _mm_loadu_ps( other.m[2] );
+	const __m128 b3 = _mm_loadu_ps( other.m[3] );
+
+	for ( int j = 0 ; j < ROWS ; ++j )
+		_mm_storeu_ps( r.m[j], mulRowSSE(_mm_loadu_ps(m[j]),b0,b1,b2,b3) );
+
+#else
+
 	for ( int j = 0 ; j < ROWS ; ++j )
 	{
 		r.m[j][0] = m[j][0]*other.m[0][0] +	
@@ -191,6 +224,7 @@ float4x4 float4x4::operator*( const float4x4& other ) const
 					m[j][3]*other.m[3][3];
 	}
 
+#endif // MATH_SSE
 		
 	return r;
 }
@@ -397,6 +431,18 @@ float4x4 float4x4::operator*( const float3x4& other ) const
 {
 	float4x4 r;
 
+#ifdef MATH_SSE
+
+	const __m128 b0 = _mm_loadu_ps( &other(0,0) );
+	const __m128 b1 = _mm_loadu_ps( &other(1,0) );
+	const __m128 b2 = _mm_loadu_ps( &other(2,0) );
+	const __m128 b3 = _mm_set_ps( 1.f, 0.f, 0.f, 0.f );
+
+	for ( int j = 0 ; j < ROWS ; ++j )
+		_mm_storeu_ps( r.m[j], mulRowSSE(_mm_loadu_ps(m[j]),b0,b1,b2,b3) );
+
+#else
+
 	const float other_m3[4] = {0.f,0.f,0.f,1.f};
 	for ( int j = 0 ; j < ROWS ; ++j )
 		for ( int i = 0 ; i < COLUMNS ; ++i )
@@ -405,11 +451,11 @@ float4x4 float4x4::operator*( const float3x4& other ) const
 						m[j][2]*other(2,i) +	
 						m[j][3]*other_m3[i];
 
+#endif // MATH_SSE
 		
 	return r;
 }
 
-
 END_NAMESPACE() // math
 
 // Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.
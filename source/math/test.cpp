@@ -1,7 +1,10 @@
 #include <lang/all.h>
 #include <math/all.h>
+#include <math/Domain.h>
+#include <math/IntersectionUtil.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <config.h>
 
 
@@ -87,6 +90,131 @@ static void test_Matrix3x4()
 		//Debug::printf( "err=%f\n", err );
 		assert( err < 1e-6f );
 	}
+
+	// multiply/inverse of general transforms against element-wise reference
+	{
+		Random rng( 3 );
+		for ( int n = 0 ; n < 100 ; ++n )
+		{
+			float3x4 a, b;
+			for ( int j = 0 ; j < 3 ; ++j )
+				for ( int i = 0 ; i < 4 ; ++i )
+				{
+					a(j,i) = rng.nextFloat( -2.f, 2.f );
+					b(j,i) = rng.nextFloat( -2.f, 2.f );
+				}
+			if ( fabsf(a.determinant3()) < 0.1f )
+				continue;
+
+			float3x4 ab = a * b;
+			float4x4 ab4 = float4x4(a) * b;
+			float4x4 ab44 = float4x4(a) * float4x4(b);
+			for ( int j = 0 ; j < 3 ; ++j )
+				for ( int i = 0 ; i < 4 ; ++i )
+				{
+					float v = a(j,0)*b(0,i) + a(j,1)*b(1,i) + a(j,2)*b(2,i) + (i == 3 ? a(j,3) : 0.f);
+					if ( fabsf(ab(j,i)-v) > 1e-4f || fabsf(ab4(j,i)-v) > 1e-4f || fabsf(ab44(j,i)-v) > 1e-4f )
+						throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+				}
+
+			float3x4 id = a * a.inverse();
+			for ( int j = 0 ; j < 3 ; ++j )
+				for ( int i = 0 ; i < 4 ; ++i )
+					if ( fabsf(id(j,i) - (i == j ? 1.f : 0.f)) > 1e-3f )
+						throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		}
+	}
+}
+
+static void test_Quaternion()
+{
+	// nlerp/fastSlerp against slerp
+	{
+		Random rng( 5 );
+		float maxerr = 0.f;
+		for ( int n = 0 ; n < 1000 ; ++n )
+		{
+			quaternion p = quaternion( normalize(float3(rng.nextFloat(-1,1),rng.nextFloat(-1,1),rng.nextFloat(-1,1))+float3(0,0,1e-3f)), rng.nextFloat(0,6.28f) );
+			quaternion q = quaternion( normalize(float3(rng.nextFloat(-1,1),rng.nextFloat(-1,1),rng.nextFloat(-1,1))+float3(0,0,1e-3f)), rng.nextFloat(0,6.28f) );
+			if ( p.dot(q) < 0.f )
+				q = -q;
+			float t = rng.nextFloat();
+
+			quaternion s = p.slerp( t, q );
+			quaternion f = p.fastSlerp( t, q );
+			quaternion l = p.nlerp( t, q );
+			if ( fabsf(f.norm()-1.f) > 1e-4f || fabsf(l.norm()-1.f) > 1e-4f )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+			// angle between the results
+			float err = 2.f * acosf( Math::min(fabsf(s.dot(f)),1.f) );
+			if ( err > maxerr )
+				maxerr = err;
+		}
+		if ( maxerr > 2e-3f )
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+	}
+
+	// microbenchmark of the transform and interpolation hot paths
+	{
+		const int count = 1000;
+		const int rounds = 200;
+		Array<float3x4> tm( count );
+		Array<quaternion> q( count );
+		Random rng( 9 );
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			q[i] = quaternion( normalize(float3(rng.nextFloat(),rng.nextFloat(),1.f)), rng.nextFloat(0,3.f) );
+			tm[i] = float3x4( q[i], float3(rng.nextFloat(),rng.nextFloat(),rng.nextFloat()) );
+		}
+		float sum = 0.f;
+
+		int time = System::currentTimeMillis();
+		for ( int k = 0 ; k < rounds ; ++k )
+		{
+			float3x4 m = tm[0];
+			for ( int i = 1 ; i < count ; ++i )
+				m = tm[i] * m.inverse();
+			sum += m(0,3);
+		}
+		int multime = System::currentTimeMillis() - time;
+
+		float4x4 proj;
+		proj.setPerspectiveProjection( 1.5f, 1.f, 1000.f, 1.33f );
+		time = System::currentTimeMillis();
+		for ( int k = 0 ; k < rounds ; ++k )
+		{
+			for ( int i = 0 ; i < count ; ++i )
+				sum += (proj * tm[i])(3,3);
+		}
+		int mul4time = System::currentTimeMillis() - time;
+
+		time = System::currentTimeMillis();
+		for ( int k = 0 ; k < rounds ; ++k )
+		{
+			float t = float(k) / float(rounds);
+			for ( int i = 1 ; i < count ; ++i )
+				sum += q[i-1].slerp( t, q[i] ).w;
+		}
+		int slerptime = System::currentTimeMillis() - time;
+
+		time = System::currentTimeMillis();
+		for ( int k = 0 ; k < rounds ; ++k )
+		{
+			float t = float(k) / float(rounds);
+			for ( int i = 1 ; i < count ; ++i )
+				sum += q[i-1].fastSlerp( t, q[i] ).w;
+		}
+		int fastslerptime = System::currentTimeMillis() - time;
+
+#ifdef MATH_SSE
+		const char* backend = "SSE";
+#else
+		const char* backend = "portable";
+#endif
+		Debug::printf( "math: %d ops (%s), float3x4 mul+inverse=%d ms, float4x4*float3x4=%d ms, slerp=%d ms, fastSlerp=%d ms (%g)\n", 
+			count*rounds, backend, multime, mul4time, slerptime, fastslerptime, sum );
+	}
 }
 
 static void test_InterpolationUtil()
@@ -163,11 +291,344 @@ static void test_InterpolationUtil()
 	}
 }
 
+static void test_Skinning()
+{
+	// random bone transforms, 4 mesh bones in primitive bone palette
+	const int bones = 6;
+	Random rng( 17 );
+	float3x4 tms[bones];
+	float4 columns[bones*4];
+	for ( int i = 0 ; i < bones ; ++i )
+	{
+		quaternion q( normalize(float3(rng.nextFloat(-1,1),rng.nextFloat(-1,1),rng.nextFloat(-1,1)+2.f)), rng.nextFloat(-3,3) );
+		tms[i] = float3x4( q, float3(rng.nextFloat(-5,5),rng.nextFloat(-5,5),rng.nextFloat(-5,5)), float3(rng.nextFloat(.5f,2.f),1,1) );
+		InterpolationUtil::setSkinBoneColumns( tms[i], &columns[i*4] );
+	}
+	const uint8_t palette[] = {5,3,0,4};
+	const int palettesize = int(sizeof(palette)/sizeof(palette[0]));
+
+	// skinned vertices against vertices transformed by blended float3x4 bone transforms,
+	// with all weight dimensions and with and without bone palette
+	const int count = 200;
+	Array<float4> pos( count );
+	Array<float4> nrm( count );
+	Array<float4> weights( count );
+	Array<float4> refweights( count );
+	Array<float4> vertexbones( count );
+	Array<uint8_t> boneindices( count*4 );
+	Array<float4> outpos( count );
+	Array<float4> outnrm( count );
+	for ( int dim = 1 ; dim <= 4 ; ++dim )
+	{
+		for ( int usepalette = 0 ; usepalette < 2 ; ++usepalette )
+		{
+			for ( int i = 0 ; i < count ; ++i )
+			{
+				pos[i] = float4( rng.nextFloat(-10,10), rng.nextFloat(-10,10), rng.nextFloat(-10,10), 1.f );
+				nrm[i] = float4( normalize(float3(rng.nextFloat(-1,1),rng.nextFloat(-1,1),1.f)), 0.f );
+
+				// unused weight components are garbage, last used weight is implied if dim<4
+				float4 w( 7, 7, 7, 7 );
+				float4 ref( 0, 0, 0, 0 );
+				float sum = 0.f;
+				for ( int n = 0 ; n < dim && n < 3 ; ++n )
+				{
+					w[n] = ref[n] = rng.nextFloat( 0.f, .33f );
+					sum += w[n];
+				}
+				ref[dim < 4 ? dim : 3] = 1.f - sum;
+				if ( 4 == dim )
+					w[3] = ref[3];
+				weights[i] = w;
+				refweights[i] = ref;
+
+				for ( int n = 0 ; n < 4 ; ++n )
+					vertexbones[i][n] = float( rng.nextInt(usepalette ? palettesize : bones) );
+			}
+
+			InterpolationUtil::setSkinBones( dim, vertexbones.begin(), usepalette ? palette : 0, usepalette ? palettesize : 0, bones, 
+				weights.begin(), boneindices.begin(), count );
+			InterpolationUtil::skinVertices( columns, pos.begin(), nrm.begin(), weights.begin(), boneindices.begin(), 
+				outpos.begin(), outnrm.begin(), count );
+
+			for ( int i = 0 ; i < count ; ++i )
+			{
+				float3x4 tm( 0.f );
+				for ( int n = 0 ; n < 4 ; ++n )
+				{
+					int bone = (int)vertexbones[i][n];
+					if ( usepalette )
+						bone = palette[bone];
+					if ( refweights[i][n] == 0.f )
+						bone = 0;
+					if ( weights[i][n] != refweights[i][n] || boneindices[i*4+n] != bone )
+						throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+					tm += tms[bone] * refweights[i][n];
+				}
+
+				const float3 p = tm.transform( pos[i].xyz() );
+				const float3 n = tm.rotate( nrm[i].xyz() );
+				if ( (p-outpos[i].xyz()).length() > 1e-4f || (n-outnrm[i].xyz()).length() > 1e-4f ||
+					fabsf(outpos[i].w-1.f) > 1e-5f || outnrm[i].w != 0.f )
+					throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+			}
+		}
+	}
+
+	// skinning speed
+	const int rounds = 500;
+	float sum = 0.f;
+	int time = System::currentTimeMillis();
+	for ( int k = 0 ; k < rounds ; ++k )
+	{
+		InterpolationUtil::skinVertices( columns, pos.begin(), nrm.begin(), weights.begin(), boneindices.begin(), 
+			outpos.begin(), outnrm.begin(), count );
+		sum += outpos[k%count].x;
+	}
+	int skintime = System::currentTimeMillis() - time;
+
+#ifdef MATH_SSE
+	const char* backend = "SSE";
+#else
+	const char* backend = "portable";
+#endif
+	Debug::printf( "math: %d vertices skinned (%s) in %d ms (%g)\n", count*rounds, backend, skintime, sum );
+}
+
+static void test_Random()
+{
+	// same seed produces same sequence
+	{
+		Random a( 1234 );
+		Random b( 1234 );
+		Random c( 1235 );
+		int differ = 0;
+		for ( int i = 0 ; i < 1000 ; ++i )
+		{
+			uint32_t x = a.nextInt();
+			if ( x != b.nextInt() )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+			if ( x != c.nextInt() )
+				++differ;
+		}
+		if ( differ < 990 )
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+	}
+
+	// values are in range and roughly uniform
+	{
+		Random rng( 1 );
+		float buf[4096];
+		rng.nextFloats( buf, 4096 );
+		int buckets[8] = {0,0,0,0,0,0,0,0};
+		for ( int i = 0 ; i < 4096 ; ++i )
+		{
+			if ( !(buf[i] >= 0.f && buf[i] < 1.f) )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+			++buckets[ int(buf[i]*8.f) ];
+
+			int k = rng.nextInt( 7 );
+			if ( k < 0 || k >= 7 )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		}
+		for ( int i = 0 ; i < 8 ; ++i )
+			if ( buckets[i] < 400 || buckets[i] > 624 )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+	}
+
+	// batch domain sampling stays inside the domain and is reproducible
+	{
+		Domain box;
+		box.setBox( float3(-1,2,3), float3(1,4,7) );
+		Domain sphere;
+		sphere.setSphere( float3(10,0,0), 1.f, 2.f );
+		Domain disk;
+		disk.setDisk( float3(0,5,0), float3(0,1,0), 0.f, 3.f );
+
+		const int count = 1000;
+		Array<float3> v( count );
+		Array<float3> w( count );
+		Random rng( 7 );
+		Random rng2( 7 );
+
+		box.getRandomFloat3( rng, v.begin(), count );
+		box.getRandomFloat3( rng2, w.begin(), count );
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			const float3& p = v[i];
+			if ( p.x < -1.f || p.x >= 1.f || p.y < 2.f || p.y >= 4.f || p.z < 3.f || p.z >= 7.f || p != w[i] )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		}
+
+		sphere.getRandomFloat3( rng, v.begin(), count );
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			float r = (v[i]-float3(10,0,0)).length();
+			if ( r < 1.f-1e-4f || r > 2.f+1e-4f )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		}
+
+		disk.getRandomFloat3( rng, v.begin(), count );
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			float3 d = v[i] - float3(0,5,0);
+			if ( Math::abs(d.y) > 1e-4f || d.length() > 3.f+1e-4f )
+				throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		}
+	}
+
+	// spawning benchmark: C library rand() vs generator with batch sampling
+	{
+		Domain box;
+		box.setBox( float3(-1,-1,-1), float3(1,1,1) );
+		const int count = 1000;
+		const int rounds = 2000;
+		Array<float3> v( count );
+		float sum = 0.f;
+
+		int time = System::currentTimeMillis();
+		const float RAND_SCALE = 1.f / (float(RAND_MAX)+1.f);
+		for ( int k = 0 ; k < rounds ; ++k )
+			for ( int i = 0 ; i < count ; ++i )
+				v[i] = float3( 2.f*RAND_SCALE*float(rand())-1.f, 2.f*RAND_SCALE*float(rand())-1.f, 2.f*RAND_SCALE*float(rand())-1.f );
+		int randtime = System::currentTimeMillis() - time;
+		sum += v[0].x;
+
+		time = System::currentTimeMillis();
+		Random rng( 1 );
+		for ( int k = 0 ; k < rounds ; ++k )
+			box.getRandomFloat3( rng, v.begin(), count );
+		int batchtime = System::currentTimeMillis() - time;
+		sum += v[0].x;
+
+		Debug::printf( "math: %d box samples, rand()=%d ms, batch=%d ms (%g)\n", count*rounds, randtime, batchtime, sum );
+	}
+}
+
+static void test_IntersectionUtil()
+{
+	// tessellated sphere as test mesh
+	const int segs = 64;
+	Array<float3> verts;
+	for ( int j = 0 ; j < segs ; ++j )
+	{
+		for ( int i = 0 ; i < segs ; ++i )
+		{
+			float3 v[4];
+			for ( int k = 0 ; k < 4 ; ++k )
+			{
+				float a = float(i + (k==1||k==2)) / float(segs) * 6.2831853f;
+				float b = float(j + (k>=2)) / float(segs) * 3.1415927f;
+				v[k] = float3( sinf(b)*cosf(a), cosf(b), sinf(b)*sinf(a) ) * 10.f;
+			}
+			verts.add( v[0] ); verts.add( v[1] ); verts.add( v[2] );
+			verts.add( v[0] ); verts.add( v[2] ); verts.add( v[3] );
+		}
+	}
+	const int tricount = verts.size() / 3;
+	Array<float> blocks( IntersectionUtil::getTriangleBlockSize(tricount) );
+	IntersectionUtil::setTriangleBlocks( verts.begin(), tricount, blocks.begin() );
+
+	const int raycount = 200;
+	Array<float3> orig( raycount );
+	Array<float3> dir( raycount );
+	Random rng( 13 );
+	for ( int i = 0 ; i < raycount ; ++i )
+	{
+		orig[i] = float3( rng.nextFloat(-15,15), rng.nextFloat(-15,15), -20.f );
+		dir[i] = float3( rng.nextFloat(-.5f,.5f), rng.nextFloat(-.5f,.5f), 1.f );
+	}
+
+	// batch ray-triangle test against one-at-a-time test
+	float sum = 0.f;
+	int time = System::currentTimeMillis();
+	Array<int> scalarhit( raycount );
+	Array<float> scalart( raycount );
+	for ( int i = 0 ; i < raycount ; ++i )
+	{
+		float tmin = 100.f;
+		scalarhit[i] = -1;
+		for ( int k = 0 ; k < tricount ; ++k )
+		{
+			float t;
+			if ( IntersectionUtil::findRayTriangleIntersection(orig[i],dir[i],verts[k*3],verts[k*3+1],verts[k*3+2],&t) && t < tmin )
+			{
+				tmin = t;
+				scalarhit[i] = k;
+			}
+		}
+		scalart[i] = tmin;
+		sum += tmin;
+	}
+	int scalartime = System::currentTimeMillis() - time;
+
+	time = System::currentTimeMillis();
+	int hits = 0;
+	for ( int i = 0 ; i < raycount ; ++i )
+	{
+		float t = 100.f;
+		int hit = IntersectionUtil::findRayTrianglesIntersection( orig[i], dir[i], blocks.begin(), tricount, &t );
+		if ( hit != scalarhit[i] || fabsf(t-scalart[i]) > 1e-4f )
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		hits += hit >= 0;
+		sum += t;
+	}
+	int batchtime = System::currentTimeMillis() - time;
+	if ( 0 == hits )
+		throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+	// batch ray-box test against one-at-a-time test
+	const int rounds = 500;
+	const float3 boxmin( -6, -4, -5 );
+	const float3 boxmax( 5, 7, 3 );
+	Array<float> boxt( raycount );
+	Array<bool> boxhit( raycount );
+	time = System::currentTimeMillis();
+	for ( int k = 0 ; k < rounds ; ++k )
+	{
+		for ( int i = 0 ; i < raycount ; ++i )
+		{
+			float t = 1.f;
+			boxhit[i] = IntersectionUtil::findLineBoxIntersection( orig[i], dir[i]*40.f, float4x4(1.f), boxmin, boxmax, &t );
+			boxt[i] = t;
+		}
+	}
+	int scalarboxtime = System::currentTimeMillis() - time;
+
+	Array<float3> delta( raycount );
+	for ( int i = 0 ; i < raycount ; ++i )
+		delta[i] = dir[i] * 40.f;
+	Array<float> t( raycount );
+	Array<bool> hit( raycount );
+	time = System::currentTimeMillis();
+	for ( int k = 0 ; k < rounds ; ++k )
+	{
+		for ( int i = 0 ; i < raycount ; ++i )
+			t[i] = 1.f;
+		IntersectionUtil::findRaysBoxIntersection( orig.begin(), delta.begin(), raycount, boxmin, boxmax, t.begin(), hit.begin() );
+	}
+	int batchboxtime = System::currentTimeMillis() - time;
+
+	for ( int i = 0 ; i < raycount ; ++i )
+	{
+		if ( hit[i] != boxhit[i] || (hit[i] && fabsf(t[i]-boxt[i]) > 1e-4f) )
+			throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+		sum += t[i];
+	}
+
+	Debug::printf( "math: %d rays x %d triangles, scalar=%d ms, batch=%d ms; %d rays x box, scalar=%d ms, batch=%d ms (%g)\n", 
+		raycount, tricount, scalartime, batchtime, raycount*rounds, scalarboxtime, batchboxtime, sum );
+}
+
 static void run()
 {
 	test_Matrix4x4();
 	test_Matrix3x4();
+	test_Quaternion();
 	test_InterpolationUtil();
+	test_Skinning();
+	test_IntersectionUtil();
+	test_Random();
 }
 
 void test()
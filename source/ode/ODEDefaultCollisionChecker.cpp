@@ -27,6 +27,11 @@ int ODEDefaultCollisionChecker::checkCollisions( dGeomID o1, dGeomID o2,
 	return numc;
 }
 
+bool ODEDefaultCollisionChecker::isThreadSafe() const
+{
+	return true;
+}
+
 
 END_NAMESPACE() // ode
 
@@ -1,9 +1,11 @@
 #include <ode/ODEObject.h>
+#include <ode/ODEWorld.h>
 #include <gr/Primitive.h>
-#include <io/PropertyParser.h>
+#include <io/PropertySchema.h>
 #include <hgr/Mesh.h>
 #include <ode/ode.h>
 #include <lang/Exception.h>
+#include <lang/UTFConverter.h>
 #include <string.h>
 #include <config.h>
 
@@ -18,6 +20,32 @@ USING_NAMESPACE(math)
 BEGIN_NAMESPACE(ode) 
 
 
+/** Mesh user properties used by physics. */
+struct PhysicsProperties
+{
+	PropertyView	physics;
+	PropertyView	mass;
+	PropertyView	density;
+};
+
+/** Indices of the fields in PHYSICS_PROPERTY_FIELDS. */
+enum PhysicsPropertyField
+{
+	PHYSICSPROPERTY_PHYSICS,
+	PHYSICSPROPERTY_MASS,
+	PHYSICSPROPERTY_DENSITY,
+};
+
+static const PropertySchema::Field PHYSICS_PROPERTY_FIELDS[] =
+{
+	PROPERTYSCHEMA_FIELD( PhysicsProperties, "physics", FIELD_VIEW, physics ),
+	PROPERTYSCHEMA_FIELD( PhysicsProperties, "mass", FIELD_VIEW, mass ),
+	PROPERTYSCHEMA_FIELD( PhysicsProperties, "density", FIELD_VIEW, density ),
+};
+
+static const PropertySchema s_physicsPropertySchema( PHYSICS_PROPERTY_FIELDS, sizeof(PHYSICS_PROPERTY_FIELDS)/sizeof(PHYSICS_PROPERTY_FIELDS[0]) );
+
+
 ODEObject::ODEObject() :
 	m_mesh( 0 ),
 	m_geom( 0 ),
@@ -174,6 +202,20 @@ void ODEObject::updateVisualTransform()
 	}
 }
 
+void ODEObject::updateVisualTransform( const ODEWorld* world )
+{
+	assert( m_geom );
+	assert( world );
+
+	dBodyID body = dGeomGetBody( m_geom );
+	if ( body != 0 )
+	{
+		float3x4 tm;
+		world->getInterpolatedTransform( body, &tm );
+		m_mesh->setTransform( tm * m_ibodytm );
+	}
+}
+
 void ODEObject::addImpulse( dWorldID world, const float3& imp, float dt )
 {
 	assert( body() ); // body is required for simulations
@@ -416,7 +458,14 @@ dGeomID ODEObject::geom() const
 void ODEObject::parseProperties( Mesh* mesh, const String& props,
 	GeomType* geomtype, MassType* masstype, float* mass )
 {
-	PropertyParser parser( props, mesh->name() );
+	// parse from own copies, views of prop point to text
+	Array<char> text( props.length()+1 );
+	props.get( text.begin(), text.size() );
+	Array<char> name( mesh->name().length()+1 );
+	mesh->name().get( name.begin(), name.size() );
+
+	PhysicsProperties prop;
+	uint32_t found = s_physicsPropertySchema.parse( text.begin(), props.length(), &prop, name.begin() );
 
 	// defaults
 	*geomtype = GEOM_DEFAULT;
@@ -424,36 +473,33 @@ void ODEObject::parseProperties( Mesh* mesh, const String& props,
 	*mass = 0.f;
 
 	// parse geometry shape
-	if ( parser.hasKey("physics") )
+	if ( found & (1<<PHYSICSPROPERTY_PHYSICS) )
 	{
-		const char* sz = parser.getString( "physics" );
-		if ( !strcmp(sz,"trimesh") ) // triangle mesh
+		if ( prop.physics == "trimesh" ) // triangle mesh
 			*geomtype = GEOM_TRIMESH;
-		else if ( !strcmp(sz,"box") ) // bounding box
+		else if ( prop.physics == "box" ) // bounding box
 			*geomtype = GEOM_BOX;
-		else if ( !strcmp(sz,"sphere") ) // bounding sphere
+		else if ( prop.physics == "sphere" ) // bounding sphere
 			*geomtype = GEOM_SPHERE;
 	}
 
 	// see if user has specified mass/density property
-	if ( parser.hasKey("mass") )
+	if ( found & (1<<PHYSICSPROPERTY_MASS) )
 	{
-		const char* sz = parser.getString( "mass" );
 		if ( *geomtype == GEOM_DEFAULT )
 			throwError( Exception( Format("Failed to parse mesh \"{0}\" user property: 'Mass=<x>' doesnt make sense if object has no 'Physics=<x>' defined", mesh->name()) ) );
-		if ( sscanf(sz,"%g",mass) != 1 )
-			throwError( Exception( Format("Failed to parse mesh \"{0}\" user property 'mass': {1}", mesh->name(), sz) ) );
+		if ( PropertyTokenizer::parseFloats(prop.mass,mass,1) != 1 )
+			throwError( Exception( Format("Failed to parse mesh \"{0}\" user property 'mass': {1}", mesh->name(), String(prop.mass.begin,prop.mass.length,UTFConverter(UTFConverter::ENCODING_UTF8))) ) );
 		*masstype = MASS_TOTAL;
 	}
-	else if ( parser.hasKey("density") )
+	else if ( found & (1<<PHYSICSPROPERTY_DENSITY) )
 	{
-		const char* sz = parser.getString( "density" );
 		if ( *geomtype == GEOM_DEFAULT )
 			throwError( Exception( Format("Failed to parse mesh \"{0}\" user property: 'Density=<x>' doesnt make sense if object has no 'Physics=<x>' defined", mesh->name()) ) );
 		if ( *masstype != MASS_INFINITE )
 			throwError( Exception( Format("Failed to parse mesh \"{0}\" user property: Density and Mass are mutually exlusive properties", mesh->name()) ) );
-		if ( sscanf(sz,"%g",mass) != 1 )
-			throwError( Exception( Format("Failed to parse mesh \"{0}\" user property 'density': {1}", mesh->name(), sz) ) );
+		if ( PropertyTokenizer::parseFloats(prop.density,mass,1) != 1 )
+			throwError( Exception( Format("Failed to parse mesh \"{0}\" user property 'density': {1}", mesh->name(), String(prop.density.begin,prop.density.length,UTFConverter(UTFConverter::ENCODING_UTF8))) ) );
 		*masstype = MASS_DENSITY;
 	}
 }
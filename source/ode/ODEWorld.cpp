@@ -2,7 +2,13 @@
 #include <ode/ODEDefaultCollisionChecker.h>
 #include <ode/ode.h>
 #include <lang/Math.h>
+#include <lang/ThreadPool.h>
 #include <math/float3.h>
+#include <math/float3x4.h>
+#include <objects.h>
+#include <joint.h>
+#include <util.h>
+#include <quickstep.h>
 #include <config.h>
 
 
@@ -13,11 +19,69 @@ USING_NAMESPACE(math)
 BEGIN_NAMESPACE(ode) 
 
 
+/** Near object pairs per collision checking job. */
+const int COLLISION_PAIRS_PER_JOB = 32;
+
+/** Minimum number of bodies per island solving job. */
+const int ISLAND_BODIES_PER_JOB = 16;
+
+
+/** Checks contacts of a range of near object pairs. */
+class CollisionJob :
+	public ThreadPool::Job
+{
+public:
+	ODECollisionInterface*		checker;
+	ODEWorld::CollisionPair*	pairs;
+	dContact*					contacts;
+	int							begin;
+	int							end;
+
+	void run()
+	{
+		for ( int i = begin ; i < end ; ++i )
+		{
+			ODEWorld::CollisionPair& pair = pairs[i];
+			if ( !pair.serial )
+				pair.contacts = checker->checkCollisions( pair.o1, pair.o2, contacts+i*ODEWorld::MAX_CONTACTS, ODEWorld::MAX_CONTACTS );
+		}
+	}
+};
+
+/** Solves a range of islands. */
+class IslandJob :
+	public ThreadPool::Job
+{
+public:
+	dWorldID				world;
+	ODEWorld::Island*		islands;
+	dBodyID*				bodies;
+	dJointID*				joints;
+	int						begin;
+	int						end;
+	float					dt;
+
+	void run()
+	{
+		for ( int i = begin ; i < end ; ++i )
+		{
+			ODEWorld::Island& island = islands[i];
+			dxQuickStepperSeeded( world, bodies+island.firstBody, island.bodies, 
+				joints+island.firstJoint, island.joints, dt, &island.seed );
+		}
+	}
+};
+
+
 ODEWorld::ODEWorld( float groundlevel ) :
 	m_world( 0 ),
 	m_space( 0 ),
 	m_contacts( 0 ),
-	m_ground( 0 )
+	m_ground( 0 ),
+	m_prevStates( 256 ),
+	m_timeStep( 1.f/100.f ),
+	m_time( 0.f ),
+	m_maxSteps( 8 )
 {
 	m_world = dWorldCreate();
 	setGravity( float3(0,-9.8f,0) );
@@ -69,8 +133,10 @@ void ODEWorld::setGravity( const float3& f )
 	dWorldSetGravity( m_world, f.x, f.y, f.z );
 }
 
-void ODEWorld::step( float dt, ODECollisionInterface* checker )
+void ODEWorld::step( float dt, ODECollisionInterface* checker, ThreadPool* pool )
 {
+	assert( dt > 0.f );
+
 	// use default collision checker if needed
 	ODEDefaultCollisionChecker defaultcollisionchecker;
 	if ( !checker )
@@ -78,14 +144,286 @@ void ODEWorld::step( float dt, ODECollisionInterface* checker )
 
 	// collect contacts
 	dJointGroupEmpty( m_contacts );
-	CollisionCallbackProxyData data;
-	data.world = this;
-	data.checker = checker;
-	dSpaceCollide( m_space, &data, collisionCallbackProxy );
+	collide( checker, pool );
 
 	// simulate step
-	dWorldQuickStep( m_world, dt );
-	//dWorldStep( m_world, dt );
+	stepIslands( dt, pool );
+}
+
+int ODEWorld::update( float dt, ODECollisionInterface* checker, ThreadPool* pool )
+{
+	assert( dt >= 0.f );
+
+	m_time += dt;
+	int steps = int( m_time / m_timeStep );
+	if ( steps > m_maxSteps )
+	{
+		steps = m_maxSteps;
+		m_time = m_timeStep * float(steps);
+	}
+
+	for ( int i = 0 ; i < steps ; ++i )
+	{
+		// only state before the last step is needed for interpolation
+		if ( i+1 == steps )
+			storeBodyStates();
+
+		step( m_timeStep, checker, pool );
+	}
+
+	m_time -= m_timeStep * float(steps);
+	if ( m_time < 0.f )
+		m_time = 0.f;
+	return steps;
+}
+
+void ODEWorld::setTimeStep( float dt, int maxsteps )
+{
+	assert( dt > 0.f );
+	assert( maxsteps > 0 );
+
+	m_timeStep = dt;
+	m_maxSteps = maxsteps;
+}
+
+float ODEWorld::timeStep() const
+{
+	return m_timeStep;
+}
+
+float ODEWorld::interpolation() const
+{
+	return Math::min( m_time / m_timeStep, 1.f );
+}
+
+void ODEWorld::storeBodyStates()
+{
+	// disabled bodies do not move, so their current state is used as is
+	m_prevStates.clear();
+	for ( dxBody* b = m_world->firstbody ; b ; b = (dxBody*)b->next )
+	{
+		if ( b->flags & dxBodyDisabled )
+			continue;
+
+		const float* r = b->R;
+		float3x3 rot;
+		rot(0,0) = r[0];
+		rot(0,1) = r[1];
+		rot(0,2) = r[2];
+		rot(1,0) = r[4+0];
+		rot(1,1) = r[4+1];
+		rot(1,2) = r[4+2];
+		rot(2,0) = r[8+0];
+		rot(2,1) = r[8+1];
+		rot(2,2) = r[8+2];
+
+		BodyState state;
+		state.position = float3( b->pos[0], b->pos[1], b->pos[2] );
+		state.rotation = quaternion( rot );
+		m_prevStates[b] = state;
+	}
+}
+
+void ODEWorld::getInterpolatedTransform( dBodyID body, float3x4* tm ) const
+{
+	assert( body );
+
+	const float* p = dBodyGetPosition( body );
+	const float* r = dBodyGetRotation( body );
+	float3x3 rot;
+	rot(0,0) = r[0];
+	rot(0,1) = r[1];
+	rot(0,2) = r[2];
+	rot(1,0) = r[4+0];
+	rot(1,1) = r[4+1];
+	rot(1,2) = r[4+2];
+	rot(2,0) = r[8+0];
+	rot(2,1) = r[8+1];
+	rot(2,2) = r[8+2];
+	float3 pos( p[0], p[1], p[2] );
+
+	if ( m_prevStates.containsKey(body) )
+	{
+		const BodyState& prev = m_prevStates[body];
+		const float t = interpolation();
+		pos = prev.position + (pos - prev.position) * t;
+		rot = float3x3( prev.rotation.nlerp(t,quaternion(rot)) );
+	}
+
+	tm->setRotation( rot );
+	tm->setTranslation( pos );
+}
+
+void ODEWorld::collide( ODECollisionInterface* checker, ThreadPool* pool )
+{
+	// find near object pairs
+	m_pairs.clear();
+	dSpaceCollide( m_space, this, collisionCallbackProxy );
+	const int count = m_pairs.size();
+	if ( 0 == count )
+		return;
+
+	m_contactBuffer.resize( count*MAX_CONTACTS );
+	dContact* contacts = m_contactBuffer.begin();
+
+	int jobcount = 1;
+	if ( pool != 0 && checker->isThreadSafe() && count > COLLISION_PAIRS_PER_JOB )
+		jobcount = (count+COLLISION_PAIRS_PER_JOB-1) / COLLISION_PAIRS_PER_JOB;
+	Array<CollisionJob> jobs( jobcount );
+	for ( int i = 0 ; i < jobcount ; ++i )
+	{
+		CollisionJob& job = jobs[i];
+		job.checker = checker;
+		job.pairs = m_pairs.begin();
+		job.contacts = contacts;
+		job.begin = i*count/jobcount;
+		job.end = (i+1)*count/jobcount;
+	}
+
+	ThreadPool::Batch batch;
+	if ( jobcount > 1 )
+	{
+		for ( int i = 0 ; i < jobcount ; ++i )
+			pool->add( &jobs[i], &batch );
+	}
+	else
+	{
+		jobs[0].run();
+	}
+
+	// pairs which cannot be checked in parallel
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		CollisionPair& pair = m_pairs[i];
+		if ( pair.serial )
+			pair.contacts = checker->checkCollisions( pair.o1, pair.o2, contacts+i*MAX_CONTACTS, MAX_CONTACTS );
+	}
+
+	if ( jobcount > 1 )
+		pool->wait( &batch );
+
+	// add contacts to contact joint group in pair order
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		const CollisionPair& pair = m_pairs[i];
+		dBodyID b1 = dGeomGetBody( pair.o1 );
+		dBodyID b2 = dGeomGetBody( pair.o2 );
+		for ( int k = 0 ; k < pair.contacts ; ++k )
+		{
+			dJointID c = dJointCreateContact( m_world, m_contacts, &contacts[i*MAX_CONTACTS+k] );
+			dJointAttach( c, b1, b2 );
+		}
+	}
+}
+
+void ODEWorld::stepIslands( float dt, ThreadPool* pool )
+{
+	// same as ODE dxProcessIslands, but collects all islands before solving them
+	dxWorld* world = m_world;
+	if ( world->nb <= 0 )
+		return;
+
+	dInternalHandleAutoDisabling( world, dt );
+
+	m_islands.clear();
+	m_islandBodies.resize( world->nb );
+	m_islandJoints.resize( world->nj );
+	dxBody** body = m_islandBodies.begin();
+	dxJoint** joint = m_islandJoints.begin();
+	int bcount = 0;
+	int jcount = 0;
+
+	dxBody* b;
+	dxJoint* j;
+	for ( b = world->firstbody ; b ; b = (dxBody*)b->next ) 
+		b->tag = 0;
+	for ( j = world->firstjoint ; j ; j = (dxJoint*)j->next ) 
+		j->tag = 0;
+
+	// bodies which have been tagged but not yet added to the island,
+	// these are in the end of the body array
+	Array<dxBody*> stack;
+	for ( dxBody* bb = world->firstbody ; bb ; bb = (dxBody*)bb->next )
+	{
+		if ( bb->tag || (bb->flags & dxBodyDisabled) )
+			continue;
+		bb->tag = 1;
+
+		Island island;
+		island.firstBody = bcount;
+		island.firstJoint = jcount;
+
+		stack.clear();
+		stack.add( bb );
+		while ( stack.size() > 0 )
+		{
+			b = stack.last();
+			stack.resize( stack.size()-1 );
+			body[bcount++] = b;
+
+			for ( dxJointNode* n = b->firstjoint ; n ; n = n->next )
+			{
+				if ( !n->joint->tag )
+				{
+					n->joint->tag = 1;
+					joint[jcount++] = n->joint;
+					if ( n->body && !n->body->tag )
+					{
+						n->body->tag = 1;
+						stack.add( n->body );
+					}
+				}
+			}
+		}
+
+		// random number generator state per island keeps results independent of solving order
+		island.bodies = bcount - island.firstBody;
+		island.joints = jcount - island.firstJoint;
+		island.seed = dRand();
+		m_islands.add( island );
+	}
+
+	// group consecutive islands to jobs
+	Array<IslandJob> jobs;
+	for ( int i = 0 ; i < m_islands.size() ; )
+	{
+		IslandJob job;
+		job.world = m_world;
+		job.islands = m_islands.begin();
+		job.bodies = m_islandBodies.begin();
+		job.joints = m_islandJoints.begin();
+		job.dt = dt;
+		job.begin = i;
+		int bodies = 0;
+		while ( i < m_islands.size() && (pool == 0 || bodies < ISLAND_BODIES_PER_JOB) )
+			bodies += m_islands[i++].bodies;
+		job.end = i;
+		jobs.add( job );
+	}
+
+	if ( jobs.size() > 1 )
+	{
+		ThreadPool::Batch batch;
+		for ( int i = 0 ; i < jobs.size() ; ++i )
+			pool->add( &jobs[i], &batch );
+		pool->wait( &batch );
+	}
+	else if ( jobs.size() > 0 )
+	{
+		jobs[0].run();
+	}
+
+	// solving may have altered the body/joint tag values,
+	// make sure these are nonzero and all bodies are enabled.
+	// moved geoms are relinked in the space, so notify them here in fixed order
+	for ( int i = 0 ; i < bcount ; ++i )
+	{
+		dxBodyMoved( body[i] );
+		body[i]->tag = 1;
+		body[i]->flags &= ~dxBodyDisabled;
+	}
+	for ( int i = 0 ; i < jcount ; ++i )
+		joint[i]->tag = 1;
 }
 
 dSpaceID ODEWorld::space() const
@@ -129,17 +467,18 @@ void ODEWorld::collisionCallbackProxy( void* data, dGeomID o1, dGeomID o2 )
 	if ( (!b1 || !dBodyIsEnabled(b1)) && (!b2 || !dBodyIsEnabled(b2)) )
 		return;
 
-	// ask contacts from the callback
-	CollisionCallbackProxyData* proxydata = reinterpret_cast<CollisionCallbackProxyData*>( data );
-	ODEWorld* world = proxydata->world;
-	int numc = proxydata->checker->checkCollisions( o1, o2, proxydata->contacts, MAX_CONTACTS );
-
-	// add contacts to contact joint group
-	for ( int i = 0 ; i < numc ; ++i )
-	{
-		dJointID c = dJointCreateContact( world->m_world, world->m_contacts, &proxydata->contacts[i] );
-		dJointAttach( c, b1, b2 );
-	}
+	// only collect pairs here, contacts are checked afterwards (possibly in parallel),
+	// except pairs with trimeshes since ODE trimesh colliders use static data,
+	// and pairs with geometry transforms since their collider moves the transformed geometry
+	const int class1 = dGeomGetClass( o1 );
+	const int class2 = dGeomGetClass( o2 );
+	CollisionPair pair;
+	pair.o1 = o1;
+	pair.o2 = o2;
+	pair.contacts = 0;
+	pair.serial = class1 == dTriMeshClass || class2 == dTriMeshClass ||
+		class1 == dGeomTransformClass || class2 == dGeomTransformClass;
+	reinterpret_cast<ODEWorld*>( data )->m_pairs.add( pair );
 }
 
 
@@ -31,6 +31,7 @@
 #include <ode/misc.h>
 #include "lcp.h"
 #include "util.h"
+#include "quickstep.h"
 
 #define ALLOCA dALLOCA16
 
@@ -308,10 +309,24 @@ static int compare_index_error (const void *a, const void *b)
 #endif
 
 
+#ifdef RANDOMLY_REORDER_CONSTRAINTS
+
+// same as dRandInt() but with caller specified generator state, so that
+// islands can be solved in parallel and still get deterministic results
+static int dRandIntSeeded (unsigned long *seed, int n)
+{
+  *seed = (1664525L*(*seed) + 1013904223L) & 0xffffffff;
+  double a = double(n) / 4294967296.0;
+  return (int) (double(*seed) * a);
+}
+
+#endif
+
+
 static void SOR_LCP (int m, int nb, dRealMutablePtr J, int *jb, dxBody * const *body,
 	dRealPtr invI, dRealMutablePtr lambda, dRealMutablePtr fc, dRealMutablePtr b,
 	dRealMutablePtr lo, dRealMutablePtr hi, dRealPtr cfm, int *findex,
-	dxQuickStepParameters *qs)
+	dxQuickStepParameters *qs, unsigned long *seed)
 {
 	const int num_iterations = qs->num_iterations;
 	const dReal sor_w = qs->w;		// SOR over-relaxation parameter
@@ -422,7 +437,7 @@ static void SOR_LCP (int m, int nb, dRealMutablePtr J, int *jb, dxBody * const *
                 if ((iteration & 7) == 0) {
 			for (i=1; i<m; ++i) {
 				IndexError tmp = order[i];
-				int swapi = dRandInt(i+1);
+				int swapi = dRandIntSeeded(seed,i+1);
 				order[i] = order[swapi];
 				order[swapi] = tmp;
 			}
@@ -521,6 +536,17 @@ static void SOR_LCP (int m, int nb, dRealMutablePtr J, int *jb, dxBody * const *
 
 void dxQuickStepper (dxWorld *world, dxBody * const *body, int nb,
 		     dxJoint * const *_joint, int nj, dReal stepsize)
+{
+	unsigned long seed = dRandGetSeed();
+	dxQuickStepperSeeded (world,body,nb,_joint,nj,stepsize,&seed);
+	dRandSetSeed (seed);
+	for (int i=0; i<nb; i++) dxBodyMoved (body[i]);
+}
+
+
+void dxQuickStepperSeeded (dxWorld *world, dxBody * const *body, int nb,
+		     dxJoint * const *_joint, int nj, dReal stepsize,
+		     unsigned long *seed)
 {
 	int i,j;
 	IFTIMING(dTimerStart("preprocessing");)
@@ -687,7 +713,7 @@ void dxQuickStepper (dxWorld *world, dxBody * const *body, int nb,
 		// solve the LCP problem and get lambda and invM*constraint_force
 		IFTIMING (dTimerNow ("solving LCP problem");)
 		dRealAllocaArray (cforce,nb*6);
-		SOR_LCP (m,nb,J,jb,body,invI,lambda,cforce,rhs,lo,hi,cfm,findex,&world->qs);
+		SOR_LCP (m,nb,J,jb,body,invI,lambda,cforce,rhs,lo,hi,cfm,findex,&world->qs,seed);
 
 #ifdef WARM_STARTING
 		// save lambda for the next iteration
@@ -772,7 +798,7 @@ void dxQuickStepper (dxWorld *world, dxBody * const *body, int nb,
 	// update the position and orientation from the new linear/angular velocity
 	// (over the given timestep)
 	IFTIMING (dTimerNow ("update position");)
-	for (i=0; i<nb; i++) dxStepBody (body[i],stepsize);
+	for (i=0; i<nb; i++) dxIntegrateBody (body[i],stepsize);
 
 	IFTIMING (dTimerNow ("tidy up");)
 
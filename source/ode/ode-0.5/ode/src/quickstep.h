@@ -29,5 +29,13 @@
 void dxQuickStepper (dxWorld *world, dxBody * const *body, int nb,
 		     dxJoint * const *_joint, int nj, dReal stepsize);
 
+// same as dxQuickStepper but uses given random number generator state
+// instead of the global one, so that islands can be stepped in parallel.
+// attached geoms are not notified about moved bodies, caller must call
+// dxBodyMoved() for each body afterwards (serially, geoms modify spaces)
+void dxQuickStepperSeeded (dxWorld *world, dxBody * const *body, int nb,
+		     dxJoint * const *_joint, int nj, dReal stepsize,
+		     unsigned long *seed);
+
 
 #endif
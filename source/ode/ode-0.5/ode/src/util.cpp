@@ -90,6 +90,16 @@ static inline dReal sinc (dReal x)
 // interval h, thereby adjusting its position and orientation.
 
 void dxStepBody (dxBody *b, dReal h)
+{
+  dxIntegrateBody (b,h);
+  dxBodyMoved (b);
+}
+
+
+// same as dxStepBody but does not notify attached geoms. geom notification
+// modifies the space the geoms are in, so it must not be done concurrently.
+
+void dxIntegrateBody (dxBody *b, dReal h)
 {
   int j;
 
@@ -157,8 +167,13 @@ void dxStepBody (dxBody *b, dReal h)
   // normalize the quaternion and convert it to a rotation matrix
   dNormalize4 (b->q);
   dQtoR (b->q,b->R);
+}
+
 
-  // notify all attached geoms that this body has moved
+// notify all attached geoms that this body has moved
+
+void dxBodyMoved (dxBody *b)
+{
   for (dxGeom *geom = b->geom; geom; geom = dGeomGetBodyNext (geom))
     dGeomMoved (geom);
 }
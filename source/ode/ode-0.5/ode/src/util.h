@@ -28,6 +28,8 @@
 
 void dInternalHandleAutoDisabling (dxWorld *world, dReal stepsize);
 void dxStepBody (dxBody *b, dReal h);
+void dxIntegrateBody (dxBody *b, dReal h);
+void dxBodyMoved (dxBody *b);
 
 typedef void (*dstepper_fn_t) (dxWorld *world, dxBody * const *body, int nb,
         dxJoint * const *_joint, int nj, dReal stepsize);
@@ -0,0 +1,176 @@
+#include <ode/test.h>
+#include <ode/ODEWorld.h>
+#include <ode/ODEDefaultCollisionChecker.h>
+#include <ode/ode.h>
+#include <lang/all.h>
+#include <string.h>
+#include <config.h>
+
+
+USING_NAMESPACE(lang)
+
+
+BEGIN_NAMESPACE(ode) 
+
+
+/** Collision checker which is not thread safe and checks that it is not called concurrently. */
+class SerialCollisionChecker :
+	public ODEDefaultCollisionChecker
+{
+public:
+	int		calls;
+	int		maxCalls;
+
+	SerialCollisionChecker() : calls(0), maxCalls(0) {}
+
+	int checkCollisions( dGeomID o1, dGeomID o2, dContact* contacts, int maxcontacts )
+	{
+		{Mutex::Lock lk( m_mutex ); 
+		if ( ++calls > maxCalls ) maxCalls = calls;}
+
+		int numc = ODEDefaultCollisionChecker::checkCollisions( o1, o2, contacts, maxcontacts );
+
+		{Mutex::Lock lk( m_mutex ); 
+		--calls;}
+		return numc;
+	}
+
+	bool isThreadSafe() const
+	{
+		return false;
+	}
+
+private:
+	Mutex	m_mutex;
+};
+
+/** Body positions and rotations after simulation. */
+class BodyStates
+{
+public:
+	Array<dReal>	positions;
+	Array<dReal>	rotations;
+};
+
+/**
+ * Simulates stacks of boxes, spheres and transformed boxes falling on each other.
+ * @return Simulation time in milliseconds.
+ */
+static int simulate( ThreadPool* pool, ODECollisionInterface* checker, int steps, BodyStates* out )
+{
+	dRandSetSeed( 0 );
+	ODEWorld world( 0.f );
+	Array<dBodyID> bodies;
+	Array<dGeomID> geoms;
+	for ( int s = 0 ; s < 20 ; ++s )
+	{
+		for ( int k = 0 ; k < 6 ; ++k )
+		{
+			dBodyID body = dBodyCreate( world.world() );
+			dBodySetPosition( body, float(s%5)*4.f + .05f*float(k), .5f + float(k)*1.05f, float(s/5)*4.f );
+			dMass mass;
+			dGeomID geom;
+			switch ( k%3 )
+			{
+			case 0:
+				dMassSetBox( &mass, 1.f, 1.f, 1.f, 1.f );
+				geom = dCreateBox( world.space(), 1.f, 1.f, 1.f );
+				break;
+			case 1:
+				dMassSetSphere( &mass, 1.f, .5f );
+				geom = dCreateSphere( world.space(), .5f );
+				break;
+			default:{
+				dMassSetBox( &mass, 1.f, 1.f, 1.f, 1.f );
+				dGeomID box = dCreateBox( 0, 1.f, .8f, 1.f );
+				dGeomSetPosition( box, .1f, 0.f, 0.f );
+				geom = dCreateGeomTransform( world.space() );
+				dGeomTransformSetGeom( geom, box );
+				dGeomTransformSetCleanup( geom, 1 );
+				break;}
+			}
+			dBodySetMass( body, &mass );
+			dGeomSetBody( geom, body );
+			bodies.add( body );
+			geoms.add( geom );
+		}
+	}
+
+	int time = System::currentTimeMillis();
+	for ( int i = 0 ; i < steps ; ++i )
+		world.step( 1.f/60.f, checker, pool );
+	time = System::currentTimeMillis() - time;
+
+	out->positions.clear();
+	out->rotations.clear();
+	for ( int i = 0 ; i < bodies.size() ; ++i )
+	{
+		const dReal* p = dBodyGetPosition( bodies[i] );
+		const dReal* r = dBodyGetRotation( bodies[i] );
+		for ( int k = 0 ; k < 3 ; ++k )
+			out->positions.add( p[k] );
+		for ( int k = 0 ; k < 12 ; ++k )
+			out->rotations.add( r[k] );
+	}
+
+	for ( int i = 0 ; i < geoms.size() ; ++i )
+		dGeomDestroy( geoms[i] );
+	return time;
+}
+
+static bool operator==( const BodyStates& a, const BodyStates& b )
+{
+	return a.positions.size() == b.positions.size() && a.rotations.size() == b.rotations.size() &&
+		0 == memcmp( a.positions.begin(), b.positions.begin(), a.positions.size()*sizeof(dReal) ) &&
+		0 == memcmp( a.rotations.begin(), b.rotations.begin(), a.rotations.size()*sizeof(dReal) );
+}
+
+static void testDeterminism()
+{
+	// results must not depend on thread pool or number of threads
+	const int steps = 300;
+	ODEDefaultCollisionChecker checker;
+	BodyStates serial;
+	int serialtime = simulate( 0, &checker, steps, &serial );
+
+	ThreadPool pool1( 1 );
+	BodyStates states;
+	simulate( &pool1, &checker, steps, &states );
+	if ( !(states == serial) )
+		throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+	ThreadPool pool( 4 );
+	int pooltime = simulate( &pool, &checker, steps, &states );
+	if ( !(states == serial) )
+		throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+	// checker which is not thread safe is never called concurrently
+	SerialCollisionChecker serialchecker;
+	simulate( &pool, &serialchecker, steps, &states );
+	if ( !(states == serial) || serialchecker.maxCalls != 1 )
+		throwError( Exception( Format("Error at {0}({1})", __FILE__, __LINE__) ) );
+
+	Debug::printf( "ode: %d bodies x %d steps, %d ms serially, %d ms with %d threads\n", 
+		serial.positions.size()/3, steps, serialtime, pooltime, pool.threads() );
+}
+
+static void run()
+{
+	testDeterminism();
+}
+
+void test()
+{
+	String libname = "ode";
+
+	Debug::printf( "\n-------------------------------------------------------------------------\n" );
+	Debug::printf( "%s library test begin\n", libname.c_str() );
+	Debug::printf( "-------------------------------------------------------------------------\n" );
+	run();
+	Debug::printf( "%s library test ok\n", libname.c_str() );
+}
+
+
+END_NAMESPACE() // ode
+
+// Copyright (C) 2004-2006 Pixelgene Ltd. All rights reserved. Consult your license regarding permissions and restrictions.